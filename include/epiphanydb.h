@@ -56,6 +56,7 @@ typedef struct {
     bool enable_logging;
     bool enable_compression;
     EpiphanyDBStorageType default_storage_type;
+    size_t scan_cache_size;    /* bytes of decoded columnar data kept for repeated scans, 0 disables */
 } EpiphanyDBConfig;
 
 /* Core API functions */
@@ -70,6 +71,11 @@ EpiphanyDBError epiphanydb_init(EpiphanyDBContext **ctx, const EpiphanyDBConfig
  */
 void epiphanydb_cleanup(EpiphanyDBContext *ctx);
 
+/**
+ * Get the configuration context was initialized with
+ */
+const EpiphanyDBConfig *epiphanydb_get_config(const EpiphanyDBContext *ctx);
+
 /**
  * Get EpiphanyDB version string
  */
@@ -118,6 +124,16 @@ void epiphanydb_close_table(EpiphanyDBTable *table);
  */
 EpiphanyDBError epiphanydb_drop_table(EpiphanyDBContext *ctx, const char *table_name);
 
+/**
+ * Get storage engine specific handle attached to table
+ */
+void *epiphanydb_table_storage_handle(const EpiphanyDBTable *table);
+
+/**
+ * Attach storage engine specific handle to table
+ */
+void epiphanydb_table_set_storage_handle(EpiphanyDBTable *table, void *handle);
+
 /* Transaction management */
 
 /**
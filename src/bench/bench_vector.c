@@ -0,0 +1,492 @@
+/*
+ * EpiphanyDB Vector Benchmark
+ *
+ * Builds each vector index over one data set and sweeps its search
+ * parameter, printing one CSV row per setting with recall@k against the
+ * exact neighbors, queries per second, median and 99th percentile query
+ * latency, build time and index memory. Base and query vectors come from
+ * SIFT/GIST style fvecs or bvecs files, with optional ivecs ground truth,
+ * or from Gaussian clusters generated with a fixed seed.
+ *
+ * Tables are created under ./data/vector, one index at a time, and their
+ * files removed once swept.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "../../include/epiphanydb.h"
+#include "../storage/vector_storage.h"
+
+#define BENCH_MAX_SWEEP 16
+
+/* Index under test with the schema clause selecting it and its sweep */
+typedef struct BenchIndex {
+    const char *name;
+    const char *clause;
+    const char *parameter;          /* swept VectorTable field, NULL for none */
+    size_t values[BENCH_MAX_SWEEP];
+    size_t num_values;
+} BenchIndex;
+
+static const BenchIndex bench_indexes[] = {
+    {"flat", "FLAT", NULL, {0}, 1},
+    {"hnsw", "HNSW (M 16, EF_CONSTRUCTION 200)", "ef_search", {10, 20, 40, 80, 160, 320, 640}, 7},
+    {"ivfpq", "IVFPQ (RERANK 4)", "nprobe", {1, 2, 4, 8, 16, 32, 64, 128}, 8},
+    {"diskann", "DISKANN", "search_l", {10, 20, 40, 80, 160, 320}, 6}
+};
+
+typedef struct BenchOptions {
+    const char *base_file;
+    const char *query_file;
+    const char *groundtruth_file;
+    size_t count;                   /* base vectors, 0 for the whole file */
+    size_t num_queries;
+    size_t dimension;               /* of generated vectors */
+    size_t clusters;
+    size_t k;
+    const char *metric;
+    const char *indexes;            /* comma separated names, NULL for all */
+    uint64_t seed;
+} BenchOptions;
+
+static double bench_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static uint64_t bench_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/* Standard normal sample by the Box-Muller transform */
+static float bench_gaussian(uint64_t *state) {
+    double u = ((double)(bench_random(state) >> 11) + 1.0) / 9007199254740993.0;
+    double v = (double)(bench_random(state) >> 11) / 9007199254740992.0;
+    return (float)(sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v));
+}
+
+/*
+ * Read up to limit vectors, 0 for all, of an fvecs, bvecs or ivecs file:
+ * each vector is its int32 dimension followed by that many float32, uint8
+ * or int32 components. bvecs components are widened to floats; ivecs ones
+ * are stored as int32 into a buffer of the same size. available, when
+ * given, receives the number of vectors in the whole file.
+ */
+static int bench_read_vecs(const char *path, size_t limit, float **vectors, size_t *count, size_t *dimension, size_t *available) {
+    const char *suffix = strrchr(path, '.');
+    size_t component = suffix && strcmp(suffix, ".bvecs") == 0 ? 1 : 4;
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return EPIPHANYDB_ERROR_IO;
+    }
+
+    int32_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header <= 0) {
+        fprintf(stderr, "%s: bad vector header\n", path);
+        fclose(file);
+        return EPIPHANYDB_ERROR_IO;
+    }
+    size_t dim = (size_t)header;
+    size_t record = sizeof(int32_t) + dim * component;
+    fseek(file, 0, SEEK_END);
+    size_t n = (size_t)ftell(file) / record;
+    fseek(file, 0, SEEK_SET);
+    if (available) {
+        *available = n;
+    }
+    if (limit && limit < n) {
+        n = limit;
+    }
+
+    float *data = malloc(n * dim * sizeof(float));
+    uint8_t *bytes = malloc(dim * component);
+    int result = data && bytes ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    for (size_t i = 0; i < n && result == EPIPHANYDB_SUCCESS; i++) {
+        if (fread(&header, sizeof(header), 1, file) != 1 || (size_t)header != dim ||
+            fread(bytes, component, dim, file) != dim) {
+            fprintf(stderr, "%s: truncated at vector %zu\n", path, i);
+            result = EPIPHANYDB_ERROR_IO;
+        } else if (component == 1) {
+            for (size_t d = 0; d < dim; d++) {
+                data[i * dim + d] = (float)bytes[d];
+            }
+        } else {
+            memcpy(data + i * dim, bytes, dim * component);
+        }
+    }
+    free(bytes);
+    fclose(file);
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(data);
+        return result;
+    }
+    *vectors = data;
+    *count = n;
+    *dimension = dim;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Points scattered with unit variance around centers drawn with variance 4 */
+static float *bench_generate(size_t n, size_t dim, size_t clusters, const float *centers, uint64_t *state) {
+    float *data = malloc(n * dim * sizeof(float));
+    if (!data) {
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        const float *center = centers + (bench_random(state) % clusters) * dim;
+        for (size_t d = 0; d < dim; d++) {
+            data[i * dim + d] = center[d] + bench_gaussian(state);
+        }
+    }
+    return data;
+}
+
+static int bench_compare_latency(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static bool bench_selected(const BenchOptions *options, const char *name) {
+    if (!options->indexes) {
+        return true;
+    }
+    size_t length = strlen(name);
+    for (const char *p = options->indexes; *p;) {
+        const char *end = strchr(p, ',');
+        size_t token = end ? (size_t)(end - p) : strlen(p);
+        if (token == length && strncasecmp(p, name, length) == 0) {
+            return true;
+        }
+        p += token + (end ? 1 : 0);
+    }
+    return false;
+}
+
+/* Point the swept search parameter of table at value */
+static void bench_set_parameter(VectorTable *table, const BenchIndex *index, size_t value) {
+    if (!index->parameter) {
+        return;
+    }
+    if (strcmp(index->parameter, "ef_search") == 0) {
+        table->ef_search = value;
+    } else if (strcmp(index->parameter, "nprobe") == 0) {
+        table->ivf_nprobe = value;
+    } else {
+        table->diskann_search_l = value;
+    }
+}
+
+static size_t bench_index_memory(const VectorTable *table) {
+    size_t bytes = table->codes ? vector_codes_memory_usage(table->codes) : 0;
+    if (table->hnsw) {
+        bytes += vector_hnsw_memory_usage(table->hnsw);
+    }
+    if (table->ivfpq) {
+        bytes += vector_ivfpq_memory_usage(table->ivfpq);
+    }
+    if (table->diskann) {
+        bytes += vector_diskann_memory_usage(table->diskann);
+    }
+    return bytes;
+}
+
+/*
+ * Exact k nearest ids of every query, num_queries rows of k with
+ * UINT32_MAX past the end of short lists
+ */
+static uint32_t *bench_ground_truth(EpiphanyDBTable *table, const float *queries, size_t num_queries, size_t dim, size_t k) {
+    uint32_t *truth = malloc(num_queries * k * sizeof(uint32_t));
+    if (!truth) {
+        return NULL;
+    }
+    for (size_t q = 0; q < num_queries; q++) {
+        void *results = NULL;
+        size_t num_hits = 0;
+        if (vector_similarity_search_exact(table, queries + q * dim, dim, k, &results, &num_hits) != EPIPHANYDB_SUCCESS) {
+            num_hits = 0;
+        }
+        const VectorSearchResult *hits = results;
+        for (size_t i = 0; i < k; i++) {
+            truth[q * k + i] = i < num_hits ? (uint32_t)hits[i].id : UINT32_MAX;
+        }
+        free(results);
+    }
+    return truth;
+}
+
+/* Create, fill and index the table of one index, then sweep its parameter */
+static int bench_run_index(EpiphanyDBContext *ctx, const BenchIndex *index, const BenchOptions *options,
+                           const float *base, size_t n, const float *queries, size_t num_queries, size_t dim,
+                           uint32_t **truth) {
+    char name[64];
+    char schema[256];
+    snprintf(name, sizeof(name), "bench_%s", index->name);
+    snprintf(schema, sizeof(schema), "embedding VECTOR(%zu) METRIC %s %s", dim, options->metric, index->clause);
+
+    int result = vector_storage_init(ctx);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+    result = vector_create_table(ctx, name, schema);
+    EpiphanyDBTable *table = NULL;
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_open_table(ctx, name, &table);
+    }
+
+    VectorTable *vec_table = table ? vector_get_table(table) : NULL;
+    for (size_t i = 0; i < n && result == EPIPHANYDB_SUCCESS; i++) {
+        result = vector_insert_vector(table, base + i * dim, dim, NULL);
+    }
+
+    double build_start = bench_now();
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_build_index(table);
+    }
+    double build_seconds = bench_now() - build_start;
+    fprintf(stderr, "%s: built in %.2f s\n", index->name, build_seconds);
+
+    if (result == EPIPHANYDB_SUCCESS && !*truth) {
+        *truth = bench_ground_truth(table, queries, num_queries, dim, options->k);
+        result = *truth ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    double *latencies = malloc(num_queries * sizeof(double));
+    if (!latencies && result == EPIPHANYDB_SUCCESS) {
+        result = EPIPHANYDB_ERROR_MEMORY;
+    }
+    for (size_t s = 0; s < index->num_values && result == EPIPHANYDB_SUCCESS; s++) {
+        size_t value = index->values[s];
+        if (index->parameter && strcmp(index->parameter, "nprobe") == 0 && value > vec_table->ivf_nlist) {
+            break;
+        }
+        bench_set_parameter(vec_table, index, value);
+
+        size_t found = 0;
+        size_t expected = 0;
+        double sweep_start = bench_now();
+        for (size_t q = 0; q < num_queries && result == EPIPHANYDB_SUCCESS; q++) {
+            void *results = NULL;
+            size_t num_results = 0;
+            double query_start = bench_now();
+            result = vector_similarity_search(table, queries + q * dim, dim, options->k, &results, &num_results);
+            latencies[q] = bench_now() - query_start;
+
+            const uint32_t *exact = *truth + q * options->k;
+            const VectorSearchResult *hits = results;
+            for (size_t i = 0; i < options->k && exact[i] != UINT32_MAX; i++) {
+                expected++;
+                for (size_t j = 0; j < num_results; j++) {
+                    if (hits[j].id == exact[i]) {
+                        found++;
+                        break;
+                    }
+                }
+            }
+            free(results);
+        }
+        double sweep_seconds = bench_now() - sweep_start;
+        if (result != EPIPHANYDB_SUCCESS) {
+            break;
+        }
+
+        qsort(latencies, num_queries, sizeof(double), bench_compare_latency);
+        printf("%s,%s,%zu,%zu,%.4f,%.1f,%.1f,%.1f,%.3f,%zu\n", index->name,
+               index->parameter ? index->parameter : "", index->parameter ? value : 0, options->k,
+               expected ? (double)found / (double)expected : 0.0, (double)num_queries / sweep_seconds,
+               latencies[num_queries / 2] * 1e6, latencies[num_queries * 99 / 100] * 1e6, build_seconds,
+               bench_index_memory(vec_table));
+        fflush(stdout);
+    }
+    free(latencies);
+
+    /* Table files outlive the storage context, copy their paths first */
+    char *vector_file = vec_table ? strdup(vec_table->vector_file) : NULL;
+    char *metadata_file = vec_table ? strdup(vec_table->metadata_file) : NULL;
+    char *index_file = vec_table ? strdup(vec_table->index_file) : NULL;
+    if (table) {
+        vector_close_table(table);
+    }
+    vector_storage_cleanup(ctx);
+    char *files[] = {vector_file, metadata_file, index_file};
+    for (size_t i = 0; i < 3; i++) {
+        if (files[i]) {
+            unlink(files[i]);
+        }
+        free(files[i]);
+    }
+    if (result != EPIPHANYDB_SUCCESS) {
+        fprintf(stderr, "%s: %s\n", index->name, epiphanydb_error_message(result));
+    }
+    return result;
+}
+
+static void bench_usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --base FILE         base vectors, .fvecs or .bvecs (default: generated)\n"
+            "  --query FILE        query vectors in the format of the base\n"
+            "  --groundtruth FILE  .ivecs neighbor ids of the queries in the whole base file,\n"
+            "                      ignored when --count loads only part of it\n"
+            "  --count N           base vectors to load or generate (default 100000)\n"
+            "  --queries N         queries to run (default 1000)\n"
+            "  --dimension D       dimension of generated vectors (default 128)\n"
+            "  --clusters C        Gaussian clusters of generated vectors (default 100)\n"
+            "  --k K               neighbors per query for recall@k (default 10)\n"
+            "  --metric NAME       euclidean, cosine or manhattan (default euclidean)\n"
+            "  --indexes LIST      comma separated flat,hnsw,ivfpq,diskann (default all)\n"
+            "  --seed S            generator seed (default 42)\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options = {NULL, NULL, NULL, 100000, 1000, 128, 100, 10, "euclidean", NULL, 42};
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value || strncmp(arg, "--", 2) != 0) {
+            bench_usage(argv[0]);
+            return 1;
+        }
+        i++;
+        if (strcmp(arg, "--base") == 0) {
+            options.base_file = value;
+        } else if (strcmp(arg, "--query") == 0) {
+            options.query_file = value;
+        } else if (strcmp(arg, "--groundtruth") == 0) {
+            options.groundtruth_file = value;
+        } else if (strcmp(arg, "--count") == 0) {
+            options.count = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--queries") == 0) {
+            options.num_queries = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--dimension") == 0) {
+            options.dimension = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--clusters") == 0) {
+            options.clusters = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--k") == 0) {
+            options.k = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--metric") == 0) {
+            options.metric = value;
+        } else if (strcmp(arg, "--indexes") == 0) {
+            options.indexes = value;
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = strtoull(value, NULL, 10);
+        } else {
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.k == 0 || options.num_queries == 0 || options.dimension == 0 || options.clusters == 0 ||
+        (options.base_file && !options.query_file) || (options.groundtruth_file && !options.base_file)) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    float *base = NULL;
+    float *queries = NULL;
+    uint32_t *truth = NULL;
+    size_t n = 0;
+    size_t available = 0;
+    size_t num_queries = 0;
+    size_t dim = 0;
+    int result = EPIPHANYDB_SUCCESS;
+
+    if (options.base_file) {
+        size_t query_dim = 0;
+        result = bench_read_vecs(options.base_file, options.count, &base, &n, &dim, &available);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = bench_read_vecs(options.query_file, options.num_queries, &queries, &num_queries, &query_dim, NULL);
+        }
+        if (result == EPIPHANYDB_SUCCESS && query_dim != dim) {
+            fprintf(stderr, "query dimension %zu does not match base dimension %zu\n", query_dim, dim);
+            result = EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+    } else {
+        uint64_t state = options.seed * 0x9E3779B97F4A7C15ULL + 1;
+        n = options.count;
+        num_queries = options.num_queries;
+        dim = options.dimension;
+        float *centers = malloc(options.clusters * dim * sizeof(float));
+        if (centers) {
+            for (size_t i = 0; i < options.clusters * dim; i++) {
+                centers[i] = 2.0f * bench_gaussian(&state);
+            }
+            base = bench_generate(n, dim, options.clusters, centers, &state);
+            queries = bench_generate(num_queries, dim, options.clusters, centers, &state);
+        }
+        free(centers);
+        result = base && queries ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    /* Neighbors in the whole base file are not those in its first n vectors */
+    if (result == EPIPHANYDB_SUCCESS && options.groundtruth_file && n < available) {
+        fprintf(stderr, "%s is for all %zu base vectors, computing the neighbors among the first %zu instead\n",
+                options.groundtruth_file, available, n);
+        options.groundtruth_file = NULL;
+    }
+
+    /* ivecs ids are read as int32 into the float sized slots */
+    if (result == EPIPHANYDB_SUCCESS && options.groundtruth_file) {
+        float *ids = NULL;
+        size_t rows = 0;
+        size_t width = 0;
+        result = bench_read_vecs(options.groundtruth_file, num_queries, &ids, &rows, &width, NULL);
+        if (result == EPIPHANYDB_SUCCESS && (rows < num_queries || width < options.k)) {
+            fprintf(stderr, "ground truth holds %zu ids for %zu queries, need %zu for %zu\n", width, rows,
+                    options.k, num_queries);
+            result = EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        if (result == EPIPHANYDB_SUCCESS) {
+            truth = malloc(num_queries * options.k * sizeof(uint32_t));
+            result = truth ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+        }
+        for (size_t q = 0; q < num_queries && result == EPIPHANYDB_SUCCESS; q++) {
+            const int32_t *row = (const int32_t *)(ids + q * width);
+            for (size_t i = 0; i < options.k && result == EPIPHANYDB_SUCCESS; i++) {
+                if (row[i] < 0 || (size_t)row[i] >= n) {
+                    fprintf(stderr, "%s: id %d of query %zu is not a base vector\n", options.groundtruth_file, row[i], q);
+                    result = EPIPHANYDB_ERROR_INVALID_PARAM;
+                } else {
+                    truth[q * options.k + i] = (uint32_t)row[i];
+                }
+            }
+        }
+        free(ids);
+    }
+
+    EpiphanyDBContext *ctx = NULL;
+    EpiphanyDBConfig config = {0};
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = epiphanydb_init(&ctx, &config);
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        fprintf(stderr, "%zu base vectors, %zu queries, dimension %zu, k %zu\n", n, num_queries, dim, options.k);
+        printf("index,parameter,value,k,recall,qps,p50_us,p99_us,build_s,index_bytes\n");
+    }
+    for (size_t i = 0; i < sizeof(bench_indexes) / sizeof(bench_indexes[0]) && result == EPIPHANYDB_SUCCESS; i++) {
+        if (bench_selected(&options, bench_indexes[i].name)) {
+            result = bench_run_index(ctx, &bench_indexes[i], &options, base, n, queries, num_queries, dim, &truth);
+        }
+    }
+
+    if (ctx) {
+        epiphanydb_cleanup(ctx);
+    }
+    free(truth);
+    free(queries);
+    free(base);
+    return result == EPIPHANYDB_SUCCESS ? 0 : 1;
+}
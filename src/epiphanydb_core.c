@@ -5,6 +5,7 @@
  */
 
 #include "../include/epiphanydb.h"
+#include "storage/columnar_storage.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -144,6 +145,15 @@ void epiphanydb_cleanup(EpiphanyDBContext *ctx)
     free(ctx);
 }
 
+const EpiphanyDBConfig *epiphanydb_get_config(const EpiphanyDBContext *ctx)
+{
+    if (!ctx) {
+        return NULL;
+    }
+
+    return &ctx->config;
+}
+
 const char *epiphanydb_version(void)
 {
     return EPIPHANYDB_VERSION_STRING;
@@ -264,6 +274,24 @@ EpiphanyDBError epiphanydb_drop_table(EpiphanyDBContext *ctx, const char *table_
     return EPIPHANYDB_SUCCESS;
 }
 
+void *epiphanydb_table_storage_handle(const EpiphanyDBTable *table)
+{
+    if (!table) {
+        return NULL;
+    }
+
+    return table->storage_handle;
+}
+
+void epiphanydb_table_set_storage_handle(EpiphanyDBTable *table, void *handle)
+{
+    if (!table) {
+        return;
+    }
+
+    table->storage_handle = handle;
+}
+
 /* Transaction management implementation */
 
 EpiphanyDBError epiphanydb_begin_transaction(EpiphanyDBContext *ctx,
@@ -416,7 +444,11 @@ EpiphanyDBError epiphanydb_get_table_stats(EpiphanyDBTable *table,
         return EPIPHANYDB_ERROR_INVALID_PARAM;
     }
 
-    /* TODO: Implement statistics gathering */
+    if (table->storage_type == EPIPHANYDB_STORAGE_COLUMNAR && table->storage_handle) {
+        return columnar_table_stats(table, num_rows, table_size);
+    }
+
+    /* TODO: Implement statistics gathering for the other engines */
     *num_rows = 0;
     *table_size = 0;
     
@@ -439,6 +471,10 @@ EpiphanyDBError epiphanydb_analyze_table(EpiphanyDBTable *table)
         return EPIPHANYDB_ERROR_INVALID_PARAM;
     }
 
-    /* TODO: Implement analyze logic */
+    if (table->storage_type == EPIPHANYDB_STORAGE_COLUMNAR && table->storage_handle) {
+        return columnar_analyze_table(table);
+    }
+
+    /* TODO: Implement analyze logic for the other engines */
     return EPIPHANYDB_SUCCESS;
 }
\ No newline at end of file
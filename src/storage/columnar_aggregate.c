@@ -0,0 +1,1069 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Vectorized aggregation over column batches: SIMD kernels for ungrouped
+ * SUM/COUNT/MIN/MAX/AVG, a linear probing hash aggregation for GROUP BY and
+ * a metadata-only path answering COUNT/MIN/MAX from zone maps.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <float.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define COLUMNAR_HAVE_AVX2_KERNELS 1
+#endif
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+/* Running state of one aggregate for one group */
+typedef struct ColumnarAccumulator {
+    int64_t count;
+    uint64_t isum;         /* wraps around, as the SIMD kernels do */
+    double dsum;
+    bool has_value;
+    ColumnarDatum min;     /* TEXT bounds are owned copies */
+    ColumnarDatum max;
+} ColumnarAccumulator;
+
+/* Aggregation operator fed one batch at a time */
+typedef struct ColumnarAggregator {
+    const ColumnarTable *table;
+    size_t num_aggregates;
+    ColumnarAggFunc *funcs;
+    int *columns;
+    int group_column;       /* -1 without GROUP BY */
+
+    ColumnarAccumulator *accumulators;  /* num_groups * num_aggregates */
+    size_t num_groups;
+    size_t groups_capacity;
+    ColumnarDatum *group_keys;
+    bool *group_key_nulls;
+    uint64_t *group_hashes;
+    int64_t null_group;     /* group index of the NULL key, -1 if none yet */
+
+    uint64_t *slots;        /* hash tag << 32 | (group index + 1), 0 when empty */
+    size_t num_slots;
+
+    uint64_t *batch_hashes;
+    uint32_t *batch_groups;
+} ColumnarAggregator;
+
+/* Dense kernels */
+
+typedef uint64_t (*ColumnarSumInt64Fn)(const int64_t *values, size_t n);
+typedef double (*ColumnarSumDoubleFn)(const double *values, size_t n);
+typedef void (*ColumnarMinMaxInt64Fn)(const int64_t *values, size_t n, int64_t *min, int64_t *max);
+typedef void (*ColumnarMinMaxDoubleFn)(const double *values, size_t n, double *min, double *max);
+
+static uint64_t columnar_sum_int64_scalar(const int64_t *values, size_t n) {
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        s0 += (uint64_t)values[i];
+        s1 += (uint64_t)values[i + 1];
+        s2 += (uint64_t)values[i + 2];
+        s3 += (uint64_t)values[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += (uint64_t)values[i];
+    }
+    return s0 + s1 + s2 + s3;
+}
+
+static double columnar_sum_double_scalar(const double *values, size_t n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        s0 += values[i];
+        s1 += values[i + 1];
+        s2 += values[i + 2];
+        s3 += values[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += values[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+static void columnar_minmax_int64_scalar(const int64_t *values, size_t n, int64_t *min, int64_t *max) {
+    int64_t lo = *min;
+    int64_t hi = *max;
+
+    for (size_t i = 0; i < n; i++) {
+        lo = values[i] < lo ? values[i] : lo;
+        hi = values[i] > hi ? values[i] : hi;
+    }
+    *min = lo;
+    *max = hi;
+}
+
+static void columnar_minmax_double_scalar(const double *values, size_t n, double *min, double *max) {
+    double lo = *min;
+    double hi = *max;
+
+    for (size_t i = 0; i < n; i++) {
+        lo = values[i] < lo ? values[i] : lo;
+        hi = values[i] > hi ? values[i] : hi;
+    }
+    *min = lo;
+    *max = hi;
+}
+
+#ifdef COLUMNAR_HAVE_AVX2_KERNELS
+
+__attribute__((target("avx2")))
+static uint64_t columnar_sum_int64_avx2(const int64_t *values, size_t n) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    uint64_t lanes[4];
+
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256((const __m256i *)(values + i)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256((const __m256i *)(values + i + 4)));
+    }
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+
+    uint64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++) {
+        sum += (uint64_t)values[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static double columnar_sum_double_avx2(const double *values, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    size_t i = 0;
+    double lanes[4];
+
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(values + i + 4));
+        acc2 = _mm256_add_pd(acc2, _mm256_loadu_pd(values + i + 8));
+        acc3 = _mm256_add_pd(acc3, _mm256_loadu_pd(values + i + 12));
+    }
+    _mm256_storeu_pd(lanes, _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static void columnar_minmax_int64_avx2(const int64_t *values, size_t n, int64_t *min, int64_t *max) {
+    __m256i lo = _mm256_set1_epi64x(*min);
+    __m256i hi = _mm256_set1_epi64x(*max);
+    size_t i = 0;
+    int64_t lo_lanes[4];
+    int64_t hi_lanes[4];
+
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+        lo = _mm256_blendv_epi8(lo, v, _mm256_cmpgt_epi64(lo, v));
+        hi = _mm256_blendv_epi8(hi, v, _mm256_cmpgt_epi64(v, hi));
+    }
+    _mm256_storeu_si256((__m256i *)lo_lanes, lo);
+    _mm256_storeu_si256((__m256i *)hi_lanes, hi);
+
+    int64_t min_value = *min;
+    int64_t max_value = *max;
+    for (int lane = 0; lane < 4; lane++) {
+        min_value = lo_lanes[lane] < min_value ? lo_lanes[lane] : min_value;
+        max_value = hi_lanes[lane] > max_value ? hi_lanes[lane] : max_value;
+    }
+    *min = min_value;
+    *max = max_value;
+    columnar_minmax_int64_scalar(values + i, n - i, min, max);
+}
+
+__attribute__((target("avx2")))
+static void columnar_minmax_double_avx2(const double *values, size_t n, double *min, double *max) {
+    __m256d lo = _mm256_set1_pd(*min);
+    __m256d hi = _mm256_set1_pd(*max);
+    size_t i = 0;
+    double lo_lanes[4];
+    double hi_lanes[4];
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(values + i);
+        lo = _mm256_min_pd(lo, v);
+        hi = _mm256_max_pd(hi, v);
+    }
+    _mm256_storeu_pd(lo_lanes, lo);
+    _mm256_storeu_pd(hi_lanes, hi);
+
+    double min_value = *min;
+    double max_value = *max;
+    for (int lane = 0; lane < 4; lane++) {
+        min_value = lo_lanes[lane] < min_value ? lo_lanes[lane] : min_value;
+        max_value = hi_lanes[lane] > max_value ? hi_lanes[lane] : max_value;
+    }
+    *min = min_value;
+    *max = max_value;
+    columnar_minmax_double_scalar(values + i, n - i, min, max);
+}
+
+#endif /* COLUMNAR_HAVE_AVX2_KERNELS */
+
+static ColumnarSumInt64Fn columnar_sum_int64 = columnar_sum_int64_scalar;
+static ColumnarSumDoubleFn columnar_sum_double = columnar_sum_double_scalar;
+static ColumnarMinMaxInt64Fn columnar_minmax_int64 = columnar_minmax_int64_scalar;
+static ColumnarMinMaxDoubleFn columnar_minmax_double = columnar_minmax_double_scalar;
+
+/* Pick the widest kernels the CPU supports */
+static void columnar_init_kernels(void) {
+#ifdef COLUMNAR_HAVE_AVX2_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        columnar_sum_int64 = columnar_sum_int64_avx2;
+        columnar_sum_double = columnar_sum_double_avx2;
+        columnar_minmax_int64 = columnar_minmax_int64_avx2;
+        columnar_minmax_double = columnar_minmax_double_avx2;
+    }
+#endif
+}
+
+static void columnar_select_kernels(void) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+    pthread_once(&once, columnar_init_kernels);
+}
+
+/* Accumulator updates */
+
+static int columnar_accumulate_text(ColumnarAccumulator *acc, const char *value) {
+    if (!acc->has_value || strcmp(value, acc->min.text) < 0) {
+        char *copy = strdup(value);
+        if (!copy) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        if (acc->has_value) {
+            free((char *)acc->min.text);
+        }
+        acc->min.text = copy;
+    }
+    if (!acc->has_value || strcmp(value, acc->max.text) > 0) {
+        char *copy = strdup(value);
+        if (!copy) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        if (acc->has_value) {
+            free((char *)acc->max.text);
+        }
+        acc->max.text = copy;
+    }
+    acc->has_value = true;
+    return EPIPHANYDB_SUCCESS;
+}
+
+static size_t columnar_count_nulls(const uint8_t *nulls, size_t n) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        count += nulls[i];
+    }
+    return count;
+}
+
+/* Fold a whole batch into a single accumulator */
+static int columnar_accumulate_batch(ColumnarAccumulator *acc, ColumnarAggFunc func, int type, const ColumnarBatch *batch, int column) {
+    const uint16_t *sel = batch->selection;
+    size_t n = batch->num_selected;
+
+    if (func == COLUMNAR_AGG_COUNT_STAR) {
+        acc->count += (int64_t)n;
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    const void *values = batch->values[column];
+    const uint8_t *nulls = batch->nulls[column];
+
+    /* Dense windows use the SIMD kernels; NULL rows hold 0 so sums are unaffected */
+    bool dense = !sel && (func == COLUMNAR_AGG_COUNT ||
+                          (type != COLUMNAR_TYPE_TEXT && (!nulls || func == COLUMNAR_AGG_SUM || func == COLUMNAR_AGG_AVG)));
+    if (dense) {
+        size_t valid = n - (nulls ? columnar_count_nulls(nulls, n) : 0);
+        acc->count += (int64_t)valid;
+
+        switch (func) {
+            case COLUMNAR_AGG_SUM:
+            case COLUMNAR_AGG_AVG:
+                if (type == COLUMNAR_TYPE_INT64) {
+                    acc->isum += columnar_sum_int64(values, n);
+                } else {
+                    acc->dsum += columnar_sum_double(values, n);
+                }
+                acc->has_value |= valid > 0;
+                return EPIPHANYDB_SUCCESS;
+            case COLUMNAR_AGG_MIN:
+            case COLUMNAR_AGG_MAX:
+                if (n == 0) {
+                    return EPIPHANYDB_SUCCESS;
+                }
+                if (type == COLUMNAR_TYPE_INT64) {
+                    if (!acc->has_value) {
+                        acc->min.i64 = INT64_MAX;
+                        acc->max.i64 = INT64_MIN;
+                    }
+                    columnar_minmax_int64(values, n, &acc->min.i64, &acc->max.i64);
+                } else {
+                    if (!acc->has_value) {
+                        acc->min.f64 = DBL_MAX;
+                        acc->max.f64 = -DBL_MAX;
+                    }
+                    columnar_minmax_double(values, n, &acc->min.f64, &acc->max.f64);
+                }
+                acc->has_value = true;
+                return EPIPHANYDB_SUCCESS;
+            default:
+                return EPIPHANYDB_SUCCESS;
+        }
+    }
+
+    /* Sparse selections and NULL-bearing MIN/MAX take the row loop */
+    for (size_t i = 0; i < n; i++) {
+        size_t row = sel ? sel[i] : i;
+        if (nulls && nulls[row]) {
+            continue;
+        }
+        acc->count++;
+        switch (type) {
+            case COLUMNAR_TYPE_INT64: {
+                int64_t v = ((const int64_t *)values)[row];
+                acc->isum += (uint64_t)v;
+                if (!acc->has_value || v < acc->min.i64) {
+                    acc->min.i64 = v;
+                }
+                if (!acc->has_value || v > acc->max.i64) {
+                    acc->max.i64 = v;
+                }
+                acc->has_value = true;
+                break;
+            }
+            case COLUMNAR_TYPE_DOUBLE: {
+                double v = ((const double *)values)[row];
+                acc->dsum += v;
+                if (!acc->has_value || v < acc->min.f64) {
+                    acc->min.f64 = v;
+                }
+                if (!acc->has_value || v > acc->max.f64) {
+                    acc->max.f64 = v;
+                }
+                acc->has_value = true;
+                break;
+            }
+            default:
+                if (func == COLUMNAR_AGG_MIN || func == COLUMNAR_AGG_MAX) {
+                    int result = columnar_accumulate_text(acc, ((char *const *)values)[row]);
+                    if (result != EPIPHANYDB_SUCCESS) {
+                        return result;
+                    }
+                }
+                break;
+        }
+    }
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Hash aggregation */
+
+static bool columnar_key_equal(int type, ColumnarDatum a, ColumnarDatum b) {
+    switch (type) {
+        case COLUMNAR_TYPE_INT64:
+            return a.i64 == b.i64;
+        case COLUMNAR_TYPE_DOUBLE:
+            return a.f64 == b.f64;
+        default:
+            return strcmp(a.text, b.text) == 0;
+    }
+}
+
+/* Append a new group and return its index, or -1 on allocation failure */
+static int64_t columnar_add_group(ColumnarAggregator *agg, ColumnarDatum key, bool is_null, uint64_t hash) {
+    int type = agg->table->column_types[agg->group_column];
+
+    if (agg->num_groups == agg->groups_capacity) {
+        size_t capacity = agg->groups_capacity ? agg->groups_capacity * 2 : 64;
+        ColumnarDatum *keys = realloc(agg->group_keys, capacity * sizeof(ColumnarDatum));
+        if (keys) {
+            agg->group_keys = keys;
+        }
+        bool *key_nulls = realloc(agg->group_key_nulls, capacity * sizeof(bool));
+        if (key_nulls) {
+            agg->group_key_nulls = key_nulls;
+        }
+        uint64_t *hashes = realloc(agg->group_hashes, capacity * sizeof(uint64_t));
+        if (hashes) {
+            agg->group_hashes = hashes;
+        }
+        ColumnarAccumulator *accs = realloc(agg->accumulators, capacity * agg->num_aggregates * sizeof(ColumnarAccumulator));
+        if (accs) {
+            agg->accumulators = accs;
+        }
+        if (!keys || !key_nulls || !hashes || !accs) {
+            return -1;
+        }
+        agg->groups_capacity = capacity;
+    }
+
+    size_t group = agg->num_groups;
+    if (!is_null && type == COLUMNAR_TYPE_TEXT) {
+        key.text = strdup(key.text);
+        if (!key.text) {
+            return -1;
+        }
+    }
+    agg->group_keys[group] = key;
+    agg->group_key_nulls[group] = is_null;
+    agg->group_hashes[group] = hash;
+    memset(&agg->accumulators[group * agg->num_aggregates], 0, agg->num_aggregates * sizeof(ColumnarAccumulator));
+    agg->num_groups++;
+
+    return (int64_t)group;
+}
+
+static int columnar_grow_slots(ColumnarAggregator *agg) {
+    size_t num_slots = agg->num_slots ? agg->num_slots * 2 : 1024;
+    uint64_t *slots = calloc(num_slots, sizeof(uint64_t));
+    if (!slots) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    for (size_t g = 0; g < agg->num_groups; g++) {
+        if (agg->group_key_nulls[g]) {
+            continue;
+        }
+        uint64_t hash = agg->group_hashes[g];
+        size_t slot = hash & (num_slots - 1);
+        while (slots[slot]) {
+            slot = (slot + 1) & (num_slots - 1);
+        }
+        slots[slot] = (hash >> 32) << 32 | (uint64_t)(g + 1);
+    }
+
+    free(agg->slots);
+    agg->slots = slots;
+    agg->num_slots = num_slots;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Hash the group keys of a batch in one pass before probing */
+static void columnar_hash_keys(const ColumnarAggregator *agg, const ColumnarBatch *batch) {
+    int column = agg->group_column;
+    const void *values = batch->values[column];
+    const uint16_t *sel = batch->selection;
+    size_t n = batch->num_selected;
+
+    switch (agg->table->column_types[column]) {
+        case COLUMNAR_TYPE_INT64:
+            for (size_t i = 0; i < n; i++) {
+                size_t row = sel ? sel[i] : i;
+                agg->batch_hashes[i] = columnar_hash_int64((uint64_t)((const int64_t *)values)[row]);
+            }
+            break;
+        case COLUMNAR_TYPE_DOUBLE:
+            for (size_t i = 0; i < n; i++) {
+                size_t row = sel ? sel[i] : i;
+                agg->batch_hashes[i] = columnar_hash_double(((const double *)values)[row]);
+            }
+            break;
+        default:
+            for (size_t i = 0; i < n; i++) {
+                size_t row = sel ? sel[i] : i;
+                const char *text = ((char *const *)values)[row];
+                agg->batch_hashes[i] = text ? columnar_hash_bytes(text, strlen(text)) : 0;
+            }
+            break;
+    }
+}
+
+/* Find the group of a non-NULL key, adding it when new; -1 on allocation failure */
+static int64_t columnar_probe_group(ColumnarAggregator *agg, int type, ColumnarDatum key, uint64_t hash) {
+    /* Keep the load factor at or below one half */
+    if ((agg->num_groups + 1) * 2 > agg->num_slots) {
+        if (columnar_grow_slots(agg) != EPIPHANYDB_SUCCESS) {
+            return -1;
+        }
+    }
+
+    uint64_t tag = hash >> 32;
+    size_t mask = agg->num_slots - 1;
+    size_t slot = hash & mask;
+
+    for (;;) {
+        uint64_t entry = agg->slots[slot];
+        if (!entry) {
+            int64_t group = columnar_add_group(agg, key, false, hash);
+            if (group >= 0) {
+                agg->slots[slot] = tag << 32 | (uint64_t)(group + 1);
+            }
+            return group;
+        }
+        if ((entry >> 32) == tag) {
+            size_t group = (size_t)(entry & 0xffffffffULL) - 1;
+            if (columnar_key_equal(type, agg->group_keys[group], key)) {
+                return (int64_t)group;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+/* Group of the NULL key, adding it when new; -1 on allocation failure */
+static int64_t columnar_null_group(ColumnarAggregator *agg) {
+    if (agg->null_group < 0) {
+        ColumnarDatum key;
+        memset(&key, 0, sizeof(key));
+        agg->null_group = columnar_add_group(agg, key, true, 0);
+    }
+    return agg->null_group;
+}
+
+/* Resolve the group of every selected row of a batch */
+static int columnar_lookup_groups(ColumnarAggregator *agg, const ColumnarBatch *batch) {
+    int column = agg->group_column;
+    int type = agg->table->column_types[column];
+    const void *values = batch->values[column];
+    const uint8_t *nulls = batch->nulls[column];
+    const uint16_t *sel = batch->selection;
+
+    columnar_hash_keys(agg, batch);
+
+    for (size_t i = 0; i < batch->num_selected; i++) {
+        size_t row = sel ? sel[i] : i;
+        ColumnarDatum key;
+        int64_t group;
+
+        if (nulls && nulls[row]) {
+            group = columnar_null_group(agg);
+        } else {
+            switch (type) {
+                case COLUMNAR_TYPE_INT64:
+                    key.i64 = ((const int64_t *)values)[row];
+                    break;
+                case COLUMNAR_TYPE_DOUBLE:
+                    key.f64 = ((const double *)values)[row];
+                    break;
+                default:
+                    key.text = ((char *const *)values)[row];
+                    break;
+            }
+            group = columnar_probe_group(agg, type, key, agg->batch_hashes[i]);
+        }
+        if (group < 0) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        agg->batch_groups[i] = (uint32_t)group;
+    }
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Update one aggregate column-at-a-time using the resolved group ids */
+static int columnar_accumulate_grouped(ColumnarAggregator *agg, size_t a, const ColumnarBatch *batch) {
+    ColumnarAggFunc func = agg->funcs[a];
+    size_t stride = agg->num_aggregates;
+    ColumnarAccumulator *accs = agg->accumulators + a;
+    const uint32_t *groups = agg->batch_groups;
+    const uint16_t *sel = batch->selection;
+    size_t n = batch->num_selected;
+
+    if (func == COLUMNAR_AGG_COUNT_STAR) {
+        for (size_t i = 0; i < n; i++) {
+            accs[groups[i] * stride].count++;
+        }
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    int column = agg->columns[a];
+    const void *values = batch->values[column];
+    const uint8_t *nulls = batch->nulls[column];
+    int type = agg->table->column_types[column];
+
+    for (size_t i = 0; i < n; i++) {
+        size_t row = sel ? sel[i] : i;
+        ColumnarAccumulator *acc = &accs[groups[i] * stride];
+
+        if (nulls && nulls[row]) {
+            continue;
+        }
+        acc->count++;
+        switch (type) {
+            case COLUMNAR_TYPE_INT64: {
+                int64_t v = ((const int64_t *)values)[row];
+                acc->isum += (uint64_t)v;
+                if (!acc->has_value || v < acc->min.i64) {
+                    acc->min.i64 = v;
+                }
+                if (!acc->has_value || v > acc->max.i64) {
+                    acc->max.i64 = v;
+                }
+                acc->has_value = true;
+                break;
+            }
+            case COLUMNAR_TYPE_DOUBLE: {
+                double v = ((const double *)values)[row];
+                acc->dsum += v;
+                if (!acc->has_value || v < acc->min.f64) {
+                    acc->min.f64 = v;
+                }
+                if (!acc->has_value || v > acc->max.f64) {
+                    acc->max.f64 = v;
+                }
+                acc->has_value = true;
+                break;
+            }
+            default:
+                if (func == COLUMNAR_AGG_MIN || func == COLUMNAR_AGG_MAX) {
+                    int result = columnar_accumulate_text(acc, ((char *const *)values)[row]);
+                    if (result != EPIPHANYDB_SUCCESS) {
+                        return result;
+                    }
+                }
+                break;
+        }
+    }
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Operator lifecycle */
+
+static void columnar_aggregator_free(ColumnarAggregator *agg) {
+    if (!agg) {
+        return;
+    }
+
+    for (size_t g = 0; g < agg->num_groups; g++) {
+        for (size_t a = 0; a < agg->num_aggregates; a++) {
+            ColumnarAccumulator *acc = &agg->accumulators[g * agg->num_aggregates + a];
+            if (agg->columns[a] >= 0 && agg->table->column_types[agg->columns[a]] == COLUMNAR_TYPE_TEXT && acc->has_value) {
+                free((char *)acc->min.text);
+                free((char *)acc->max.text);
+            }
+        }
+        if (agg->group_keys && agg->table->column_types[agg->group_column] == COLUMNAR_TYPE_TEXT && !agg->group_key_nulls[g]) {
+            free((char *)agg->group_keys[g].text);
+        }
+    }
+    free(agg->funcs);
+    free(agg->columns);
+    free(agg->accumulators);
+    free(agg->group_keys);
+    free(agg->group_key_nulls);
+    free(agg->group_hashes);
+    free(agg->slots);
+    free(agg->batch_hashes);
+    free(agg->batch_groups);
+    free(agg);
+}
+
+static int columnar_aggregator_create(const ColumnarTable *table, const char *group_by, const ColumnarAggSpec *aggregates, size_t num_aggregates, ColumnarAggregator **out) {
+    ColumnarAggregator *agg = calloc(1, sizeof(ColumnarAggregator));
+    if (!agg) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    agg->table = table;
+    agg->num_aggregates = num_aggregates;
+    agg->null_group = -1;
+    agg->group_column = -1;
+    agg->funcs = malloc(num_aggregates * sizeof(ColumnarAggFunc));
+    agg->columns = malloc(num_aggregates * sizeof(int));
+    if (!agg->funcs || !agg->columns) {
+        columnar_aggregator_free(agg);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    for (size_t a = 0; a < num_aggregates; a++) {
+        agg->funcs[a] = aggregates[a].func;
+        agg->columns[a] = -1;
+        if (aggregates[a].func == COLUMNAR_AGG_COUNT_STAR) {
+            continue;
+        }
+        if (!aggregates[a].column) {
+            columnar_aggregator_free(agg);
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        agg->columns[a] = columnar_find_column(table, aggregates[a].column);
+        if (agg->columns[a] < 0) {
+            columnar_aggregator_free(agg);
+            return EPIPHANYDB_ERROR_NOT_FOUND;
+        }
+        if ((aggregates[a].func == COLUMNAR_AGG_SUM || aggregates[a].func == COLUMNAR_AGG_AVG) &&
+            table->column_types[agg->columns[a]] == COLUMNAR_TYPE_TEXT) {
+            columnar_aggregator_free(agg);
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+    }
+
+    if (group_by) {
+        agg->group_column = columnar_find_column(table, group_by);
+        if (agg->group_column < 0) {
+            columnar_aggregator_free(agg);
+            return EPIPHANYDB_ERROR_NOT_FOUND;
+        }
+        agg->batch_hashes = malloc(COLUMNAR_BATCH_SIZE * sizeof(uint64_t));
+        agg->batch_groups = malloc(COLUMNAR_BATCH_SIZE * sizeof(uint32_t));
+        if (!agg->batch_hashes || !agg->batch_groups || columnar_grow_slots(agg) != EPIPHANYDB_SUCCESS) {
+            columnar_aggregator_free(agg);
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+    } else {
+        /* Ungrouped aggregation always produces exactly one row */
+        agg->accumulators = calloc(num_aggregates, sizeof(ColumnarAccumulator));
+        if (!agg->accumulators) {
+            columnar_aggregator_free(agg);
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        agg->num_groups = 1;
+        agg->groups_capacity = 1;
+    }
+
+    *out = agg;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Feed one batch of qualifying rows to the operator */
+static int columnar_aggregator_consume(ColumnarAggregator *agg, const ColumnarBatch *batch) {
+    int result;
+
+    if (agg->group_column < 0) {
+        for (size_t a = 0; a < agg->num_aggregates; a++) {
+            int type = agg->columns[a] >= 0 ? agg->table->column_types[agg->columns[a]] : COLUMNAR_TYPE_INT64;
+            result = columnar_accumulate_batch(&agg->accumulators[a], agg->funcs[a], type, batch, agg->columns[a]);
+            if (result != EPIPHANYDB_SUCCESS) {
+                return result;
+            }
+        }
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    result = columnar_lookup_groups(agg, batch);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+    for (size_t a = 0; a < agg->num_aggregates; a++) {
+        result = columnar_accumulate_grouped(agg, a, batch);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Fold the partial state of src into dst */
+static int columnar_merge_accumulator(ColumnarAccumulator *dst, const ColumnarAccumulator *src, int type) {
+    dst->count += src->count;
+    dst->isum += src->isum;
+    dst->dsum += src->dsum;
+    if (!src->has_value) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    if (type == COLUMNAR_TYPE_TEXT) {
+        int result = columnar_accumulate_text(dst, src->min.text);
+        return result == EPIPHANYDB_SUCCESS ? columnar_accumulate_text(dst, src->max.text) : result;
+    }
+    if (!dst->has_value || columnar_compare_datum(type, src->min, dst->min) < 0) {
+        dst->min = src->min;
+    }
+    if (!dst->has_value || columnar_compare_datum(type, src->max, dst->max) > 0) {
+        dst->max = src->max;
+    }
+    dst->has_value = true;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Merge the groups of a parallel worker's aggregator into dst */
+static int columnar_aggregator_merge(ColumnarAggregator *dst, const ColumnarAggregator *src) {
+    int key_type = dst->group_column >= 0 ? dst->table->column_types[dst->group_column] : COLUMNAR_TYPE_INT64;
+
+    for (size_t g = 0; g < src->num_groups; g++) {
+        int64_t group = 0;
+
+        if (dst->group_column >= 0) {
+            group = src->group_key_nulls[g] ? columnar_null_group(dst) :
+                    columnar_probe_group(dst, key_type, src->group_keys[g], src->group_hashes[g]);
+            if (group < 0) {
+                return EPIPHANYDB_ERROR_MEMORY;
+            }
+        }
+
+        for (size_t a = 0; a < dst->num_aggregates; a++) {
+            int type = dst->columns[a] >= 0 ? dst->table->column_types[dst->columns[a]] : COLUMNAR_TYPE_INT64;
+            int result = columnar_merge_accumulator(&dst->accumulators[(size_t)group * dst->num_aggregates + a],
+                                                    &src->accumulators[g * src->num_aggregates + a], type);
+            if (result != EPIPHANYDB_SUCCESS) {
+                return result;
+            }
+        }
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+static int columnar_aggregate_batch(void *state, const ColumnarBatch *batch) {
+    return columnar_aggregator_consume(state, batch);
+}
+
+/* Turn the accumulators into result values */
+static int columnar_aggregator_finish(ColumnarAggregator *agg, ColumnarAggResult **out) {
+    ColumnarAggResult *result = calloc(1, sizeof(ColumnarAggResult));
+    if (!result) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    result->grouped = agg->group_column >= 0;
+    result->num_groups = agg->num_groups;
+    result->num_aggregates = agg->num_aggregates;
+    result->values = calloc(agg->num_groups * agg->num_aggregates + 1, sizeof(ColumnarAggValue));
+    if (!result->values) {
+        free(result);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    if (result->grouped) {
+        result->group_type = agg->table->column_types[agg->group_column];
+        /* Ownership of the keys moves to the result */
+        result->group_keys = agg->group_keys;
+        result->group_key_nulls = agg->group_key_nulls;
+        agg->group_keys = NULL;
+        agg->group_key_nulls = NULL;
+    }
+
+    for (size_t g = 0; g < agg->num_groups; g++) {
+        for (size_t a = 0; a < agg->num_aggregates; a++) {
+            ColumnarAccumulator *acc = &agg->accumulators[g * agg->num_aggregates + a];
+            ColumnarAggValue *value = &result->values[g * agg->num_aggregates + a];
+            int type = agg->columns[a] >= 0 ? agg->table->column_types[agg->columns[a]] : COLUMNAR_TYPE_INT64;
+
+            switch (agg->funcs[a]) {
+                case COLUMNAR_AGG_COUNT_STAR:
+                case COLUMNAR_AGG_COUNT:
+                    value->type = COLUMNAR_TYPE_INT64;
+                    value->value.i64 = acc->count;
+                    break;
+                case COLUMNAR_AGG_SUM:
+                    value->type = type;
+                    value->is_null = acc->count == 0;
+                    if (type == COLUMNAR_TYPE_INT64) {
+                        value->value.i64 = (int64_t)acc->isum;
+                    } else {
+                        value->value.f64 = acc->dsum;
+                    }
+                    break;
+                case COLUMNAR_AGG_AVG:
+                    value->type = COLUMNAR_TYPE_DOUBLE;
+                    value->is_null = acc->count == 0;
+                    if (acc->count > 0) {
+                        double sum = type == COLUMNAR_TYPE_INT64 ? (double)(int64_t)acc->isum : acc->dsum;
+                        value->value.f64 = sum / (double)acc->count;
+                    }
+                    break;
+                case COLUMNAR_AGG_MIN:
+                case COLUMNAR_AGG_MAX:
+                    value->type = type;
+                    value->is_null = !acc->has_value;
+                    if (acc->has_value) {
+                        ColumnarDatum datum = agg->funcs[a] == COLUMNAR_AGG_MIN ? acc->min : acc->max;
+                        if (type == COLUMNAR_TYPE_TEXT) {
+                            datum.text = strdup(datum.text);
+                            if (!datum.text) {
+                                columnar_free_agg_result(result);
+                                return EPIPHANYDB_ERROR_MEMORY;
+                            }
+                        }
+                        value->value = datum;
+                    }
+                    break;
+            }
+        }
+    }
+
+    *out = result;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Zone map answers */
+
+static bool columnar_metadata_answerable(const ColumnarAggSpec *aggregates, size_t num_aggregates) {
+    for (size_t a = 0; a < num_aggregates; a++) {
+        switch (aggregates[a].func) {
+            case COLUMNAR_AGG_COUNT_STAR:
+            case COLUMNAR_AGG_COUNT:
+            case COLUMNAR_AGG_MIN:
+            case COLUMNAR_AGG_MAX:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Fold zone maps of row groups without deletes into the accumulators without
+ * touching values. Caller holds the table lock through a dirty-only scan.
+ */
+static int columnar_aggregate_metadata(ColumnarAggregator *agg) {
+    const ColumnarTable *table = agg->table;
+
+    for (size_t i = 0; i < table->num_row_groups; i++) {
+        const ColumnarRowGroup *row_group = table->row_groups[i];
+        if (row_group->num_deleted > 0) {
+            continue;
+        }
+
+        for (size_t a = 0; a < agg->num_aggregates; a++) {
+            ColumnarAccumulator *acc = &agg->accumulators[a];
+            int column = agg->columns[a];
+
+            if (agg->funcs[a] == COLUMNAR_AGG_COUNT_STAR) {
+                acc->count += (int64_t)row_group->num_rows;
+                continue;
+            }
+
+            const ColumnarZoneMap *zone_map = &row_group->chunks[column].zone_map;
+            int type = table->column_types[column];
+
+            acc->count += (int64_t)(row_group->num_rows - zone_map->null_count);
+            if (!zone_map->has_values) {
+                continue;
+            }
+            if (type == COLUMNAR_TYPE_TEXT) {
+                int result = columnar_accumulate_text(acc, zone_map->min.text);
+                if (result == EPIPHANYDB_SUCCESS) {
+                    result = columnar_accumulate_text(acc, zone_map->max.text);
+                }
+                if (result != EPIPHANYDB_SUCCESS) {
+                    return result;
+                }
+                continue;
+            }
+            if (!acc->has_value || columnar_compare_datum(type, zone_map->min, acc->min) < 0) {
+                acc->min = zone_map->min;
+            }
+            if (!acc->has_value || columnar_compare_datum(type, zone_map->max, acc->max) > 0) {
+                acc->max = zone_map->max;
+            }
+            acc->has_value = true;
+        }
+    }
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Aggregate the rows of a columnar table matching condition, optionally
+ * grouped by one column. COUNT/MIN/MAX without filter or grouping are
+ * answered from zone maps of row groups without deletes; everything else,
+ * including unmerged delta rows, streams batches from a parallel scan.
+ * Groups are returned in no particular order.
+ */
+int columnar_aggregate(EpiphanyDBTable *table, const char *group_by, const ColumnarAggSpec *aggregates, size_t num_aggregates, const char *condition, ColumnarAggResult **result) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table || !aggregates || num_aggregates == 0 || !result) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    columnar_select_kernels();
+
+    ColumnarAggregator *agg = NULL;
+    int status = columnar_aggregator_create(col_table, group_by, aggregates, num_aggregates, &agg);
+    if (status != EPIPHANYDB_SUCCESS) {
+        return status;
+    }
+
+    bool no_condition = !condition || condition[strspn(condition, " \t\r\n")] == '\0';
+    bool metadata = !group_by && no_condition && columnar_metadata_answerable(aggregates, num_aggregates);
+
+    /* Load the aggregated columns and the grouping column */
+    const char **columns = malloc((num_aggregates + 1) * sizeof(char *));
+    size_t num_columns = 0;
+    if (!columns) {
+        columnar_aggregator_free(agg);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    for (size_t a = 0; a < num_aggregates; a++) {
+        if (agg->columns[a] >= 0) {
+            columns[num_columns++] = col_table->column_names[agg->columns[a]];
+        }
+    }
+    if (group_by) {
+        columns[num_columns++] = group_by;
+    }
+
+    ColumnarScan *scan = NULL;
+    status = columnar_scan_begin(col_table, columns, num_columns, condition, &scan);
+    free(columns);
+    if (status != EPIPHANYDB_SUCCESS) {
+        columnar_aggregator_free(agg);
+        return status;
+    }
+
+    /* Clean row groups come from zone maps; deletes and delta rows are scanned */
+    if (metadata) {
+        scan->dirty_only = true;
+        status = columnar_aggregate_metadata(agg);
+    }
+
+    /* Every worker aggregates its own row groups; partials merge into agg */
+    size_t num_workers = columnar_scan_workers(scan);
+    ColumnarAggregator *workers[COLUMNAR_MAX_SCAN_WORKERS] = {agg};
+    for (size_t w = 1; status == EPIPHANYDB_SUCCESS && w < num_workers; w++) {
+        status = columnar_aggregator_create(col_table, group_by, aggregates, num_aggregates, &workers[w]);
+    }
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = columnar_parallel_scan(scan, num_workers, columnar_aggregate_batch, (void **)workers);
+    }
+    for (size_t w = 1; w < num_workers; w++) {
+        if (status == EPIPHANYDB_SUCCESS && workers[w]) {
+            status = columnar_aggregator_merge(agg, workers[w]);
+        }
+        columnar_aggregator_free(workers[w]);
+    }
+    bool values_read = scan->row_groups_scanned > 0;
+    columnar_scan_end(scan);
+
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = columnar_aggregator_finish(agg, result);
+    }
+    if (status == EPIPHANYDB_SUCCESS) {
+        (*result)->from_metadata = metadata && !values_read;
+    }
+    columnar_aggregator_free(agg);
+    return status;
+}
+
+void columnar_free_agg_result(ColumnarAggResult *result) {
+    if (!result) {
+        return;
+    }
+
+    for (size_t i = 0; i < result->num_groups * result->num_aggregates; i++) {
+        if (result->values[i].type == COLUMNAR_TYPE_TEXT && !result->values[i].is_null) {
+            free((char *)result->values[i].value.text);
+        }
+    }
+    if (result->grouped && result->group_type == COLUMNAR_TYPE_TEXT) {
+        for (size_t g = 0; g < result->num_groups; g++) {
+            if (!result->group_key_nulls[g]) {
+                free((char *)result->group_keys[g].text);
+            }
+        }
+    }
+    free(result->group_keys);
+    free(result->group_key_nulls);
+    free(result->values);
+    free(result);
+}
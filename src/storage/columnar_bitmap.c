@@ -0,0 +1,234 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Roaring-style compressed bitmaps marking deleted rows of a row group.
+ * Row numbers are split into a 16-bit container key and 16 low bits kept
+ * either in a sorted array (sparse) or a 65536-bit bitset (dense), so
+ * scattered deletes cost two bytes each and dense ones one bit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+#define COLUMNAR_BITSET_WORDS (65536 / 64)
+
+/* Container lookup */
+
+/* Index of the container with key, or of the position it would be inserted at */
+static size_t columnar_bitmap_search(const ColumnarBitmap *bitmap, uint16_t key, bool *found) {
+    size_t low = 0;
+    size_t high = bitmap->num_containers;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (bitmap->containers[mid].key < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *found = low < bitmap->num_containers && bitmap->containers[low].key == key;
+    return low;
+}
+
+/* First array position whose value is not below value */
+static size_t columnar_array_lower_bound(const uint16_t *array, size_t n, uint16_t value) {
+    size_t low = 0;
+    size_t high = n;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (array[mid] < value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static bool columnar_container_contains(const ColumnarBitmapContainer *container, uint16_t low) {
+    if (container->bits) {
+        return (container->bits[low >> 6] >> (low & 63)) & 1;
+    }
+    size_t pos = columnar_array_lower_bound(container->array, container->cardinality, low);
+    return pos < container->cardinality && container->array[pos] == low;
+}
+
+/* Container updates */
+
+static int columnar_container_to_bitset(ColumnarBitmapContainer *container) {
+    uint64_t *bits = calloc(COLUMNAR_BITSET_WORDS, sizeof(uint64_t));
+    if (!bits) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    for (uint32_t i = 0; i < container->cardinality; i++) {
+        uint16_t low = container->array[i];
+        bits[low >> 6] |= 1ULL << (low & 63);
+    }
+    free(container->array);
+    container->array = NULL;
+    container->bits = bits;
+    return EPIPHANYDB_SUCCESS;
+}
+
+static int columnar_container_add(ColumnarBitmapContainer *container, uint16_t low, bool *added) {
+    *added = false;
+
+    if (container->bits) {
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(container->bits[low >> 6] & mask)) {
+            container->bits[low >> 6] |= mask;
+            container->cardinality++;
+            *added = true;
+        }
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t pos = columnar_array_lower_bound(container->array, container->cardinality, low);
+    if (pos < container->cardinality && container->array[pos] == low) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    if (container->cardinality == COLUMNAR_BITMAP_ARRAY_MAX) {
+        int result = columnar_container_to_bitset(container);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+        return columnar_container_add(container, low, added);
+    }
+
+    /* Arrays grow in powers of two starting at 4 entries */
+    uint32_t n = container->cardinality;
+    if (n == 0 || (n >= 4 && (n & (n - 1)) == 0)) {
+        uint16_t *grown = realloc(container->array, (n ? n * 2 : 4) * sizeof(uint16_t));
+        if (!grown) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        container->array = grown;
+    }
+    memmove(container->array + pos + 1, container->array + pos, (n - pos) * sizeof(uint16_t));
+    container->array[pos] = low;
+    container->cardinality++;
+    *added = true;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Bitmap operations */
+
+int columnar_bitmap_add(ColumnarBitmap *bitmap, uint32_t value, bool *added) {
+    uint16_t key = (uint16_t)(value >> 16);
+    bool found;
+    size_t index = columnar_bitmap_search(bitmap, key, &found);
+
+    if (!found) {
+        if (bitmap->num_containers == bitmap->capacity) {
+            size_t capacity = bitmap->capacity ? bitmap->capacity * 2 : 1;
+            ColumnarBitmapContainer *grown = realloc(bitmap->containers, capacity * sizeof(ColumnarBitmapContainer));
+            if (!grown) {
+                return EPIPHANYDB_ERROR_MEMORY;
+            }
+            bitmap->containers = grown;
+            bitmap->capacity = capacity;
+        }
+        memmove(bitmap->containers + index + 1, bitmap->containers + index,
+                (bitmap->num_containers - index) * sizeof(ColumnarBitmapContainer));
+        memset(&bitmap->containers[index], 0, sizeof(ColumnarBitmapContainer));
+        bitmap->containers[index].key = key;
+        bitmap->num_containers++;
+    }
+
+    int result = columnar_container_add(&bitmap->containers[index], (uint16_t)value, added);
+    if (result == EPIPHANYDB_SUCCESS && *added) {
+        bitmap->cardinality++;
+    }
+    return result;
+}
+
+bool columnar_bitmap_contains(const ColumnarBitmap *bitmap, uint32_t value) {
+    bool found;
+    size_t index;
+
+    if (bitmap->cardinality == 0) {
+        return false;
+    }
+    index = columnar_bitmap_search(bitmap, (uint16_t)(value >> 16), &found);
+    return found && columnar_container_contains(&bitmap->containers[index], (uint16_t)value);
+}
+
+/*
+ * Drop the rows of a selection vector (offsets from first_row, ascending)
+ * that are set in the bitmap, returning the remaining count. Bitset
+ * containers are probed directly; array containers are merged against the
+ * selection in one pass.
+ */
+size_t columnar_bitmap_filter(const ColumnarBitmap *bitmap, uint32_t first_row, uint16_t *selection, size_t num_selected) {
+    size_t k = 0;
+
+    if (bitmap->cardinality == 0 || num_selected == 0) {
+        return num_selected;
+    }
+
+    uint32_t last_row = first_row + selection[num_selected - 1];
+    if ((first_row >> 16) != (last_row >> 16)) {
+        /* Window straddles two containers */
+        for (size_t i = 0; i < num_selected; i++) {
+            selection[k] = selection[i];
+            k += !columnar_bitmap_contains(bitmap, first_row + selection[i]);
+        }
+        return k;
+    }
+
+    bool found;
+    size_t index = columnar_bitmap_search(bitmap, (uint16_t)(first_row >> 16), &found);
+    if (!found) {
+        return num_selected;
+    }
+
+    const ColumnarBitmapContainer *container = &bitmap->containers[index];
+    uint16_t base = (uint16_t)first_row;
+
+    if (container->bits) {
+        for (size_t i = 0; i < num_selected; i++) {
+            uint16_t low = (uint16_t)(base + selection[i]);
+            selection[k] = selection[i];
+            k += !((container->bits[low >> 6] >> (low & 63)) & 1);
+        }
+        return k;
+    }
+
+    size_t pos = columnar_array_lower_bound(container->array, container->cardinality, base);
+    for (size_t i = 0; i < num_selected; i++) {
+        uint16_t low = (uint16_t)(base + selection[i]);
+        while (pos < container->cardinality && container->array[pos] < low) {
+            pos++;
+        }
+        selection[k] = selection[i];
+        k += !(pos < container->cardinality && container->array[pos] == low);
+    }
+    return k;
+}
+
+/* Heap bytes held by the bitmap */
+size_t columnar_bitmap_memory_usage(const ColumnarBitmap *bitmap) {
+    size_t bytes = bitmap->capacity * sizeof(ColumnarBitmapContainer);
+
+    for (size_t i = 0; i < bitmap->num_containers; i++) {
+        const ColumnarBitmapContainer *container = &bitmap->containers[i];
+        bytes += container->bits ? COLUMNAR_BITSET_WORDS * sizeof(uint64_t) : container->cardinality * sizeof(uint16_t);
+    }
+    return bytes;
+}
+
+void columnar_bitmap_free(ColumnarBitmap *bitmap) {
+    for (size_t i = 0; i < bitmap->num_containers; i++) {
+        free(bitmap->containers[i].array);
+        free(bitmap->containers[i].bits);
+    }
+    free(bitmap->containers);
+    memset(bitmap, 0, sizeof(ColumnarBitmap));
+}
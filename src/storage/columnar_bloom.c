@@ -0,0 +1,181 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Split-block bloom filters over the values of one chunk. Each block is a
+ * cache line of eight 64-bit words; a key picks one block from the high
+ * half of its hash and sets one bit in every word of it from the low half,
+ * so a probe touches a single cache line and checks all eight bits at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define COLUMNAR_HAVE_AVX2_BLOOM 1
+#endif
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+#define COLUMNAR_BLOOM_BLOCK_BITS (COLUMNAR_BLOOM_BLOCK_WORDS * 64)
+
+/* Odd multipliers deriving the bit of every word from the key */
+static const uint32_t columnar_bloom_salts[COLUMNAR_BLOOM_BLOCK_WORDS] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+static inline const uint64_t *columnar_bloom_block(const ColumnarBloomFilter *filter, uint64_t hash) {
+    size_t block = (size_t)(((hash >> 32) * filter->num_blocks) >> 32);
+    return filter->blocks + block * COLUMNAR_BLOOM_BLOCK_WORDS;
+}
+
+/* Probe kernels */
+
+typedef bool (*ColumnarBloomProbeFn)(const uint64_t *block, uint32_t key);
+
+static bool columnar_bloom_probe_scalar(const uint64_t *block, uint32_t key) {
+    uint64_t missing = 0;
+
+    for (size_t i = 0; i < COLUMNAR_BLOOM_BLOCK_WORDS; i++) {
+        uint64_t mask = 1ULL << ((key * columnar_bloom_salts[i]) >> 26);
+        missing |= mask & ~block[i];
+    }
+    return missing == 0;
+}
+
+#ifdef COLUMNAR_HAVE_AVX2_BLOOM
+
+__attribute__((target("avx2")))
+static bool columnar_bloom_probe_avx2(const uint64_t *block, uint32_t key) {
+    __m256i salts = _mm256_loadu_si256((const __m256i *)columnar_bloom_salts);
+    __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((int)key), salts), 26);
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256i mask_low = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+    __m256i mask_high = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+    __m256i words_low = _mm256_load_si256((const __m256i *)block);
+    __m256i words_high = _mm256_load_si256((const __m256i *)(block + 4));
+    __m256i missing = _mm256_or_si256(_mm256_andnot_si256(words_low, mask_low),
+                                      _mm256_andnot_si256(words_high, mask_high));
+    return _mm256_testz_si256(missing, missing);
+}
+
+#endif /* COLUMNAR_HAVE_AVX2_BLOOM */
+
+static ColumnarBloomProbeFn columnar_bloom_probe = columnar_bloom_probe_scalar;
+
+static void columnar_bloom_init_kernels(void) {
+#ifdef COLUMNAR_HAVE_AVX2_BLOOM
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        columnar_bloom_probe = columnar_bloom_probe_avx2;
+    }
+#endif
+}
+
+/* Filter operations */
+
+/* Empty filter sized at bits_per_key for num_keys keys */
+int columnar_bloom_init(ColumnarBloomFilter *filter, size_t num_keys, size_t bits_per_key) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+    pthread_once(&once, columnar_bloom_init_kernels);
+    memset(filter, 0, sizeof(ColumnarBloomFilter));
+
+    size_t num_blocks = (num_keys * bits_per_key + COLUMNAR_BLOOM_BLOCK_BITS - 1) / COLUMNAR_BLOOM_BLOCK_BITS;
+    size_t size = num_blocks * COLUMNAR_BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+    if (num_blocks == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    filter->blocks = aligned_alloc(COLUMNAR_CACHE_LINE_SIZE, size);
+    if (!filter->blocks) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    memset(filter->blocks, 0, size);
+    filter->num_blocks = (uint32_t)num_blocks;
+    return EPIPHANYDB_SUCCESS;
+}
+
+void columnar_bloom_add(ColumnarBloomFilter *filter, uint64_t hash) {
+    uint64_t *block = (uint64_t *)columnar_bloom_block(filter, hash);
+    uint32_t key = (uint32_t)hash;
+
+    for (size_t i = 0; i < COLUMNAR_BLOOM_BLOCK_WORDS; i++) {
+        block[i] |= 1ULL << ((key * columnar_bloom_salts[i]) >> 26);
+    }
+}
+
+/* Hash of a non-NULL value as stored in filters and probed by predicates */
+uint64_t columnar_bloom_hash(ColumnarType type, ColumnarDatum value) {
+    switch (type) {
+        case COLUMNAR_TYPE_INT64:
+            return columnar_hash_int64((uint64_t)value.i64);
+        case COLUMNAR_TYPE_DOUBLE:
+            return columnar_hash_double(value.f64);
+        default:
+            return columnar_hash_bytes(value.text, strlen(value.text));
+    }
+}
+
+/*
+ * Build a filter sized at bits_per_key for the non-NULL values of a chunk.
+ * Chunks whose zone map already pins a single value get no filter.
+ */
+int columnar_bloom_build(ColumnarType type, const ColumnarChunk *chunk, size_t num_rows, size_t bits_per_key, ColumnarBloomFilter *filter) {
+    const ColumnarZoneMap *zone_map = &chunk->zone_map;
+
+    memset(filter, 0, sizeof(ColumnarBloomFilter));
+    if (bits_per_key == 0 || !zone_map->has_values || columnar_compare_datum(type, zone_map->min, zone_map->max) == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    int result = columnar_bloom_init(filter, num_rows - zone_map->null_count, bits_per_key);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    for (size_t r = 0; r < num_rows; r++) {
+        ColumnarDatum value;
+
+        if (chunk->nulls && chunk->nulls[r]) {
+            continue;
+        }
+        switch (type) {
+            case COLUMNAR_TYPE_INT64:
+                value.i64 = ((const int64_t *)chunk->values)[r];
+                break;
+            case COLUMNAR_TYPE_DOUBLE:
+                value.f64 = ((const double *)chunk->values)[r];
+                break;
+            default:
+                value.text = ((char *const *)chunk->values)[r];
+                break;
+        }
+        columnar_bloom_add(filter, columnar_bloom_hash(type, value));
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * False only when no value of the chunk hashes to hash; chunks without a
+ * filter may match. Filters only exist once columnar_bloom_init has picked
+ * the kernel.
+ */
+bool columnar_bloom_may_contain(const ColumnarBloomFilter *filter, uint64_t hash) {
+    if (filter->num_blocks == 0) {
+        return true;
+    }
+    return columnar_bloom_probe(columnar_bloom_block(filter, hash), (uint32_t)hash);
+}
+
+size_t columnar_bloom_size(const ColumnarBloomFilter *filter) {
+    return (size_t)filter->num_blocks * COLUMNAR_BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+}
+
+void columnar_bloom_free(ColumnarBloomFilter *filter) {
+    free(filter->blocks);
+    memset(filter, 0, sizeof(ColumnarBloomFilter));
+}
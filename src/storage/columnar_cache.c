@@ -0,0 +1,275 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Scan cache. Sealed row groups never change, so the chunks a scan decodes
+ * and the rows of a row group a condition selects can be kept and reused
+ * by later scans running the same query. Entries live in a hash table and
+ * in one of two LRU segments sharing a memory budget: entries start in the
+ * probationary segment and move to the protected one on their next hit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+/* Source of the table ids of cache keys, shared by every engine instance */
+static uint64_t columnar_cache_next_table_id = 1;
+
+uint64_t columnar_cache_table_id(void) {
+    return __atomic_fetch_add(&columnar_cache_next_table_id, 1, __ATOMIC_RELAXED);
+}
+
+static uint64_t columnar_cache_key_hash(const ColumnarCacheKey *key) {
+    uint64_t hash = columnar_hash_int64(key->table_id);
+    hash = columnar_hash_int64(hash ^ key->row_group_id);
+    hash = columnar_hash_int64(hash ^ key->column);
+    return columnar_hash_int64(hash ^ key->hash);
+}
+
+static bool columnar_cache_key_equal(const ColumnarCacheKey *a, const ColumnarCacheKey *b) {
+    return a->table_id == b->table_id && a->row_group_id == b->row_group_id &&
+           a->column == b->column && a->hash == b->hash;
+}
+
+/* Segment lists */
+
+static void columnar_cache_list_init(ColumnarCacheEntry *head) {
+    head->prev = head;
+    head->next = head;
+}
+
+static void columnar_cache_unlink(ColumnarCacheEntry *entry) {
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void columnar_cache_push_front(ColumnarCacheEntry *head, ColumnarCacheEntry *entry) {
+    entry->prev = head;
+    entry->next = head->next;
+    head->next->prev = entry;
+    head->next = entry;
+}
+
+/* Hash table */
+
+static ColumnarCacheEntry **columnar_cache_slot(ColumnarCache *cache, const ColumnarCacheKey *key) {
+    ColumnarCacheEntry **slot = &cache->buckets[columnar_cache_key_hash(key) & (cache->num_buckets - 1)];
+    while (*slot && !columnar_cache_key_equal(&(*slot)->key, key)) {
+        slot = &(*slot)->hash_next;
+    }
+    return slot;
+}
+
+/* Double the buckets once entries outnumber them; keeps the old table on failure */
+static void columnar_cache_grow(ColumnarCache *cache) {
+    size_t num_buckets = cache->num_buckets * 2;
+    ColumnarCacheEntry **buckets = calloc(num_buckets, sizeof(ColumnarCacheEntry *));
+    if (!buckets) {
+        return;
+    }
+
+    for (size_t b = 0; b < cache->num_buckets; b++) {
+        ColumnarCacheEntry *entry = cache->buckets[b];
+        while (entry) {
+            ColumnarCacheEntry *next = entry->hash_next;
+            size_t slot = columnar_cache_key_hash(&entry->key) & (num_buckets - 1);
+            entry->hash_next = buckets[slot];
+            buckets[slot] = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->num_buckets = num_buckets;
+}
+
+/* Drop entry from the cache, mutex held; it is freed once unpinned */
+static void columnar_cache_remove(ColumnarCache *cache, ColumnarCacheEntry *entry) {
+    *columnar_cache_slot(cache, &entry->key) = entry->hash_next;
+    entry->hash_next = NULL;
+    columnar_cache_unlink(entry);
+    cache->used -= entry->size;
+    if (entry->protected_segment) {
+        cache->protected_used -= entry->size;
+    }
+    cache->num_entries--;
+    entry->cached = false;
+    if (entry->refs == 0) {
+        free(entry);
+    }
+}
+
+/* Evict least recently used entries, probationary ones first, until within budget */
+static void columnar_cache_evict(ColumnarCache *cache) {
+    while (cache->used > cache->budget) {
+        ColumnarCacheEntry *victim = cache->probation.prev;
+        if (victim == &cache->probation) {
+            victim = cache->protected_list.prev;
+        }
+        if (victim == &cache->protected_list) {
+            return;
+        }
+        columnar_cache_remove(cache, victim);
+        cache->evictions++;
+    }
+}
+
+/* Cache lifecycle */
+
+ColumnarCache *columnar_cache_create(size_t budget) {
+    ColumnarCache *cache = calloc(1, sizeof(ColumnarCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->num_buckets = 256;
+    cache->buckets = calloc(cache->num_buckets, sizeof(ColumnarCacheEntry *));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+    cache->budget = budget;
+    columnar_cache_list_init(&cache->probation);
+    columnar_cache_list_init(&cache->protected_list);
+    pthread_mutex_init(&cache->mutex, NULL);
+    return cache;
+}
+
+/* Free the cache and its entries; no entry may still be pinned */
+void columnar_cache_destroy(ColumnarCache *cache) {
+    if (!cache) {
+        return;
+    }
+
+    for (size_t b = 0; b < cache->num_buckets; b++) {
+        ColumnarCacheEntry *entry = cache->buckets[b];
+        while (entry) {
+            ColumnarCacheEntry *next = entry->hash_next;
+            free(entry);
+            entry = next;
+        }
+    }
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache->buckets);
+    free(cache);
+}
+
+/* Drop the entries of a table that is going away */
+void columnar_cache_forget_table(ColumnarCache *cache, uint64_t table_id) {
+    if (!cache) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    for (size_t b = 0; b < cache->num_buckets; b++) {
+        ColumnarCacheEntry *entry = cache->buckets[b];
+        while (entry) {
+            ColumnarCacheEntry *next = entry->hash_next;
+            if (entry->key.table_id == table_id) {
+                columnar_cache_remove(cache, entry);
+            }
+            entry = next;
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+/* Entries */
+
+/* Unlinked entry with data_size bytes of data, pinned by the caller */
+ColumnarCacheEntry *columnar_cache_entry_alloc(const ColumnarCacheKey *key, size_t data_size) {
+    ColumnarCacheEntry *entry = calloc(1, sizeof(ColumnarCacheEntry) + data_size);
+    if (!entry) {
+        return NULL;
+    }
+    entry->key = *key;
+    entry->refs = 1;
+    entry->size = sizeof(ColumnarCacheEntry) + data_size;
+    return entry;
+}
+
+/*
+ * Pinned entry for key, or NULL. A hit moves a probationary entry into the
+ * protected segment, demoting the least recently used protected entries
+ * beyond COLUMNAR_CACHE_PROTECTED_SHARE of the budget.
+ */
+ColumnarCacheEntry *columnar_cache_lookup(ColumnarCache *cache, const ColumnarCacheKey *key) {
+    pthread_mutex_lock(&cache->mutex);
+    ColumnarCacheEntry *entry = *columnar_cache_slot(cache, key);
+    if (!entry) {
+        cache->misses++;
+        pthread_mutex_unlock(&cache->mutex);
+        return NULL;
+    }
+
+    cache->hits++;
+    entry->refs++;
+    columnar_cache_unlink(entry);
+    columnar_cache_push_front(&cache->protected_list, entry);
+    if (!entry->protected_segment) {
+        entry->protected_segment = true;
+        cache->protected_used += entry->size;
+    }
+
+    size_t protected_budget = (size_t)(cache->budget * COLUMNAR_CACHE_PROTECTED_SHARE);
+    while (cache->protected_used > protected_budget && cache->protected_list.prev != entry) {
+        ColumnarCacheEntry *demoted = cache->protected_list.prev;
+        columnar_cache_unlink(demoted);
+        columnar_cache_push_front(&cache->probation, demoted);
+        demoted->protected_segment = false;
+        cache->protected_used -= demoted->size;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return entry;
+}
+
+/* True when key is cached, without counting a hit or refreshing the entry */
+bool columnar_cache_contains(ColumnarCache *cache, const ColumnarCacheKey *key) {
+    pthread_mutex_lock(&cache->mutex);
+    bool found = *columnar_cache_slot(cache, key) != NULL;
+    pthread_mutex_unlock(&cache->mutex);
+    return found;
+}
+
+/*
+ * Publish an entry built by the caller, who keeps its pin. Entries larger
+ * than the budget, or whose key another scan published first, stay private
+ * to the caller and are freed on release.
+ */
+void columnar_cache_insert(ColumnarCache *cache, ColumnarCacheEntry *entry) {
+    pthread_mutex_lock(&cache->mutex);
+    ColumnarCacheEntry **slot = columnar_cache_slot(cache, &entry->key);
+    if (*slot || entry->size > cache->budget) {
+        pthread_mutex_unlock(&cache->mutex);
+        return;
+    }
+
+    *slot = entry;
+    entry->cached = true;
+    columnar_cache_push_front(&cache->probation, entry);
+    cache->used += entry->size;
+    cache->num_entries++;
+    columnar_cache_evict(cache);
+    if (cache->num_entries > cache->num_buckets) {
+        columnar_cache_grow(cache);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void columnar_cache_release(ColumnarCache *cache, ColumnarCacheEntry *entry) {
+    if (!entry) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    bool unused = --entry->refs == 0 && !entry->cached;
+    pthread_mutex_unlock(&cache->mutex);
+    if (unused) {
+        free(entry);
+    }
+}
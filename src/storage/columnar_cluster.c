@@ -0,0 +1,453 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Clustered row order. Rows are ordered lexicographically on a sort key or
+ * by the Z-order or Hilbert position of a multi-column key, whose columns
+ * are first mapped onto order-preserving integers and scaled to the range
+ * of the rows being ordered. Clustering passes merge row groups whose key
+ * column zone maps overlap into new row groups covering disjoint ranges.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+/* Row to be written with its curve position, unused for sort keys */
+typedef struct ColumnarClusterEntry {
+    uint64_t key;
+    ColumnarRowOrigin origin;
+} ColumnarClusterEntry;
+
+/* Loaded chunks of every source, indexed by source * num_columns + column */
+typedef struct ColumnarClusterInput {
+    const ColumnarTable *table;
+    const void **values;
+    const uint8_t **nulls;
+} ColumnarClusterInput;
+
+static bool columnar_input_is_null(const ColumnarClusterInput *input, ColumnarRowOrigin origin, size_t column) {
+    const uint8_t *nulls = input->nulls[origin.source * input->table->num_columns + column];
+    return nulls && nulls[origin.row];
+}
+
+static ColumnarDatum columnar_input_value(const ColumnarClusterInput *input, ColumnarRowOrigin origin, size_t column) {
+    const void *values = input->values[origin.source * input->table->num_columns + column];
+    ColumnarDatum value;
+
+    switch (input->table->column_types[column]) {
+        case COLUMNAR_TYPE_INT64:
+            value.i64 = ((const int64_t *)values)[origin.row];
+            break;
+        case COLUMNAR_TYPE_DOUBLE:
+            value.f64 = ((const double *)values)[origin.row];
+            break;
+        default:
+            value.text = ((char *const *)values)[origin.row];
+            break;
+    }
+    return value;
+}
+
+/* Ordering */
+
+static int columnar_compare_origin(ColumnarRowOrigin a, ColumnarRowOrigin b) {
+    if (a.source != b.source) {
+        return a.source < b.source ? -1 : 1;
+    }
+    return (a.row > b.row) - (a.row < b.row);
+}
+
+/* Sort key order, NULLs first, ties in source order */
+static int columnar_compare_sort_key(const void *a, const void *b, void *arg) {
+    const ColumnarClusterEntry *x = a;
+    const ColumnarClusterEntry *y = b;
+    const ColumnarClusterInput *input = arg;
+    const ColumnarTable *table = input->table;
+
+    for (size_t k = 0; k < table->num_cluster_columns; k++) {
+        int column = table->cluster_columns[k];
+        bool x_null = columnar_input_is_null(input, x->origin, column);
+        bool y_null = columnar_input_is_null(input, y->origin, column);
+
+        if (x_null || y_null) {
+            if (x_null != y_null) {
+                return x_null ? -1 : 1;
+            }
+            continue;
+        }
+        int cmp = columnar_compare_datum(table->column_types[column],
+                                         columnar_input_value(input, x->origin, column),
+                                         columnar_input_value(input, y->origin, column));
+        if (cmp != 0) {
+            return cmp;
+        }
+    }
+    return columnar_compare_origin(x->origin, y->origin);
+}
+
+static int columnar_compare_curve_key(const void *a, const void *b) {
+    const ColumnarClusterEntry *x = a;
+    const ColumnarClusterEntry *y = b;
+
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return columnar_compare_origin(x->origin, y->origin);
+}
+
+/* Unsigned integer with the same order as the value; TEXT by its first 8 bytes */
+static uint64_t columnar_ordered_bits(int type, ColumnarDatum value) {
+    uint64_t bits = 0;
+
+    switch (type) {
+        case COLUMNAR_TYPE_INT64:
+            return (uint64_t)value.i64 ^ (1ULL << 63);
+        case COLUMNAR_TYPE_DOUBLE:
+            memcpy(&bits, &value.f64, sizeof(bits));
+            return (bits >> 63) ? ~bits : bits | (1ULL << 63);
+        default:
+            for (size_t i = 0; i < 8 && value.text[i]; i++) {
+                bits |= (uint64_t)(unsigned char)value.text[i] << (56 - 8 * i);
+            }
+            return bits;
+    }
+}
+
+/* Map each coordinate to the position on the Hilbert curve, in transposed form */
+static void columnar_hilbert_transpose(uint64_t *x, size_t n, unsigned bits) {
+    uint64_t m = 1ULL << (bits - 1);
+
+    for (uint64_t q = m; q > 1; q >>= 1) {
+        uint64_t p = q - 1;
+        for (size_t i = 0; i < n; i++) {
+            if (x[i] & q) {
+                x[0] ^= p;
+            } else {
+                uint64_t t = (x[0] ^ x[i]) & p;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+
+    for (size_t i = 1; i < n; i++) {
+        x[i] ^= x[i - 1];
+    }
+    uint64_t t = 0;
+    for (uint64_t q = m; q > 1; q >>= 1) {
+        if (x[n - 1] & q) {
+            t ^= q - 1;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        x[i] ^= t;
+    }
+}
+
+/* Z-order or Hilbert position of every entry */
+static void columnar_curve_keys(const ColumnarClusterInput *input, ColumnarClusterEntry *entries, size_t num_entries) {
+    const ColumnarTable *table = input->table;
+    size_t n = table->num_cluster_columns;
+    unsigned bits = (unsigned)(64 / n);
+    uint64_t scale = bits == 64 ? UINT64_MAX : (1ULL << bits) - 1;
+    uint64_t low[COLUMNAR_MAX_CLUSTER_COLUMNS];
+    uint64_t high[COLUMNAR_MAX_CLUSTER_COLUMNS];
+
+    /* Scale every coordinate to the range actually present */
+    for (size_t k = 0; k < n; k++) {
+        low[k] = UINT64_MAX;
+        high[k] = 0;
+    }
+    for (size_t e = 0; e < num_entries; e++) {
+        for (size_t k = 0; k < n; k++) {
+            int column = table->cluster_columns[k];
+            if (columnar_input_is_null(input, entries[e].origin, column)) {
+                continue;
+            }
+            uint64_t v = columnar_ordered_bits(table->column_types[column], columnar_input_value(input, entries[e].origin, column));
+            low[k] = v < low[k] ? v : low[k];
+            high[k] = v > high[k] ? v : high[k];
+        }
+    }
+
+    for (size_t e = 0; e < num_entries; e++) {
+        uint64_t x[COLUMNAR_MAX_CLUSTER_COLUMNS];
+
+        for (size_t k = 0; k < n; k++) {
+            int column = table->cluster_columns[k];
+            x[k] = 0;  /* NULLs sort first */
+            if (!columnar_input_is_null(input, entries[e].origin, column) && high[k] > low[k]) {
+                uint64_t v = columnar_ordered_bits(table->column_types[column], columnar_input_value(input, entries[e].origin, column));
+                x[k] = (uint64_t)((unsigned __int128)(v - low[k]) * scale / (high[k] - low[k]));
+            }
+        }
+        if (table->cluster_kind == COLUMNAR_CLUSTER_HILBERT && n > 1) {
+            columnar_hilbert_transpose(x, n, bits);
+        }
+
+        /* Interleave the coordinates from the most significant bit down */
+        uint64_t key = 0;
+        for (int bit = (int)bits - 1; bit >= 0; bit--) {
+            for (size_t k = 0; k < n; k++) {
+                key = key << 1 | ((x[k] >> bit) & 1);
+            }
+        }
+        entries[e].key = key;
+    }
+}
+
+/* Row rewriting */
+
+/*
+ * Write the live rows of sources into new unsealed row groups ordered by
+ * the cluster key of table, at most COLUMNAR_ROW_GROUP_SIZE rows each.
+ * targets must hold num_sources entries and origins the rows of all
+ * sources; origins receives the source row of every written row, in
+ * order. Sources must not change meanwhile.
+ */
+int columnar_cluster_rows(const ColumnarTable *table, ColumnarRowGroup *const *sources, size_t num_sources, ColumnarRowGroup **targets, size_t *num_targets, ColumnarRowOrigin *origins) {
+    size_t num_chunks = num_sources * table->num_columns;
+    size_t total_rows = 0;
+    ColumnarClusterInput input = {table, NULL, NULL};
+    int result = EPIPHANYDB_SUCCESS;
+
+    *num_targets = 0;
+    for (size_t s = 0; s < num_sources; s++) {
+        total_rows += sources[s]->num_rows;
+    }
+
+    ColumnarChunkBuffer *buffers = calloc(num_chunks, sizeof(ColumnarChunkBuffer));
+    input.values = calloc(num_chunks, sizeof(void *));
+    input.nulls = calloc(num_chunks, sizeof(uint8_t *));
+    ColumnarClusterEntry *entries = malloc((total_rows + 1) * sizeof(ColumnarClusterEntry));
+    ColumnarDatum *values = malloc(table->num_columns * sizeof(ColumnarDatum));
+    bool *nulls = malloc(table->num_columns * sizeof(bool));
+    uint16_t *selection = malloc(COLUMNAR_BATCH_SIZE * sizeof(uint16_t));
+    if (!buffers || !input.values || !input.nulls || !entries || !values || !nulls || !selection) {
+        result = EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    for (size_t s = 0; s < num_sources && result == EPIPHANYDB_SUCCESS; s++) {
+        for (size_t c = 0; c < table->num_columns && result == EPIPHANYDB_SUCCESS; c++) {
+            size_t i = s * table->num_columns + c;
+            result = columnar_chunk_load(table, sources[s], c, &buffers[i], &input.values[i], &input.nulls[i]);
+        }
+    }
+
+    /* Live rows of every source */
+    size_t num_entries = 0;
+    for (size_t s = 0; s < num_sources && result == EPIPHANYDB_SUCCESS; s++) {
+        const ColumnarRowGroup *source = sources[s];
+        for (size_t first = 0; first < source->num_rows; first += COLUMNAR_BATCH_SIZE) {
+            size_t n = source->num_rows - first < COLUMNAR_BATCH_SIZE ? source->num_rows - first : COLUMNAR_BATCH_SIZE;
+            for (size_t i = 0; i < n; i++) {
+                selection[i] = (uint16_t)i;
+            }
+            n = columnar_bitmap_filter(&source->deleted, (uint32_t)first, selection, n);
+            for (size_t i = 0; i < n; i++) {
+                entries[num_entries].key = 0;
+                entries[num_entries].origin.source = (uint32_t)s;
+                entries[num_entries].origin.row = (uint32_t)(first + selection[i]);
+                num_entries++;
+            }
+        }
+    }
+
+    if (result == EPIPHANYDB_SUCCESS) {
+        if (table->cluster_kind == COLUMNAR_CLUSTER_SORT) {
+            qsort_r(entries, num_entries, sizeof(ColumnarClusterEntry), columnar_compare_sort_key, &input);
+        } else {
+            columnar_curve_keys(&input, entries, num_entries);
+            qsort(entries, num_entries, sizeof(ColumnarClusterEntry), columnar_compare_curve_key);
+        }
+    }
+
+    ColumnarRowGroup *target = NULL;
+    for (size_t e = 0; e < num_entries && result == EPIPHANYDB_SUCCESS; e++) {
+        if (!target || target->num_rows == COLUMNAR_ROW_GROUP_SIZE) {
+            target = columnar_row_group_create(table);
+            if (!target) {
+                result = EPIPHANYDB_ERROR_MEMORY;
+                break;
+            }
+            targets[(*num_targets)++] = target;
+        }
+        for (size_t c = 0; c < table->num_columns; c++) {
+            nulls[c] = columnar_input_is_null(&input, entries[e].origin, c);
+            values[c] = columnar_input_value(&input, entries[e].origin, c);
+        }
+        result = columnar_row_group_append(table, target, values, nulls);
+        origins[e] = entries[e].origin;
+    }
+
+    if (result != EPIPHANYDB_SUCCESS) {
+        for (size_t t = 0; t < *num_targets; t++) {
+            columnar_row_group_free(table, targets[t]);
+        }
+        *num_targets = 0;
+    }
+    for (size_t i = 0; buffers && i < num_chunks; i++) {
+        columnar_chunk_buffer_free(&buffers[i]);
+    }
+    free(buffers);
+    free(input.values);
+    free(input.nulls);
+    free(entries);
+    free(values);
+    free(nulls);
+    free(selection);
+    return result;
+}
+
+/* Clustering passes */
+
+/* False when the zone maps of a and b are disjoint on some key column */
+static bool columnar_key_ranges_overlap(const ColumnarTable *table, const ColumnarRowGroup *a, const ColumnarRowGroup *b) {
+    for (size_t k = 0; k < table->num_cluster_columns; k++) {
+        int column = table->cluster_columns[k];
+        int type = table->column_types[column];
+        const ColumnarZoneMap *x = &a->chunks[column].zone_map;
+        const ColumnarZoneMap *y = &b->chunks[column].zone_map;
+
+        if (!x->has_values || !y->has_values) {
+            continue;
+        }
+        if (columnar_compare_datum(type, x->max, y->min) < 0 || columnar_compare_datum(type, y->max, x->min) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Re-sort the row groups written by merges since the last pass together
+ * with the clustered row groups they overlap, once at least min_groups of
+ * them exist, and replace them by row groups covering disjoint key ranges.
+ * At most COLUMNAR_CLUSTER_MAX_GROUPS row groups are rewritten per pass.
+ * Like compaction, the rewrite runs under the read lock and the swap under
+ * the write lock, carrying over rows deleted meanwhile.
+ */
+int columnar_cluster_row_groups(ColumnarTable *table, size_t min_groups) {
+    ColumnarDeltaStore *delta = &table->delta;
+    ColumnarRowGroup *sources[COLUMNAR_CLUSTER_MAX_GROUPS];
+    ColumnarRowGroup *targets[COLUMNAR_CLUSTER_MAX_GROUPS];
+    size_t num_sources = 0;
+    size_t num_targets = 0;
+    size_t num_new = 0;
+    int result = EPIPHANYDB_SUCCESS;
+
+    if (table->cluster_kind == COLUMNAR_CLUSTER_NONE) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    /* Row group positions only change under merge_mutex */
+    pthread_mutex_lock(&delta->merge_mutex);
+    pthread_rwlock_rdlock(&table->lock);
+
+    for (size_t g = 0; g < table->num_row_groups; g++) {
+        if (!table->row_groups[g]->clustered) {
+            num_new++;
+            if (num_sources < COLUMNAR_CLUSTER_MAX_GROUPS) {
+                sources[num_sources++] = table->row_groups[g];
+            }
+        }
+    }
+    if (num_new < min_groups || num_new == 0) {
+        pthread_rwlock_unlock(&table->lock);
+        pthread_mutex_unlock(&delta->merge_mutex);
+        return EPIPHANYDB_SUCCESS;
+    }
+    size_t num_unclustered = num_sources;
+    for (size_t g = 0; g < table->num_row_groups && num_sources < COLUMNAR_CLUSTER_MAX_GROUPS; g++) {
+        ColumnarRowGroup *row_group = table->row_groups[g];
+        if (!row_group->clustered) {
+            continue;
+        }
+        for (size_t s = 0; s < num_unclustered; s++) {
+            if (columnar_key_ranges_overlap(table, row_group, sources[s])) {
+                sources[num_sources++] = row_group;
+                break;
+            }
+        }
+    }
+
+    /* A lone row group overlapping nothing is already in key order */
+    ColumnarRowOrigin *origins = NULL;
+    if (num_sources > 1) {
+        size_t total_rows = 0;
+        for (size_t s = 0; s < num_sources; s++) {
+            total_rows += sources[s]->num_rows;
+        }
+        origins = malloc((total_rows + 1) * sizeof(ColumnarRowOrigin));
+        result = origins ? columnar_cluster_rows(table, sources, num_sources, targets, &num_targets, origins)
+                         : EPIPHANYDB_ERROR_MEMORY;
+    }
+    pthread_rwlock_unlock(&table->lock);
+
+    for (size_t t = 0; t < num_targets && result == EPIPHANYDB_SUCCESS; t++) {
+        result = columnar_row_group_persist(table, targets[t]);
+    }
+
+    pthread_rwlock_wrlock(&table->lock);
+    if (result == EPIPHANYDB_SUCCESS && num_sources == 1) {
+        sources[0]->clustered = true;
+    } else if (result == EPIPHANYDB_SUCCESS) {
+        /* Rows deleted while the copies were being built */
+        size_t e = 0;
+        for (size_t t = 0; t < num_targets && result == EPIPHANYDB_SUCCESS; t++) {
+            ColumnarRowGroup *target = targets[t];
+            for (size_t r = 0; r < target->num_rows && result == EPIPHANYDB_SUCCESS; r++, e++) {
+                bool added = false;
+                if (columnar_bitmap_contains(&sources[origins[e].source]->deleted, origins[e].row)) {
+                    result = columnar_bitmap_add(&target->deleted, (uint32_t)r, &added);
+                    target->num_deleted += added;
+                }
+            }
+        }
+    }
+    if (result == EPIPHANYDB_SUCCESS && num_sources > 1) {
+        /* Swap the sources for the targets, dropping targets left empty */
+        size_t kept = 0;
+        for (size_t g = 0; g < table->num_row_groups; g++) {
+            bool replaced = false;
+            for (size_t s = 0; s < num_sources && !replaced; s++) {
+                replaced = table->row_groups[g] == sources[s];
+            }
+            if (!replaced) {
+                table->row_groups[kept++] = table->row_groups[g];
+            }
+        }
+        for (size_t t = 0; t < num_targets; t++) {
+            ColumnarRowGroup *target = targets[t];
+            if (target->num_rows == target->num_deleted) {
+                columnar_row_group_free(table, target);
+                continue;
+            }
+            target->id = table->next_row_group_id++;
+            target->sealed = true;
+            target->clustered = true;
+            table->row_groups[kept++] = target;
+        }
+        table->num_row_groups = kept;
+        for (size_t s = 0; s < num_sources; s++) {
+            columnar_row_group_free(table, sources[s]);
+        }
+    } else if (result != EPIPHANYDB_SUCCESS) {
+        for (size_t t = 0; t < num_targets; t++) {
+            columnar_row_group_free(table, targets[t]);
+        }
+    }
+    pthread_rwlock_unlock(&table->lock);
+
+    if (result == EPIPHANYDB_SUCCESS && num_sources > 1) {
+        result = columnar_files_write_footer(table);
+    }
+    pthread_mutex_unlock(&delta->merge_mutex);
+
+    free(origins);
+    return result;
+}
@@ -0,0 +1,251 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Block compression for column chunks. Each chunk is compressed with LZ4,
+ * zstd or stored as is, whichever gives the cheapest estimated read: the
+ * measured compressed size at COLUMNAR_READ_BANDWIDTH plus the raw size at
+ * the codec's decompression rate. Codecs missing at build time are skipped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* Read cost model, bytes per second */
+#define COLUMNAR_READ_BANDWIDTH   (500.0 * 1024 * 1024)
+#define COLUMNAR_LZ4_DECODE_RATE  (4000.0 * 1024 * 1024)
+#define COLUMNAR_ZSTD_DECODE_RATE (1000.0 * 1024 * 1024)
+
+/* Levels below this only consider LZ4 when it is available */
+#define COLUMNAR_ZSTD_MIN_LEVEL 3
+
+/* Blocks smaller than this are stored uncompressed */
+#define COLUMNAR_MIN_COMPRESS_SIZE 256
+
+static double columnar_read_cost(ColumnarCodec codec, size_t raw_size, size_t block_size) {
+    double cost = (double)block_size / COLUMNAR_READ_BANDWIDTH;
+
+    switch (codec) {
+        case COLUMNAR_CODEC_LZ4:
+            return cost + (double)raw_size / COLUMNAR_LZ4_DECODE_RATE;
+        case COLUMNAR_CODEC_ZSTD:
+            return cost + (double)raw_size / COLUMNAR_ZSTD_DECODE_RATE;
+        default:
+            return cost;
+    }
+}
+
+/* Compress data with codec into out, returning the payload size or 0 on failure */
+static size_t columnar_codec_compress(ColumnarCodec codec, int level, const void *data, size_t data_size, void *out, size_t out_capacity) {
+    switch (codec) {
+#ifdef HAVE_LZ4
+        case COLUMNAR_CODEC_LZ4:
+            if (data_size > LZ4_MAX_INPUT_SIZE) {
+                return 0;
+            }
+            return (size_t)LZ4_compress_default(data, out, (int)data_size, (int)out_capacity);
+#endif
+#ifdef HAVE_ZSTD
+        case COLUMNAR_CODEC_ZSTD: {
+            int zstd_level = level < ZSTD_maxCLevel() ? level : ZSTD_maxCLevel();
+            size_t result = ZSTD_compress(out, out_capacity, data, data_size, zstd_level);
+            return ZSTD_isError(result) ? 0 : result;
+        }
+#endif
+        default:
+            (void)level;
+            (void)data;
+            (void)data_size;
+            (void)out;
+            (void)out_capacity;
+            return 0;
+    }
+}
+
+static size_t columnar_codec_bound(ColumnarCodec codec, size_t data_size) {
+    switch (codec) {
+#ifdef HAVE_LZ4
+        case COLUMNAR_CODEC_LZ4:
+            return data_size > LZ4_MAX_INPUT_SIZE ? 0 : (size_t)LZ4_compressBound((int)data_size);
+#endif
+#ifdef HAVE_ZSTD
+        case COLUMNAR_CODEC_ZSTD:
+            return ZSTD_compressBound(data_size);
+#endif
+        default:
+            (void)data_size;
+            return 0;
+    }
+}
+
+/*
+ * Compress one chunk image into a self-describing block. level follows
+ * ColumnarStorageContext.compression_level: 0 stores blocks uncompressed,
+ * low levels favour LZ4 and higher ones also try zstd at that level.
+ */
+int columnar_block_compress(const void *data, size_t data_size, int level, void **block, size_t *block_size, ColumnarCodec *codec) {
+    ColumnarCodec candidates[2];
+    size_t num_candidates = 0;
+
+    if ((!data && data_size > 0) || !block || !block_size || !codec) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    if (level > 0 && data_size >= COLUMNAR_MIN_COMPRESS_SIZE) {
+#ifdef HAVE_LZ4
+        candidates[num_candidates++] = COLUMNAR_CODEC_LZ4;
+#endif
+#ifdef HAVE_ZSTD
+        if (level >= COLUMNAR_ZSTD_MIN_LEVEL || num_candidates == 0) {
+            candidates[num_candidates++] = COLUMNAR_CODEC_ZSTD;
+        }
+#endif
+    }
+
+    /* Stored block is the baseline every codec has to beat */
+    ColumnarCodec best_codec = COLUMNAR_CODEC_NONE;
+    uint8_t *best = NULL;
+    size_t best_size = data_size;
+    double best_cost = columnar_read_cost(COLUMNAR_CODEC_NONE, data_size, data_size);
+
+    for (size_t i = 0; i < num_candidates; i++) {
+        size_t bound = columnar_codec_bound(candidates[i], data_size);
+        if (bound == 0) {
+            continue;
+        }
+        uint8_t *out = malloc(sizeof(ColumnarBlockHeader) + bound);
+        if (!out) {
+            free(best);
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+
+        size_t size = columnar_codec_compress(candidates[i], level, data, data_size, out + sizeof(ColumnarBlockHeader), bound);
+        double cost = columnar_read_cost(candidates[i], data_size, size);
+        if (size == 0 || cost >= best_cost) {
+            free(out);
+            /* Data LZ4 cannot shrink is not worth a slower codec either */
+            if (candidates[i] == COLUMNAR_CODEC_LZ4 && (size == 0 || size >= data_size)) {
+                break;
+            }
+            continue;
+        }
+        free(best);
+        best = out;
+        best_size = size;
+        best_cost = cost;
+        best_codec = candidates[i];
+    }
+
+    if (!best) {
+        best = malloc(sizeof(ColumnarBlockHeader) + data_size);
+        if (!best) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        if (data_size > 0) {
+            memcpy(best + sizeof(ColumnarBlockHeader), data, data_size);
+        }
+    }
+
+    ColumnarBlockHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = COLUMNAR_BLOCK_MAGIC;
+    header.codec = (uint8_t)best_codec;
+    header.raw_size = data_size;
+    memcpy(best, &header, sizeof(header));
+
+    *block = best;
+    *block_size = sizeof(ColumnarBlockHeader) + best_size;
+    *codec = best_codec;
+    return EPIPHANYDB_SUCCESS;
+}
+
+int columnar_block_raw_size(const void *block, size_t block_size, size_t *raw_size) {
+    ColumnarBlockHeader header;
+
+    if (!block || block_size < sizeof(header) || !raw_size) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    memcpy(&header, block, sizeof(header));
+    if (header.magic != COLUMNAR_BLOCK_MAGIC) {
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+
+    *raw_size = header.raw_size;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Decompress a block into data, which must hold its raw size. When
+ * codec_context is given, decoder state is kept there across calls so
+ * repeated decompression does not allocate; free it with
+ * columnar_codec_context_free.
+ */
+int columnar_block_decompress(const void *block, size_t block_size, void *data, size_t data_size, void **codec_context) {
+    ColumnarBlockHeader header;
+
+    if (!block || block_size < sizeof(header) || (!data && data_size > 0)) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    memcpy(&header, block, sizeof(header));
+    if (header.magic != COLUMNAR_BLOCK_MAGIC || header.raw_size > data_size) {
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+
+    const uint8_t *payload = (const uint8_t *)block + sizeof(header);
+    size_t payload_size = block_size - sizeof(header);
+
+    switch (header.codec) {
+        case COLUMNAR_CODEC_NONE:
+            if (payload_size != header.raw_size) {
+                return EPIPHANYDB_ERROR_STORAGE;
+            }
+            if (payload_size > 0) {
+                memcpy(data, payload, payload_size);
+            }
+            return EPIPHANYDB_SUCCESS;
+#ifdef HAVE_LZ4
+        case COLUMNAR_CODEC_LZ4: {
+            int result = LZ4_decompress_safe((const char *)payload, data, (int)payload_size, (int)header.raw_size);
+            return result == (int)header.raw_size ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_STORAGE;
+        }
+#endif
+#ifdef HAVE_ZSTD
+        case COLUMNAR_CODEC_ZSTD: {
+            size_t result;
+            if (codec_context) {
+                if (!*codec_context) {
+                    *codec_context = ZSTD_createDCtx();
+                    if (!*codec_context) {
+                        return EPIPHANYDB_ERROR_MEMORY;
+                    }
+                }
+                result = ZSTD_decompressDCtx(*codec_context, data, header.raw_size, payload, payload_size);
+            } else {
+                result = ZSTD_decompress(data, header.raw_size, payload, payload_size);
+            }
+            return !ZSTD_isError(result) && result == header.raw_size ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_STORAGE;
+        }
+#endif
+        default:
+            (void)codec_context;
+            return EPIPHANYDB_ERROR_STORAGE;  /* codec not compiled in */
+    }
+}
+
+void columnar_codec_context_free(void *codec_context) {
+#ifdef HAVE_ZSTD
+    ZSTD_freeDCtx(codec_context);
+#else
+    (void)codec_context;
+#endif
+}
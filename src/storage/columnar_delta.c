@@ -0,0 +1,720 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Write-optimized delta store: row-oriented segments that absorb inserts and
+ * updates, merged into immutable row groups by a background thread that also
+ * compacts row groups whose delete bitmaps grew too dense.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+/* Segment management */
+
+static ColumnarDeltaSegment *columnar_segment_create(void) {
+    return calloc(1, sizeof(ColumnarDeltaSegment));
+}
+
+static void columnar_segment_free(ColumnarDeltaSegment *segment) {
+    if (!segment) {
+        return;
+    }
+    free(segment->data);
+    free(segment->rows);
+    free(segment);
+}
+
+static int columnar_segment_append(ColumnarDeltaSegment *segment, const void *data, size_t data_size) {
+    if (segment->size + data_size > segment->capacity) {
+        size_t capacity = segment->capacity ? segment->capacity * 2 : 64 * 1024;
+        while (capacity < segment->size + data_size) {
+            capacity *= 2;
+        }
+        uint8_t *grown = realloc(segment->data, capacity);
+        if (!grown) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        segment->data = grown;
+        segment->capacity = capacity;
+    }
+    if (segment->num_rows == segment->rows_capacity) {
+        size_t capacity = segment->rows_capacity ? segment->rows_capacity * 2 : 1024;
+        ColumnarDeltaRow *grown = realloc(segment->rows, capacity * sizeof(ColumnarDeltaRow));
+        if (!grown) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        segment->rows = grown;
+        segment->rows_capacity = capacity;
+    }
+
+    ColumnarDeltaRow *row = &segment->rows[segment->num_rows++];
+    row->offset = segment->size;
+    row->length = (uint32_t)data_size;
+    row->dead = false;
+    memcpy(segment->data + segment->size, data, data_size);
+    segment->size += data_size;
+    segment->num_live++;
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Move the active segment to the tail of the frozen list, delta mutex held */
+static void columnar_segment_freeze(ColumnarDeltaStore *delta) {
+    ColumnarDeltaSegment **tail = &delta->frozen;
+
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = delta->active;
+    delta->active = NULL;
+}
+
+/* Store lifecycle */
+
+int columnar_delta_init(ColumnarDeltaStore *delta) {
+    memset(delta, 0, sizeof(ColumnarDeltaStore));
+    if (pthread_mutex_init(&delta->mutex, NULL) != 0) {
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+    if (pthread_mutex_init(&delta->merge_mutex, NULL) != 0) {
+        pthread_mutex_destroy(&delta->mutex);
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+void columnar_delta_destroy(ColumnarDeltaStore *delta) {
+    ColumnarDeltaSegment *segment = delta->frozen;
+
+    while (segment) {
+        ColumnarDeltaSegment *next = segment->next;
+        columnar_segment_free(segment);
+        segment = next;
+    }
+    columnar_segment_free(delta->active);
+    pthread_mutex_destroy(&delta->merge_mutex);
+    pthread_mutex_destroy(&delta->mutex);
+}
+
+/* Append an encoded row, reporting whether a frozen segment awaits merging */
+int columnar_delta_insert(ColumnarTable *table, const void *data, size_t data_size, bool *merge_needed) {
+    ColumnarDeltaStore *delta = &table->delta;
+    int result = EPIPHANYDB_SUCCESS;
+
+    *merge_needed = false;
+
+    pthread_mutex_lock(&delta->mutex);
+    if (!delta->active) {
+        delta->active = columnar_segment_create();
+    }
+    if (!delta->active) {
+        result = EPIPHANYDB_ERROR_MEMORY;
+    } else {
+        result = columnar_segment_append(delta->active, data, data_size);
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        __atomic_add_fetch(&table->num_rows, 1, __ATOMIC_RELAXED);
+        if (delta->active->num_rows >= COLUMNAR_DELTA_MERGE_THRESHOLD) {
+            columnar_segment_freeze(delta);
+            *merge_needed = true;
+        }
+    }
+    pthread_mutex_unlock(&delta->mutex);
+
+    return result;
+}
+
+/* Key matching */
+
+/* Compare the first column of an encoded row against key */
+static bool columnar_row_key_equals(const ColumnarTable *table, const uint8_t *row, ColumnarDatum key) {
+    size_t offset = (table->num_columns + 7) / 8;
+
+    if (row[0] & 1) {
+        return false;  /* NULL keys never match */
+    }
+
+    switch (table->column_types[0]) {
+        case COLUMNAR_TYPE_INT64: {
+            int64_t value;
+            memcpy(&value, row + offset, sizeof(value));
+            return value == key.i64;
+        }
+        case COLUMNAR_TYPE_DOUBLE: {
+            double value;
+            memcpy(&value, row + offset, sizeof(value));
+            return value == key.f64;
+        }
+        default: {
+            uint32_t len;
+            memcpy(&len, row + offset, sizeof(len));
+            return strlen(key.text) == len && memcmp(row + offset + sizeof(len), key.text, len) == 0;
+        }
+    }
+}
+
+static bool columnar_chunk_value_equals(int type, const void *values, const uint8_t *nulls, size_t row, ColumnarDatum key) {
+    if (nulls && nulls[row]) {
+        return false;
+    }
+    switch (type) {
+        case COLUMNAR_TYPE_INT64:
+            return ((const int64_t *)values)[row] == key.i64;
+        case COLUMNAR_TYPE_DOUBLE:
+            return ((const double *)values)[row] == key.f64;
+        default:
+            return strcmp(((char *const *)values)[row], key.text) == 0;
+    }
+}
+
+static void columnar_segment_delete_key(const ColumnarTable *table, ColumnarDeltaSegment *segment, ColumnarDatum key, size_t *num_deleted) {
+    for (size_t i = 0; segment && i < segment->num_rows; i++) {
+        ColumnarDeltaRow *row = &segment->rows[i];
+        if (!row->dead && columnar_row_key_equals(table, segment->data + row->offset, key)) {
+            row->dead = true;
+            segment->num_live--;
+            (*num_deleted)++;
+        }
+    }
+}
+
+/*
+ * Delete every row whose first column equals key: delta rows are dropped in
+ * place, row group rows get a bit in the row group delete bitmap. The table
+ * lock must be held in write mode.
+ */
+int columnar_delta_delete_key(ColumnarTable *table, ColumnarDatum key, size_t *num_deleted) {
+    ColumnarDeltaStore *delta = &table->delta;
+    ColumnarChunkBuffer buffer;
+    int type = table->column_types[0];
+    uint64_t hash = columnar_bloom_hash(type, key);
+    size_t deleted = 0;
+
+    memset(&buffer, 0, sizeof(buffer));
+    for (size_t g = 0; g < table->num_row_groups; g++) {
+        ColumnarRowGroup *row_group = table->row_groups[g];
+        const ColumnarZoneMap *zone_map = &row_group->chunks[0].zone_map;
+        const void *values;
+        const uint8_t *nulls;
+
+        if (!zone_map->has_values ||
+            columnar_compare_datum(type, key, zone_map->min) < 0 ||
+            columnar_compare_datum(type, key, zone_map->max) > 0 ||
+            !columnar_bloom_may_contain(&row_group->chunks[0].bloom, hash)) {
+            continue;
+        }
+        int result = columnar_chunk_load(table, row_group, 0, &buffer, &values, &nulls);
+        if (result != EPIPHANYDB_SUCCESS) {
+            columnar_chunk_buffer_free(&buffer);
+            return result;
+        }
+        for (size_t r = 0; r < row_group->num_rows; r++) {
+            bool added = false;
+            if (!columnar_chunk_value_equals(type, values, nulls, r, key)) {
+                continue;
+            }
+            result = columnar_bitmap_add(&row_group->deleted, (uint32_t)r, &added);
+            if (result != EPIPHANYDB_SUCCESS) {
+                columnar_chunk_buffer_free(&buffer);
+                return result;
+            }
+            if (added) {
+                row_group->num_deleted++;
+                deleted++;
+            }
+        }
+        if (row_group->num_deleted > row_group->num_rows * COLUMNAR_COMPACT_THRESHOLD) {
+            __atomic_store_n(&delta->compact_pending, true, __ATOMIC_RELAXED);
+        }
+    }
+    columnar_chunk_buffer_free(&buffer);
+
+    pthread_mutex_lock(&delta->mutex);
+    for (ColumnarDeltaSegment *segment = delta->frozen; segment; segment = segment->next) {
+        columnar_segment_delete_key(table, segment, key, &deleted);
+    }
+    columnar_segment_delete_key(table, delta->active, key, &deleted);
+    pthread_mutex_unlock(&delta->mutex);
+
+    __atomic_sub_fetch(&table->num_rows, deleted, __ATOMIC_RELAXED);
+    *num_deleted = deleted;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Scans and merges */
+
+/* Decode the live rows of a segment into a row group */
+static int columnar_segment_build(const ColumnarTable *table, const ColumnarDeltaSegment *segment, ColumnarRowGroup *row_group, ColumnarDatum *values, bool *nulls, size_t *included) {
+    for (size_t i = 0; i < segment->num_rows; i++) {
+        const ColumnarDeltaRow *row = &segment->rows[i];
+        char *text_buffer = NULL;
+
+        if (row->dead) {
+            continue;
+        }
+        int result = columnar_decode_row(table, segment->data + row->offset, row->length, values, nulls, &text_buffer);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = columnar_row_group_append(table, row_group, values, nulls);
+        }
+        free(text_buffer);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+        if (included) {
+            included[row_group->num_rows - 1] = i;
+        }
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Materialize every live delta row as one temporary row group so scans can
+ * run the same batch operators over it. The table lock is held by the scan.
+ */
+int columnar_delta_snapshot(ColumnarTable *table, ColumnarRowGroup **row_group) {
+    ColumnarDeltaStore *delta = &table->delta;
+    int result = EPIPHANYDB_SUCCESS;
+
+    *row_group = NULL;
+
+    ColumnarDatum *values = malloc(table->num_columns * sizeof(ColumnarDatum));
+    bool *nulls = malloc(table->num_columns * sizeof(bool));
+    if (!values || !nulls) {
+        free(values);
+        free(nulls);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    pthread_mutex_lock(&delta->mutex);
+    size_t live = delta->active ? delta->active->num_live : 0;
+    for (ColumnarDeltaSegment *segment = delta->frozen; segment; segment = segment->next) {
+        live += segment->num_live;
+    }
+    if (live > 0) {
+        ColumnarRowGroup *snapshot = columnar_row_group_create(table);
+        if (!snapshot) {
+            result = EPIPHANYDB_ERROR_MEMORY;
+        }
+        for (ColumnarDeltaSegment *segment = delta->frozen; segment && result == EPIPHANYDB_SUCCESS; segment = segment->next) {
+            result = columnar_segment_build(table, segment, snapshot, values, nulls, NULL);
+        }
+        if (result == EPIPHANYDB_SUCCESS && delta->active) {
+            result = columnar_segment_build(table, delta->active, snapshot, values, nulls, NULL);
+        }
+        if (result == EPIPHANYDB_SUCCESS) {
+            snapshot->id = UINT64_MAX;
+            *row_group = snapshot;
+        } else {
+            columnar_row_group_free(table, snapshot);
+        }
+    }
+    pthread_mutex_unlock(&delta->mutex);
+
+    free(values);
+    free(nulls);
+    return result;
+}
+
+/*
+ * Put a freshly built row group into cluster key order, keeping included
+ * pointing at the segment row of every row group row.
+ */
+static int columnar_merge_clustered(const ColumnarTable *table, ColumnarRowGroup **row_group, size_t *included, ColumnarRowOrigin *origins) {
+    ColumnarRowGroup *sorted = NULL;
+    size_t num_sorted = 0;
+
+    int result = columnar_cluster_rows(table, row_group, 1, &sorted, &num_sorted, origins);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+    if (num_sorted == 0) {
+        return EPIPHANYDB_SUCCESS;  /* no rows */
+    }
+
+    /* Segment rows are dropped before building, never by the delete bitmap */
+    for (size_t r = 0; r < sorted->num_rows; r++) {
+        origins[r].source = (uint32_t)included[origins[r].row];
+    }
+    for (size_t r = 0; r < sorted->num_rows; r++) {
+        included[r] = origins[r].source;
+    }
+    columnar_row_group_free(table, *row_group);
+    *row_group = sorted;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Compact frozen segments into sealed row groups. Segments are decoded under
+ * the read lock so scans and inserts continue; publication swaps the segment
+ * for its row group under the write lock, re-checking rows deleted meanwhile.
+ */
+int columnar_delta_merge(ColumnarTable *table, bool flush_active) {
+    ColumnarDeltaStore *delta = &table->delta;
+    int result = EPIPHANYDB_SUCCESS;
+    bool merged = false;
+
+    ColumnarDatum *values = malloc(table->num_columns * sizeof(ColumnarDatum));
+    bool *nulls = malloc(table->num_columns * sizeof(bool));
+    size_t *included = malloc(COLUMNAR_ROW_GROUP_SIZE * sizeof(size_t));
+    ColumnarRowOrigin *origins = malloc(COLUMNAR_ROW_GROUP_SIZE * sizeof(ColumnarRowOrigin));
+    if (!values || !nulls || !included || !origins) {
+        free(values);
+        free(nulls);
+        free(included);
+        free(origins);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    pthread_mutex_lock(&delta->merge_mutex);
+
+    if (flush_active) {
+        pthread_mutex_lock(&delta->mutex);
+        if (delta->active && delta->active->num_rows > 0) {
+            columnar_segment_freeze(delta);
+        }
+        pthread_mutex_unlock(&delta->mutex);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&delta->mutex);
+        ColumnarDeltaSegment *segment = delta->frozen;
+        pthread_mutex_unlock(&delta->mutex);
+        if (!segment) {
+            break;
+        }
+
+        ColumnarRowGroup *row_group = columnar_row_group_create(table);
+        if (!row_group) {
+            result = EPIPHANYDB_ERROR_MEMORY;
+            break;
+        }
+
+        pthread_rwlock_rdlock(&table->lock);
+        result = columnar_segment_build(table, segment, row_group, values, nulls, included);
+        pthread_rwlock_unlock(&table->lock);
+        if (result == EPIPHANYDB_SUCCESS && table->cluster_kind != COLUMNAR_CLUSTER_NONE) {
+            result = columnar_merge_clustered(table, &row_group, included, origins);
+        }
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = columnar_row_group_persist(table, row_group);
+        }
+        if (result != EPIPHANYDB_SUCCESS) {
+            columnar_row_group_free(table, row_group);
+            break;
+        }
+
+        pthread_rwlock_wrlock(&table->lock);
+        /* Rows deleted while the row group was being built */
+        for (size_t r = 0; r < row_group->num_rows && result == EPIPHANYDB_SUCCESS; r++) {
+            bool added = false;
+            if (segment->rows[included[r]].dead) {
+                result = columnar_bitmap_add(&row_group->deleted, (uint32_t)r, &added);
+                row_group->num_deleted += added;
+            }
+        }
+        if (result == EPIPHANYDB_SUCCESS && row_group->num_rows > row_group->num_deleted) {
+            result = columnar_publish_row_group(table, row_group);
+            if (result != EPIPHANYDB_SUCCESS) {
+                columnar_row_group_free(table, row_group);
+            }
+        } else {
+            columnar_row_group_free(table, row_group);
+        }
+        if (result == EPIPHANYDB_SUCCESS) {
+            pthread_mutex_lock(&delta->mutex);
+            delta->frozen = segment->next;
+            pthread_mutex_unlock(&delta->mutex);
+            columnar_segment_free(segment);
+        }
+        pthread_rwlock_unlock(&table->lock);
+
+        if (result != EPIPHANYDB_SUCCESS) {
+            break;
+        }
+        merged = true;
+    }
+
+    if (merged) {
+        int footer_result = columnar_files_write_footer(table);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = footer_result;
+        }
+    }
+    pthread_mutex_unlock(&delta->merge_mutex);
+
+    free(values);
+    free(nulls);
+    free(included);
+    free(origins);
+    return result;
+}
+
+/* Compaction */
+
+/* Copy the rows of source missing from its delete bitmap into target */
+static int columnar_row_group_rewrite(const ColumnarTable *table, const ColumnarRowGroup *source, ColumnarRowGroup *target, ColumnarChunkBuffer *buffers, ColumnarDatum *values, bool *nulls, uint16_t *selection, uint32_t *included) {
+    const void **chunk_values = malloc(table->num_columns * sizeof(void *));
+    const uint8_t **chunk_nulls = malloc(table->num_columns * sizeof(uint8_t *));
+    int result = chunk_values && chunk_nulls ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+
+    for (size_t c = 0; c < table->num_columns && result == EPIPHANYDB_SUCCESS; c++) {
+        result = columnar_chunk_load(table, source, c, &buffers[c], &chunk_values[c], &chunk_nulls[c]);
+    }
+
+    for (size_t first = 0; first < source->num_rows && result == EPIPHANYDB_SUCCESS; first += COLUMNAR_BATCH_SIZE) {
+        size_t n = source->num_rows - first;
+        if (n > COLUMNAR_BATCH_SIZE) {
+            n = COLUMNAR_BATCH_SIZE;
+        }
+        for (size_t i = 0; i < n; i++) {
+            selection[i] = (uint16_t)i;
+        }
+        n = columnar_bitmap_filter(&source->deleted, (uint32_t)first, selection, n);
+
+        for (size_t i = 0; i < n && result == EPIPHANYDB_SUCCESS; i++) {
+            size_t row = first + selection[i];
+            for (size_t c = 0; c < table->num_columns; c++) {
+                nulls[c] = chunk_nulls[c] && chunk_nulls[c][row];
+                switch (table->column_types[c]) {
+                    case COLUMNAR_TYPE_INT64:
+                        values[c].i64 = ((const int64_t *)chunk_values[c])[row];
+                        break;
+                    case COLUMNAR_TYPE_DOUBLE:
+                        values[c].f64 = ((const double *)chunk_values[c])[row];
+                        break;
+                    default:
+                        values[c].text = ((char *const *)chunk_values[c])[row];
+                        break;
+                }
+            }
+            result = columnar_row_group_append(table, target, values, nulls);
+            if (result == EPIPHANYDB_SUCCESS) {
+                included[target->num_rows - 1] = (uint32_t)row;
+            }
+        }
+    }
+
+    free(chunk_values);
+    free(chunk_nulls);
+    return result;
+}
+
+/*
+ * Rewrite row groups whose deleted fraction exceeds COLUMNAR_COMPACT_THRESHOLD
+ * without their deleted rows, dropping row groups left empty. Like merges,
+ * the copy runs under the read lock and the swap under the write lock.
+ */
+int columnar_compact_row_groups(ColumnarTable *table) {
+    ColumnarDeltaStore *delta = &table->delta;
+    int result = EPIPHANYDB_SUCCESS;
+    bool compacted = false;
+
+    ColumnarDatum *values = malloc(table->num_columns * sizeof(ColumnarDatum));
+    bool *nulls = malloc(table->num_columns * sizeof(bool));
+    uint16_t *selection = malloc(COLUMNAR_BATCH_SIZE * sizeof(uint16_t));
+    uint32_t *included = malloc(COLUMNAR_ROW_GROUP_SIZE * sizeof(uint32_t));
+    ColumnarChunkBuffer *buffers = calloc(table->num_columns, sizeof(ColumnarChunkBuffer));
+    if (!values || !nulls || !selection || !included || !buffers) {
+        free(values);
+        free(nulls);
+        free(selection);
+        free(included);
+        free(buffers);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    /* Row group positions only change under merge_mutex */
+    pthread_mutex_lock(&delta->merge_mutex);
+
+    pthread_rwlock_rdlock(&table->lock);
+    __atomic_store_n(&delta->compact_pending, false, __ATOMIC_RELAXED);
+    size_t num_row_groups = table->num_row_groups;
+    pthread_rwlock_unlock(&table->lock);
+
+    size_t g = 0;
+    while (g < num_row_groups) {
+        ColumnarRowGroup *target = NULL;
+
+        pthread_rwlock_rdlock(&table->lock);
+        ColumnarRowGroup *source = table->row_groups[g];
+        bool dense = source->num_deleted > source->num_rows * COLUMNAR_COMPACT_THRESHOLD;
+        if (dense) {
+            target = columnar_row_group_create(table);
+            result = target ? columnar_row_group_rewrite(table, source, target, buffers, values, nulls, selection, included)
+                            : EPIPHANYDB_ERROR_MEMORY;
+        }
+        pthread_rwlock_unlock(&table->lock);
+
+        if (!dense) {
+            g++;
+            continue;
+        }
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = columnar_row_group_persist(table, target);
+        }
+        if (result != EPIPHANYDB_SUCCESS) {
+            columnar_row_group_free(table, target);
+            break;
+        }
+
+        pthread_rwlock_wrlock(&table->lock);
+        /* Rows deleted while the copy was being built */
+        for (size_t r = 0; r < target->num_rows && result == EPIPHANYDB_SUCCESS; r++) {
+            bool added = false;
+            if (columnar_bitmap_contains(&source->deleted, included[r])) {
+                result = columnar_bitmap_add(&target->deleted, (uint32_t)r, &added);
+                target->num_deleted += added;
+            }
+        }
+        if (result != EPIPHANYDB_SUCCESS) {
+            columnar_row_group_free(table, target);
+        } else if (target->num_rows > target->num_deleted) {
+            target->id = table->next_row_group_id++;
+            target->sealed = true;
+            target->clustered = source->clustered;
+            table->row_groups[g++] = target;
+            columnar_row_group_free(table, source);
+        } else {
+            memmove(table->row_groups + g, table->row_groups + g + 1,
+                    (table->num_row_groups - g - 1) * sizeof(ColumnarRowGroup *));
+            table->num_row_groups--;
+            num_row_groups--;
+            columnar_row_group_free(table, target);
+            columnar_row_group_free(table, source);
+        }
+        pthread_rwlock_unlock(&table->lock);
+
+        if (result != EPIPHANYDB_SUCCESS) {
+            break;
+        }
+        compacted = true;
+    }
+
+    if (compacted) {
+        int footer_result = columnar_files_write_footer(table);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = footer_result;
+        }
+    }
+    pthread_mutex_unlock(&delta->merge_mutex);
+
+    free(values);
+    free(nulls);
+    free(selection);
+    free(included);
+    for (size_t c = 0; c < table->num_columns; c++) {
+        columnar_chunk_buffer_free(&buffers[c]);
+    }
+    free(buffers);
+    return result;
+}
+
+/* Background merger */
+
+static void *columnar_merger_main(void *arg) {
+    ColumnarStorageContext *ctx = arg;
+
+    pthread_mutex_lock(&ctx->merge_mutex);
+    while (!ctx->shutdown) {
+        while (!ctx->merge_pending && !ctx->shutdown) {
+            pthread_cond_wait(&ctx->merge_cond, &ctx->merge_mutex);
+        }
+        if (ctx->shutdown) {
+            break;
+        }
+        ctx->merge_pending = false;
+        ColumnarTable *tables = ctx->tables;
+        pthread_mutex_unlock(&ctx->merge_mutex);
+
+        /* Tables are only freed after the merger has been stopped */
+        for (ColumnarTable *table = tables; table; table = table->next) {
+            columnar_delta_merge(table, false);
+            if (__atomic_load_n(&table->delta.compact_pending, __ATOMIC_RELAXED)) {
+                columnar_compact_row_groups(table);
+            }
+            columnar_cluster_row_groups(table, COLUMNAR_CLUSTER_TRIGGER);
+        }
+
+        pthread_mutex_lock(&ctx->merge_mutex);
+    }
+    pthread_mutex_unlock(&ctx->merge_mutex);
+
+    return NULL;
+}
+
+int columnar_merger_start(ColumnarStorageContext *ctx) {
+    ctx->shutdown = false;
+    ctx->merge_pending = false;
+    if (pthread_create(&ctx->merger, NULL, columnar_merger_main, ctx) != 0) {
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+    ctx->merger_running = true;
+    return EPIPHANYDB_SUCCESS;
+}
+
+void columnar_merger_stop(ColumnarStorageContext *ctx) {
+    if (!ctx->merger_running) {
+        return;
+    }
+
+    pthread_mutex_lock(&ctx->merge_mutex);
+    ctx->shutdown = true;
+    pthread_cond_signal(&ctx->merge_cond);
+    pthread_mutex_unlock(&ctx->merge_mutex);
+
+    pthread_join(ctx->merger, NULL);
+    ctx->merger_running = false;
+}
+
+void columnar_merger_request(ColumnarStorageContext *ctx) {
+    pthread_mutex_lock(&ctx->merge_mutex);
+    ctx->merge_pending = true;
+    pthread_cond_signal(&ctx->merge_cond);
+    pthread_mutex_unlock(&ctx->merge_mutex);
+}
+
+/* Synchronously merge every buffered delta row into row groups */
+int columnar_flush_delta(EpiphanyDBTable *table) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    return columnar_delta_merge(col_table, true);
+}
+
+static bool columnar_has_unclustered(ColumnarTable *table) {
+    bool found = false;
+
+    if (table->cluster_kind == COLUMNAR_CLUSTER_NONE) {
+        return false;
+    }
+    pthread_rwlock_rdlock(&table->lock);
+    for (size_t g = 0; g < table->num_row_groups && !found; g++) {
+        found = !table->row_groups[g]->clustered;
+    }
+    pthread_rwlock_unlock(&table->lock);
+    return found;
+}
+
+/*
+ * Synchronously rewrite row groups whose delete bitmaps crossed the
+ * threshold, then cluster every row group not yet in cluster key order.
+ */
+int columnar_compact_table(EpiphanyDBTable *table) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int result = columnar_compact_row_groups(col_table);
+    while (result == EPIPHANYDB_SUCCESS && columnar_has_unclustered(col_table)) {
+        result = columnar_cluster_row_groups(col_table, 1);
+    }
+    return result;
+}
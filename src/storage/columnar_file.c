@@ -0,0 +1,484 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Column files: every column of a table has its own append-only file under
+ * <data_directory>/<table>/ holding one compressed block per sealed chunk,
+ * each followed by the chunk's bloom filter, and a footer indexing the live
+ * chunks. Chunks are read back with pread into per-scan buffers, so
+ * concurrent scans share the descriptors without seeking.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+/* File management */
+
+/* Create empty column files for a new table, replacing leftovers */
+int columnar_files_create(ColumnarTable *table, const char *data_directory) {
+    char path[1024];
+
+    int len = snprintf(path, sizeof(path), "%s/%s", data_directory, table->table_name);
+    if (len < 0 || (size_t)len >= sizeof(path)) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        return EPIPHANYDB_ERROR_IO;
+    }
+
+    table->column_files = calloc(table->num_columns, sizeof(char *));
+    table->column_fds = malloc(table->num_columns * sizeof(int));
+    table->column_file_sizes = calloc(table->num_columns, sizeof(uint64_t));
+    if (!table->column_files || !table->column_fds || !table->column_file_sizes) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    for (size_t c = 0; c < table->num_columns; c++) {
+        table->column_fds[c] = -1;
+    }
+
+    for (size_t c = 0; c < table->num_columns; c++) {
+        len = snprintf(path, sizeof(path), "%s/%s/%s.col", data_directory, table->table_name, table->column_names[c]);
+        if (len < 0 || (size_t)len >= sizeof(path)) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        table->column_files[c] = strdup(path);
+        if (!table->column_files[c]) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        table->column_fds[c] = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (table->column_fds[c] < 0) {
+            return EPIPHANYDB_ERROR_IO;
+        }
+    }
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+void columnar_files_close(ColumnarTable *table) {
+    for (size_t c = 0; table->column_fds && c < table->num_columns; c++) {
+        if (table->column_fds[c] >= 0) {
+            close(table->column_fds[c]);
+        }
+    }
+    free(table->column_fds);
+    free(table->column_file_sizes);
+    table->column_fds = NULL;
+    table->column_file_sizes = NULL;
+}
+
+static int columnar_write_all(int fd, const void *data, size_t size, uint64_t offset) {
+    const uint8_t *p = data;
+
+    while (size > 0) {
+        ssize_t written = pwrite(fd, p, size, (off_t)offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return EPIPHANYDB_ERROR_IO;
+        }
+        p += written;
+        size -= (size_t)written;
+        offset += (uint64_t)written;
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+static int columnar_read_all(int fd, void *data, size_t size, uint64_t offset) {
+    uint8_t *p = data;
+
+    while (size > 0) {
+        ssize_t bytes = pread(fd, p, size, (off_t)offset);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return EPIPHANYDB_ERROR_IO;
+        }
+        if (bytes == 0) {
+            return EPIPHANYDB_ERROR_IO;  /* truncated column file */
+        }
+        p += bytes;
+        size -= (size_t)bytes;
+        offset += (uint64_t)bytes;
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Chunk images */
+
+/* Serialize a chunk into values followed by the null bytes, if any */
+static int columnar_chunk_image(int type, const ColumnarChunk *chunk, size_t num_rows, uint8_t **image, size_t *image_size) {
+    size_t values_size;
+    size_t nulls_size = chunk->nulls ? num_rows : 0;
+
+    if (type == COLUMNAR_TYPE_TEXT) {
+        char *const *texts = chunk->values;
+        values_size = num_rows * sizeof(uint32_t);
+        for (size_t r = 0; r < num_rows; r++) {
+            values_size += texts[r] ? strlen(texts[r]) + 1 : 1;
+        }
+    } else {
+        values_size = num_rows * sizeof(int64_t);
+    }
+
+    uint8_t *out = malloc(values_size + nulls_size + 1);
+    if (!out) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    if (type == COLUMNAR_TYPE_TEXT) {
+        char *const *texts = chunk->values;
+        uint32_t *offsets = (uint32_t *)out;
+        char *strings = (char *)(out + num_rows * sizeof(uint32_t));
+        uint32_t offset = 0;
+        for (size_t r = 0; r < num_rows; r++) {
+            const char *text = texts[r] ? texts[r] : "";
+            size_t len = strlen(text) + 1;
+            offsets[r] = offset;
+            memcpy(strings + offset, text, len);
+            offset += (uint32_t)len;
+        }
+    } else if (num_rows > 0) {
+        memcpy(out, chunk->values, values_size);
+    }
+    if (nulls_size > 0) {
+        memcpy(out + values_size, chunk->nulls, nulls_size);
+    }
+
+    *image = out;
+    *image_size = values_size + nulls_size;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Drop the in-memory values of a chunk that now lives in its column file */
+static void columnar_chunk_release(int type, ColumnarChunk *chunk, size_t num_rows) {
+    if (type == COLUMNAR_TYPE_TEXT) {
+        char **texts = chunk->values;
+        for (size_t r = 0; texts && r < num_rows; r++) {
+            free(texts[r]);
+        }
+    }
+    free(chunk->values);
+    free(chunk->nulls);
+    chunk->values = NULL;
+    chunk->nulls = NULL;
+    chunk->capacity = 0;
+}
+
+/*
+ * Build the bloom filters and statistics of a row group that is about to be published,
+ * then compress every chunk and append it to its column file followed by
+ * its filter. Caller holds delta.merge_mutex, which serializes appends;
+ * the row group is not yet visible to scans.
+ */
+int columnar_row_group_persist(ColumnarTable *table, ColumnarRowGroup *row_group) {
+    for (size_t c = 0; c < table->num_columns; c++) {
+        int result = columnar_bloom_build(table->column_types[c], &row_group->chunks[c], row_group->num_rows,
+                                          table->bloom_bits_per_key, &row_group->chunks[c].bloom);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = columnar_stats_build(table->column_types[c], &row_group->chunks[c], row_group->num_rows,
+                                          &row_group->chunks[c].stats);
+        }
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+    }
+
+    if (!table->column_fds) {
+        return EPIPHANYDB_SUCCESS;  /* in-memory table */
+    }
+
+    for (size_t c = 0; c < table->num_columns; c++) {
+        ColumnarChunk *chunk = &row_group->chunks[c];
+        int type = table->column_types[c];
+        uint64_t offset = table->column_file_sizes[c];
+        uint8_t *image = NULL;
+        size_t image_size = 0;
+        void *block = NULL;
+        size_t block_size = 0;
+        ColumnarCodec codec;
+
+        int result = columnar_chunk_image(type, chunk, row_group->num_rows, &image, &image_size);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+        result = columnar_block_compress(image, image_size, table->compression_level, &block, &block_size, &codec);
+        free(image);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+        result = columnar_write_all(table->column_fds[c], block, block_size, offset);
+        free(block);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+
+        size_t bloom_size = columnar_bloom_size(&chunk->bloom);
+        if (bloom_size > 0) {
+            result = columnar_write_all(table->column_fds[c], chunk->bloom.blocks, bloom_size, offset + block_size);
+            if (result != EPIPHANYDB_SUCCESS) {
+                return result;
+            }
+            chunk->bloom_offset = offset + block_size;
+        }
+
+        chunk->file_offset = offset;
+        chunk->block_size = block_size;
+        chunk->raw_size = image_size;
+        chunk->has_nulls = chunk->nulls != NULL;
+        chunk->codec = codec;
+        table->column_file_sizes[c] += block_size + bloom_size;
+        columnar_chunk_release(type, chunk, row_group->num_rows);
+    }
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Rewrite the footer of every column file behind its last block, listing
+ * the chunks of the current row groups. Caller holds delta.merge_mutex, so
+ * row groups are neither published nor replaced meanwhile; the next append
+ * overwrites the footer and writes a new one.
+ */
+int columnar_files_write_footer(ColumnarTable *table) {
+    if (!table->column_fds) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t num_entries = table->num_row_groups;
+    int result = EPIPHANYDB_SUCCESS;
+    for (size_t c = 0; c < table->num_columns && result == EPIPHANYDB_SUCCESS; c++) {
+        ColumnarType type = table->column_types[c];
+        size_t stats_size = 0;
+        for (size_t g = 0; g < num_entries; g++) {
+            stats_size += columnar_stats_serialize(type, &table->row_groups[g]->chunks[c], NULL);
+        }
+
+        size_t footer_size = num_entries * sizeof(ColumnarFooterEntry) + stats_size + sizeof(ColumnarFileTrailer);
+        uint8_t *footer = calloc(1, footer_size);
+        if (!footer) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+
+        ColumnarFooterEntry *entries = (ColumnarFooterEntry *)footer;
+        uint8_t *stats = footer + num_entries * sizeof(ColumnarFooterEntry);
+        ColumnarFileTrailer trailer;
+        for (size_t g = 0; g < num_entries; g++) {
+            const ColumnarRowGroup *row_group = table->row_groups[g];
+            const ColumnarChunk *chunk = &row_group->chunks[c];
+            entries[g].row_group_id = row_group->id;
+            entries[g].num_rows = row_group->num_rows;
+            entries[g].block_offset = chunk->file_offset;
+            entries[g].block_size = chunk->block_size;
+            entries[g].bloom_offset = chunk->bloom_offset;
+            entries[g].bloom_blocks = chunk->bloom.num_blocks;
+            entries[g].stats_size = (uint32_t)columnar_stats_serialize(type, chunk, stats);
+            stats += entries[g].stats_size;
+        }
+        trailer.footer_offset = table->column_file_sizes[c];
+        trailer.num_entries = (uint32_t)num_entries;
+        trailer.magic = COLUMNAR_FOOTER_MAGIC;
+        memcpy(footer + footer_size - sizeof(trailer), &trailer, sizeof(trailer));
+
+        result = columnar_write_all(table->column_fds[c], footer, footer_size, table->column_file_sizes[c]);
+        if (result == EPIPHANYDB_SUCCESS && ftruncate(table->column_fds[c], (off_t)(table->column_file_sizes[c] + footer_size)) != 0) {
+            result = EPIPHANYDB_ERROR_IO;
+        }
+        free(footer);
+    }
+
+    return result;
+}
+
+/* Chunk reads */
+
+static int columnar_buffer_reserve(void **buffer, size_t *capacity, size_t size) {
+    if (size <= *capacity) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t grown_capacity = *capacity ? *capacity : 4096;
+    while (grown_capacity < size) {
+        grown_capacity *= 2;
+    }
+    void *grown = realloc(*buffer, grown_capacity);
+    if (!grown) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    *buffer = grown;
+    *capacity = grown_capacity;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Point values and nulls at the decompressed data of a chunk, filling texts for TEXT chunks */
+static void columnar_chunk_decode(int type, const ColumnarChunk *chunk, size_t num_rows, uint8_t *data, char **texts, const void **values, const uint8_t **nulls) {
+    const uint8_t *chunk_nulls = chunk->has_nulls ? data + chunk->raw_size - num_rows : NULL;
+
+    if (type == COLUMNAR_TYPE_TEXT) {
+        const uint32_t *offsets = (const uint32_t *)data;
+        char *strings = (char *)(data + num_rows * sizeof(uint32_t));
+        for (size_t r = 0; r < num_rows; r++) {
+            texts[r] = chunk_nulls && chunk_nulls[r] ? NULL : strings + offsets[r];
+        }
+        *values = texts;
+    } else {
+        *values = data;
+    }
+    *nulls = chunk_nulls;
+}
+
+/* True when the block of chunk lies in the coalesced read window of buffer */
+bool columnar_chunk_buffered(const ColumnarChunkBuffer *buffer, const ColumnarChunk *chunk) {
+    return chunk->block_size > 0 && buffer->window_size > 0 && chunk->file_offset >= buffer->window_offset &&
+           chunk->file_offset + chunk->block_size <= buffer->window_offset + buffer->window_size;
+}
+
+/*
+ * Read the blocks of column for row_groups[0..count) with a single read
+ * while they follow each other closely in the column file, so that the
+ * next loads of those chunks into buffer need no I/O. The span ends at the
+ * first chunk that is held in memory, out of file order, too far away or
+ * beyond COLUMNAR_COALESCE_MAX_BYTES. Row groups must be published.
+ */
+int columnar_chunk_prefetch(const ColumnarTable *table, ColumnarRowGroup *const *row_groups, size_t count, size_t column, ColumnarChunkBuffer *buffer) {
+    if (count == 0 || columnar_chunk_buffered(buffer, &row_groups[0]->chunks[column]) ||
+        row_groups[0]->chunks[column].block_size == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    uint64_t start = row_groups[0]->chunks[column].file_offset;
+    uint64_t end = start + row_groups[0]->chunks[column].block_size;
+    size_t span = 1;
+    for (; span < count; span++) {
+        const ColumnarChunk *chunk = &row_groups[span]->chunks[column];
+        if (chunk->block_size == 0 || chunk->file_offset < end || chunk->file_offset - end > COLUMNAR_COALESCE_GAP_BYTES ||
+            chunk->file_offset + chunk->block_size - start > COLUMNAR_COALESCE_MAX_BYTES) {
+            break;
+        }
+        end = chunk->file_offset + chunk->block_size;
+    }
+    if (span == 1) {
+        return EPIPHANYDB_SUCCESS;  /* nothing to coalesce, load the block on its own */
+    }
+
+    int result = columnar_buffer_reserve((void **)&buffer->window, &buffer->window_capacity, (size_t)(end - start));
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = columnar_read_all(table->column_fds[column], buffer->window, (size_t)(end - start), start);
+    }
+    buffer->window_offset = start;
+    buffer->window_size = result == EPIPHANYDB_SUCCESS ? (size_t)(end - start) : 0;
+    return result;
+}
+
+/*
+ * Point values and nulls at one chunk of a row group. Chunks still held in
+ * memory are returned in place; chunks in the column file are read, or
+ * taken from the prefetched window, and decompressed into buffer, valid
+ * until the next load into the same buffer.
+ */
+int columnar_chunk_load(const ColumnarTable *table, const ColumnarRowGroup *row_group, size_t column, ColumnarChunkBuffer *buffer, const void **values, const uint8_t **nulls) {
+    const ColumnarChunk *chunk = &row_group->chunks[column];
+    size_t num_rows = row_group->num_rows;
+
+    if (chunk->block_size == 0) {
+        *values = chunk->values;
+        *nulls = chunk->nulls;
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    int result = columnar_buffer_reserve((void **)&buffer->data, &buffer->data_capacity, chunk->raw_size);
+    const uint8_t *block = NULL;
+    if (result == EPIPHANYDB_SUCCESS && columnar_chunk_buffered(buffer, chunk)) {
+        block = buffer->window + (chunk->file_offset - buffer->window_offset);
+    } else if (result == EPIPHANYDB_SUCCESS) {
+        result = columnar_buffer_reserve((void **)&buffer->block, &buffer->block_capacity, chunk->block_size);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = columnar_read_all(table->column_fds[column], buffer->block, chunk->block_size, chunk->file_offset);
+        }
+        block = buffer->block;
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = columnar_block_decompress(block, chunk->block_size, buffer->data, chunk->raw_size, &buffer->codec_context);
+    }
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    if (table->column_types[column] == COLUMNAR_TYPE_TEXT) {
+        result = columnar_buffer_reserve((void **)&buffer->texts, &buffer->texts_capacity, num_rows * sizeof(char *));
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+    }
+    columnar_chunk_decode(table->column_types[column], chunk, num_rows, buffer->data, buffer->texts, values, nulls);
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * columnar_chunk_load through the scan cache: a chunk read from the column
+ * file is decoded once and kept in cache, pinned in *entry until released.
+ * Chunks held in memory bypass the cache and leave *entry NULL.
+ */
+int columnar_chunk_load_cached(const ColumnarTable *table, const ColumnarRowGroup *row_group, size_t column, ColumnarChunkBuffer *buffer, ColumnarCacheEntry **entry, const void **values, const uint8_t **nulls) {
+    const ColumnarChunk *chunk = &row_group->chunks[column];
+    ColumnarCacheKey key = {table->cache_id, row_group->id, (uint32_t)column, 0};
+
+    *entry = NULL;
+    if (!table->cache || chunk->block_size == 0) {
+        return columnar_chunk_load(table, row_group, column, buffer, values, nulls);
+    }
+
+    ColumnarCacheEntry *cached = columnar_cache_lookup(table->cache, &key);
+    if (cached) {
+        *entry = cached;
+        *values = cached->values;
+        *nulls = cached->nulls;
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    int result = columnar_chunk_load(table, row_group, column, buffer, values, nulls);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    /* Keep a copy of the decompressed chunk, TEXT pointers ahead of it */
+    int type = table->column_types[column];
+    size_t num_rows = row_group->num_rows;
+    size_t texts_size = type == COLUMNAR_TYPE_TEXT ? num_rows * sizeof(char *) : 0;
+    cached = columnar_cache_entry_alloc(&key, texts_size + chunk->raw_size);
+    if (!cached) {
+        return EPIPHANYDB_SUCCESS;  /* the cache is an optimization, serve the scan from buffer */
+    }
+    memcpy(cached->data + texts_size, buffer->data, chunk->raw_size);
+    columnar_chunk_decode(type, chunk, num_rows, cached->data + texts_size, (char **)cached->data,
+                          &cached->values, &cached->nulls);
+    cached->num_rows = num_rows;
+    columnar_cache_insert(table->cache, cached);
+
+    *entry = cached;
+    *values = cached->values;
+    *nulls = cached->nulls;
+    return EPIPHANYDB_SUCCESS;
+}
+
+void columnar_chunk_buffer_free(ColumnarChunkBuffer *buffer) {
+    if (!buffer) {
+        return;
+    }
+    free(buffer->block);
+    free(buffer->data);
+    free(buffer->texts);
+    free(buffer->window);
+    if (buffer->codec_context) {
+        columnar_codec_context_free(buffer->codec_context);
+    }
+    memset(buffer, 0, sizeof(ColumnarChunkBuffer));
+}
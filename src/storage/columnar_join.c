@@ -0,0 +1,243 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Runtime join filters. The small side of a join collects its join keys
+ * into a range and a bloom filter, which scans of the large side apply as
+ * an extra predicate: row groups whose zone maps fall outside the range, or
+ * whose chunk bloom filters hold none of a few keys, are skipped unread, and
+ * the remaining rows are filtered before they reach the join.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+static int columnar_compare_hash(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Filter construction */
+
+/*
+ * Build a filter from num_keys join keys of the given type; nulls may be
+ * NULL when no key is NULL. TEXT keys are not referenced once built.
+ */
+int columnar_join_filter_build(ColumnarType type, const ColumnarDatum *keys, const bool *nulls, size_t num_keys, ColumnarJoinFilter *filter) {
+    if (!filter || (num_keys > 0 && !keys) || type > COLUMNAR_TYPE_TEXT) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    memset(filter, 0, sizeof(ColumnarJoinFilter));
+    filter->type = type;
+
+    size_t num_values = 0;
+    ColumnarDatum min = {0};
+    ColumnarDatum max = {0};
+    for (size_t i = 0; i < num_keys; i++) {
+        if (nulls && nulls[i]) {
+            continue;
+        }
+        if (num_values == 0 || columnar_compare_datum(type, keys[i], min) < 0) {
+            min = keys[i];
+        }
+        if (num_values == 0 || columnar_compare_datum(type, keys[i], max) > 0) {
+            max = keys[i];
+        }
+        num_values++;
+    }
+    if (num_values == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    uint64_t *hashes = malloc(num_values * sizeof(uint64_t));
+    if (!hashes) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < num_keys; i++) {
+        if (!nulls || !nulls[i]) {
+            hashes[n++] = columnar_bloom_hash(type, keys[i]);
+        }
+    }
+
+    /* Size the bloom filter on distinct keys, the build side often repeats them */
+    qsort(hashes, n, sizeof(uint64_t), columnar_compare_hash);
+    size_t num_distinct = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (num_distinct == 0 || hashes[i] != hashes[num_distinct - 1]) {
+            hashes[num_distinct++] = hashes[i];
+        }
+    }
+
+    int result = columnar_bloom_init(&filter->bloom, num_distinct, COLUMNAR_BLOOM_BITS_PER_KEY);
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(hashes);
+        return result;
+    }
+    for (size_t i = 0; i < num_distinct; i++) {
+        columnar_bloom_add(&filter->bloom, hashes[i]);
+    }
+
+    if (num_distinct <= COLUMNAR_JOIN_PROBE_KEYS) {
+        filter->hashes = hashes;
+        filter->num_hashes = num_distinct;
+    } else {
+        free(hashes);
+    }
+
+    if (type == COLUMNAR_TYPE_TEXT) {
+        min.text = strdup(min.text);
+        max.text = strdup(max.text);
+        if (!min.text || !max.text) {
+            free((char *)min.text);
+            free((char *)max.text);
+            columnar_join_filter_free(filter);
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+    filter->min = min;
+    filter->max = max;
+    filter->has_keys = true;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Build a filter from the values of column_name in the rows of table matching condition */
+int columnar_join_filter_from_table(EpiphanyDBTable *table, const char *column_name, const char *condition, ColumnarJoinFilter *filter) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table || !column_name || !filter) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int column = columnar_find_column(col_table, column_name);
+    if (column < 0) {
+        return EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+
+    void *keys = NULL;
+    size_t num_keys = 0;
+    int result = columnar_vectorized_scan(table, column_name, condition, &keys, &num_keys);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    result = columnar_join_filter_build(col_table->column_types[column], keys, NULL, num_keys, filter);
+    free(keys);
+    return result;
+}
+
+void columnar_join_filter_free(ColumnarJoinFilter *filter) {
+    if (!filter) {
+        return;
+    }
+    if (filter->type == COLUMNAR_TYPE_TEXT && filter->has_keys) {
+        free((char *)filter->min.text);
+        free((char *)filter->max.text);
+    }
+    columnar_bloom_free(&filter->bloom);
+    free(filter->hashes);
+    memset(filter, 0, sizeof(ColumnarJoinFilter));
+}
+
+/* Row group pruning */
+
+/* False when no value of chunk can be one of the keys of filter */
+bool columnar_join_filter_may_match(const ColumnarJoinFilter *filter, const ColumnarChunk *chunk) {
+    const ColumnarZoneMap *zone_map = &chunk->zone_map;
+
+    if (!filter->has_keys || !zone_map->has_values) {
+        return false;
+    }
+    if (columnar_compare_datum(filter->type, zone_map->max, filter->min) < 0 ||
+        columnar_compare_datum(filter->type, zone_map->min, filter->max) > 0) {
+        return false;
+    }
+
+    /* Chunks of a single value need no bloom filter of their own */
+    if (columnar_compare_datum(filter->type, zone_map->min, zone_map->max) == 0) {
+        return columnar_bloom_may_contain(&filter->bloom, columnar_bloom_hash(filter->type, zone_map->min));
+    }
+
+    if (filter->num_hashes == 0 || chunk->bloom.num_blocks == 0) {
+        return true;
+    }
+    for (size_t i = 0; i < filter->num_hashes; i++) {
+        if (columnar_bloom_may_contain(&chunk->bloom, filter->hashes[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Row filtering */
+
+#define COLUMNAR_JOIN_RANGE_KERNEL(NAME, CTYPE, COMPARE)                                              \
+    static size_t NAME(const ColumnarJoinFilter *filter, CTYPE const *values, const uint8_t *nulls,   \
+                       const uint16_t *in, size_t n, uint16_t *out) {                                 \
+        size_t count = 0;                                                                             \
+        for (size_t i = 0; i < n; i++) {                                                              \
+            uint16_t row = in ? in[i] : (uint16_t)i;                                                  \
+            out[count] = row;                                                                         \
+            count += !(nulls && nulls[row]) && COMPARE(values[row], filter->min) >= 0 &&              \
+                     COMPARE(values[row], filter->max) <= 0;                                          \
+        }                                                                                             \
+        return count;                                                                                 \
+    }
+
+#define COLUMNAR_JOIN_COMPARE_INT64(value, bound) (((value) > (bound).i64) - ((value) < (bound).i64))
+#define COLUMNAR_JOIN_COMPARE_DOUBLE(value, bound) (((value) > (bound).f64) - ((value) < (bound).f64))
+#define COLUMNAR_JOIN_COMPARE_TEXT(value, bound) strcmp((value), (bound).text)
+
+COLUMNAR_JOIN_RANGE_KERNEL(columnar_join_range_int64, int64_t, COLUMNAR_JOIN_COMPARE_INT64)
+COLUMNAR_JOIN_RANGE_KERNEL(columnar_join_range_double, double, COLUMNAR_JOIN_COMPARE_DOUBLE)
+COLUMNAR_JOIN_RANGE_KERNEL(columnar_join_range_text, char *, COLUMNAR_JOIN_COMPARE_TEXT)
+
+/*
+ * Write to out the rows among in (rows 0..n-1 when in is NULL) whose value
+ * may be a key of filter: non-NULL, within the key range and present in the
+ * bloom filter. out may alias in. Returns the number of rows written.
+ */
+size_t columnar_join_filter_apply(const ColumnarJoinFilter *filter, const void *values, const uint8_t *nulls, const uint16_t *in, size_t n, uint16_t *out) {
+    if (!filter->has_keys) {
+        return 0;
+    }
+
+    /* The range check needs no hashing, probe the bloom filter for the rows it keeps */
+    size_t count;
+    switch (filter->type) {
+        case COLUMNAR_TYPE_INT64:
+            count = columnar_join_range_int64(filter, values, nulls, in, n, out);
+            break;
+        case COLUMNAR_TYPE_DOUBLE:
+            count = columnar_join_range_double(filter, values, nulls, in, n, out);
+            break;
+        default:
+            count = columnar_join_range_text(filter, values, nulls, in, n, out);
+            break;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint16_t row = out[i];
+        ColumnarDatum value;
+
+        switch (filter->type) {
+            case COLUMNAR_TYPE_INT64:
+                value.i64 = ((const int64_t *)values)[row];
+                break;
+            case COLUMNAR_TYPE_DOUBLE:
+                value.f64 = ((const double *)values)[row];
+                break;
+            default:
+                value.text = ((char *const *)values)[row];
+                break;
+        }
+        out[kept] = row;
+        kept += columnar_bloom_may_contain(&filter->bloom, columnar_bloom_hash(filter->type, value));
+    }
+    return kept;
+}
@@ -0,0 +1,308 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Parallel scans: worker threads pinned to the allowed CPUs claim row
+ * groups from a shared work queue and feed their batches to a per-worker
+ * consumer, whose partial state the caller merges afterwards. The queue
+ * holds one contiguous range per NUMA node; workers drain the range of
+ * their own node first, so their decode buffers and partial state stay
+ * node-local, and steal from the other ranges once it is empty.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sched.h>
+#include <dirent.h>
+#include <pthread.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+/* CPU topology */
+
+/* Allowed CPUs, interleaved across nodes so any prefix spreads evenly */
+typedef struct ColumnarTopology {
+    size_t num_cpus;
+    int cpus[COLUMNAR_MAX_SCAN_WORKERS];
+    size_t nodes[COLUMNAR_MAX_SCAN_WORKERS];  /* dense node index of cpus[i] */
+    size_t num_nodes;
+} ColumnarTopology;
+
+static ColumnarTopology columnar_topology;
+static pthread_once_t columnar_topology_once = PTHREAD_ONCE_INIT;
+
+/* NUMA node of a CPU from sysfs, or 0 without NUMA information */
+static int columnar_cpu_node(int cpu) {
+    char path[64];
+    int node = 0;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && sscanf(entry->d_name + 4, "%d", &node) == 1) {
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+static void columnar_topology_init(void) {
+    ColumnarTopology *topology = &columnar_topology;
+    int cpus[COLUMNAR_MAX_SCAN_WORKERS];
+    int node_ids[COLUMNAR_MAX_SCAN_WORKERS];
+    size_t cpu_nodes[COLUMNAR_MAX_SCAN_WORKERS];
+    size_t num_cpus = 0;
+    size_t num_nodes = 0;
+    cpu_set_t allowed;
+
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        topology->num_cpus = 0;  /* run unpinned */
+        topology->num_nodes = 1;
+        return;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && num_cpus < COLUMNAR_MAX_SCAN_WORKERS; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        int node = columnar_cpu_node(cpu);
+        size_t n = 0;
+        while (n < num_nodes && node_ids[n] != node) {
+            n++;
+        }
+        if (n == num_nodes) {
+            node_ids[num_nodes++] = node;
+        }
+        cpus[num_cpus] = cpu;
+        cpu_nodes[num_cpus] = n;
+        num_cpus++;
+    }
+
+    /* Take one CPU of every node in turn */
+    bool taken[COLUMNAR_MAX_SCAN_WORKERS] = {false};
+    size_t count = 0;
+    while (count < num_cpus) {
+        for (size_t n = 0; n < num_nodes; n++) {
+            for (size_t i = 0; i < num_cpus; i++) {
+                if (!taken[i] && cpu_nodes[i] == n) {
+                    taken[i] = true;
+                    topology->cpus[count] = cpus[i];
+                    topology->nodes[count] = n;
+                    count++;
+                    break;
+                }
+            }
+        }
+    }
+    topology->num_cpus = num_cpus;
+    topology->num_nodes = num_nodes > 0 ? num_nodes : 1;
+}
+
+/*
+ * Number of workers worth starting for a scan: one per allowed CPU, or the
+ * configured scan_workers of the table, but no more than there are row
+ * groups (plus the delta snapshot) to hand out.
+ */
+size_t columnar_scan_workers(const ColumnarScan *scan) {
+    pthread_once(&columnar_topology_once, columnar_topology_init);
+
+    size_t workers = scan->table->scan_workers;
+    if (workers == 0) {
+        workers = columnar_topology.num_cpus;
+    }
+    size_t units = scan->table->num_row_groups + 1;
+    if (workers > units) {
+        workers = units;
+    }
+    if (workers > COLUMNAR_MAX_SCAN_WORKERS) {
+        workers = COLUMNAR_MAX_SCAN_WORKERS;
+    }
+    return workers > 0 ? workers : 1;
+}
+
+/* Work queue */
+
+/* Split units into contiguous per-node ranges sized by the workers on each node */
+static int columnar_work_queue_init(ColumnarWorkQueue *queue, size_t units, const size_t *worker_nodes, size_t num_workers, size_t num_nodes) {
+    size_t node_workers[COLUMNAR_MAX_SCAN_WORKERS] = {0};
+
+    queue->ranges = aligned_alloc(COLUMNAR_CACHE_LINE_SIZE, num_nodes * sizeof(ColumnarWorkRange));
+    if (!queue->ranges) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    queue->num_ranges = num_nodes;
+    queue->stop = false;
+
+    for (size_t i = 0; i < num_workers; i++) {
+        node_workers[worker_nodes[i]]++;
+    }
+
+    size_t start = 0;
+    size_t assigned = 0;
+    for (size_t n = 0; n < num_nodes; n++) {
+        assigned += node_workers[n];
+        size_t end = units * assigned / num_workers;
+        memset(&queue->ranges[n], 0, sizeof(ColumnarWorkRange));
+        queue->ranges[n].next = start;
+        queue->ranges[n].end = end;
+        start = end;
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Claim the next unit for a worker on node home: from its own range while
+ * it lasts, then from the others. Returns SIZE_MAX when no work is left or
+ * the scan was stopped after an error.
+ */
+size_t columnar_work_queue_claim(ColumnarWorkQueue *queue, size_t home) {
+    if (__atomic_load_n(&queue->stop, __ATOMIC_RELAXED)) {
+        return SIZE_MAX;
+    }
+
+    for (size_t i = 0; i < queue->num_ranges; i++) {
+        ColumnarWorkRange *range = &queue->ranges[(home + i) % queue->num_ranges];
+        if (__atomic_load_n(&range->next, __ATOMIC_RELAXED) >= range->end) {
+            continue;
+        }
+        size_t unit = __atomic_fetch_add(&range->next, 1, __ATOMIC_RELAXED);
+        if (unit < range->end) {
+            return unit;
+        }
+    }
+    return SIZE_MAX;
+}
+
+/* Workers */
+
+typedef struct ColumnarWorker {
+    pthread_t thread;
+    ColumnarScan *parent;
+    ColumnarWorkQueue *queue;
+    size_t home;
+    ColumnarBatchFn consume;
+    void *state;
+    int result;
+    size_t row_groups_scanned;
+    size_t row_groups_skipped;
+} ColumnarWorker;
+
+static void *columnar_worker_main(void *arg) {
+    ColumnarWorker *worker = arg;
+    ColumnarScan *scan;
+    ColumnarBatch *batch;
+
+    worker->result = columnar_scan_fork(worker->parent, worker->queue, worker->home, &scan);
+    if (worker->result != EPIPHANYDB_SUCCESS) {
+        __atomic_store_n(&worker->queue->stop, true, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    while (worker->result == EPIPHANYDB_SUCCESS && columnar_scan_next(scan, &batch)) {
+        worker->result = worker->consume(worker->state, batch);
+    }
+    if (worker->result == EPIPHANYDB_SUCCESS) {
+        worker->result = scan->status;
+    }
+    if (worker->result != EPIPHANYDB_SUCCESS) {
+        __atomic_store_n(&worker->queue->stop, true, __ATOMIC_RELAXED);
+    }
+
+    worker->row_groups_scanned = scan->row_groups_scanned;
+    worker->row_groups_skipped = scan->row_groups_skipped;
+    columnar_scan_end(scan);
+    return NULL;
+}
+
+/*
+ * Run scan on num_workers threads, handing the batches of worker i to
+ * consume(states[i], batch). Batches of one row group always go to the
+ * same worker, in order; batch->row_group_index tells the row groups
+ * apart. With a single worker the scan runs on the calling thread. The
+ * caller merges the per-worker states after this returns.
+ */
+int columnar_parallel_scan(ColumnarScan *scan, size_t num_workers, ColumnarBatchFn consume, void **states) {
+    ColumnarBatch *batch;
+    int result = EPIPHANYDB_SUCCESS;
+
+    if (!scan || !consume || !states || num_workers == 0 || num_workers > COLUMNAR_MAX_SCAN_WORKERS || scan->parent) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    if (num_workers == 1) {
+        while (result == EPIPHANYDB_SUCCESS && columnar_scan_next(scan, &batch)) {
+            result = consume(states[0], batch);
+        }
+        return result == EPIPHANYDB_SUCCESS ? scan->status : result;
+    }
+
+    pthread_once(&columnar_topology_once, columnar_topology_init);
+    const ColumnarTopology *topology = &columnar_topology;
+
+    size_t worker_nodes[COLUMNAR_MAX_SCAN_WORKERS];
+    for (size_t i = 0; i < num_workers; i++) {
+        worker_nodes[i] = topology->num_cpus > 0 ? topology->nodes[i % topology->num_cpus] : 0;
+    }
+
+    ColumnarWorkQueue queue;
+    result = columnar_work_queue_init(&queue, scan->table->num_row_groups + 1, worker_nodes, num_workers, topology->num_nodes);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    ColumnarWorker *workers = calloc(num_workers, sizeof(ColumnarWorker));
+    if (!workers) {
+        free(queue.ranges);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    size_t started = 0;
+    for (size_t i = 0; i < num_workers; i++) {
+        ColumnarWorker *worker = &workers[i];
+        pthread_attr_t attr;
+
+        worker->parent = scan;
+        worker->queue = &queue;
+        worker->home = worker_nodes[i];
+        worker->consume = consume;
+        worker->state = states[i];
+
+        pthread_attr_init(&attr);
+        if (topology->num_cpus > 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(topology->cpus[i % topology->num_cpus], &cpus);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+        }
+        int error = pthread_create(&worker->thread, &attr, columnar_worker_main, worker);
+        pthread_attr_destroy(&attr);
+        if (error != 0) {
+            __atomic_store_n(&queue.stop, true, __ATOMIC_RELAXED);
+            result = EPIPHANYDB_ERROR_STORAGE;
+            break;
+        }
+        started++;
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = workers[i].result;
+        }
+        scan->row_groups_scanned += workers[i].row_groups_scanned;
+        scan->row_groups_skipped += workers[i].row_groups_skipped;
+    }
+
+    free(workers);
+    free(queue.ranges);
+    return result;
+}
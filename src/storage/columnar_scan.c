@@ -0,0 +1,941 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Batch-at-a-time scans with zone map pruning and vectorized filters
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+/* Stand-in NULL mask for chunks without NULL values */
+static const uint8_t columnar_no_nulls[COLUMNAR_BATCH_SIZE];
+
+/* Vectorized filter kernels */
+
+/*
+ * Qualifying rows are written to out without branching on the comparison
+ * result. One kernel is generated for every column type and operator so
+ * the comparison is fixed inside the row loop.
+ */
+#define COLUMNAR_FILTER(COND) \
+    do { \
+        if (in) { \
+            for (size_t i = 0; i < n; i++) { \
+                size_t row = in[i]; \
+                out[k] = (uint16_t)row; \
+                k += (size_t)((COND) & !nulls[row]); \
+            } \
+        } else { \
+            for (size_t row = 0; row < n; row++) { \
+                out[k] = (uint16_t)row; \
+                k += (size_t)((COND) & !nulls[row]); \
+            } \
+        } \
+    } while (0)
+
+#define COLUMNAR_DEFINE_FILTER(NAME, CTYPE, VALUE, CMP, CONSTANT) \
+    static size_t NAME(const void *column, const uint8_t *nulls, ColumnarDatum constant, const uint16_t *in, size_t n, uint16_t *out) { \
+        CTYPE const *values = column; \
+        size_t k = 0; \
+        COLUMNAR_FILTER((VALUE) CMP (CONSTANT)); \
+        return k; \
+    }
+
+#define COLUMNAR_DEFINE_FILTERS(KIND, CTYPE, VALUE, CONSTANT) \
+    COLUMNAR_DEFINE_FILTER(columnar_filter_##KIND##_eq, CTYPE, VALUE, ==, CONSTANT) \
+    COLUMNAR_DEFINE_FILTER(columnar_filter_##KIND##_ne, CTYPE, VALUE, !=, CONSTANT) \
+    COLUMNAR_DEFINE_FILTER(columnar_filter_##KIND##_lt, CTYPE, VALUE, <, CONSTANT) \
+    COLUMNAR_DEFINE_FILTER(columnar_filter_##KIND##_le, CTYPE, VALUE, <=, CONSTANT) \
+    COLUMNAR_DEFINE_FILTER(columnar_filter_##KIND##_gt, CTYPE, VALUE, >, CONSTANT) \
+    COLUMNAR_DEFINE_FILTER(columnar_filter_##KIND##_ge, CTYPE, VALUE, >=, CONSTANT)
+
+COLUMNAR_DEFINE_FILTERS(int64, int64_t, values[row], constant.i64)
+COLUMNAR_DEFINE_FILTERS(int64_as_double, int64_t, (double)values[row], constant.f64)
+COLUMNAR_DEFINE_FILTERS(double, double, values[row], constant.f64)
+/* NULL rows hold a NULL pointer, compare them against "" and mask them out */
+COLUMNAR_DEFINE_FILTERS(text, char *, strcmp(values[row] ? values[row] : "", constant.text), 0)
+
+#define COLUMNAR_FILTER_KERNELS(KIND) \
+    { columnar_filter_##KIND##_eq, columnar_filter_##KIND##_ne, columnar_filter_##KIND##_lt, \
+      columnar_filter_##KIND##_le, columnar_filter_##KIND##_gt, columnar_filter_##KIND##_ge }
+
+/* Indexed by ColumnarType, then ColumnarCompareOp; the last row holds INT64 columns compared as doubles */
+static const ColumnarFilterFn columnar_filter_kernels[4][6] = {
+    COLUMNAR_FILTER_KERNELS(int64),
+    COLUMNAR_FILTER_KERNELS(double),
+    COLUMNAR_FILTER_KERNELS(text),
+    COLUMNAR_FILTER_KERNELS(int64_as_double)
+};
+
+/* Condition parsing */
+
+typedef struct ColumnarLexer {
+    const char *p;
+} ColumnarLexer;
+
+static void columnar_skip_space(ColumnarLexer *lex) {
+    while (isspace((unsigned char)*lex->p)) {
+        lex->p++;
+    }
+}
+
+/* Read an identifier into buffer, returns false when none is present or it does not fit */
+static bool columnar_read_identifier(ColumnarLexer *lex, char *buffer, size_t size) {
+    size_t len = 0;
+
+    columnar_skip_space(lex);
+    if (!isalpha((unsigned char)*lex->p) && *lex->p != '_') {
+        return false;
+    }
+    while (isalnum((unsigned char)*lex->p) || *lex->p == '_') {
+        if (len + 1 == size) {
+            return false;
+        }
+        buffer[len++] = *lex->p;
+        lex->p++;
+    }
+    buffer[len] = '\0';
+    return true;
+}
+
+static bool columnar_read_operator(ColumnarLexer *lex, ColumnarCompareOp *op) {
+    columnar_skip_space(lex);
+    const char *p = lex->p;
+
+    if (p[0] == '=' ) {
+        *op = COLUMNAR_OP_EQ;
+        lex->p += (p[1] == '=') ? 2 : 1;
+    } else if (p[0] == '!' && p[1] == '=') {
+        *op = COLUMNAR_OP_NE;
+        lex->p += 2;
+    } else if (p[0] == '<' && p[1] == '>') {
+        *op = COLUMNAR_OP_NE;
+        lex->p += 2;
+    } else if (p[0] == '<') {
+        *op = (p[1] == '=') ? COLUMNAR_OP_LE : COLUMNAR_OP_LT;
+        lex->p += (p[1] == '=') ? 2 : 1;
+    } else if (p[0] == '>') {
+        *op = (p[1] == '=') ? COLUMNAR_OP_GE : COLUMNAR_OP_GT;
+        lex->p += (p[1] == '=') ? 2 : 1;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* Read a numeric or quoted string constant for a column of the given type */
+static int columnar_read_constant(ColumnarLexer *lex, int type, ColumnarPredicate *predicate) {
+    columnar_skip_space(lex);
+
+    if (*lex->p == '\'') {
+        if (type != COLUMNAR_TYPE_TEXT) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        const char *start = ++lex->p;
+        while (*lex->p && *lex->p != '\'') {
+            lex->p++;
+        }
+        if (*lex->p != '\'') {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        char *text = strndup(start, (size_t)(lex->p - start));
+        if (!text) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        lex->p++;
+        predicate->value.text = text;
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    if (type == COLUMNAR_TYPE_TEXT) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    char *end;
+    double number = strtod(lex->p, &end);
+    if (end == lex->p) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    if (type == COLUMNAR_TYPE_DOUBLE) {
+        predicate->value.f64 = number;
+        lex->p = end;
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    /* Constants strtoll does not read whole, such as 1.5, 1E3, 0x10, inf or out of range ones, compare as doubles */
+    char *integer_end;
+    errno = 0;
+    long long integer = strtoll(lex->p, &integer_end, 10);
+    if (integer_end != end || errno == ERANGE) {
+        predicate->value.f64 = number;
+        predicate->compare_as_double = true;
+    } else {
+        predicate->value.i64 = integer;
+    }
+    lex->p = end;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Hash an equality constant once so row groups can be ruled out by bloom filters */
+static void columnar_prepare_bloom_probe(const ColumnarTable *table, ColumnarPredicate *predicate) {
+    int type = table->column_types[predicate->column];
+
+    if (predicate->op != COLUMNAR_OP_EQ) {
+        return;
+    }
+    if (predicate->compare_as_double) {
+        /* Only integral constants can equal an INT64 value */
+        double value = predicate->value.f64;
+        if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0) || value != (double)(int64_t)value) {
+            return;
+        }
+        ColumnarDatum key;
+        key.i64 = (int64_t)value;
+        predicate->bloom_hash = columnar_bloom_hash(COLUMNAR_TYPE_INT64, key);
+    } else {
+        predicate->bloom_hash = columnar_bloom_hash(type, predicate->value);
+    }
+    predicate->bloom_probe = true;
+}
+
+/* Parse "column op constant [AND column op constant ...]" */
+int columnar_parse_condition(const ColumnarTable *table, const char *condition, ColumnarPredicate **predicates, size_t *num_predicates) {
+    ColumnarLexer lex = {condition};
+    ColumnarPredicate *list = NULL;
+    size_t count = 0;
+    int result = EPIPHANYDB_SUCCESS;
+
+    *predicates = NULL;
+    *num_predicates = 0;
+    if (!condition) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    columnar_skip_space(&lex);
+    while (*lex.p) {
+        char name[128];
+        ColumnarPredicate predicate = {0};
+
+        if (count > 0) {
+            char keyword[8];
+            if (!columnar_read_identifier(&lex, keyword, sizeof(keyword)) || strcasecmp(keyword, "AND") != 0) {
+                result = EPIPHANYDB_ERROR_INVALID_PARAM;
+                break;
+            }
+        }
+
+        if (!columnar_read_identifier(&lex, name, sizeof(name))) {
+            result = EPIPHANYDB_ERROR_INVALID_PARAM;
+            break;
+        }
+        predicate.column = columnar_find_column(table, name);
+        if (predicate.column < 0) {
+            result = EPIPHANYDB_ERROR_NOT_FOUND;
+            break;
+        }
+        if (!columnar_read_operator(&lex, &predicate.op)) {
+            result = EPIPHANYDB_ERROR_INVALID_PARAM;
+            break;
+        }
+        result = columnar_read_constant(&lex, table->column_types[predicate.column], &predicate);
+        if (result != EPIPHANYDB_SUCCESS) {
+            break;
+        }
+        columnar_prepare_bloom_probe(table, &predicate);
+        predicate.filter = columnar_filter_kernels[predicate.compare_as_double ? 3 : table->column_types[predicate.column]][predicate.op];
+
+        ColumnarPredicate *grown = realloc(list, (count + 1) * sizeof(ColumnarPredicate));
+        if (!grown) {
+            if (table->column_types[predicate.column] == COLUMNAR_TYPE_TEXT) {
+                free((char *)predicate.value.text);
+            }
+            result = EPIPHANYDB_ERROR_MEMORY;
+            break;
+        }
+        list = grown;
+        list[count++] = predicate;
+        columnar_skip_space(&lex);
+    }
+
+    if (result != EPIPHANYDB_SUCCESS) {
+        columnar_free_predicates(table, list, count);
+        return result;
+    }
+
+    *predicates = list;
+    *num_predicates = count;
+    return EPIPHANYDB_SUCCESS;
+}
+
+void columnar_free_predicates(const ColumnarTable *table, ColumnarPredicate *predicates, size_t num_predicates) {
+    for (size_t i = 0; i < num_predicates; i++) {
+        if (table->column_types[predicates[i].column] == COLUMNAR_TYPE_TEXT) {
+            free((char *)predicates[i].value.text);
+        }
+    }
+    free(predicates);
+}
+
+/* Compiled conditions */
+
+static void columnar_condition_free(ColumnarTable *table, ColumnarCondition *compiled) {
+    columnar_free_predicates(table, compiled->predicates, compiled->num_predicates);
+    free(compiled->text);
+    free(compiled);
+}
+
+/*
+ * Compiled form of condition, parsed on first use and then served from the
+ * cache of the table until COLUMNAR_CONDITION_CACHE_SIZE newer conditions
+ * push it out. *compiled is NULL for an empty condition; otherwise the
+ * caller releases it with columnar_condition_release.
+ */
+int columnar_condition_acquire(ColumnarTable *table, const char *condition, ColumnarCondition **compiled) {
+    *compiled = NULL;
+    if (!condition) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    uint64_t hash = columnar_hash_bytes(condition, strlen(condition));
+
+    pthread_mutex_lock(&table->conditions_mutex);
+    for (size_t i = 0; i < table->num_conditions; i++) {
+        ColumnarCondition *cached = table->conditions[i];
+        if (cached->hash == hash && strcmp(cached->text, condition) == 0) {
+            memmove(table->conditions + 1, table->conditions, i * sizeof(ColumnarCondition *));
+            table->conditions[0] = cached;
+            cached->refs++;
+            pthread_mutex_unlock(&table->conditions_mutex);
+            *compiled = cached;
+            return EPIPHANYDB_SUCCESS;
+        }
+    }
+    pthread_mutex_unlock(&table->conditions_mutex);
+
+    /* Compile outside the mutex; a racing compile of the same text is harmless */
+    ColumnarCondition *entry = calloc(1, sizeof(ColumnarCondition));
+    if (!entry) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    entry->text = strdup(condition);
+    if (!entry->text) {
+        free(entry);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    int result = columnar_parse_condition(table, condition, &entry->predicates, &entry->num_predicates);
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(entry->text);
+        free(entry);
+        return result;
+    }
+    entry->hash = hash;
+    entry->refs = 2;  /* the cache and the caller */
+
+    ColumnarCondition *evicted = NULL;
+    pthread_mutex_lock(&table->conditions_mutex);
+    if (table->num_conditions == COLUMNAR_CONDITION_CACHE_SIZE) {
+        evicted = table->conditions[--table->num_conditions];
+        if (--evicted->refs > 0) {
+            evicted = NULL;  /* freed by the last scan using it */
+        }
+    }
+    memmove(table->conditions + 1, table->conditions, table->num_conditions * sizeof(ColumnarCondition *));
+    table->conditions[0] = entry;
+    table->num_conditions++;
+    pthread_mutex_unlock(&table->conditions_mutex);
+
+    if (evicted) {
+        columnar_condition_free(table, evicted);
+    }
+    *compiled = entry;
+    return EPIPHANYDB_SUCCESS;
+}
+
+void columnar_condition_release(ColumnarTable *table, ColumnarCondition *compiled) {
+    if (!compiled) {
+        return;
+    }
+
+    pthread_mutex_lock(&table->conditions_mutex);
+    bool last = --compiled->refs == 0;
+    pthread_mutex_unlock(&table->conditions_mutex);
+    if (last) {
+        columnar_condition_free(table, compiled);
+    }
+}
+
+/* Drop every cached condition, scans still running keep theirs */
+void columnar_condition_cache_clear(ColumnarTable *table) {
+    pthread_mutex_lock(&table->conditions_mutex);
+    size_t num_conditions = table->num_conditions;
+    ColumnarCondition *conditions[COLUMNAR_CONDITION_CACHE_SIZE];
+    memcpy(conditions, table->conditions, num_conditions * sizeof(ColumnarCondition *));
+    table->num_conditions = 0;
+    pthread_mutex_unlock(&table->conditions_mutex);
+
+    for (size_t i = 0; i < num_conditions; i++) {
+        columnar_condition_release(table, conditions[i]);
+    }
+}
+
+/* Zone map and bloom filter pruning */
+
+static bool columnar_range_may_match(ColumnarCompareOp op, int cmp_min, int cmp_max) {
+    /* cmp_min and cmp_max compare the constant against the chunk bounds */
+    switch (op) {
+        case COLUMNAR_OP_EQ:
+            return cmp_min >= 0 && cmp_max <= 0;
+        case COLUMNAR_OP_NE:
+            return !(cmp_min == 0 && cmp_max == 0);
+        case COLUMNAR_OP_LT:
+            return cmp_min > 0;
+        case COLUMNAR_OP_LE:
+            return cmp_min >= 0;
+        case COLUMNAR_OP_GT:
+            return cmp_max < 0;
+        case COLUMNAR_OP_GE:
+            return cmp_max <= 0;
+    }
+    return true;
+}
+
+/* False when zone maps or bloom filters prove no row of the row group can qualify */
+bool columnar_predicates_may_match(const ColumnarTable *table, const ColumnarRowGroup *row_group, const ColumnarPredicate *predicates, size_t num_predicates) {
+    for (size_t i = 0; i < num_predicates; i++) {
+        const ColumnarPredicate *predicate = &predicates[i];
+        const ColumnarZoneMap *zone_map = &row_group->chunks[predicate->column].zone_map;
+        int type = table->column_types[predicate->column];
+        int cmp_min;
+        int cmp_max;
+
+        if (!zone_map->has_values) {
+            return false;
+        }
+
+        if (predicate->compare_as_double) {
+            double value = predicate->value.f64;
+            double min = (double)zone_map->min.i64;
+            double max = (double)zone_map->max.i64;
+            cmp_min = (value > min) - (value < min);
+            cmp_max = (value > max) - (value < max);
+        } else {
+            cmp_min = columnar_compare_datum(type, predicate->value, zone_map->min);
+            cmp_max = columnar_compare_datum(type, predicate->value, zone_map->max);
+        }
+
+        if (!columnar_range_may_match(predicate->op, cmp_min, cmp_max)) {
+            return false;
+        }
+
+        /* Point lookups inside the bounds of unsorted high-cardinality columns */
+        if (predicate->bloom_probe &&
+            !columnar_bloom_may_contain(&row_group->chunks[predicate->column].bloom, predicate->bloom_hash)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Drop rows set in the row group delete bitmap from the current selection */
+static void columnar_mask_deleted(ColumnarScan *scan) {
+    ColumnarBatch *batch = &scan->batch;
+
+    if (!batch->selection) {
+        for (size_t i = 0; i < batch->num_selected; i++) {
+            scan->selection[i] = (uint16_t)i;
+        }
+    }
+    batch->num_selected = columnar_bitmap_filter(&batch->row_group->deleted, (uint32_t)batch->first_row,
+                                                 scan->selection, batch->num_selected);
+    batch->selection = scan->selection;
+}
+
+/* Rows of the window [first, first + n) set in bits, window-relative */
+static size_t columnar_bits_select(const uint64_t *bits, size_t first, size_t n, uint16_t *out) {
+    size_t count = 0;
+
+    for (size_t w = 0; w * 64 < n; w++) {
+        uint64_t word = bits[first / 64 + w];
+        while (word) {
+            size_t row = w * 64 + (size_t)__builtin_ctzll(word);
+            if (row >= n) {
+                break;
+            }
+            out[count++] = (uint16_t)row;
+            word &= word - 1;
+        }
+    }
+    return count;
+}
+
+/*
+ * Apply the condition and every join filter to the current batch window.
+ * The condition result comes from the scan cache when it holds one for the
+ * row group, and is otherwise recorded for it when the scan has a cache.
+ */
+static void columnar_filter_batch(ColumnarScan *scan) {
+    ColumnarBatch *batch = &scan->batch;
+    const uint16_t *in = NULL;
+    size_t n = batch->num_rows;
+
+    if (scan->filter_entry) {
+        n = columnar_bits_select(scan->filter_entry->bitmap, batch->first_row, n, scan->selection);
+        in = scan->selection;
+    } else {
+        for (size_t i = 0; i < scan->num_predicates && n > 0; i++) {
+            const ColumnarPredicate *predicate = &scan->predicates[i];
+            const uint8_t *nulls = batch->nulls[predicate->column];
+
+            n = predicate->filter(batch->values[predicate->column], nulls ? nulls : columnar_no_nulls,
+                                  predicate->value, in, n, scan->selection);
+            in = scan->selection;
+        }
+    }
+    if (scan->record_filter) {
+        for (size_t i = 0; i < n; i++) {
+            size_t row = batch->first_row + (in ? in[i] : i);
+            scan->filter_bits[row / 64] |= 1ULL << (row % 64);
+        }
+    }
+
+    for (size_t i = 0; i < scan->num_join_probes && n > 0; i++) {
+        const ColumnarJoinProbe *probe = &scan->join_probes[i];
+
+        n = columnar_join_filter_apply(probe->filter, batch->values[probe->column], batch->nulls[probe->column],
+                                       in, n, scan->selection);
+        in = scan->selection;
+    }
+
+    batch->selection = in;
+    batch->num_selected = n;
+}
+
+/* Scan iteration */
+
+/* Allocate the per-cursor state of a scan over table */
+static ColumnarScan *columnar_scan_alloc(ColumnarTable *table) {
+    ColumnarScan *s = calloc(1, sizeof(ColumnarScan));
+    if (!s) {
+        return NULL;
+    }
+
+    s->table = table;
+    s->batch.values = calloc(table->num_columns, sizeof(void *));
+    s->batch.nulls = calloc(table->num_columns, sizeof(uint8_t *));
+    s->selection = malloc(COLUMNAR_BATCH_SIZE * sizeof(uint16_t));
+    s->buffers = calloc(table->num_columns, sizeof(ColumnarChunkBuffer));
+    s->chunk_values = calloc(table->num_columns, sizeof(void *));
+    s->chunk_nulls = calloc(table->num_columns, sizeof(uint8_t *));
+    s->chunk_entries = calloc(table->num_columns, sizeof(ColumnarCacheEntry *));
+    if (!s->batch.values || !s->batch.nulls || !s->selection ||
+        !s->buffers || !s->chunk_values || !s->chunk_nulls || !s->chunk_entries) {
+        free(s->batch.values);
+        free(s->batch.nulls);
+        free(s->selection);
+        free(s->buffers);
+        free(s->chunk_values);
+        free(s->chunk_nulls);
+        free(s->chunk_entries);
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+int columnar_scan_begin(ColumnarTable *table, const char *const *columns, size_t num_columns, const char *condition, ColumnarScan **scan) {
+    if (!table || !scan || (num_columns > 0 && !columns)) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    ColumnarScan *s = columnar_scan_alloc(table);
+    if (!s) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    /* Row groups stay stable until columnar_scan_end releases the lock */
+    pthread_rwlock_rdlock(&table->lock);
+    s->load_columns = calloc(table->num_columns, sizeof(bool));
+    s->condition_only = calloc(table->num_columns, sizeof(bool));
+    if (!s->load_columns || !s->condition_only) {
+        columnar_scan_end(s);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    for (size_t i = 0; i < num_columns; i++) {
+        int column = columnar_find_column(table, columns[i]);
+        if (column < 0) {
+            columnar_scan_end(s);
+            return EPIPHANYDB_ERROR_NOT_FOUND;
+        }
+        s->load_columns[column] = true;
+    }
+
+    int result = columnar_condition_acquire(table, condition, &s->condition);
+    if (result != EPIPHANYDB_SUCCESS) {
+        columnar_scan_end(s);
+        return result;
+    }
+    if (s->condition) {
+        s->predicates = s->condition->predicates;
+        s->num_predicates = s->condition->num_predicates;
+    }
+    for (size_t i = 0; i < s->num_predicates; i++) {
+        int column = s->predicates[i].column;
+        if (!s->load_columns[column]) {
+            s->load_columns[column] = true;
+            s->condition_only[column] = true;
+        }
+    }
+
+    result = columnar_delta_snapshot(table, &s->delta_group);
+    if (result != EPIPHANYDB_SUCCESS) {
+        columnar_scan_end(s);
+        return result;
+    }
+
+    *scan = s;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Restrict the scan to rows whose column_name value may be a key of filter,
+ * which must outlive the scan. Join filters are added before the first
+ * batch is requested and before workers are forked.
+ */
+int columnar_scan_add_join_filter(ColumnarScan *scan, const char *column_name, const ColumnarJoinFilter *filter) {
+    if (!scan || scan->parent || !column_name || !filter) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (scan->num_join_probes == COLUMNAR_MAX_JOIN_FILTERS) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int column = columnar_find_column(scan->table, column_name);
+    if (column < 0) {
+        return EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+    if (scan->table->column_types[column] != (int)filter->type) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    scan->join_probes[scan->num_join_probes].column = column;
+    scan->join_probes[scan->num_join_probes].filter = filter;
+    scan->num_join_probes++;
+    scan->load_columns[column] = true;
+    scan->condition_only[column] = false;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Create a worker cursor sharing the predicates, snapshot and table lock of
+ * parent. The worker claims row groups from queue, preferring range home,
+ * and must be ended before its parent.
+ */
+int columnar_scan_fork(ColumnarScan *parent, ColumnarWorkQueue *queue, size_t home, ColumnarScan **worker) {
+    ColumnarScan *s = columnar_scan_alloc(parent->table);
+    if (!s) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    s->parent = parent;
+    s->load_columns = parent->load_columns;
+    s->condition_only = parent->condition_only;
+    s->condition = parent->condition;
+    s->predicates = parent->predicates;
+    s->num_predicates = parent->num_predicates;
+    memcpy(s->join_probes, parent->join_probes, parent->num_join_probes * sizeof(ColumnarJoinProbe));
+    s->num_join_probes = parent->num_join_probes;
+    s->delta_group = parent->delta_group;
+    s->dirty_only = parent->dirty_only;
+    s->queue = queue;
+    s->queue_home = home;
+    s->row_group_index = columnar_work_queue_claim(queue, home);
+
+    *worker = s;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Move to the next row group: the following one, or the next claimed one */
+static void columnar_scan_advance(ColumnarScan *scan) {
+    scan->row_offset = 0;
+    if (scan->queue) {
+        scan->row_group_index = columnar_work_queue_claim(scan->queue, scan->queue_home);
+    } else {
+        scan->row_group_index++;
+    }
+}
+
+/* True when the scan reads column c of the current row group */
+static bool columnar_scan_reads(const ColumnarScan *scan, size_t c) {
+    return scan->load_columns[c] && !(scan->filter_entry && scan->condition_only[c]);
+}
+
+/* True when the scan cache holds column c of row_group */
+static bool columnar_scan_cached(const ColumnarScan *scan, const ColumnarRowGroup *row_group, size_t c) {
+    ColumnarCacheKey key = {scan->table->cache_id, row_group->id, (uint32_t)c, 0};
+    return scan->table->cache && columnar_cache_contains(scan->table->cache, &key);
+}
+
+/* Release the scan cache entries pinned for the current row group */
+static void columnar_scan_unpin(ColumnarScan *scan) {
+    ColumnarCache *cache = scan->table->cache;
+
+    for (size_t c = 0; c < scan->table->num_columns && cache; c++) {
+        columnar_cache_release(cache, scan->chunk_entries[c]);
+        scan->chunk_entries[c] = NULL;
+    }
+    if (scan->filter_entry) {
+        columnar_cache_release(cache, scan->filter_entry);
+        scan->filter_entry = NULL;
+    }
+    scan->record_filter = false;
+}
+
+/*
+ * Look up the condition result of a sealed row group in the scan cache, or
+ * prepare to record it. False when the cached result selects no row.
+ */
+static bool columnar_scan_lookup_filter(ColumnarScan *scan, const ColumnarRowGroup *row_group) {
+    ColumnarCache *cache = scan->table->cache;
+    if (!cache || !scan->condition) {
+        return true;
+    }
+
+    ColumnarCacheKey key = {scan->table->cache_id, row_group->id, COLUMNAR_CACHE_FILTER, scan->condition->hash};
+    scan->filter_entry = columnar_cache_lookup(cache, &key);
+    if (scan->filter_entry) {
+        return scan->filter_entry->num_matches > 0;
+    }
+
+    size_t words = (row_group->num_rows + 63) / 64;
+    if (words > scan->filter_bits_capacity) {
+        uint64_t *grown = realloc(scan->filter_bits, words * sizeof(uint64_t));
+        if (!grown) {
+            return true;  /* run the condition without recording it */
+        }
+        scan->filter_bits = grown;
+        scan->filter_bits_capacity = words;
+    }
+    memset(scan->filter_bits, 0, words * sizeof(uint64_t));
+    scan->record_filter = true;
+    return true;
+}
+
+/* Publish the condition result recorded over every row of row_group */
+static void columnar_scan_store_filter(ColumnarScan *scan, const ColumnarRowGroup *row_group) {
+    ColumnarCacheKey key = {scan->table->cache_id, row_group->id, COLUMNAR_CACHE_FILTER, scan->condition->hash};
+    size_t words = (row_group->num_rows + 63) / 64;
+    ColumnarCacheEntry *entry = columnar_cache_entry_alloc(&key, words * sizeof(uint64_t));
+
+    scan->record_filter = false;
+    if (!entry) {
+        return;
+    }
+    entry->bitmap = (uint64_t *)entry->data;
+    entry->num_rows = row_group->num_rows;
+    for (size_t w = 0; w < words; w++) {
+        entry->bitmap[w] = scan->filter_bits[w];
+        entry->num_matches += (size_t)__builtin_popcountll(scan->filter_bits[w]);
+    }
+    columnar_cache_insert(scan->table->cache, entry);
+    columnar_cache_release(scan->table->cache, entry);
+}
+
+/* True when no row of row_group can qualify or be of interest to the scan */
+static bool columnar_scan_skips(const ColumnarScan *scan, const ColumnarRowGroup *row_group, bool is_delta) {
+    if (row_group->num_rows == 0 ||
+        (scan->dirty_only && !is_delta && row_group->num_deleted == 0) ||
+        !columnar_predicates_may_match(scan->table, row_group, scan->predicates, scan->num_predicates)) {
+        return true;
+    }
+    for (size_t i = 0; i < scan->num_join_probes; i++) {
+        const ColumnarJoinProbe *probe = &scan->join_probes[i];
+        if (!columnar_join_filter_may_match(probe->filter, &row_group->chunks[probe->column])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Read the chunks of the current row group together with those of the
+ * following row groups the scan will not skip, one read per column, once
+ * the current chunks are neither in the read windows nor in the scan cache.
+ */
+static int columnar_scan_prefetch(ColumnarScan *scan) {
+    ColumnarTable *table = scan->table;
+    ColumnarRowGroup *run[COLUMNAR_COALESCE_MAX_GROUPS];
+    size_t count = 0;
+    bool buffered = true;
+
+    const ColumnarRowGroup *current = table->row_groups[scan->row_group_index];
+    for (size_t c = 0; c < table->num_columns && buffered; c++) {
+        const ColumnarChunk *chunk = &current->chunks[c];
+        buffered = !columnar_scan_reads(scan, c) || chunk->block_size == 0 ||
+                   columnar_chunk_buffered(&scan->buffers[c], chunk) || columnar_scan_cached(scan, current, c);
+    }
+    if (buffered) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    run[count++] = table->row_groups[scan->row_group_index];
+    size_t last = scan->row_group_index + COLUMNAR_COALESCE_MAX_GROUPS;
+    for (size_t g = scan->row_group_index + 1; g < table->num_row_groups && g < last; g++) {
+        if (!columnar_scan_skips(scan, table->row_groups[g], false)) {
+            run[count++] = table->row_groups[g];
+        }
+    }
+
+    for (size_t c = 0; c < table->num_columns; c++) {
+        if (columnar_scan_reads(scan, c) && !columnar_scan_cached(scan, current, c)) {
+            int result = columnar_chunk_prefetch(table, run, count, c, &scan->buffers[c]);
+            if (result != EPIPHANYDB_SUCCESS) {
+                return result;
+            }
+        }
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Produce the next batch with at least one qualifying row */
+bool columnar_scan_next(ColumnarScan *scan, ColumnarBatch **batch) {
+    ColumnarTable *table = scan->table;
+
+    for (;;) {
+        const ColumnarRowGroup *row_group;
+        bool is_delta = scan->row_group_index == table->num_row_groups;
+
+        if (scan->row_group_index < table->num_row_groups) {
+            row_group = table->row_groups[scan->row_group_index];
+        } else if (is_delta && scan->delta_group) {
+            row_group = scan->delta_group;
+        } else if (is_delta) {
+            columnar_scan_advance(scan);  /* no unmerged delta rows */
+            continue;
+        } else {
+            return false;
+        }
+
+        if (scan->row_offset == 0) {
+            columnar_scan_unpin(scan);
+            if (columnar_scan_skips(scan, row_group, is_delta) ||
+                (!is_delta && !columnar_scan_lookup_filter(scan, row_group))) {
+                scan->row_groups_skipped++;
+                columnar_scan_advance(scan);
+                continue;
+            }
+            scan->row_groups_scanned++;
+
+            /* Workers claim scattered row groups, only serial scans read ahead */
+            if (!is_delta && !scan->queue) {
+                int result = columnar_scan_prefetch(scan);
+                if (result != EPIPHANYDB_SUCCESS) {
+                    scan->status = result;
+                    return false;
+                }
+            }
+
+            /* Read and decompress the loaded columns once per row group */
+            for (size_t c = 0; c < table->num_columns; c++) {
+                if (!columnar_scan_reads(scan, c)) {
+                    continue;
+                }
+                int result = columnar_chunk_load_cached(table, row_group, c, &scan->buffers[c], &scan->chunk_entries[c],
+                                                        &scan->chunk_values[c], &scan->chunk_nulls[c]);
+                if (result != EPIPHANYDB_SUCCESS) {
+                    scan->status = result;
+                    return false;
+                }
+            }
+        }
+
+        if (scan->row_offset >= row_group->num_rows) {
+            if (scan->record_filter) {
+                columnar_scan_store_filter(scan, row_group);
+            }
+            columnar_scan_advance(scan);
+            continue;
+        }
+
+        size_t first = scan->row_offset;
+        size_t n = row_group->num_rows - first;
+        if (n > COLUMNAR_BATCH_SIZE) {
+            n = COLUMNAR_BATCH_SIZE;
+        }
+        scan->row_offset += n;
+
+        ColumnarBatch *b = &scan->batch;
+        b->row_group = row_group;
+        b->row_group_index = scan->row_group_index;
+        b->first_row = first;
+        b->num_rows = n;
+        for (size_t c = 0; c < table->num_columns; c++) {
+            const void *values = scan->chunk_values[c];
+            if (!columnar_scan_reads(scan, c)) {
+                b->values[c] = NULL;
+                b->nulls[c] = NULL;
+                continue;
+            }
+            switch (table->column_types[c]) {
+                case COLUMNAR_TYPE_INT64:
+                    b->values[c] = (const int64_t *)values + first;
+                    break;
+                case COLUMNAR_TYPE_DOUBLE:
+                    b->values[c] = (const double *)values + first;
+                    break;
+                default:
+                    b->values[c] = (char *const *)values + first;
+                    break;
+            }
+            b->nulls[c] = scan->chunk_nulls[c] ? scan->chunk_nulls[c] + first : NULL;
+        }
+
+        columnar_filter_batch(scan);
+        if (!is_delta && row_group->num_deleted > 0 && b->num_selected > 0) {
+            columnar_mask_deleted(scan);
+        }
+        if (b->num_selected == 0) {
+            continue;
+        }
+
+        *batch = b;
+        return true;
+    }
+}
+
+void columnar_scan_end(ColumnarScan *scan) {
+    if (!scan) {
+        return;
+    }
+
+    columnar_scan_unpin(scan);
+
+    /* Workers borrow everything but their cursor from the parent scan */
+    if (!scan->parent) {
+        columnar_row_group_free(scan->table, scan->delta_group);
+        columnar_condition_release(scan->table, scan->condition);
+        pthread_rwlock_unlock(&scan->table->lock);
+        free(scan->load_columns);
+        free(scan->condition_only);
+    }
+    free(scan->batch.values);
+    free(scan->batch.nulls);
+    free(scan->selection);
+    for (size_t c = 0; c < scan->table->num_columns; c++) {
+        columnar_chunk_buffer_free(&scan->buffers[c]);
+    }
+    free(scan->buffers);
+    free(scan->chunk_values);
+    free(scan->chunk_nulls);
+    free(scan->chunk_entries);
+    free(scan->filter_bits);
+    free(scan);
+}
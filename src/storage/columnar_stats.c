@@ -0,0 +1,549 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Column statistics. Every sealed chunk carries a HyperLogLog sketch and an
+ * equi-depth histogram of its values next to its zone map; ANALYZE merges
+ * these summaries into table statistics without reading any values, and
+ * selectivity estimates read the result.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
+
+/* Selectivities assumed for columns that have not been analyzed */
+#define COLUMNAR_DEFAULT_EQ_SELECTIVITY 0.005
+#define COLUMNAR_DEFAULT_RANGE_SELECTIVITY (1.0 / 3.0)
+
+static ColumnarDatum columnar_chunk_value(int type, const void *values, size_t row) {
+    ColumnarDatum value;
+
+    switch (type) {
+        case COLUMNAR_TYPE_INT64:
+            value.i64 = ((const int64_t *)values)[row];
+            break;
+        case COLUMNAR_TYPE_DOUBLE:
+            value.f64 = ((const double *)values)[row];
+            break;
+        default:
+            value.text = ((char *const *)values)[row];
+            break;
+    }
+    return value;
+}
+
+static int columnar_copy_datum(int type, ColumnarDatum value, ColumnarDatum *copy) {
+    *copy = value;
+    if (type == COLUMNAR_TYPE_TEXT) {
+        copy->text = strdup(value.text);
+        if (!copy->text) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Chunk statistics */
+
+static int columnar_compare_int64_values(const void *a, const void *b) {
+    int64_t x = ((const ColumnarDatum *)a)->i64;
+    int64_t y = ((const ColumnarDatum *)b)->i64;
+    return (x > y) - (x < y);
+}
+
+static int columnar_compare_double_values(const void *a, const void *b) {
+    double x = ((const ColumnarDatum *)a)->f64;
+    double y = ((const ColumnarDatum *)b)->f64;
+    return (x > y) - (x < y);
+}
+
+static int columnar_compare_text_values(const void *a, const void *b) {
+    return strcmp(((const ColumnarDatum *)a)->text, ((const ColumnarDatum *)b)->text);
+}
+
+static void columnar_sketch_add(uint8_t *sketch, uint64_t hash) {
+    size_t index = (size_t)(hash >> (64 - COLUMNAR_HLL_PRECISION));
+    uint64_t rest = (hash << COLUMNAR_HLL_PRECISION) | (1ULL << (COLUMNAR_HLL_PRECISION - 1));
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+
+    if (rank > sketch[index]) {
+        sketch[index] = rank;
+    }
+}
+
+static double columnar_sketch_estimate(const uint8_t *sketch) {
+    const double m = COLUMNAR_HLL_REGISTERS;
+    double sum = 0.0;
+    size_t zeros = 0;
+
+    for (size_t i = 0; i < COLUMNAR_HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -sketch[i]);
+        zeros += sketch[i] == 0;
+    }
+    double estimate = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / (double)zeros);  /* linear counting for small sets */
+    }
+    return estimate;
+}
+
+/*
+ * Build the sketch and histogram of the non-NULL values of a chunk that
+ * still holds its values in memory.
+ */
+int columnar_stats_build(ColumnarType type, const ColumnarChunk *chunk, size_t num_rows, ColumnarChunkStats *stats) {
+    memset(stats, 0, sizeof(ColumnarChunkStats));
+    if (!chunk->zone_map.has_values) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t num_values = num_rows - chunk->zone_map.null_count;
+    ColumnarDatum *sorted = malloc(num_values * sizeof(ColumnarDatum));
+    stats->sketch = calloc(COLUMNAR_HLL_REGISTERS, 1);
+    stats->bounds = calloc(COLUMNAR_HISTOGRAM_BUCKETS + 1, sizeof(ColumnarDatum));
+    if (!sorted || !stats->sketch || !stats->bounds) {
+        free(sorted);
+        columnar_stats_free(type, stats);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    size_t n = 0;
+    for (size_t r = 0; r < num_rows; r++) {
+        if (chunk->nulls && chunk->nulls[r]) {
+            continue;
+        }
+        sorted[n] = columnar_chunk_value(type, chunk->values, r);
+        columnar_sketch_add(stats->sketch, columnar_bloom_hash(type, sorted[n]));
+        n++;
+    }
+
+    switch (type) {
+        case COLUMNAR_TYPE_INT64:
+            qsort(sorted, n, sizeof(ColumnarDatum), columnar_compare_int64_values);
+            break;
+        case COLUMNAR_TYPE_DOUBLE:
+            qsort(sorted, n, sizeof(ColumnarDatum), columnar_compare_double_values);
+            break;
+        default:
+            qsort(sorted, n, sizeof(ColumnarDatum), columnar_compare_text_values);
+            break;
+    }
+
+    /* Bound i sits at quantile i / COLUMNAR_HISTOGRAM_BUCKETS */
+    int result = EPIPHANYDB_SUCCESS;
+    for (size_t i = 0; i <= COLUMNAR_HISTOGRAM_BUCKETS && result == EPIPHANYDB_SUCCESS; i++) {
+        result = columnar_copy_datum(type, sorted[i * (n - 1) / COLUMNAR_HISTOGRAM_BUCKETS], &stats->bounds[i]);
+        stats->num_bounds += result == EPIPHANYDB_SUCCESS;
+    }
+    free(sorted);
+    if (result != EPIPHANYDB_SUCCESS) {
+        columnar_stats_free(type, stats);
+    }
+    return result;
+}
+
+void columnar_stats_free(ColumnarType type, ColumnarChunkStats *stats) {
+    if (type == COLUMNAR_TYPE_TEXT) {
+        for (size_t i = 0; i < stats->num_bounds; i++) {
+            free((char *)stats->bounds[i].text);
+        }
+    }
+    free(stats->bounds);
+    free(stats->sketch);
+    memset(stats, 0, sizeof(ColumnarChunkStats));
+}
+
+/* Footer encoding */
+
+static size_t columnar_put(uint8_t *out, size_t offset, const void *data, size_t size) {
+    if (out) {
+        memcpy(out + offset, data, size);
+    }
+    return offset + size;
+}
+
+/* Fixed-width values as 8 bytes, TEXT as a 32-bit length and the bytes */
+static size_t columnar_put_datum(uint8_t *out, size_t offset, int type, ColumnarDatum value) {
+    if (type != COLUMNAR_TYPE_TEXT) {
+        return columnar_put(out, offset, &value, sizeof(uint64_t));
+    }
+    uint32_t len = (uint32_t)strlen(value.text);
+    offset = columnar_put(out, offset, &len, sizeof(len));
+    return columnar_put(out, offset, value.text, len);
+}
+
+/*
+ * Write the zone map and statistics of a chunk to out, or only measure
+ * them when out is NULL: null count, value flags, min and max, histogram
+ * bounds and sketch registers. Returns the size in bytes.
+ */
+size_t columnar_stats_serialize(ColumnarType type, const ColumnarChunk *chunk, uint8_t *out) {
+    const ColumnarZoneMap *zone_map = &chunk->zone_map;
+    const ColumnarChunkStats *stats = &chunk->stats;
+    uint64_t null_count = zone_map->null_count;
+    uint8_t flags[4] = {zone_map->has_values, stats->sketch != NULL, 0, 0};
+    uint32_t num_bounds = (uint32_t)stats->num_bounds;
+    size_t offset = 0;
+
+    offset = columnar_put(out, offset, &null_count, sizeof(null_count));
+    offset = columnar_put(out, offset, flags, sizeof(flags));
+    offset = columnar_put(out, offset, &num_bounds, sizeof(num_bounds));
+    if (zone_map->has_values) {
+        offset = columnar_put_datum(out, offset, type, zone_map->min);
+        offset = columnar_put_datum(out, offset, type, zone_map->max);
+    }
+    for (size_t i = 0; i < stats->num_bounds; i++) {
+        offset = columnar_put_datum(out, offset, type, stats->bounds[i]);
+    }
+    if (stats->sketch) {
+        offset = columnar_put(out, offset, stats->sketch, COLUMNAR_HLL_REGISTERS);
+    }
+    return offset;
+}
+
+/* Table statistics */
+
+/* Histogram bucket upper bound carrying a share of the rows of its chunk */
+typedef struct ColumnarHistogramPoint {
+    ColumnarDatum value;
+    double weight;
+} ColumnarHistogramPoint;
+
+static int columnar_compare_points(const void *a, const void *b, void *type) {
+    return columnar_compare_datum(*(const int *)type, ((const ColumnarHistogramPoint *)a)->value,
+                                  ((const ColumnarHistogramPoint *)b)->value);
+}
+
+void columnar_column_stats_free(const ColumnarTable *table, ColumnarColumnStats *stats) {
+    if (!stats) {
+        return;
+    }
+    for (size_t c = 0; c < table->num_columns; c++) {
+        if (table->column_types[c] != COLUMNAR_TYPE_TEXT) {
+            continue;
+        }
+        if (stats[c].has_values) {
+            free((char *)stats[c].min.text);
+            free((char *)stats[c].max.text);
+        }
+        for (size_t i = 0; i < stats[c].num_bounds; i++) {
+            free((char *)stats[c].bounds[i].text);
+        }
+    }
+    free(stats);
+}
+
+/* Merge the chunk statistics of one column across row groups */
+static int columnar_merge_column_stats(const ColumnarTable *table, size_t column, ColumnarRowGroup *const *row_groups, size_t num_row_groups, ColumnarColumnStats *out) {
+    int type = table->column_types[column];
+    uint8_t sketch[COLUMNAR_HLL_REGISTERS] = {0};
+    double nulls = 0.0;
+    double values = 0.0;
+    size_t num_points = 0;
+    int result = EPIPHANYDB_SUCCESS;
+
+    ColumnarHistogramPoint *points = malloc((num_row_groups * COLUMNAR_HISTOGRAM_BUCKETS + 1) * sizeof(ColumnarHistogramPoint));
+    if (!points) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    const ColumnarZoneMap *min_map = NULL;
+    const ColumnarZoneMap *max_map = NULL;
+    for (size_t g = 0; g < num_row_groups; g++) {
+        const ColumnarRowGroup *row_group = row_groups[g];
+        const ColumnarChunk *chunk = &row_group->chunks[column];
+        const ColumnarZoneMap *zone_map = &chunk->zone_map;
+
+        if (row_group->num_rows == 0) {
+            continue;
+        }
+        /* Deleted rows are assumed to be spread like the others */
+        double live = (double)(row_group->num_rows - row_group->num_deleted) / (double)row_group->num_rows;
+        double chunk_values = (double)(row_group->num_rows - zone_map->null_count) * live;
+        nulls += (double)zone_map->null_count * live;
+        values += chunk_values;
+
+        if (!zone_map->has_values || row_group->num_deleted == row_group->num_rows) {
+            continue;
+        }
+        if (!min_map || columnar_compare_datum(type, zone_map->min, min_map->min) < 0) {
+            min_map = zone_map;
+        }
+        if (!max_map || columnar_compare_datum(type, zone_map->max, max_map->max) > 0) {
+            max_map = zone_map;
+        }
+        if (chunk->stats.sketch) {
+            for (size_t i = 0; i < COLUMNAR_HLL_REGISTERS; i++) {
+                sketch[i] = chunk->stats.sketch[i] > sketch[i] ? chunk->stats.sketch[i] : sketch[i];
+            }
+        }
+        for (size_t i = 1; i < chunk->stats.num_bounds; i++) {
+            points[num_points].value = chunk->stats.bounds[i];
+            points[num_points].weight = chunk_values / COLUMNAR_HISTOGRAM_BUCKETS;
+            num_points++;
+        }
+    }
+
+    memset(out, 0, sizeof(ColumnarColumnStats));
+    out->null_count = (uint64_t)llround(nulls);
+    if (min_map) {
+        out->has_values = true;
+        double ndv = columnar_sketch_estimate(sketch);
+        out->ndv = ndv < values ? ndv : values;
+        if (out->ndv < 1.0) {
+            out->ndv = 1.0;
+        }
+        result = columnar_copy_datum(type, min_map->min, &out->min);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = columnar_copy_datum(type, max_map->max, &out->max);
+            if (result != EPIPHANYDB_SUCCESS && type == COLUMNAR_TYPE_TEXT) {
+                free((char *)out->min.text);
+            }
+        }
+        out->has_values = result == EPIPHANYDB_SUCCESS;
+    }
+
+    /* Equi-depth bounds over the pooled bucket bounds of every chunk */
+    if (out->has_values && num_points > 0) {
+        qsort_r(points, num_points, sizeof(ColumnarHistogramPoint), columnar_compare_points, &type);
+
+        double total = 0.0;
+        for (size_t i = 0; i < num_points; i++) {
+            total += points[i].weight;
+        }
+        size_t p = 0;
+        double cumulative = 0.0;
+        for (size_t b = 0; b <= COLUMNAR_HISTOGRAM_BUCKETS && result == EPIPHANYDB_SUCCESS; b++) {
+            ColumnarDatum bound = out->max;
+            if (b == 0) {
+                bound = out->min;
+            } else if (b < COLUMNAR_HISTOGRAM_BUCKETS) {
+                double target = total * (double)b / COLUMNAR_HISTOGRAM_BUCKETS;
+                while (p < num_points - 1 && cumulative + points[p].weight < target) {
+                    cumulative += points[p++].weight;
+                }
+                bound = points[p].value;
+            }
+            result = columnar_copy_datum(type, bound, &out->bounds[b]);
+            out->num_bounds += result == EPIPHANYDB_SUCCESS;
+        }
+    }
+
+    free(points);
+    return result;
+}
+
+/*
+ * Recompute the table statistics from the chunk statistics of the row
+ * groups and of a snapshot of the delta rows. Only the delta snapshot
+ * has its values summarized here; row groups were summarized when sealed.
+ */
+int columnar_analyze(ColumnarTable *table) {
+    ColumnarRowGroup *snapshot = NULL;
+
+    pthread_rwlock_rdlock(&table->lock);
+    int result = columnar_delta_snapshot(table, &snapshot);
+    for (size_t c = 0; snapshot && c < table->num_columns && result == EPIPHANYDB_SUCCESS; c++) {
+        result = columnar_stats_build(table->column_types[c], &snapshot->chunks[c], snapshot->num_rows, &snapshot->chunks[c].stats);
+    }
+
+    size_t num_row_groups = table->num_row_groups;
+    ColumnarRowGroup **row_groups = malloc((num_row_groups + 1) * sizeof(ColumnarRowGroup *));
+    ColumnarColumnStats *stats = calloc(table->num_columns, sizeof(ColumnarColumnStats));
+    if (result == EPIPHANYDB_SUCCESS && (!row_groups || !stats)) {
+        result = EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    uint64_t rows = 0;
+    if (result == EPIPHANYDB_SUCCESS) {
+        memcpy(row_groups, table->row_groups, num_row_groups * sizeof(ColumnarRowGroup *));
+        if (snapshot) {
+            row_groups[num_row_groups++] = snapshot;
+        }
+        for (size_t g = 0; g < num_row_groups; g++) {
+            rows += row_groups[g]->num_rows - row_groups[g]->num_deleted;
+        }
+    }
+    for (size_t c = 0; c < table->num_columns && result == EPIPHANYDB_SUCCESS; c++) {
+        result = columnar_merge_column_stats(table, c, row_groups, num_row_groups, &stats[c]);
+    }
+    pthread_rwlock_unlock(&table->lock);
+
+    columnar_row_group_free(table, snapshot);
+    free(row_groups);
+    if (result != EPIPHANYDB_SUCCESS) {
+        columnar_column_stats_free(table, stats);
+        return result;
+    }
+
+    pthread_rwlock_wrlock(&table->lock);
+    ColumnarColumnStats *previous = table->stats;
+    table->stats = stats;
+    table->stats_rows = rows;
+    pthread_rwlock_unlock(&table->lock);
+
+    columnar_column_stats_free(table, previous);
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Selectivity estimates */
+
+static double columnar_datum_as_double(int type, ColumnarDatum value) {
+    return type == COLUMNAR_TYPE_INT64 ? (double)value.i64 : value.f64;
+}
+
+/* Compare the constant of predicate against a value of its column */
+static int columnar_compare_constant(const ColumnarTable *table, const ColumnarPredicate *predicate, ColumnarDatum value) {
+    if (predicate->compare_as_double) {
+        double bound = (double)value.i64;
+        return (predicate->value.f64 > bound) - (predicate->value.f64 < bound);
+    }
+    return columnar_compare_datum(table->column_types[predicate->column], predicate->value, value);
+}
+
+/* Estimated fraction of the non-NULL values below the constant of predicate */
+static double columnar_fraction_below(const ColumnarTable *table, const ColumnarColumnStats *stats, const ColumnarPredicate *predicate) {
+    int type = table->column_types[predicate->column];
+    size_t buckets = stats->num_bounds - 1;
+
+    for (size_t b = 0; b < buckets; b++) {
+        const ColumnarDatum *lo = &stats->bounds[b];
+        const ColumnarDatum *hi = &stats->bounds[b + 1];
+        double position = 0.5;
+
+        if (predicate->compare_as_double || type != COLUMNAR_TYPE_TEXT) {
+            double value = predicate->compare_as_double ? predicate->value.f64 : columnar_datum_as_double(type, predicate->value);
+            double low = columnar_datum_as_double(type, *lo);
+            double high = columnar_datum_as_double(type, *hi);
+            if (value > high) {
+                continue;
+            }
+            if (value <= low) {
+                return (double)b / buckets;
+            }
+            position = (value - low) / (high - low);
+        } else {
+            if (columnar_compare_datum(type, predicate->value, *hi) > 0) {
+                continue;
+            }
+            if (columnar_compare_datum(type, predicate->value, *lo) <= 0) {
+                return (double)b / buckets;
+            }
+        }
+        return ((double)b + position) / buckets;
+    }
+    return 1.0;
+}
+
+/*
+ * Estimated fraction of the rows of table that satisfy predicate, from the
+ * statistics of the last analyze or from fixed guesses without them.
+ */
+double columnar_estimate_selectivity(ColumnarTable *table, const ColumnarPredicate *predicate) {
+    double selectivity;
+
+    pthread_rwlock_rdlock(&table->lock);
+    const ColumnarColumnStats *stats = table->stats ? &table->stats[predicate->column] : NULL;
+    if (!stats) {
+        selectivity = predicate->op == COLUMNAR_OP_EQ ? COLUMNAR_DEFAULT_EQ_SELECTIVITY
+                    : predicate->op == COLUMNAR_OP_NE ? 1.0 - COLUMNAR_DEFAULT_EQ_SELECTIVITY
+                    : COLUMNAR_DEFAULT_RANGE_SELECTIVITY;
+        pthread_rwlock_unlock(&table->lock);
+        return selectivity;
+    }
+    if (!stats->has_values || table->stats_rows == 0) {
+        pthread_rwlock_unlock(&table->lock);
+        return 0.0;
+    }
+
+    double non_null = 1.0 - (double)stats->null_count / (double)table->stats_rows;
+    double equal = non_null / stats->ndv;
+    double below = stats->num_bounds > 1 ? columnar_fraction_below(table, stats, predicate) : 0.5;
+    if (columnar_compare_constant(table, predicate, stats->min) < 0 ||
+        columnar_compare_constant(table, predicate, stats->max) > 0) {
+        equal = 0.0;  /* outside the observed values */
+    }
+
+    switch (predicate->op) {
+        case COLUMNAR_OP_EQ:
+            selectivity = equal;
+            break;
+        case COLUMNAR_OP_NE:
+            selectivity = non_null - equal;
+            break;
+        case COLUMNAR_OP_LT:
+            selectivity = non_null * below;
+            break;
+        case COLUMNAR_OP_LE:
+            selectivity = non_null * below + equal;
+            break;
+        case COLUMNAR_OP_GT:
+            selectivity = non_null * (1.0 - below) - equal;
+            break;
+        default:
+            selectivity = non_null * (1.0 - below);
+            break;
+    }
+    pthread_rwlock_unlock(&table->lock);
+
+    if (selectivity < 0.0) {
+        return 0.0;
+    }
+    return selectivity > 1.0 ? 1.0 : selectivity;
+}
+
+/* Entry points */
+
+int columnar_analyze_table(EpiphanyDBTable *table) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    return columnar_analyze(col_table);
+}
+
+/*
+ * Live rows, including unmerged delta rows, and bytes stored: blocks and
+ * bloom filters of persisted chunks, buffered delta rows.
+ */
+int columnar_table_stats(EpiphanyDBTable *table, uint64_t *num_rows, uint64_t *table_size) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table || !num_rows || !table_size) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t rows = 0;
+    uint64_t size = 0;
+
+    pthread_rwlock_rdlock(&col_table->lock);
+    for (size_t g = 0; g < col_table->num_row_groups; g++) {
+        const ColumnarRowGroup *row_group = col_table->row_groups[g];
+        rows += row_group->num_rows - row_group->num_deleted;
+        for (size_t c = 0; c < col_table->num_columns; c++) {
+            size += row_group->chunks[c].block_size + columnar_bloom_size(&row_group->chunks[c].bloom);
+        }
+    }
+
+    ColumnarDeltaStore *delta = &col_table->delta;
+    pthread_mutex_lock(&delta->mutex);
+    if (delta->active) {
+        rows += delta->active->num_live;
+        size += delta->active->size;
+    }
+    for (ColumnarDeltaSegment *segment = delta->frozen; segment; segment = segment->next) {
+        rows += segment->num_live;
+        size += segment->size;
+    }
+    pthread_mutex_unlock(&delta->mutex);
+    pthread_rwlock_unlock(&col_table->lock);
+
+    *num_rows = rows;
+    *table_size = size;
+    return EPIPHANYDB_SUCCESS;
+}
@@ -1,141 +1,1331 @@
 /*
  * EpiphanyDB Columnar Storage Engine
- * 
+ *
  * Column-oriented storage engine optimized for analytical workloads
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "../../include/epiphanydb.h"
+#include "columnar_storage.h"
 
-/* Columnar storage specific structures */
-typedef struct ColumnarStorageContext {
-    char *data_directory;
-    size_t compression_level;
-    bool enable_vectorization;
-} ColumnarStorageContext;
-
-typedef struct ColumnarTable {
-    char *table_name;
-    char **column_files;
-    size_t num_columns;
-    size_t num_rows;
-    char **column_names;
-    int *column_types;
-} ColumnarTable;
+/* Engine wide state, set up by columnar_storage_init */
+static ColumnarStorageContext *columnar_ctx = NULL;
+
+/* Create a directory and its missing parents */
+static int columnar_make_directory(const char *path) {
+    char buffer[1024];
+    size_t len = strlen(path);
+
+    if (len == 0 || len >= sizeof(buffer)) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    memcpy(buffer, path, len + 1);
+    for (char *p = buffer + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+                return EPIPHANYDB_ERROR_IO;
+            }
+            *p = '/';
+        }
+    }
+    if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+        return EPIPHANYDB_ERROR_IO;
+    }
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Map a schema type name onto a column type */
+static int columnar_parse_type(const char *type_name, int *type) {
+    static const struct {
+        const char *name;
+        ColumnarType type;
+    } type_names[] = {
+        {"INTEGER", COLUMNAR_TYPE_INT64},
+        {"INT", COLUMNAR_TYPE_INT64},
+        {"BIGINT", COLUMNAR_TYPE_INT64},
+        {"SMALLINT", COLUMNAR_TYPE_INT64},
+        {"TIMESTAMP", COLUMNAR_TYPE_INT64},
+        {"DOUBLE", COLUMNAR_TYPE_DOUBLE},
+        {"FLOAT", COLUMNAR_TYPE_DOUBLE},
+        {"REAL", COLUMNAR_TYPE_DOUBLE},
+        {"NUMERIC", COLUMNAR_TYPE_DOUBLE},
+        {"TEXT", COLUMNAR_TYPE_TEXT},
+        {"VARCHAR", COLUMNAR_TYPE_TEXT},
+        {"CHAR", COLUMNAR_TYPE_TEXT}
+    };
+    size_t len = 0;
+
+    while (isalpha((unsigned char)type_name[len])) {
+        len++;
+    }
+
+    for (size_t i = 0; i < sizeof(type_names) / sizeof(type_names[0]); i++) {
+        if (strlen(type_names[i].name) == len && strncasecmp(type_names[i].name, type_name, len) == 0) {
+            *type = type_names[i].type;
+            return EPIPHANYDB_SUCCESS;
+        }
+    }
+
+    return EPIPHANYDB_ERROR_INVALID_PARAM;
+}
+
+/* Cluster kind named by a "<kind> KEY" clause, or COLUMNAR_CLUSTER_NONE */
+static ColumnarClusterKind columnar_parse_cluster_kind(const char *name, size_t name_len, const char *rest) {
+    static const struct {
+        const char *name;
+        ColumnarClusterKind kind;
+    } kind_names[] = {
+        {"SORT", COLUMNAR_CLUSTER_SORT},
+        {"ZORDER", COLUMNAR_CLUSTER_ZORDER},
+        {"HILBERT", COLUMNAR_CLUSTER_HILBERT}
+    };
+
+    if (strncasecmp(rest, "KEY", 3) != 0 || isalnum((unsigned char)rest[3]) || rest[3] == '_') {
+        return COLUMNAR_CLUSTER_NONE;
+    }
+    for (size_t i = 0; i < sizeof(kind_names) / sizeof(kind_names[0]); i++) {
+        if (strlen(kind_names[i].name) == name_len && strncasecmp(kind_names[i].name, name, name_len) == 0) {
+            return kind_names[i].kind;
+        }
+    }
+    return COLUMNAR_CLUSTER_NONE;
+}
+
+/* Resolve the "(a, b, ...)" column list of a cluster key clause */
+static int columnar_parse_cluster_columns(ColumnarTable *table, const char *p, const char *end) {
+    while (p < end && isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (p == end || *p != '(') {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    p++;
+
+    for (;;) {
+        while (p < end && isspace((unsigned char)*p)) {
+            p++;
+        }
+        const char *name = p;
+        while (p < end && (isalnum((unsigned char)*p) || *p == '_')) {
+            p++;
+        }
+        size_t name_len = (size_t)(p - name);
+        size_t c = 0;
+        while (c < table->num_columns && (strlen(table->column_names[c]) != name_len ||
+                                          strncmp(table->column_names[c], name, name_len) != 0)) {
+            c++;
+        }
+        if (name_len == 0 || c == table->num_columns || table->num_cluster_columns == COLUMNAR_MAX_CLUSTER_COLUMNS) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        for (size_t k = 0; k < table->num_cluster_columns; k++) {
+            if (table->cluster_columns[k] == (int)c) {
+                return EPIPHANYDB_ERROR_INVALID_PARAM;
+            }
+        }
+        table->cluster_columns[table->num_cluster_columns++] = (int)c;
+
+        while (p < end && isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (p < end && *p == ',') {
+            p++;
+            continue;
+        }
+        if (p == end || *p != ')') {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        p++;
+        break;
+    }
+
+    while (p < end && isspace((unsigned char)*p)) {
+        p++;
+    }
+    return p == end ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_INVALID_PARAM;
+}
+
+/*
+ * Parse "name TYPE, name TYPE, ..." into the column arrays of a table. One
+ * "SORT KEY (a, ...)", "ZORDER KEY (a, ...)" or "HILBERT KEY (a, ...)"
+ * entry may name the cluster key columns.
+ */
+static int columnar_parse_schema(ColumnarTable *table, const char *schema) {
+    const char *p = schema;
+    const char *cluster_start = NULL;
+    const char *cluster_end = NULL;
+
+    while (*p) {
+        const char *start;
+        const char *end;
+        int depth = 0;
+
+        while (isspace((unsigned char)*p) || *p == ',') {
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+
+        /* Column definitions are separated by top level commas */
+        start = p;
+        while (*p && !(*p == ',' && depth == 0)) {
+            if (*p == '(') {
+                depth++;
+            } else if (*p == ')') {
+                depth--;
+            }
+            p++;
+        }
+        end = p;
+
+        const char *name_end = start;
+        while (name_end < end && (isalnum((unsigned char)*name_end) || *name_end == '_')) {
+            name_end++;
+        }
+        const char *type_start = name_end;
+        while (type_start < end && isspace((unsigned char)*type_start)) {
+            type_start++;
+        }
+        if (name_end == start || type_start == end) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+
+        ColumnarClusterKind kind = columnar_parse_cluster_kind(start, (size_t)(name_end - start), type_start);
+        if (kind != COLUMNAR_CLUSTER_NONE) {
+            if (table->cluster_kind != COLUMNAR_CLUSTER_NONE) {
+                return EPIPHANYDB_ERROR_INVALID_PARAM;
+            }
+            /* Columns may be declared after the clause */
+            table->cluster_kind = kind;
+            cluster_start = type_start + 3;
+            cluster_end = end;
+            continue;
+        }
+
+        int type;
+        if (columnar_parse_type(type_start, &type) != EPIPHANYDB_SUCCESS) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+
+        size_t n = table->num_columns;
+        char **names = realloc(table->column_names, (n + 1) * sizeof(char *));
+        if (!names) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        table->column_names = names;
+        int *types = realloc(table->column_types, (n + 1) * sizeof(int));
+        if (!types) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        table->column_types = types;
+
+        table->column_names[n] = strndup(start, (size_t)(name_end - start));
+        if (!table->column_names[n]) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        table->column_types[n] = type;
+        table->num_columns++;
+    }
+
+    if (table->num_columns == 0) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (cluster_start) {
+        return columnar_parse_cluster_columns(table, cluster_start, cluster_end);
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Row group management */
+
+static size_t columnar_value_size(int type) {
+    switch (type) {
+        case COLUMNAR_TYPE_INT64:
+            return sizeof(int64_t);
+        case COLUMNAR_TYPE_DOUBLE:
+            return sizeof(double);
+        default:
+            return sizeof(char *);
+    }
+}
+
+/* Empty row group, its id is assigned when it is published */
+ColumnarRowGroup *columnar_row_group_create(const ColumnarTable *table) {
+    ColumnarRowGroup *row_group = calloc(1, sizeof(ColumnarRowGroup));
+    if (!row_group) {
+        return NULL;
+    }
+
+    row_group->chunks = calloc(table->num_columns, sizeof(ColumnarChunk));
+    if (!row_group->chunks) {
+        free(row_group);
+        return NULL;
+    }
+
+    return row_group;
+}
+
+void columnar_row_group_free(const ColumnarTable *table, ColumnarRowGroup *row_group) {
+    if (!row_group) {
+        return;
+    }
+
+    for (size_t c = 0; c < table->num_columns; c++) {
+        ColumnarChunk *chunk = &row_group->chunks[c];
+        if (table->column_types[c] == COLUMNAR_TYPE_TEXT) {
+            char **texts = chunk->values;
+            for (size_t r = 0; texts && r < row_group->num_rows; r++) {
+                free(texts[r]);
+            }
+            if (chunk->zone_map.has_values) {
+                free((char *)chunk->zone_map.min.text);
+                free((char *)chunk->zone_map.max.text);
+            }
+        }
+        free(chunk->values);
+        free(chunk->nulls);
+        columnar_bloom_free(&chunk->bloom);
+        columnar_stats_free(table->column_types[c], &chunk->stats);
+    }
+    free(row_group->chunks);
+    columnar_bitmap_free(&row_group->deleted);
+    free(row_group);
+}
+
+/* Seal a row group and append it to the table, table lock held in write mode */
+int columnar_publish_row_group(ColumnarTable *table, ColumnarRowGroup *row_group) {
+    if (table->num_row_groups == table->row_groups_capacity) {
+        size_t capacity = table->row_groups_capacity ? table->row_groups_capacity * 2 : 16;
+        ColumnarRowGroup **row_groups = realloc(table->row_groups, capacity * sizeof(ColumnarRowGroup *));
+        if (!row_groups) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        table->row_groups = row_groups;
+        table->row_groups_capacity = capacity;
+    }
+
+    row_group->id = table->next_row_group_id++;
+    row_group->sealed = true;
+    table->row_groups[table->num_row_groups++] = row_group;
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Widen the zone map of a chunk with one non-NULL value */
+static int columnar_zone_map_add(ColumnarZoneMap *zone_map, int type, ColumnarDatum value) {
+    if (type == COLUMNAR_TYPE_TEXT) {
+        if (!zone_map->has_values || strcmp(value.text, zone_map->min.text) < 0) {
+            char *copy = strdup(value.text);
+            if (!copy) {
+                return EPIPHANYDB_ERROR_MEMORY;
+            }
+            if (zone_map->has_values) {
+                free((char *)zone_map->min.text);
+            }
+            zone_map->min.text = copy;
+        }
+        if (!zone_map->has_values || strcmp(value.text, zone_map->max.text) > 0) {
+            char *copy = strdup(value.text);
+            if (!copy) {
+                return EPIPHANYDB_ERROR_MEMORY;
+            }
+            if (zone_map->has_values) {
+                free((char *)zone_map->max.text);
+            }
+            zone_map->max.text = copy;
+        }
+    } else if (!zone_map->has_values) {
+        zone_map->min = value;
+        zone_map->max = value;
+    } else {
+        if (columnar_compare_datum(type, value, zone_map->min) < 0) {
+            zone_map->min = value;
+        }
+        if (columnar_compare_datum(type, value, zone_map->max) > 0) {
+            zone_map->max = value;
+        }
+    }
+
+    zone_map->has_values = true;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Append one decoded row to a row group that is still being built */
+int columnar_row_group_append(const ColumnarTable *table, ColumnarRowGroup *row_group, const ColumnarDatum *values, const bool *nulls) {
+    size_t row = row_group->num_rows;
+
+    if (row_group->sealed) {
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+
+    for (size_t c = 0; c < table->num_columns; c++) {
+        ColumnarChunk *chunk = &row_group->chunks[c];
+        int type = table->column_types[c];
+
+        if (row == chunk->capacity) {
+            size_t capacity = chunk->capacity ? chunk->capacity * 2 : 1024;
+            void *grown = realloc(chunk->values, capacity * columnar_value_size(type));
+            if (!grown) {
+                return EPIPHANYDB_ERROR_MEMORY;
+            }
+            chunk->values = grown;
+            if (chunk->nulls) {
+                uint8_t *grown_nulls = realloc(chunk->nulls, capacity);
+                if (!grown_nulls) {
+                    return EPIPHANYDB_ERROR_MEMORY;
+                }
+                memset(grown_nulls + chunk->capacity, 0, capacity - chunk->capacity);
+                chunk->nulls = grown_nulls;
+            }
+            chunk->capacity = capacity;
+        }
+
+        if (nulls[c]) {
+            if (!chunk->nulls) {
+                chunk->nulls = calloc(chunk->capacity, 1);
+                if (!chunk->nulls) {
+                    return EPIPHANYDB_ERROR_MEMORY;
+                }
+            }
+            chunk->nulls[row] = 1;
+            chunk->zone_map.null_count++;
+        }
+
+        switch (type) {
+            case COLUMNAR_TYPE_INT64:
+                ((int64_t *)chunk->values)[row] = nulls[c] ? 0 : values[c].i64;
+                break;
+            case COLUMNAR_TYPE_DOUBLE:
+                ((double *)chunk->values)[row] = nulls[c] ? 0.0 : values[c].f64;
+                break;
+            default:
+                ((char **)chunk->values)[row] = NULL;
+                if (!nulls[c]) {
+                    char *copy = strdup(values[c].text);
+                    if (!copy) {
+                        return EPIPHANYDB_ERROR_MEMORY;
+                    }
+                    ((char **)chunk->values)[row] = copy;
+                }
+                break;
+        }
+
+        if (!nulls[c]) {
+            int result = columnar_zone_map_add(&chunk->zone_map, type, values[c]);
+            if (result != EPIPHANYDB_SUCCESS) {
+                return result;
+            }
+        }
+    }
+
+    row_group->num_rows++;
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Row format used by columnar_insert_row: a NULL bitmap of one bit per
+ * column followed by the non-NULL values in schema order. INT64 and DOUBLE
+ * values take 8 bytes, TEXT values a 4 byte length and the bytes.
+ */
+
+/* Encoded size of a row, 0 when a non-NULL TEXT value is missing */
+static size_t columnar_encoded_size(const ColumnarTable *table, const ColumnarDatum *values, const bool *nulls) {
+    size_t size = (table->num_columns + 7) / 8;
+
+    for (size_t c = 0; c < table->num_columns; c++) {
+        if (nulls && nulls[c]) {
+            continue;
+        }
+        if (table->column_types[c] == COLUMNAR_TYPE_TEXT) {
+            if (!values[c].text) {
+                return 0;
+            }
+            size += sizeof(uint32_t) + strlen(values[c].text);
+        } else {
+            size += 8;
+        }
+    }
+    return size;
+}
+
+/* Write a row of columnar_encoded_size bytes */
+static void columnar_encode_into(const ColumnarTable *table, const ColumnarDatum *values, const bool *nulls, uint8_t *row) {
+    size_t offset = (table->num_columns + 7) / 8;
+
+    memset(row, 0, offset);
+    for (size_t c = 0; c < table->num_columns; c++) {
+        if (nulls && nulls[c]) {
+            row[c / 8] |= (uint8_t)(1 << (c % 8));
+            continue;
+        }
+        switch (table->column_types[c]) {
+            case COLUMNAR_TYPE_INT64:
+                memcpy(row + offset, &values[c].i64, 8);
+                offset += 8;
+                break;
+            case COLUMNAR_TYPE_DOUBLE:
+                memcpy(row + offset, &values[c].f64, 8);
+                offset += 8;
+                break;
+            default: {
+                uint32_t len = (uint32_t)strlen(values[c].text);
+                memcpy(row + offset, &len, sizeof(len));
+                offset += sizeof(len);
+                memcpy(row + offset, values[c].text, len);
+                offset += len;
+                break;
+            }
+        }
+    }
+}
+
+/* Validate an encoded row and measure the TEXT bytes it carries */
+static int columnar_measure_row(const ColumnarTable *table, const uint8_t *p, size_t data_size, size_t *text_size) {
+    size_t bitmap_size = (table->num_columns + 7) / 8;
+    size_t offset = bitmap_size;
+
+    *text_size = 0;
+    if (data_size < bitmap_size) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    for (size_t c = 0; c < table->num_columns; c++) {
+        if ((p[c / 8] >> (c % 8)) & 1) {
+            continue;
+        }
+        if (table->column_types[c] == COLUMNAR_TYPE_TEXT) {
+            uint32_t len;
+            if (offset + sizeof(len) > data_size) {
+                return EPIPHANYDB_ERROR_INVALID_PARAM;
+            }
+            memcpy(&len, p + offset, sizeof(len));
+            offset += sizeof(len);
+            if (len > data_size - offset) {
+                return EPIPHANYDB_ERROR_INVALID_PARAM;
+            }
+            offset += len;
+            *text_size += len + 1;
+        } else {
+            if (offset + 8 > data_size) {
+                return EPIPHANYDB_ERROR_INVALID_PARAM;
+            }
+            offset += 8;
+        }
+    }
+
+    return offset == data_size ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_INVALID_PARAM;
+}
+
+int columnar_check_row(const ColumnarTable *table, const void *data, size_t data_size) {
+    size_t text_size;
+    return columnar_measure_row(table, data, data_size, &text_size);
+}
+
+/* Decode an encoded row; TEXT values point into *text_buffer, freed by the caller */
+int columnar_decode_row(const ColumnarTable *table, const void *data, size_t data_size, ColumnarDatum *values, bool *nulls, char **text_buffer) {
+    const uint8_t *p = data;
+    size_t bitmap_size = (table->num_columns + 7) / 8;
+    size_t offset;
+    size_t text_size;
+
+    *text_buffer = NULL;
+    int result = columnar_measure_row(table, p, data_size, &text_size);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+    for (size_t c = 0; c < table->num_columns; c++) {
+        nulls[c] = (p[c / 8] >> (c % 8)) & 1;
+    }
+
+    char *text = NULL;
+    if (text_size > 0) {
+        text = malloc(text_size);
+        if (!text) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+    *text_buffer = text;
+
+    offset = bitmap_size;
+    for (size_t c = 0; c < table->num_columns; c++) {
+        if (nulls[c]) {
+            memset(&values[c], 0, sizeof(ColumnarDatum));
+            continue;
+        }
+        switch (table->column_types[c]) {
+            case COLUMNAR_TYPE_INT64:
+                memcpy(&values[c].i64, p + offset, 8);
+                offset += 8;
+                break;
+            case COLUMNAR_TYPE_DOUBLE:
+                memcpy(&values[c].f64, p + offset, 8);
+                offset += 8;
+                break;
+            default: {
+                uint32_t len;
+                memcpy(&len, p + offset, sizeof(len));
+                offset += sizeof(len);
+                memcpy(text, p + offset, len);
+                text[len] = '\0';
+                values[c].text = text;
+                text += len + 1;
+                offset += len;
+                break;
+            }
+        }
+    }
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+static void columnar_table_free(ColumnarTable *table) {
+    if (!table) {
+        return;
+    }
+
+    columnar_condition_cache_clear(table);
+    pthread_mutex_destroy(&table->conditions_mutex);
+    columnar_cache_forget_table(table->cache, table->cache_id);
+    columnar_delta_destroy(&table->delta);
+    pthread_rwlock_destroy(&table->lock);
+    columnar_files_close(table);
+
+    for (size_t i = 0; i < table->num_row_groups; i++) {
+        columnar_row_group_free(table, table->row_groups[i]);
+    }
+    free(table->row_groups);
+    columnar_column_stats_free(table, table->stats);
+    for (size_t c = 0; c < table->num_columns; c++) {
+        free(table->column_names[c]);
+        if (table->column_files) {
+            free(table->column_files[c]);
+        }
+    }
+    free(table->column_names);
+    free(table->column_files);
+    free(table->column_types);
+    free(table->schema);
+    free(table->table_name);
+    free(table);
+}
+
+/* Find a table in the catalog, merge_mutex held */
+static ColumnarTable *columnar_lookup_table(const char *table_name) {
+    for (ColumnarTable *table = columnar_ctx ? columnar_ctx->tables : NULL; table; table = table->next) {
+        if (strcmp(table->table_name, table_name) == 0) {
+            return table;
+        }
+    }
+    return NULL;
+}
 
 /* Initialize columnar storage engine */
 int columnar_storage_init(EpiphanyDBContext *ctx) {
+    if (columnar_ctx) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
     ColumnarStorageContext *col_ctx = malloc(sizeof(ColumnarStorageContext));
     if (!col_ctx) {
         return EPIPHANYDB_ERROR_MEMORY;
     }
-    
+
     col_ctx->data_directory = strdup("./data/columnar");
     col_ctx->compression_level = 6;  /* Medium compression */
+    col_ctx->scan_workers = 0;       /* One per allowed CPU */
+    col_ctx->bloom_bits_per_key = COLUMNAR_BLOOM_BITS_PER_KEY;
     col_ctx->enable_vectorization = true;
-    
-    /* TODO: Create data directory if it doesn't exist */
-    
+    col_ctx->tables = NULL;
+    col_ctx->scan_cache = NULL;
+    if (!col_ctx->data_directory) {
+        free(col_ctx);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    const EpiphanyDBConfig *config = epiphanydb_get_config(ctx);
+    if (config && config->scan_cache_size > 0) {
+        col_ctx->scan_cache = columnar_cache_create(config->scan_cache_size);
+        if (!col_ctx->scan_cache) {
+            free(col_ctx->data_directory);
+            free(col_ctx);
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+
+    int result = columnar_make_directory(col_ctx->data_directory);
+    if (result != EPIPHANYDB_SUCCESS) {
+        columnar_cache_destroy(col_ctx->scan_cache);
+        free(col_ctx->data_directory);
+        free(col_ctx);
+        return result;
+    }
+
+    pthread_mutex_init(&col_ctx->merge_mutex, NULL);
+    pthread_cond_init(&col_ctx->merge_cond, NULL);
+    col_ctx->merger_running = false;
+
+    /* Background merger compacting delta segments into row groups */
+    result = columnar_merger_start(col_ctx);
+    if (result != EPIPHANYDB_SUCCESS) {
+        pthread_cond_destroy(&col_ctx->merge_cond);
+        pthread_mutex_destroy(&col_ctx->merge_mutex);
+        columnar_cache_destroy(col_ctx->scan_cache);
+        free(col_ctx->data_directory);
+        free(col_ctx);
+        return result;
+    }
+
+    columnar_ctx = col_ctx;
     return EPIPHANYDB_SUCCESS;
 }
 
 /* Cleanup columnar storage engine */
 int columnar_storage_cleanup(EpiphanyDBContext *ctx) {
-    /* TODO: Cleanup columnar storage resources */
+    if (!columnar_ctx) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    columnar_merger_stop(columnar_ctx);
+
+    ColumnarTable *table = columnar_ctx->tables;
+    while (table) {
+        ColumnarTable *next = table->next;
+        columnar_table_free(table);
+        table = next;
+    }
+    pthread_cond_destroy(&columnar_ctx->merge_cond);
+    pthread_mutex_destroy(&columnar_ctx->merge_mutex);
+    columnar_cache_destroy(columnar_ctx->scan_cache);
+    free(columnar_ctx->data_directory);
+    free(columnar_ctx);
+    columnar_ctx = NULL;
+
     return EPIPHANYDB_SUCCESS;
 }
 
 /* Create columnar table */
 int columnar_create_table(EpiphanyDBContext *ctx, const char *table_name, const char *schema) {
-    ColumnarTable *table = malloc(sizeof(ColumnarTable));
+    if (!table_name || !schema) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (!columnar_ctx) {
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+
+    ColumnarTable *table = calloc(1, sizeof(ColumnarTable));
     if (!table) {
         return EPIPHANYDB_ERROR_MEMORY;
     }
-    
+    if (columnar_delta_init(&table->delta) != EPIPHANYDB_SUCCESS) {
+        free(table);
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+    pthread_rwlock_init(&table->lock, NULL);
+    pthread_mutex_init(&table->conditions_mutex, NULL);
+
     table->table_name = strdup(table_name);
+    table->schema = strdup(schema);
     table->num_rows = 0;
-    
-    /* TODO: Parse schema to determine columns */
-    table->num_columns = 0;  /* Placeholder */
-    table->column_files = NULL;
-    table->column_names = NULL;
-    table->column_types = NULL;
-    
-    /* TODO: Create column files */
-    
-    free(table->table_name);
-    free(table);
-    
+    if (!table->table_name || !table->schema) {
+        columnar_table_free(table);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    int result = columnar_parse_schema(table, schema);
+    if (result != EPIPHANYDB_SUCCESS) {
+        columnar_table_free(table);
+        return result;
+    }
+
+    table->compression_level = (int)columnar_ctx->compression_level;
+    table->scan_workers = columnar_ctx->scan_workers;
+    table->bloom_bits_per_key = columnar_ctx->bloom_bits_per_key;
+    table->cache = columnar_ctx->scan_cache;
+    table->cache_id = columnar_cache_table_id();
+    result = columnar_files_create(table, columnar_ctx->data_directory);
+    if (result != EPIPHANYDB_SUCCESS) {
+        columnar_table_free(table);
+        return result;
+    }
+
+    pthread_mutex_lock(&columnar_ctx->merge_mutex);
+    if (columnar_lookup_table(table_name)) {
+        pthread_mutex_unlock(&columnar_ctx->merge_mutex);
+        columnar_table_free(table);
+        return EPIPHANYDB_ERROR_ALREADY_EXISTS;
+    }
+    table->next = columnar_ctx->tables;
+    columnar_ctx->tables = table;
+    pthread_mutex_unlock(&columnar_ctx->merge_mutex);
+
     return EPIPHANYDB_SUCCESS;
 }
 
 /* Open columnar table */
 int columnar_open_table(EpiphanyDBContext *ctx, const char *table_name, EpiphanyDBTable **table) {
-    /* TODO: Implement columnar table opening */
+    if (!ctx || !table_name || !table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    if (!columnar_ctx) {
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+
+    pthread_mutex_lock(&columnar_ctx->merge_mutex);
+    ColumnarTable *col_table = columnar_lookup_table(table_name);
+    pthread_mutex_unlock(&columnar_ctx->merge_mutex);
+    if (!col_table) {
+        return EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+
+    EpiphanyDBError result = epiphanydb_create_table(ctx, table_name, EPIPHANYDB_STORAGE_COLUMNAR, col_table->schema, table);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+    epiphanydb_table_set_storage_handle(*table, col_table);
+
     return EPIPHANYDB_SUCCESS;
 }
 
 /* Close columnar table */
 int columnar_close_table(EpiphanyDBTable *table) {
-    /* TODO: Implement columnar table closing */
+    if (!table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    /* The table itself stays registered with the engine */
+    epiphanydb_table_set_storage_handle(table, NULL);
+    epiphanydb_close_table(table);
+
     return EPIPHANYDB_SUCCESS;
 }
 
 /* Insert row into columnar table */
 int columnar_insert_row(EpiphanyDBTable *table, const void *data, size_t data_size) {
-    /* TODO: Implement columnar row insertion */
-    /* This involves splitting the row data into columns and appending to respective column files */
-    return EPIPHANYDB_SUCCESS;
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table || !data) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int result = columnar_check_row(col_table, data, data_size);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    /* Rows land in the row-oriented delta store, the merger columnizes them */
+    bool merge_needed = false;
+    result = columnar_delta_insert(col_table, data, data_size, &merge_needed);
+    if (result == EPIPHANYDB_SUCCESS && merge_needed) {
+        columnar_merger_request(columnar_ctx);
+    }
+
+    return result;
 }
 
 /* Update row in columnar table */
 int columnar_update_row(EpiphanyDBTable *table, const void *key, const void *data, size_t data_size) {
-    /* TODO: Implement columnar row update */
-    /* This is more complex in columnar storage due to the column-oriented nature */
-    return EPIPHANYDB_SUCCESS;
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table || !key || !data) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int result = columnar_check_row(col_table, data, data_size);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    /* An update deletes the old version and inserts the new one into the delta */
+    size_t num_deleted = 0;
+    bool merge_needed = false;
+    pthread_rwlock_wrlock(&col_table->lock);
+    result = columnar_delta_delete_key(col_table, *(const ColumnarDatum *)key, &num_deleted);
+    if (result == EPIPHANYDB_SUCCESS && num_deleted == 0) {
+        result = EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = columnar_delta_insert(col_table, data, data_size, &merge_needed);
+    }
+    merge_needed = merge_needed || __atomic_load_n(&col_table->delta.compact_pending, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&col_table->lock);
+
+    if (merge_needed) {
+        columnar_merger_request(columnar_ctx);
+    }
+    return result;
 }
 
 /* Delete row from columnar table */
 int columnar_delete_row(EpiphanyDBTable *table, const void *key) {
-    /* TODO: Implement columnar row deletion */
-    /* Mark rows as deleted in a separate bitmap or tombstone file */
-    return EPIPHANYDB_SUCCESS;
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table || !key) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    /* Rows only get a bit in their row group delete bitmap; chunks stay untouched */
+    size_t num_deleted = 0;
+    pthread_rwlock_wrlock(&col_table->lock);
+    int result = columnar_delta_delete_key(col_table, *(const ColumnarDatum *)key, &num_deleted);
+    bool compact_needed = __atomic_load_n(&col_table->delta.compact_pending, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&col_table->lock);
+
+    if (compact_needed) {
+        columnar_merger_request(columnar_ctx);
+    }
+    if (result == EPIPHANYDB_SUCCESS && num_deleted == 0) {
+        return EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+    return result;
 }
 
-/* Query rows from columnar table */
-int columnar_query_rows(EpiphanyDBTable *table, const char *condition, void **results, size_t *num_results) {
-    /* TODO: Implement columnar row querying */
-    /* This should leverage vectorized operations for better performance */
+/*
+ * Return the rows matching condition as an array of ColumnarRowData, each
+ * pointing at a row in the columnar_encode_row format inside the same
+ * allocation, so a single free() releases the result. Only the chunks of
+ * the projected columns and of the condition are read; the other columns
+ * come back as NULL. Row groups that zone maps or bloom filters rule out
+ * are skipped before any chunk is read.
+ */
+int columnar_query_columns(EpiphanyDBTable *table, const char *const *columns, size_t num_columns, const char *condition, void **results, size_t *num_results) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table || (num_columns > 0 && !columns) || !results || !num_results) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
     *results = NULL;
     *num_results = 0;
+
+    ColumnarScan *scan = NULL;
+    int result = columnar_scan_begin(col_table, columns, num_columns, condition, &scan);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    bool *projected = calloc(col_table->num_columns, sizeof(bool));
+    if (projected) {
+        for (size_t i = 0; i < num_columns; i++) {
+            projected[columnar_find_column(col_table, columns[i])] = true;
+        }
+    }
+
+    ColumnarDatum *values = malloc(col_table->num_columns * sizeof(ColumnarDatum));
+    bool *nulls = malloc(col_table->num_columns * sizeof(bool));
+    size_t *sizes = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    uint8_t *rows = NULL;
+    size_t row_bytes = 0;
+    size_t row_capacity = 0;
+    ColumnarBatch *batch;
+
+    if (!values || !nulls || !projected) {
+        result = EPIPHANYDB_ERROR_MEMORY;
+    }
+    while (result == EPIPHANYDB_SUCCESS && columnar_scan_next(scan, &batch)) {
+        for (size_t i = 0; i < batch->num_selected && result == EPIPHANYDB_SUCCESS; i++) {
+            size_t row = batch->selection ? batch->selection[i] : i;
+
+            for (size_t c = 0; c < col_table->num_columns; c++) {
+                nulls[c] = !projected[c] || (batch->nulls[c] && batch->nulls[c][row]);
+                if (nulls[c]) {
+                    continue;
+                }
+                switch (col_table->column_types[c]) {
+                    case COLUMNAR_TYPE_INT64:
+                        values[c].i64 = ((const int64_t *)batch->values[c])[row];
+                        break;
+                    case COLUMNAR_TYPE_DOUBLE:
+                        values[c].f64 = ((const double *)batch->values[c])[row];
+                        break;
+                    default:
+                        values[c].text = ((char *const *)batch->values[c])[row];
+                        break;
+                }
+            }
+
+            size_t size = columnar_encoded_size(col_table, values, nulls);
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                size_t *grown = realloc(sizes, capacity * sizeof(size_t));
+                if (!grown) {
+                    result = EPIPHANYDB_ERROR_MEMORY;
+                    break;
+                }
+                sizes = grown;
+            }
+            if (row_bytes + size > row_capacity) {
+                size_t grown_capacity = row_capacity ? row_capacity * 2 : 4096;
+                while (grown_capacity < row_bytes + size) {
+                    grown_capacity *= 2;
+                }
+                uint8_t *grown = realloc(rows, grown_capacity);
+                if (!grown) {
+                    result = EPIPHANYDB_ERROR_MEMORY;
+                    break;
+                }
+                rows = grown;
+                row_capacity = grown_capacity;
+            }
+            columnar_encode_into(col_table, values, nulls, rows + row_bytes);
+            sizes[count++] = size;
+            row_bytes += size;
+        }
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = scan->status;
+    }
+    columnar_scan_end(scan);
+    free(values);
+    free(nulls);
+    free(projected);
+
+    /* Row descriptors first, encoded rows behind them */
+    ColumnarRowData *out = NULL;
+    if (result == EPIPHANYDB_SUCCESS && count > 0) {
+        out = malloc(count * sizeof(ColumnarRowData) + row_bytes);
+        if (!out) {
+            result = EPIPHANYDB_ERROR_MEMORY;
+        } else {
+            uint8_t *data = (uint8_t *)(out + count);
+            memcpy(data, rows, row_bytes);
+            for (size_t i = 0; i < count; i++) {
+                out[i].data = data;
+                out[i].size = sizes[i];
+                data += sizes[i];
+            }
+        }
+    }
+    free(sizes);
+    free(rows);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    *results = out;
+    *num_results = count;
     return EPIPHANYDB_SUCCESS;
 }
 
+/* Query rows from columnar table, every column projected */
+int columnar_query_rows(EpiphanyDBTable *table, const char *condition, void **results, size_t *num_results) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    return columnar_query_columns(table, (const char *const *)col_table->column_names, col_table->num_columns,
+                                  condition, results, num_results);
+}
+
 /* Columnar-specific functions */
 
-/* Compress column data */
+/* Compress column data into a self-describing block at the engine's compression level */
 int columnar_compress_column(const void *data, size_t data_size, void **compressed_data, size_t *compressed_size) {
-    /* TODO: Implement column compression (e.g., using LZ4, Snappy, or custom algorithms) */
-    *compressed_data = NULL;
-    *compressed_size = 0;
-    return EPIPHANYDB_SUCCESS;
+    if (!compressed_data || !compressed_size) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int level = columnar_ctx ? (int)columnar_ctx->compression_level : 6;
+    ColumnarCodec codec;
+    return columnar_block_compress(data, data_size, level, compressed_data, compressed_size, &codec);
 }
 
-/* Decompress column data */
+/* Decompress a block produced by columnar_compress_column */
 int columnar_decompress_column(const void *compressed_data, size_t compressed_size, void **data, size_t *data_size) {
-    /* TODO: Implement column decompression */
-    *data = NULL;
-    *data_size = 0;
+    size_t raw_size = 0;
+
+    if (!data || !data_size) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int result = columnar_block_raw_size(compressed_data, compressed_size, &raw_size);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+    void *out = malloc(raw_size ? raw_size : 1);
+    if (!out) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    result = columnar_block_decompress(compressed_data, compressed_size, out, raw_size, NULL);
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(out);
+        return result;
+    }
+
+    *data = out;
+    *data_size = raw_size;
     return EPIPHANYDB_SUCCESS;
 }
 
-/* Vectorized column scan */
+/*
+ * Values gathered by one worker of a vectorized scan. unit_first and
+ * unit_count are shared by all workers and indexed by row group; each row
+ * group is claimed by a single worker, so the entries never race.
+ */
+typedef struct ColumnarCollector {
+    size_t worker;
+    int column;
+    int type;
+    ColumnarDatum *values;  /* TEXT values hold offsets into texts */
+    size_t count;
+    size_t capacity;
+    char *texts;
+    size_t text_bytes;
+    size_t text_capacity;
+    size_t *unit_owner;
+    size_t *unit_first;
+    size_t *unit_count;
+} ColumnarCollector;
+
+static int columnar_collect_batch(void *state, const ColumnarBatch *batch) {
+    ColumnarCollector *collector = state;
+    const void *values = batch->values[collector->column];
+    const uint8_t *nulls = batch->nulls[collector->column];
+    size_t unit = batch->row_group_index;
+
+    if (collector->unit_count[unit] == 0) {
+        collector->unit_owner[unit] = collector->worker;
+        collector->unit_first[unit] = collector->count;
+    }
+
+    if (collector->count + batch->num_selected > collector->capacity) {
+        size_t capacity = (collector->count + batch->num_selected) * 2;
+        ColumnarDatum *grown = realloc(collector->values, capacity * sizeof(ColumnarDatum));
+        if (!grown) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        collector->values = grown;
+        collector->capacity = capacity;
+    }
+
+    ColumnarDatum *out = collector->values;
+    size_t count = collector->count;
+    for (size_t i = 0; i < batch->num_selected; i++) {
+        size_t row = batch->selection ? batch->selection[i] : i;
+        if (nulls && nulls[row]) {
+            continue;
+        }
+        switch (collector->type) {
+            case COLUMNAR_TYPE_INT64:
+                out[count].i64 = ((const int64_t *)values)[row];
+                break;
+            case COLUMNAR_TYPE_DOUBLE:
+                out[count].f64 = ((const double *)values)[row];
+                break;
+            default: {
+                /* Decoded chunks are reused, copy the text and keep its offset */
+                const char *text = ((char *const *)values)[row];
+                size_t len = strlen(text) + 1;
+                if (collector->text_bytes + len > collector->text_capacity) {
+                    size_t grown_capacity = collector->text_capacity ? collector->text_capacity * 2 : 4096;
+                    while (grown_capacity < collector->text_bytes + len) {
+                        grown_capacity *= 2;
+                    }
+                    char *grown = realloc(collector->texts, grown_capacity);
+                    if (!grown) {
+                        return EPIPHANYDB_ERROR_MEMORY;
+                    }
+                    collector->texts = grown;
+                    collector->text_capacity = grown_capacity;
+                }
+                memcpy(collector->texts + collector->text_bytes, text, len);
+                out[count].i64 = (int64_t)collector->text_bytes;
+                collector->text_bytes += len;
+                break;
+            }
+        }
+        count++;
+    }
+    collector->count = count;
+    collector->unit_count[unit] = count - collector->unit_first[unit];
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Vectorized column scan. Returns an array of ColumnarDatum holding the
+ * values of column_name for every row matching condition; TEXT values point
+ * into the same allocation so a single free() releases the result. Row
+ * groups are scanned in parallel and the values concatenated in row group
+ * order.
+ */
 int columnar_vectorized_scan(EpiphanyDBTable *table, const char *column_name, const char *condition, void **results, size_t *num_results) {
-    /* TODO: Implement vectorized column scanning for analytical queries */
+    return columnar_vectorized_join_scan(table, column_name, condition, NULL, NULL, 0, results, num_results);
+}
+
+/*
+ * Vectorized column scan of the probe side of a join. Rows must also have a
+ * join_columns[i] value that may be a key of join_filters[i], built from the
+ * other side of the join; row groups the filters rule out are not read.
+ * The result may still hold rows without a join partner, the join decides.
+ */
+int columnar_vectorized_join_scan(EpiphanyDBTable *table, const char *column_name, const char *condition,
+                                  const char *const *join_columns, const ColumnarJoinFilter *const *join_filters, size_t num_join_filters,
+                                  void **results, size_t *num_results) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table || !column_name || !results || !num_results ||
+        (num_join_filters > 0 && (!join_columns || !join_filters))) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
     *results = NULL;
     *num_results = 0;
+
+    int column = columnar_find_column(col_table, column_name);
+    if (column < 0) {
+        return EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+    int type = col_table->column_types[column];
+
+    ColumnarScan *scan = NULL;
+    const char *columns[1] = {column_name};
+    int result = columnar_scan_begin(col_table, columns, 1, condition, &scan);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+    for (size_t i = 0; i < num_join_filters; i++) {
+        result = columnar_scan_add_join_filter(scan, join_columns[i], join_filters[i]);
+        if (result != EPIPHANYDB_SUCCESS) {
+            columnar_scan_end(scan);
+            return result;
+        }
+    }
+
+    size_t num_units = col_table->num_row_groups + 1;
+    size_t num_workers = columnar_scan_workers(scan);
+    ColumnarCollector collectors[COLUMNAR_MAX_SCAN_WORKERS];
+    void *states[COLUMNAR_MAX_SCAN_WORKERS];
+    size_t *units = calloc(num_units * 3, sizeof(size_t));
+    if (!units) {
+        columnar_scan_end(scan);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    memset(collectors, 0, num_workers * sizeof(ColumnarCollector));
+    for (size_t w = 0; w < num_workers; w++) {
+        collectors[w].worker = w;
+        collectors[w].column = column;
+        collectors[w].type = type;
+        collectors[w].unit_owner = units;
+        collectors[w].unit_first = units + num_units;
+        collectors[w].unit_count = units + 2 * num_units;
+        states[w] = &collectors[w];
+    }
+
+    result = columnar_parallel_scan(scan, num_workers, columnar_collect_batch, states);
+    columnar_scan_end(scan);
+
+    /* Concatenate in row group order, TEXT values behind the datum array */
+    size_t count = 0;
+    size_t text_bytes = 0;
+    for (size_t w = 0; w < num_workers; w++) {
+        count += collectors[w].count;
+        text_bytes += collectors[w].text_bytes;
+    }
+
+    ColumnarDatum *out = NULL;
+    if (result == EPIPHANYDB_SUCCESS && count > 0) {
+        out = malloc(count * sizeof(ColumnarDatum) + text_bytes);
+        if (!out) {
+            result = EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+    if (out) {
+        char *text = (char *)(out + count);
+        size_t next = 0;
+        for (size_t u = 0; u < num_units; u++) {
+            const ColumnarCollector *collector = &collectors[units[u]];
+            const ColumnarDatum *values = collector->values + units[num_units + u];
+            size_t n = units[2 * num_units + u];
+
+            if (type != COLUMNAR_TYPE_TEXT) {
+                memcpy(out + next, values, n * sizeof(ColumnarDatum));
+                next += n;
+                continue;
+            }
+            for (size_t i = 0; i < n; i++) {
+                const char *value = collector->texts + values[i].i64;
+                size_t len = strlen(value) + 1;
+                memcpy(text, value, len);
+                out[next++].text = text;
+                text += len;
+            }
+        }
+    }
+
+    for (size_t w = 0; w < num_workers; w++) {
+        free(collectors[w].values);
+        free(collectors[w].texts);
+    }
+    free(units);
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(out);
+        return result;
+    }
+
+    *results = out;
+    *num_results = count;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Internal helpers shared with the other columnar sources */
+
+/* Columnar table attached to an open table handle */
+ColumnarTable *columnar_get_table(EpiphanyDBTable *table) {
+    return table ? epiphanydb_table_storage_handle(table) : NULL;
+}
+
+/* Index of a column by name, or -1 when the table has no such column */
+int columnar_find_column(const ColumnarTable *table, const char *column_name) {
+    for (size_t c = 0; c < table->num_columns; c++) {
+        if (strcasecmp(table->column_names[c], column_name) == 0) {
+            return (int)c;
+        }
+    }
+    return -1;
+}
+
+/* Three-way comparison of two non-NULL values of the same type */
+int columnar_compare_datum(ColumnarType type, ColumnarDatum a, ColumnarDatum b) {
+    switch (type) {
+        case COLUMNAR_TYPE_INT64:
+            return (a.i64 > b.i64) - (a.i64 < b.i64);
+        case COLUMNAR_TYPE_DOUBLE:
+            return (a.f64 > b.f64) - (a.f64 < b.f64);
+        default:
+            return strcmp(a.text, b.text);
+    }
+}
+
+/* Encode values into the row format accepted by columnar_insert_row */
+int columnar_encode_row(EpiphanyDBTable *table, const ColumnarDatum *values, const bool *nulls, void **data, size_t *data_size) {
+    ColumnarTable *col_table = columnar_get_table(table);
+    if (!col_table || !values || !data || !data_size) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    size_t size = columnar_encoded_size(col_table, values, nulls);
+    if (size == 0) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    uint8_t *row = malloc(size);
+    if (!row) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    columnar_encode_into(col_table, values, nulls, row);
+
+    *data = row;
+    *data_size = size;
     return EPIPHANYDB_SUCCESS;
-}
\ No newline at end of file
+}
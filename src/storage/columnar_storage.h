@@ -0,0 +1,735 @@
+/*
+ * EpiphanyDB Columnar Storage Engine
+ *
+ * Internal definitions shared by the columnar storage engine sources
+ */
+
+#ifndef EPIPHANYDB_COLUMNAR_STORAGE_H
+#define EPIPHANYDB_COLUMNAR_STORAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include "../../include/epiphanydb.h"
+
+/* Rows per row group before it is sealed */
+#define COLUMNAR_ROW_GROUP_SIZE 65536
+
+/* Rows per batch handed to vectorized operators */
+#define COLUMNAR_BATCH_SIZE 2048
+
+/* Delta rows buffered before a segment is handed to the background merger */
+#define COLUMNAR_DELTA_MERGE_THRESHOLD COLUMNAR_ROW_GROUP_SIZE
+
+/* Deleted fraction of a row group above which compaction rewrites it */
+#define COLUMNAR_COMPACT_THRESHOLD 0.2
+
+/* Cardinality above which a bitmap container switches from array to bitset */
+#define COLUMNAR_BITMAP_ARRAY_MAX 4096
+
+/* Upper bound on scan worker threads */
+#define COLUMNAR_MAX_SCAN_WORKERS 64
+
+/* Size of a cache line, used to keep shared counters apart */
+#define COLUMNAR_CACHE_LINE_SIZE 64
+
+/* Words of a bloom filter block, one cache line */
+#define COLUMNAR_BLOOM_BLOCK_WORDS 8
+
+/* Default bloom filter size; about 1% false positives */
+#define COLUMNAR_BLOOM_BITS_PER_KEY 10
+
+/* Columns a cluster key may combine */
+#define COLUMNAR_MAX_CLUSTER_COLUMNS 8
+
+/* Unclustered row groups that trigger a background clustering pass */
+#define COLUMNAR_CLUSTER_TRIGGER 4
+
+/* Row groups rewritten together by one clustering pass */
+#define COLUMNAR_CLUSTER_MAX_GROUPS 16
+
+/* HyperLogLog registers of a distinct value sketch, 2^precision */
+#define COLUMNAR_HLL_PRECISION 10
+#define COLUMNAR_HLL_REGISTERS (1 << COLUMNAR_HLL_PRECISION)
+
+/* Buckets of equi-depth histograms */
+#define COLUMNAR_HISTOGRAM_BUCKETS 16
+
+/* Chunks of consecutive row groups are read together up to this span... */
+#define COLUMNAR_COALESCE_MAX_BYTES (4 << 20)
+
+/* ...as long as they are no further apart than this */
+#define COLUMNAR_COALESCE_GAP_BYTES (64 << 10)
+
+/* Row groups a scan looks ahead when coalescing reads */
+#define COLUMNAR_COALESCE_MAX_GROUPS 64
+
+/* Compiled scan conditions kept per table */
+#define COLUMNAR_CONDITION_CACHE_SIZE 64
+
+/* Join filters one scan may apply */
+#define COLUMNAR_MAX_JOIN_FILTERS 8
+
+/* Distinct join keys up to which chunk bloom filters are probed key by key */
+#define COLUMNAR_JOIN_PROBE_KEYS 16
+
+/* Share of the scan cache budget held by entries hit more than once */
+#define COLUMNAR_CACHE_PROTECTED_SHARE 0.8
+
+/* Column of scan cache entries holding the filter result of a condition */
+#define COLUMNAR_CACHE_FILTER UINT32_MAX
+
+/* Column value types */
+typedef enum ColumnarType {
+    COLUMNAR_TYPE_INT64 = 0,   /* INTEGER, BIGINT, SMALLINT, TIMESTAMP */
+    COLUMNAR_TYPE_DOUBLE,      /* DOUBLE, FLOAT, REAL, NUMERIC */
+    COLUMNAR_TYPE_TEXT         /* TEXT, VARCHAR, CHAR */
+} ColumnarType;
+
+/* Single column value */
+typedef union ColumnarDatum {
+    int64_t i64;
+    double f64;
+    const char *text;
+} ColumnarDatum;
+
+/* Per-chunk min/max metadata used to skip row groups */
+typedef struct ColumnarZoneMap {
+    bool has_values;       /* false when every value is NULL */
+    ColumnarDatum min;     /* TEXT bounds are owned copies */
+    ColumnarDatum max;
+    size_t null_count;
+} ColumnarZoneMap;
+
+/* Block codecs for chunks written to column files */
+typedef enum ColumnarCodec {
+    COLUMNAR_CODEC_NONE = 0,
+    COLUMNAR_CODEC_LZ4,
+    COLUMNAR_CODEC_ZSTD
+} ColumnarCodec;
+
+/* Header in front of every block produced by columnar_block_compress */
+#define COLUMNAR_BLOCK_MAGIC 0x4B4C4245  /* "EBLK" */
+typedef struct ColumnarBlockHeader {
+    uint32_t magic;
+    uint8_t codec;
+    uint8_t reserved[3];
+    uint64_t raw_size;
+} ColumnarBlockHeader;
+
+/*
+ * Column files end with a footer listing the live chunks, rewritten after
+ * every merge or compaction: one entry per row group, the serialized
+ * statistics of every entry in the same order, then the trailer. Bloom
+ * filters are stored right behind their chunk's block.
+ */
+#define COLUMNAR_FOOTER_MAGIC 0x52544645  /* "EFTR" */
+typedef struct ColumnarFooterEntry {
+    uint64_t row_group_id;
+    uint64_t num_rows;
+    uint64_t block_offset;
+    uint64_t block_size;
+    uint64_t bloom_offset;
+    uint32_t bloom_blocks;
+    uint32_t stats_size;     /* bytes of this chunk's statistics */
+} ColumnarFooterEntry;
+
+typedef struct ColumnarFileTrailer {
+    uint64_t footer_offset;
+    uint32_t num_entries;
+    uint32_t magic;
+} ColumnarFileTrailer;
+
+/* Distinct value sketch and equi-depth histogram of the non-NULL values of a chunk */
+typedef struct ColumnarChunkStats {
+    uint8_t *sketch;         /* COLUMNAR_HLL_REGISTERS HyperLogLog registers */
+    ColumnarDatum *bounds;   /* sorted bucket bounds, TEXT bounds are owned copies */
+    size_t num_bounds;       /* COLUMNAR_HISTOGRAM_BUCKETS + 1, or 0 without values */
+} ColumnarChunkStats;
+
+/*
+ * Column statistics of a whole table computed by columnar_analyze from the
+ * chunk statistics, without reading any values.
+ */
+typedef struct ColumnarColumnStats {
+    uint64_t null_count;
+    bool has_values;
+    ColumnarDatum min;       /* TEXT values are owned copies */
+    ColumnarDatum max;
+    double ndv;              /* estimated distinct non-NULL values */
+    ColumnarDatum bounds[COLUMNAR_HISTOGRAM_BUCKETS + 1];
+    size_t num_bounds;
+} ColumnarColumnStats;
+
+/* Split-block bloom filter over the non-NULL values of a chunk */
+typedef struct ColumnarBloomFilter {
+    uint64_t *blocks;      /* num_blocks cache-line aligned blocks */
+    uint32_t num_blocks;   /* 0 when the chunk has no filter */
+} ColumnarBloomFilter;
+
+/*
+ * Values of one column within one row group. Sealed chunks are written to
+ * the column file as one compressed block holding the values (TEXT: uint32
+ * offsets followed by NUL-terminated strings) and, if any, the null bytes;
+ * their in-memory values are released afterwards.
+ */
+typedef struct ColumnarChunk {
+    void *values;          /* int64_t[], double[] or char *[]; NULL rows hold 0 */
+    uint8_t *nulls;        /* one byte per row, NULL while no value is NULL */
+    size_t capacity;
+    ColumnarZoneMap zone_map;
+    uint64_t file_offset;  /* block position in the column file */
+    size_t block_size;     /* 0 while the values are held in memory */
+    size_t raw_size;
+    bool has_nulls;
+    ColumnarCodec codec;
+    ColumnarBloomFilter bloom;  /* built when sealed, copy in the column file */
+    uint64_t bloom_offset;
+    ColumnarChunkStats stats;   /* built when sealed, copy in the footer */
+} ColumnarChunk;
+
+/* Read and decompression buffers reused across the chunks of one column */
+typedef struct ColumnarChunkBuffer {
+    uint8_t *block;
+    size_t block_capacity;
+    uint8_t *data;
+    size_t data_capacity;
+    char **texts;
+    size_t texts_capacity;
+    void *codec_context;   /* decompression state kept between blocks */
+    uint8_t *window;       /* coalesced read of adjacent blocks */
+    size_t window_capacity;
+    uint64_t window_offset;
+    size_t window_size;
+} ColumnarChunkBuffer;
+
+/*
+ * Roaring-style container holding the row numbers sharing the high 16 bits
+ * key: a sorted array while sparse, a 65536-bit bitset once dense.
+ */
+typedef struct ColumnarBitmapContainer {
+    uint16_t key;
+    uint32_t cardinality;
+    uint16_t *array;        /* sorted low bits, NULL once converted to bits */
+    uint64_t *bits;
+} ColumnarBitmapContainer;
+
+/* Compressed set of row numbers; zero-initialized is empty */
+typedef struct ColumnarBitmap {
+    ColumnarBitmapContainer *containers;  /* sorted by key */
+    size_t num_containers;
+    size_t capacity;
+    size_t cardinality;
+} ColumnarBitmap;
+
+/* Horizontal slice of a table stored column by column, immutable once sealed */
+typedef struct ColumnarRowGroup {
+    uint64_t id;
+    size_t num_rows;
+    size_t num_deleted;     /* rows set in deleted */
+    bool sealed;
+    bool clustered;         /* written by a clustering pass, see ColumnarClusterKind */
+    ColumnarChunk *chunks;  /* one per column */
+    ColumnarBitmap deleted; /* masked by scans until compaction drops the rows */
+} ColumnarRowGroup;
+
+/* Source row of a row written by columnar_cluster_rows */
+typedef struct ColumnarRowOrigin {
+    uint32_t source;
+    uint32_t row;
+} ColumnarRowOrigin;
+
+/* Inserted row kept in the delta store, encoded in the insert row format */
+typedef struct ColumnarDeltaRow {
+    size_t offset;
+    uint32_t length;
+    bool dead;              /* deleted or replaced by an update */
+} ColumnarDeltaRow;
+
+/* Append-only run of delta rows, merged into one row group once frozen */
+typedef struct ColumnarDeltaSegment {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    ColumnarDeltaRow *rows;
+    size_t num_rows;
+    size_t rows_capacity;
+    size_t num_live;
+    struct ColumnarDeltaSegment *next;
+} ColumnarDeltaSegment;
+
+/*
+ * Write-optimized store in front of the row groups. Inserts append to the
+ * active segment under the delta mutex only; full segments are frozen and
+ * compacted into row groups by the background merger. Deletes of rows that
+ * already live in row groups are recorded in the row group delete bitmap.
+ */
+typedef struct ColumnarDeltaStore {
+    pthread_mutex_t mutex;
+    pthread_mutex_t merge_mutex;    /* serializes merges and compactions of this table */
+    ColumnarDeltaSegment *active;
+    ColumnarDeltaSegment *frozen;   /* oldest first */
+    bool compact_pending;           /* a row group crossed COLUMNAR_COMPACT_THRESHOLD */
+} ColumnarDeltaStore;
+
+/*
+ * Row order declared by a "SORT KEY (...)", "ZORDER KEY (...)" or
+ * "HILBERT KEY (...)" schema clause. Merges sort every new row group by the
+ * key; clustering passes re-sort overlapping row groups together so their
+ * zone maps stay tight on the key columns.
+ */
+typedef enum ColumnarClusterKind {
+    COLUMNAR_CLUSTER_NONE = 0,
+    COLUMNAR_CLUSTER_SORT,      /* lexicographic on the key columns */
+    COLUMNAR_CLUSTER_ZORDER,    /* interleaved bits of the key columns */
+    COLUMNAR_CLUSTER_HILBERT    /* position along a Hilbert curve */
+} ColumnarClusterKind;
+
+/*
+ * Scan cache key: a decoded chunk is keyed by its column with hash 0, the
+ * rows of a row group matching a condition by COLUMNAR_CACHE_FILTER and
+ * the condition hash. Row group ids are never reused within a table and
+ * row groups never change once sealed, so entries need no invalidation.
+ */
+typedef struct ColumnarCacheKey {
+    uint64_t table_id;
+    uint64_t row_group_id;
+    uint32_t column;
+    uint64_t hash;
+} ColumnarCacheKey;
+
+/*
+ * Cached decoded chunk or filter bitmap. values, nulls and bitmap point
+ * into data. Entries are pinned while referenced and freed on the last
+ * release once evicted.
+ */
+typedef struct ColumnarCacheEntry {
+    ColumnarCacheKey key;
+    struct ColumnarCacheEntry *hash_next;
+    struct ColumnarCacheEntry *prev;  /* segment list, most recent first */
+    struct ColumnarCacheEntry *next;
+    size_t refs;
+    bool cached;                      /* false once evicted */
+    bool protected_segment;           /* hit again since it was inserted */
+    size_t size;                      /* bytes charged to the budget */
+    size_t num_rows;
+    const void *values;               /* decoded chunk, TEXT as char * */
+    const uint8_t *nulls;
+    uint64_t *bitmap;                 /* matching rows of a filter entry */
+    size_t num_matches;
+    uint8_t data[];
+} ColumnarCacheEntry;
+
+/*
+ * Decoded chunks and filter results shared by the scans of every table,
+ * evicted by segmented LRU within a memory budget: new entries start in a
+ * probationary segment and move to a protected one when hit again, so one
+ * large scan cannot flush the entries that repeated queries keep using.
+ */
+typedef struct ColumnarCache {
+    pthread_mutex_t mutex;
+    size_t budget;
+    size_t used;
+    size_t protected_used;
+    ColumnarCacheEntry **buckets;
+    size_t num_buckets;
+    size_t num_entries;
+    ColumnarCacheEntry probation;     /* list heads */
+    ColumnarCacheEntry protected_list;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} ColumnarCache;
+
+/* Columnar storage specific structures */
+typedef struct ColumnarStorageContext {
+    char *data_directory;
+    size_t compression_level;
+    size_t scan_workers;           /* threads per scan, 0 for one per allowed CPU */
+    size_t bloom_bits_per_key;     /* chunk bloom filter size, 0 disables them */
+    bool enable_vectorization;
+    ColumnarCache *scan_cache;     /* NULL without a scan cache budget */
+    struct ColumnarTable *tables;  /* catalog of created tables */
+    pthread_mutex_t merge_mutex;   /* guards the catalog and merge requests */
+    pthread_cond_t merge_cond;
+    pthread_t merger;
+    bool merger_running;
+    bool merge_pending;
+    bool shutdown;
+} ColumnarStorageContext;
+
+typedef struct ColumnarTable {
+    char *table_name;
+    char **column_files;
+    size_t num_columns;
+    size_t num_rows;
+    char **column_names;
+    int *column_types;
+    char *schema;
+    int *column_fds;
+    uint64_t *column_file_sizes;   /* append position, advanced under delta.merge_mutex */
+    int compression_level;
+    size_t scan_workers;
+    size_t bloom_bits_per_key;
+    ColumnarCache *cache;          /* scan cache of the engine, may be NULL */
+    uint64_t cache_id;             /* identifies the table in cache keys */
+    ColumnarClusterKind cluster_kind;
+    int cluster_columns[COLUMNAR_MAX_CLUSTER_COLUMNS];
+    size_t num_cluster_columns;
+    ColumnarRowGroup **row_groups;
+    size_t num_row_groups;
+    size_t row_groups_capacity;
+    uint64_t next_row_group_id;
+    pthread_rwlock_t lock;         /* scans read, row group publication and deletes write */
+    ColumnarDeltaStore delta;
+    ColumnarColumnStats *stats;    /* one per column, NULL until analyzed; guarded by lock */
+    uint64_t stats_rows;           /* live rows when stats were computed */
+    struct ColumnarCondition *conditions[COLUMNAR_CONDITION_CACHE_SIZE];  /* most recently used first */
+    size_t num_conditions;
+    pthread_mutex_t conditions_mutex;
+    struct ColumnarTable *next;
+} ColumnarTable;
+
+/* Comparison operators accepted in scan conditions */
+typedef enum ColumnarCompareOp {
+    COLUMNAR_OP_EQ = 0,
+    COLUMNAR_OP_NE,
+    COLUMNAR_OP_LT,
+    COLUMNAR_OP_LE,
+    COLUMNAR_OP_GT,
+    COLUMNAR_OP_GE
+} ColumnarCompareOp;
+
+/*
+ * Filter kernel specialized for one column type and operator. With in ==
+ * NULL it considers rows 0..n-1, otherwise the n rows listed in in, and
+ * writes the qualifying non-NULL rows to out, which may alias in.
+ */
+typedef size_t (*ColumnarFilterFn)(const void *values, const uint8_t *nulls, ColumnarDatum constant, const uint16_t *in, size_t n, uint16_t *out);
+
+/* One "column op constant" conjunct of a scan condition */
+typedef struct ColumnarPredicate {
+    int column;
+    ColumnarCompareOp op;
+    bool compare_as_double;  /* INT64 column compared with a constant strtoll cannot read */
+    ColumnarDatum value;     /* TEXT constants are owned copies */
+    bool bloom_probe;        /* equality that bloom filters can rule out */
+    uint64_t bloom_hash;
+    ColumnarFilterFn filter;
+} ColumnarPredicate;
+
+/*
+ * Condition text compiled against the schema of a table: resolved columns,
+ * typed constants, bloom hashes and filter kernels. Shared by the condition
+ * cache of the table and the scans running it.
+ */
+typedef struct ColumnarCondition {
+    char *text;
+    uint64_t hash;
+    ColumnarPredicate *predicates;
+    size_t num_predicates;
+    size_t refs;             /* guarded by the conditions_mutex of the table */
+} ColumnarCondition;
+
+/*
+ * Runtime filter built from the join keys of the small side of a join and
+ * pushed into scans of the large side: the key range, a bloom filter over
+ * the keys and, for few distinct keys, their hashes. NULL keys never join
+ * and are left out; a filter without keys rejects every row.
+ */
+typedef struct ColumnarJoinFilter {
+    ColumnarType type;
+    bool has_keys;
+    ColumnarDatum min;       /* TEXT bounds are owned copies */
+    ColumnarDatum max;
+    ColumnarBloomFilter bloom;
+    uint64_t *hashes;        /* sorted distinct key hashes */
+    size_t num_hashes;       /* 0 beyond COLUMNAR_JOIN_PROBE_KEYS */
+} ColumnarJoinFilter;
+
+/* Join filter applied by a scan to one of its columns */
+typedef struct ColumnarJoinProbe {
+    int column;
+    const ColumnarJoinFilter *filter;
+} ColumnarJoinProbe;
+
+/*
+ * Window of up to COLUMNAR_BATCH_SIZE rows of one row group. values[c] and
+ * nulls[c] point at the first row of the window for every loaded column and
+ * are NULL for columns the scan did not load, which include the columns
+ * only the condition reads when its result came from the scan cache. When selection is NULL every
+ * row of the window qualifies, otherwise it lists the qualifying row offsets.
+ */
+typedef struct ColumnarBatch {
+    const ColumnarRowGroup *row_group;
+    size_t row_group_index;         /* num_row_groups for the delta snapshot */
+    size_t first_row;
+    size_t num_rows;
+    const void **values;
+    const uint8_t **nulls;
+    const uint16_t *selection;
+    size_t num_selected;
+} ColumnarBatch;
+
+/*
+ * Row groups [next, end) not yet claimed by the workers of one NUMA node.
+ * next is advanced atomically; each range sits on its own cache line.
+ */
+typedef struct ColumnarWorkRange {
+    size_t next;
+    size_t end;
+    char padding[COLUMNAR_CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+} ColumnarWorkRange;
+
+/* Scan units shared by parallel workers, split into one range per node */
+typedef struct ColumnarWorkQueue {
+    ColumnarWorkRange *ranges;
+    size_t num_ranges;
+    bool stop;                      /* set when a worker fails */
+} ColumnarWorkQueue;
+
+/* Consumer of the batches of one parallel scan worker */
+typedef int (*ColumnarBatchFn)(void *state, const ColumnarBatch *batch);
+
+/*
+ * Batch iterator over the row groups of a table followed by a snapshot of
+ * its delta store. The table lock is held in read mode until the scan ends,
+ * so the scanning thread must not modify the table meanwhile. Worker scans
+ * forked for a parallel scan claim row groups from a shared work queue and
+ * borrow the predicates, join filters, snapshot and lock of their parent.
+ */
+typedef struct ColumnarScan {
+    ColumnarTable *table;
+    struct ColumnarScan *parent;    /* set for parallel workers */
+    ColumnarWorkQueue *queue;
+    size_t queue_home;              /* preferred range of queue */
+    bool *load_columns;
+    ColumnarCondition *condition;   /* NULL without a condition */
+    ColumnarPredicate *predicates;  /* those of condition */
+    size_t num_predicates;
+    ColumnarJoinProbe join_probes[COLUMNAR_MAX_JOIN_FILTERS];
+    size_t num_join_probes;
+    size_t row_group_index;
+    size_t row_offset;
+    ColumnarRowGroup *delta_group;  /* live delta rows, scanned last */
+    bool dirty_only;                /* skip row groups without deleted rows */
+    ColumnarBatch batch;
+    uint16_t *selection;
+    ColumnarChunkBuffer *buffers;   /* one per column */
+    const void **chunk_values;      /* loaded chunks of the current row group */
+    const uint8_t **chunk_nulls;
+    ColumnarCacheEntry **chunk_entries;  /* scan cache entries pinned for them */
+    bool *condition_only;           /* columns loaded only to evaluate the condition */
+    ColumnarCacheEntry *filter_entry;    /* cached condition result of the current row group */
+    uint64_t *filter_bits;          /* condition result being recorded for the cache */
+    size_t filter_bits_capacity;    /* words */
+    bool record_filter;
+    int status;                     /* error that ended the scan early */
+    size_t row_groups_scanned;
+    size_t row_groups_skipped;
+} ColumnarScan;
+
+/* Aggregate functions supported by the vectorized aggregation operator */
+typedef enum ColumnarAggFunc {
+    COLUMNAR_AGG_COUNT_STAR = 0,
+    COLUMNAR_AGG_COUNT,
+    COLUMNAR_AGG_SUM,
+    COLUMNAR_AGG_MIN,
+    COLUMNAR_AGG_MAX,
+    COLUMNAR_AGG_AVG
+} ColumnarAggFunc;
+
+typedef struct ColumnarAggSpec {
+    ColumnarAggFunc func;
+    const char *column;    /* ignored for COUNT(*) */
+} ColumnarAggSpec;
+
+typedef struct ColumnarAggValue {
+    bool is_null;
+    ColumnarType type;
+    ColumnarDatum value;   /* TEXT values are owned copies */
+} ColumnarAggValue;
+
+/* Aggregation output, values holds num_groups rows of num_aggregates values */
+typedef struct ColumnarAggResult {
+    bool grouped;
+    ColumnarType group_type;
+    size_t num_groups;
+    size_t num_aggregates;
+    ColumnarDatum *group_keys;
+    bool *group_key_nulls;
+    ColumnarAggValue *values;
+    bool from_metadata;    /* answered from zone maps without reading values */
+} ColumnarAggResult;
+
+/* One row returned by columnar_query_rows, in the columnar_encode_row format */
+typedef struct ColumnarRowData {
+    const void *data;
+    size_t size;
+} ColumnarRowData;
+
+/* Hashing shared by the hash aggregation and other key-based structures */
+static inline uint64_t columnar_hash_int64(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+static inline uint64_t columnar_hash_double(double key) {
+    uint64_t bits;
+    if (key == 0.0) {
+        key = 0.0;  /* -0.0 and 0.0 hash alike */
+    }
+    memcpy(&bits, &key, sizeof(bits));
+    return columnar_hash_int64(bits);
+}
+
+static inline uint64_t columnar_hash_bytes(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return columnar_hash_int64(hash);
+}
+
+/* Storage engine entry points (columnar_storage.c) */
+int columnar_storage_init(EpiphanyDBContext *ctx);
+int columnar_storage_cleanup(EpiphanyDBContext *ctx);
+int columnar_create_table(EpiphanyDBContext *ctx, const char *table_name, const char *schema);
+int columnar_open_table(EpiphanyDBContext *ctx, const char *table_name, EpiphanyDBTable **table);
+int columnar_close_table(EpiphanyDBTable *table);
+int columnar_insert_row(EpiphanyDBTable *table, const void *data, size_t data_size);
+/* key points to a ColumnarDatum holding the value of the first column */
+int columnar_update_row(EpiphanyDBTable *table, const void *key, const void *data, size_t data_size);
+int columnar_delete_row(EpiphanyDBTable *table, const void *key);
+/* results receives an array of ColumnarRowData, decoded with columnar_decode_row */
+int columnar_query_rows(EpiphanyDBTable *table, const char *condition, void **results, size_t *num_results);
+int columnar_query_columns(EpiphanyDBTable *table, const char *const *columns, size_t num_columns, const char *condition, void **results, size_t *num_results);
+int columnar_compress_column(const void *data, size_t data_size, void **compressed_data, size_t *compressed_size);
+int columnar_decompress_column(const void *compressed_data, size_t compressed_size, void **data, size_t *data_size);
+int columnar_vectorized_scan(EpiphanyDBTable *table, const char *column_name, const char *condition, void **results, size_t *num_results);
+int columnar_vectorized_join_scan(EpiphanyDBTable *table, const char *column_name, const char *condition,
+                                  const char *const *join_columns, const ColumnarJoinFilter *const *join_filters, size_t num_join_filters,
+                                  void **results, size_t *num_results);
+
+/* Table access (columnar_storage.c) */
+ColumnarTable *columnar_get_table(EpiphanyDBTable *table);
+int columnar_find_column(const ColumnarTable *table, const char *column_name);
+int columnar_encode_row(EpiphanyDBTable *table, const ColumnarDatum *values, const bool *nulls, void **data, size_t *data_size);
+int columnar_check_row(const ColumnarTable *table, const void *data, size_t data_size);
+int columnar_decode_row(const ColumnarTable *table, const void *data, size_t data_size, ColumnarDatum *values, bool *nulls, char **text_buffer);
+int columnar_compare_datum(ColumnarType type, ColumnarDatum a, ColumnarDatum b);
+ColumnarRowGroup *columnar_row_group_create(const ColumnarTable *table);
+int columnar_row_group_append(const ColumnarTable *table, ColumnarRowGroup *row_group, const ColumnarDatum *values, const bool *nulls);
+void columnar_row_group_free(const ColumnarTable *table, ColumnarRowGroup *row_group);
+int columnar_publish_row_group(ColumnarTable *table, ColumnarRowGroup *row_group);
+
+/* Delta store and background merge (columnar_delta.c) */
+int columnar_delta_init(ColumnarDeltaStore *delta);
+void columnar_delta_destroy(ColumnarDeltaStore *delta);
+int columnar_delta_insert(ColumnarTable *table, const void *data, size_t data_size, bool *merge_needed);
+int columnar_delta_delete_key(ColumnarTable *table, ColumnarDatum key, size_t *num_deleted);
+int columnar_delta_snapshot(ColumnarTable *table, ColumnarRowGroup **row_group);
+int columnar_delta_merge(ColumnarTable *table, bool flush_active);
+int columnar_compact_row_groups(ColumnarTable *table);
+int columnar_merger_start(ColumnarStorageContext *ctx);
+void columnar_merger_stop(ColumnarStorageContext *ctx);
+void columnar_merger_request(ColumnarStorageContext *ctx);
+int columnar_flush_delta(EpiphanyDBTable *table);
+int columnar_compact_table(EpiphanyDBTable *table);
+
+/* Statistics (columnar_stats.c) */
+int columnar_stats_build(ColumnarType type, const ColumnarChunk *chunk, size_t num_rows, ColumnarChunkStats *stats);
+void columnar_stats_free(ColumnarType type, ColumnarChunkStats *stats);
+size_t columnar_stats_serialize(ColumnarType type, const ColumnarChunk *chunk, uint8_t *out);
+int columnar_analyze(ColumnarTable *table);
+void columnar_column_stats_free(const ColumnarTable *table, ColumnarColumnStats *stats);
+double columnar_estimate_selectivity(ColumnarTable *table, const ColumnarPredicate *predicate);
+int columnar_analyze_table(EpiphanyDBTable *table);
+int columnar_table_stats(EpiphanyDBTable *table, uint64_t *num_rows, uint64_t *table_size);
+
+/* Clustering (columnar_cluster.c) */
+int columnar_cluster_rows(const ColumnarTable *table, ColumnarRowGroup *const *sources, size_t num_sources, ColumnarRowGroup **targets, size_t *num_targets, ColumnarRowOrigin *origins);
+int columnar_cluster_row_groups(ColumnarTable *table, size_t min_groups);
+
+/* Delete bitmaps (columnar_bitmap.c) */
+int columnar_bitmap_add(ColumnarBitmap *bitmap, uint32_t value, bool *added);
+bool columnar_bitmap_contains(const ColumnarBitmap *bitmap, uint32_t value);
+size_t columnar_bitmap_filter(const ColumnarBitmap *bitmap, uint32_t first_row, uint16_t *selection, size_t num_selected);
+size_t columnar_bitmap_memory_usage(const ColumnarBitmap *bitmap);
+void columnar_bitmap_free(ColumnarBitmap *bitmap);
+
+/* Block compression (columnar_compress.c) */
+int columnar_block_compress(const void *data, size_t data_size, int level, void **block, size_t *block_size, ColumnarCodec *codec);
+int columnar_block_raw_size(const void *block, size_t block_size, size_t *raw_size);
+int columnar_block_decompress(const void *block, size_t block_size, void *data, size_t data_size, void **codec_context);
+void columnar_codec_context_free(void *codec_context);
+
+/* Bloom filters (columnar_bloom.c) */
+uint64_t columnar_bloom_hash(ColumnarType type, ColumnarDatum value);
+int columnar_bloom_init(ColumnarBloomFilter *filter, size_t num_keys, size_t bits_per_key);
+void columnar_bloom_add(ColumnarBloomFilter *filter, uint64_t hash);
+int columnar_bloom_build(ColumnarType type, const ColumnarChunk *chunk, size_t num_rows, size_t bits_per_key, ColumnarBloomFilter *filter);
+bool columnar_bloom_may_contain(const ColumnarBloomFilter *filter, uint64_t hash);
+size_t columnar_bloom_size(const ColumnarBloomFilter *filter);
+void columnar_bloom_free(ColumnarBloomFilter *filter);
+
+/* Runtime join filters (columnar_join.c) */
+int columnar_join_filter_build(ColumnarType type, const ColumnarDatum *keys, const bool *nulls, size_t num_keys, ColumnarJoinFilter *filter);
+int columnar_join_filter_from_table(EpiphanyDBTable *table, const char *column_name, const char *condition, ColumnarJoinFilter *filter);
+void columnar_join_filter_free(ColumnarJoinFilter *filter);
+bool columnar_join_filter_may_match(const ColumnarJoinFilter *filter, const ColumnarChunk *chunk);
+size_t columnar_join_filter_apply(const ColumnarJoinFilter *filter, const void *values, const uint8_t *nulls, const uint16_t *in, size_t n, uint16_t *out);
+
+/* Column files (columnar_file.c) */
+int columnar_files_create(ColumnarTable *table, const char *data_directory);
+void columnar_files_close(ColumnarTable *table);
+int columnar_row_group_persist(ColumnarTable *table, ColumnarRowGroup *row_group);
+int columnar_files_write_footer(ColumnarTable *table);
+int columnar_chunk_load(const ColumnarTable *table, const ColumnarRowGroup *row_group, size_t column, ColumnarChunkBuffer *buffer, const void **values, const uint8_t **nulls);
+bool columnar_chunk_buffered(const ColumnarChunkBuffer *buffer, const ColumnarChunk *chunk);
+int columnar_chunk_prefetch(const ColumnarTable *table, ColumnarRowGroup *const *row_groups, size_t count, size_t column, ColumnarChunkBuffer *buffer);
+int columnar_chunk_load_cached(const ColumnarTable *table, const ColumnarRowGroup *row_group, size_t column, ColumnarChunkBuffer *buffer, ColumnarCacheEntry **entry, const void **values, const uint8_t **nulls);
+void columnar_chunk_buffer_free(ColumnarChunkBuffer *buffer);
+
+/* Scan cache (columnar_cache.c) */
+uint64_t columnar_cache_table_id(void);
+ColumnarCache *columnar_cache_create(size_t budget);
+void columnar_cache_destroy(ColumnarCache *cache);
+void columnar_cache_forget_table(ColumnarCache *cache, uint64_t table_id);
+ColumnarCacheEntry *columnar_cache_entry_alloc(const ColumnarCacheKey *key, size_t data_size);
+ColumnarCacheEntry *columnar_cache_lookup(ColumnarCache *cache, const ColumnarCacheKey *key);
+bool columnar_cache_contains(ColumnarCache *cache, const ColumnarCacheKey *key);
+void columnar_cache_insert(ColumnarCache *cache, ColumnarCacheEntry *entry);
+void columnar_cache_release(ColumnarCache *cache, ColumnarCacheEntry *entry);
+
+/* Batch scans (columnar_scan.c) */
+int columnar_parse_condition(const ColumnarTable *table, const char *condition, ColumnarPredicate **predicates, size_t *num_predicates);
+void columnar_free_predicates(const ColumnarTable *table, ColumnarPredicate *predicates, size_t num_predicates);
+int columnar_condition_acquire(ColumnarTable *table, const char *condition, ColumnarCondition **compiled);
+void columnar_condition_release(ColumnarTable *table, ColumnarCondition *compiled);
+void columnar_condition_cache_clear(ColumnarTable *table);
+bool columnar_predicates_may_match(const ColumnarTable *table, const ColumnarRowGroup *row_group, const ColumnarPredicate *predicates, size_t num_predicates);
+int columnar_scan_begin(ColumnarTable *table, const char *const *columns, size_t num_columns, const char *condition, ColumnarScan **scan);
+bool columnar_scan_next(ColumnarScan *scan, ColumnarBatch **batch);
+void columnar_scan_end(ColumnarScan *scan);
+int columnar_scan_add_join_filter(ColumnarScan *scan, const char *column_name, const ColumnarJoinFilter *filter);
+int columnar_scan_fork(ColumnarScan *parent, ColumnarWorkQueue *queue, size_t home, ColumnarScan **worker);
+
+/* Parallel scans (columnar_parallel.c) */
+size_t columnar_scan_workers(const ColumnarScan *scan);
+size_t columnar_work_queue_claim(ColumnarWorkQueue *queue, size_t home);
+int columnar_parallel_scan(ColumnarScan *scan, size_t num_workers, ColumnarBatchFn consume, void **states);
+
+/* Vectorized aggregation (columnar_aggregate.c) */
+int columnar_aggregate(EpiphanyDBTable *table, const char *group_by, const ColumnarAggSpec *aggregates, size_t num_aggregates, const char *condition, ColumnarAggResult **result);
+void columnar_free_agg_result(ColumnarAggResult *result);
+
+#endif /* EPIPHANYDB_COLUMNAR_STORAGE_H */
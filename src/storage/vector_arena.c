@@ -0,0 +1,279 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * Vector arena files. A table keeps its vectors in one file laid out as a
+ * header page, capacity vectors of stride floats, capacity norms and one
+ * live bit per vector, every region starting on a cache line. The file is
+ * mapped shared and the table points into the mapping, so opening a table
+ * costs one mmap whatever its size, scans and re-ranks read the page cache
+ * in place, and processes mapping the same table share its pages. Growing
+ * the file remaps it and moves the norms and live bits, which are small
+ * next to the vectors, past the new vector region.
+ *
+ * Metadata goes to a second file, a log of (id, length, text) records
+ * appended as vectors are inserted and replayed when the table is opened;
+ * the live bits tell which records still belong to a vector.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+/* Metadata log record, followed by length bytes of text */
+typedef struct VectorMetadataRecord {
+    uint64_t id;
+    uint64_t length;
+} VectorMetadataRecord;
+
+/* Bytes rounded up to whole cache lines */
+static size_t vector_arena_align(size_t bytes) {
+    return (bytes + VECTOR_ALIGNMENT - 1) / VECTOR_ALIGNMENT * VECTOR_ALIGNMENT;
+}
+
+static size_t vector_arena_norms_offset(size_t stride, size_t capacity) {
+    return VECTOR_ARENA_HEADER + capacity * stride * sizeof(float);
+}
+
+static size_t vector_arena_live_offset(size_t stride, size_t capacity) {
+    return vector_arena_norms_offset(stride, capacity) + vector_arena_align(capacity * sizeof(float));
+}
+
+static size_t vector_arena_file_size(size_t stride, size_t capacity) {
+    return vector_arena_live_offset(stride, capacity) + vector_arena_align((capacity + 63) / 64 * sizeof(uint64_t));
+}
+
+/* Map size bytes of fd and point table at the regions of a capacity vector file */
+static int vector_arena_map(VectorTable *table, int fd, size_t capacity, size_t size) {
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return EPIPHANYDB_ERROR_IO;
+    }
+
+    uint8_t *base = mapping;
+    table->arena = mapping;
+    table->arena_size = size;
+    table->arena_fd = fd;
+    table->vectors = (float *)(base + VECTOR_ARENA_HEADER);
+    table->norms = (float *)(base + vector_arena_norms_offset(table->stride, capacity));
+    table->live = (uint64_t *)(base + vector_arena_live_offset(table->stride, capacity));
+    table->capacity = capacity;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Create or truncate the file of table with room for capacity vectors and map it */
+int vector_arena_create(VectorTable *table, size_t capacity) {
+    if (strlen(table->schema) >= sizeof(((VectorArenaHeader *)0)->schema)) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int fd = open(table->vector_file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return EPIPHANYDB_ERROR_IO;
+    }
+    size_t size = vector_arena_file_size(table->stride, capacity);
+    int result = ftruncate(fd, (off_t)size) == 0 ? vector_arena_map(table, fd, capacity, size) : EPIPHANYDB_ERROR_IO;
+    if (result != EPIPHANYDB_SUCCESS) {
+        close(fd);
+        return result;
+    }
+    table->metadata_fd = open(table->metadata_file, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (table->metadata_fd < 0) {
+        vector_arena_close(table);
+        return EPIPHANYDB_ERROR_IO;
+    }
+
+    VectorArenaHeader *header = table->arena;
+    header->magic = VECTOR_ARENA_MAGIC;
+    header->version = VECTOR_ARENA_VERSION;
+    header->dimension = table->vector_dimension;
+    header->stride = table->stride;
+    header->capacity = capacity;
+    header->num_vectors = 0;
+    strcpy(header->schema, table->schema);
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Schema stored in the arena file at path, NOT_FOUND when there is none */
+int vector_arena_read_schema(const char *path, char **schema) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+
+    VectorArenaHeader *header = malloc(sizeof(VectorArenaHeader));
+    int result = header ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    if (result == EPIPHANYDB_SUCCESS &&
+        (pread(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header) || header->magic != VECTOR_ARENA_MAGIC ||
+         header->version != VECTOR_ARENA_VERSION || !memchr(header->schema, '\0', sizeof(header->schema)))) {
+        result = EPIPHANYDB_ERROR_STORAGE;
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        *schema = strdup(header->schema);
+        result = *schema ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    }
+    free(header);
+    close(fd);
+    return result;
+}
+
+/*
+ * Map the existing file of table, whose schema it was created from. The
+ * vectors are not read; num_deleted is counted from the live bits.
+ */
+int vector_arena_open(VectorTable *table) {
+    int fd = open(table->vector_file, O_RDWR);
+    if (fd < 0) {
+        return EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+
+    VectorArenaHeader header;
+    struct stat st;
+    int result = EPIPHANYDB_SUCCESS;
+    if (pread(fd, &header, offsetof(VectorArenaHeader, schema), 0) != (ssize_t)offsetof(VectorArenaHeader, schema) ||
+        fstat(fd, &st) != 0 || header.magic != VECTOR_ARENA_MAGIC || header.version != VECTOR_ARENA_VERSION ||
+        header.dimension != table->vector_dimension || header.stride != table->stride ||
+        header.num_vectors > header.capacity ||
+        (uint64_t)st.st_size < vector_arena_file_size(header.stride, header.capacity)) {
+        result = EPIPHANYDB_ERROR_STORAGE;
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_arena_map(table, fd, header.capacity, vector_arena_file_size(header.stride, header.capacity));
+    }
+    if (result != EPIPHANYDB_SUCCESS) {
+        close(fd);
+        return result;
+    }
+    table->metadata_fd = open(table->metadata_file, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (table->metadata_fd < 0) {
+        vector_arena_close(table);
+        return EPIPHANYDB_ERROR_IO;
+    }
+
+    table->num_vectors = header.num_vectors;
+    size_t live = 0;
+    for (size_t w = 0; w < (table->num_vectors + 63) / 64; w++) {
+        live += (size_t)__builtin_popcountll(table->live[w]);
+    }
+    table->num_deleted = table->num_vectors - live;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Extend the file of table to capacity vectors, write lock held. The file
+ * is mapped anew before the old mapping goes, then the norms and live bits
+ * move up within it, the live bits first as they move further.
+ */
+int vector_arena_grow(VectorTable *table, size_t capacity) {
+    VectorArenaHeader *old_arena = table->arena;
+    size_t old_size = table->arena_size;
+    size_t old_capacity = table->capacity;
+    size_t stride = table->stride;
+    size_t size = vector_arena_file_size(stride, capacity);
+
+    if (capacity <= old_capacity) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (ftruncate(table->arena_fd, (off_t)size) != 0) {
+        return EPIPHANYDB_ERROR_IO;
+    }
+    int result = vector_arena_map(table, table->arena_fd, capacity, size);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+    munmap(old_arena, old_size);
+
+    uint8_t *base = (uint8_t *)table->arena;
+    size_t words = (old_capacity + 63) / 64;
+    size_t grown_words = (capacity + 63) / 64;
+    memmove(table->live, base + vector_arena_live_offset(stride, old_capacity), words * sizeof(uint64_t));
+    memset(table->live + words, 0, (grown_words - words) * sizeof(uint64_t));
+    memmove(table->norms, base + vector_arena_norms_offset(stride, old_capacity), old_capacity * sizeof(float));
+    memset(table->norms + old_capacity, 0, (capacity - old_capacity) * sizeof(float));
+    table->arena->capacity = capacity;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Log the metadata of vector id, write lock held */
+int vector_arena_append_metadata(VectorTable *table, size_t id, const char *metadata) {
+    VectorMetadataRecord record = {id, strlen(metadata)};
+    struct iovec parts[2] = {{&record, sizeof(record)}, {(void *)metadata, record.length}};
+    ssize_t written = writev(table->metadata_fd, parts, 2);
+    return written == (ssize_t)(sizeof(record) + record.length) ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_IO;
+}
+
+/*
+ * Cut the last record, that of metadata, off the log, write lock held.
+ * Should that fail too, the record stays behind for a vector that was
+ * never published.
+ */
+void vector_arena_drop_metadata(VectorTable *table, const char *metadata) {
+    struct stat st;
+    off_t size = (off_t)(sizeof(VectorMetadataRecord) + strlen(metadata));
+    if (fstat(table->metadata_fd, &st) == 0 && st.st_size >= size) {
+        int result = ftruncate(table->metadata_fd, st.st_size - size);
+        (void)result;
+    }
+}
+
+/*
+ * Replay the metadata log of an opened table into its metadata array.
+ * Later records of an id replace earlier ones, records of deleted vectors
+ * are dropped, and a record cut short by a crash ends the log.
+ */
+int vector_arena_load_metadata(VectorTable *table) {
+    struct stat st;
+    if (fstat(table->metadata_fd, &st) != 0) {
+        return EPIPHANYDB_ERROR_IO;
+    }
+
+    uint64_t offset = 0;
+    VectorMetadataRecord record;
+    while (offset + sizeof(record) <= (uint64_t)st.st_size) {
+        if (pread(table->metadata_fd, &record, sizeof(record), (off_t)offset) != (ssize_t)sizeof(record)) {
+            return EPIPHANYDB_ERROR_IO;
+        }
+        offset += sizeof(record);
+        if (record.length > (uint64_t)st.st_size - offset) {
+            break;
+        }
+        if (record.id < table->num_vectors && vector_filter_test(table->live, record.id)) {
+            char *text = malloc(record.length + 1);
+            if (!text) {
+                return EPIPHANYDB_ERROR_MEMORY;
+            }
+            if (pread(table->metadata_fd, text, record.length, (off_t)offset) != (ssize_t)record.length) {
+                free(text);
+                return EPIPHANYDB_ERROR_IO;
+            }
+            text[record.length] = '\0';
+            free(table->metadata[record.id]);
+            table->metadata[record.id] = text;
+        }
+        offset += record.length;
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+void vector_arena_close(VectorTable *table) {
+    if (table->metadata_fd >= 0) {
+        close(table->metadata_fd);
+        table->metadata_fd = -1;
+    }
+    if (!table->arena) {
+        return;
+    }
+    munmap(table->arena, table->arena_size);
+    close(table->arena_fd);
+    table->arena = NULL;
+    table->vectors = NULL;
+    table->norms = NULL;
+    table->live = NULL;
+}
@@ -0,0 +1,241 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * Batched exhaustive search. Distances of many queries to every vector are
+ * computed like a matrix product: the table is walked in blocks that stay
+ * in cache while every query passes over them. Each block is packed
+ * once into panels of sixteen transposed vectors, and a register-tiled
+ * kernel takes the dot products of eight queries with a panel at once, so
+ * that each load feeds eight multiply-adds and no horizontal sums are
+ * needed. Euclidean and cosine distances follow from the dot products and
+ * the stored norms.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define VECTOR_HAVE_X86_KERNELS 1
+#endif
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+/* Queries per register tile and vectors per packed panel */
+#define VECTOR_TILE 8
+#define VECTOR_PANEL 16
+
+/* Bytes of packed vectors per cache block */
+#define VECTOR_BATCH_BLOCK_BYTES (256 * 1024)
+
+/*
+ * out[i * VECTOR_PANEL + j] = q[i] . x[j] over n floats, where the panel
+ * holds the vectors x[0..15] transposed: panel[d * VECTOR_PANEL + j] = x[j][d]
+ */
+typedef void (*VectorDotPanelFn)(const float *const *q, const float *panel, size_t n, float *out);
+
+static void vector_dot_panel_scalar(const float *const *q, const float *panel, size_t n, float *out) {
+    for (size_t i = 0; i < VECTOR_TILE; i++) {
+        float sums[VECTOR_PANEL] = {0};
+        for (size_t d = 0; d < n; d++) {
+            for (size_t j = 0; j < VECTOR_PANEL; j++) {
+                sums[j] += q[i][d] * panel[d * VECTOR_PANEL + j];
+            }
+        }
+        memcpy(out + i * VECTOR_PANEL, sums, sizeof(sums));
+    }
+}
+
+#ifdef VECTOR_HAVE_X86_KERNELS
+
+/* Two passes of four queries by sixteen vectors in eight accumulators */
+__attribute__((target("avx2,fma")))
+static void vector_dot_panel_avx2(const float *const *q, const float *panel, size_t n, float *out) {
+    for (size_t i0 = 0; i0 < VECTOR_TILE; i0 += 4) {
+        __m256 acc[4][2];
+        for (size_t i = 0; i < 4; i++) {
+            acc[i][0] = _mm256_setzero_ps();
+            acc[i][1] = _mm256_setzero_ps();
+        }
+        for (size_t d = 0; d < n; d++) {
+            __m256 x0 = _mm256_load_ps(panel + d * VECTOR_PANEL);
+            __m256 x1 = _mm256_load_ps(panel + d * VECTOR_PANEL + 8);
+            for (size_t i = 0; i < 4; i++) {
+                __m256 qi = _mm256_broadcast_ss(q[i0 + i] + d);
+                acc[i][0] = _mm256_fmadd_ps(qi, x0, acc[i][0]);
+                acc[i][1] = _mm256_fmadd_ps(qi, x1, acc[i][1]);
+            }
+        }
+        for (size_t i = 0; i < 4; i++) {
+            _mm256_storeu_ps(out + (i0 + i) * VECTOR_PANEL, acc[i][0]);
+            _mm256_storeu_ps(out + (i0 + i) * VECTOR_PANEL + 8, acc[i][1]);
+        }
+    }
+}
+
+/* Eight queries by sixteen vectors, one accumulator each */
+__attribute__((target("avx512f")))
+static void vector_dot_panel_avx512(const float *const *q, const float *panel, size_t n, float *out) {
+    __m512 acc[VECTOR_TILE];
+    for (size_t i = 0; i < VECTOR_TILE; i++) {
+        acc[i] = _mm512_setzero_ps();
+    }
+    for (size_t d = 0; d < n; d++) {
+        __m512 x = _mm512_load_ps(panel + d * VECTOR_PANEL);
+        for (size_t i = 0; i < VECTOR_TILE; i++) {
+            acc[i] = _mm512_fmadd_ps(_mm512_set1_ps(q[i][d]), x, acc[i]);
+        }
+    }
+    for (size_t i = 0; i < VECTOR_TILE; i++) {
+        _mm512_storeu_ps(out + i * VECTOR_PANEL, acc[i]);
+    }
+}
+
+#endif /* VECTOR_HAVE_X86_KERNELS */
+
+/* Kernel dispatch */
+
+static VectorDotPanelFn vector_dot_panel_kernel = vector_dot_panel_scalar;
+
+__attribute__((constructor))
+static void vector_init_panel_kernels(void) {
+#ifdef VECTOR_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        vector_dot_panel_kernel = vector_dot_panel_avx512;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        vector_dot_panel_kernel = vector_dot_panel_avx2;
+    }
+#endif
+}
+
+/* Transpose vectors [first, first + count) into a panel, zero past count */
+static void vector_pack_panel(const VectorTable *table, size_t first, size_t count, float *panel) {
+    size_t dim = table->vector_dimension;
+    if (count < VECTOR_PANEL) {
+        memset(panel, 0, dim * VECTOR_PANEL * sizeof(float));
+    }
+    for (size_t j = 0; j < count; j++) {
+        const float *x = vector_at(table, first + j);
+        for (size_t d = 0; d < dim; d++) {
+            panel[d * VECTOR_PANEL + j] = x[d];
+        }
+    }
+}
+
+static int vector_batch_offer(VectorHeap *nearest, size_t k, float distance, uint32_t id) {
+    VectorCandidate candidate = {distance, id};
+    if (nearest->size < k) {
+        return vector_heap_push(nearest, candidate);
+    }
+    if (distance < nearest->items[0].distance) {
+        vector_heap_pop(nearest);
+        return vector_heap_push(nearest, candidate);
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * k nearest vectors of each of num_queries queries, dimension floats each,
+ * by an exhaustive blocked scan of the floats, read lock held. Query q
+ * writes its row results + q * k by increasing exact distance and its
+ * count to num_results[q]. Vectors outside filter, if given, are skipped.
+ */
+int vector_flat_search_batch(const VectorTable *table, const float *queries, size_t num_queries, size_t k, const uint64_t *filter, VectorSearchResult *results, size_t *num_results) {
+    size_t dim = table->vector_dimension;
+    size_t n = table->num_vectors;
+
+    memset(num_results, 0, num_queries * sizeof(size_t));
+    if (num_queries == 0 || k == 0 || n == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    size_t block = VECTOR_BATCH_BLOCK_BYTES / (dim * sizeof(float));
+    block = block < VECTOR_PANEL ? VECTOR_PANEL : block / VECTOR_PANEL * VECTOR_PANEL;
+    bool dots = table->metric != VECTOR_METRIC_MANHATTAN;
+    float *panels = dots ? aligned_alloc(VECTOR_ALIGNMENT, block * dim * sizeof(float)) : NULL;
+    float *norms = malloc(num_queries * sizeof(float));
+    VectorHeap *nearest = calloc(num_queries, sizeof(VectorHeap));
+    int result = (panels || !dots) && norms && nearest ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+
+    for (size_t q = 0; q < num_queries && result == EPIPHANYDB_SUCCESS; q++) {
+        norms[q] = vector_norm(queries + q * dim, dim);
+        nearest[q].max_heap = true;
+    }
+
+    for (size_t first = 0; first < n && result == EPIPHANYDB_SUCCESS; first += block) {
+        size_t last = first + block < n ? first + block : n;
+
+        /* Manhattan distances have no product form, every pair is scanned */
+        if (!dots) {
+            for (size_t q = 0; q < num_queries && result == EPIPHANYDB_SUCCESS; q++) {
+                for (size_t v = first; v < last && result == EPIPHANYDB_SUCCESS; v++) {
+                    if (!vector_filter_test(filter, v)) {
+                        continue;
+                    }
+                    float distance = vector_l1(queries + q * dim, vector_at(table, v), dim);
+                    result = vector_batch_offer(&nearest[q], k, distance, (uint32_t)v);
+                }
+            }
+            continue;
+        }
+
+        /* Packed once per block, then read by every query tile */
+        for (size_t v = first; v < last; v += VECTOR_PANEL) {
+            size_t count = last - v < VECTOR_PANEL ? last - v : VECTOR_PANEL;
+            vector_pack_panel(table, v, count, panels + (v - first) * dim);
+        }
+
+        for (size_t q = 0; q < num_queries && result == EPIPHANYDB_SUCCESS; q += VECTOR_TILE) {
+            size_t tile_size = num_queries - q < VECTOR_TILE ? num_queries - q : VECTOR_TILE;
+            const float *tile_queries[VECTOR_TILE];
+            for (size_t i = 0; i < VECTOR_TILE; i++) {
+                tile_queries[i] = queries + (q + (i < tile_size ? i : tile_size - 1)) * dim;
+            }
+
+            for (size_t v = first; v < last && result == EPIPHANYDB_SUCCESS; v += VECTOR_PANEL) {
+                size_t count = last - v < VECTOR_PANEL ? last - v : VECTOR_PANEL;
+                float tile[VECTOR_TILE * VECTOR_PANEL];
+                vector_dot_panel_kernel(tile_queries, panels + (v - first) * dim, dim, tile);
+
+                for (size_t i = 0; i < tile_size && result == EPIPHANYDB_SUCCESS; i++) {
+                    float query_norm = norms[q + i];
+                    for (size_t j = 0; j < count && result == EPIPHANYDB_SUCCESS; j++) {
+                        if (!vector_filter_test(filter, v + j)) {
+                            continue;
+                        }
+                        float dot = tile[i * VECTOR_PANEL + j];
+                        float norm = table->norms[v + j];
+                        float distance;
+                        if (table->metric == VECTOR_METRIC_EUCLIDEAN) {
+                            distance = query_norm * query_norm + norm * norm - 2.0f * dot;
+                        } else {
+                            distance = query_norm == 0.0f || norm == 0.0f ? 1.0f : 1.0f - dot / (query_norm * norm);
+                        }
+                        result = vector_batch_offer(&nearest[q + i], k, distance, (uint32_t)(v + j));
+                    }
+                }
+            }
+        }
+    }
+
+    /* Rows get exact distances, the expanded products lose precision near zero */
+    for (size_t q = 0; q < num_queries && result == EPIPHANYDB_SUCCESS; q++) {
+        VectorSearchResult *row = results + q * k;
+        num_results[q] = nearest[q].size;
+        for (size_t i = 0; i < nearest[q].size; i++) {
+            uint32_t id = nearest[q].items[i].id;
+            row[i].id = id;
+            row[i].distance = vector_distance(table->metric, vector_at(table, id), table->norms[id], queries + q * dim,
+                                              norms[q], dim);
+        }
+        vector_sort_results(row, num_results[q]);
+    }
+
+    for (size_t q = 0; nearest && q < num_queries; q++) {
+        vector_heap_free(&nearest[q]);
+    }
+    free(nearest);
+    free(norms);
+    free(panels);
+    return result;
+}
@@ -0,0 +1,643 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * DiskANN index. A Vamana graph of fixed degree is built in memory in two
+ * passes, the second pruning with slack alpha so that long edges survive,
+ * and written with the full vectors to 4 KB sectors of the index file.
+ * Searches keep a candidate list ordered by PQ distances computed from
+ * codes held in memory and expand the beamwidth best candidates at a time,
+ * reading their sectors in one batch of asynchronous reads; the full
+ * vectors read along the way give the exact distances of the results.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <aio.h>
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+/* Candidate list of a beam search, ordered by distance */
+typedef struct VectorBeamEntry {
+    float distance;
+    uint32_t id;
+    bool expanded;
+} VectorBeamEntry;
+
+typedef struct VectorBeam {
+    VectorBeamEntry *entries;
+    size_t size;
+    size_t capacity;                /* the list size L */
+} VectorBeam;
+
+/* Insert id unless the list is full of closer candidates */
+static void vector_beam_insert(VectorBeam *beam, float distance, uint32_t id) {
+    if (beam->size == beam->capacity && distance >= beam->entries[beam->size - 1].distance) {
+        return;
+    }
+
+    size_t i = beam->size < beam->capacity ? beam->size++ : beam->size - 1;
+    while (i > 0 && beam->entries[i - 1].distance > distance) {
+        beam->entries[i] = beam->entries[i - 1];
+        i--;
+    }
+    beam->entries[i].distance = distance;
+    beam->entries[i].id = id;
+    beam->entries[i].expanded = false;
+}
+
+/* Closest candidate not yet expanded, or NULL */
+static VectorBeamEntry *vector_beam_next(VectorBeam *beam) {
+    for (size_t i = 0; i < beam->size; i++) {
+        if (!beam->entries[i].expanded) {
+            return &beam->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static inline float vector_diskann_distance(const VectorTable *table, uint32_t a, uint32_t b) {
+    return vector_distance(table->metric, vector_at(table, a), table->norms[a], vector_at(table, b), table->norms[b],
+                           table->vector_dimension);
+}
+
+/* Graph construction */
+
+/* In-memory graph of the build: per node a count, then degree neighbor ids */
+typedef struct VectorVamana {
+    const VectorTable *table;
+    size_t num_nodes;
+    size_t degree;
+    uint32_t *links;
+    uint32_t *marks;                /* visited epochs of the build searches */
+    uint32_t epoch;
+    uint32_t medoid;
+} VectorVamana;
+
+static inline uint32_t *vector_vamana_links(const VectorVamana *graph, uint32_t id) {
+    return graph->links + (size_t)id * (1 + graph->degree);
+}
+
+/* Greedy search for node p from the medoid; expanded receives every expanded node */
+static void vector_vamana_search(VectorVamana *graph, VectorBeam *beam, uint32_t p, VectorHeap *expanded) {
+    graph->epoch++;
+    beam->size = 0;
+    expanded->size = 0;
+
+    vector_beam_insert(beam, vector_diskann_distance(graph->table, graph->medoid, p), graph->medoid);
+    graph->marks[graph->medoid] = graph->epoch;
+
+    VectorBeamEntry *next;
+    while ((next = vector_beam_next(beam)) != NULL) {
+        next->expanded = true;
+        VectorCandidate candidate = {next->distance, next->id};
+        if (vector_heap_push(expanded, candidate) != EPIPHANYDB_SUCCESS) {
+            return;
+        }
+
+        const uint32_t *links = vector_vamana_links(graph, candidate.id);
+        for (uint32_t i = 1; i <= links[0]; i++) {
+            uint32_t neighbor = links[i];
+            if (graph->marks[neighbor] == graph->epoch) {
+                continue;
+            }
+            graph->marks[neighbor] = graph->epoch;
+            vector_beam_insert(beam, vector_diskann_distance(graph->table, neighbor, p), neighbor);
+        }
+    }
+}
+
+static int vector_compare_candidate(const void *a, const void *b) {
+    const VectorCandidate *x = a;
+    const VectorCandidate *y = b;
+    if (x->distance != y->distance) {
+        return (x->distance > y->distance) - (x->distance < y->distance);
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/*
+ * Robust prune: pick neighbors of p among candidates, closest first,
+ * dropping each candidate c that a picked neighbor s covers, meaning
+ * alpha * d(s, c) <= d(p, c). Candidates are sorted in place.
+ */
+static void vector_vamana_prune(VectorVamana *graph, uint32_t p, VectorCandidate *candidates, size_t count, float alpha) {
+    uint32_t *links = vector_vamana_links(graph, p);
+    uint32_t num_links = 0;
+
+    qsort(candidates, count, sizeof(VectorCandidate), vector_compare_candidate);
+    for (size_t i = 0; i < count && num_links < graph->degree; i++) {
+        uint32_t c = candidates[i].id;
+        if (c == p || (i > 0 && candidates[i - 1].id == c)) {
+            continue;
+        }
+
+        bool covered = false;
+        for (uint32_t j = 1; j <= num_links && !covered; j++) {
+            covered = alpha * vector_diskann_distance(graph->table, links[j], c) <= candidates[i].distance;
+        }
+        if (!covered) {
+            links[++num_links] = c;
+        }
+    }
+    links[0] = num_links;
+}
+
+/* Link p into the neighbors of j, pruning them when full */
+static int vector_vamana_back_link(VectorVamana *graph, uint32_t j, uint32_t p, float alpha, VectorCandidate *scratch) {
+    uint32_t *links = vector_vamana_links(graph, j);
+    for (uint32_t i = 1; i <= links[0]; i++) {
+        if (links[i] == p) {
+            return EPIPHANYDB_SUCCESS;
+        }
+    }
+    if (links[0] < graph->degree) {
+        links[++links[0]] = p;
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t count = 0;
+    for (uint32_t i = 1; i <= links[0]; i++) {
+        scratch[count].id = links[i];
+        scratch[count++].distance = vector_diskann_distance(graph->table, j, links[i]);
+    }
+    scratch[count].id = p;
+    scratch[count++].distance = vector_diskann_distance(graph->table, j, p);
+    vector_vamana_prune(graph, j, scratch, count, alpha);
+    return EPIPHANYDB_SUCCESS;
+}
+
+static uint32_t vector_vamana_random(uint64_t *rng) {
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 7;
+    *rng ^= *rng << 17;
+    return (uint32_t)(*rng >> 32);
+}
+
+/* Live node nearest the mean of the live vectors */
+static uint32_t vector_vamana_medoid(const VectorTable *table) {
+    size_t dim = table->vector_dimension;
+    size_t live = table->num_vectors - table->num_deleted;
+    const uint64_t *filter = vector_live_filter(table);
+    double *sums = calloc(dim, sizeof(double));
+    float *mean = malloc(dim * sizeof(float));
+    uint32_t medoid = 0;
+
+    if (sums && mean && live > 0) {
+        for (size_t id = 0; id < table->num_vectors; id++) {
+            if (!vector_filter_test(filter, id)) {
+                continue;
+            }
+            const float *vector = vector_at(table, id);
+            for (size_t d = 0; d < dim; d++) {
+                sums[d] += vector[d];
+            }
+        }
+        for (size_t d = 0; d < dim; d++) {
+            mean[d] = (float)(sums[d] / (double)live);
+        }
+
+        float nearest = INFINITY;
+        float mean_norm = vector_norm(mean, dim);
+        for (size_t id = 0; id < table->num_vectors; id++) {
+            if (!vector_filter_test(filter, id)) {
+                continue;
+            }
+            float distance = vector_distance(table->metric, vector_at(table, id), table->norms[id], mean, mean_norm, dim);
+            if (distance < nearest) {
+                nearest = distance;
+                medoid = (uint32_t)id;
+            }
+        }
+    }
+    free(sums);
+    free(mean);
+    return medoid;
+}
+
+/* Two Vamana passes over a random regular graph, alpha 1 then VECTOR_DISKANN_ALPHA */
+static int vector_vamana_build(VectorVamana *graph, size_t build_l) {
+    size_t n = graph->num_nodes;
+    uint64_t rng = 0x9e3779b97f4a7c15ULL ^ n;
+    uint32_t *order = malloc(n * sizeof(uint32_t));
+    size_t candidates_capacity = build_l + graph->degree + 1;
+    VectorCandidate *candidates = malloc(candidates_capacity * sizeof(VectorCandidate));
+    VectorBeam beam = {malloc(build_l * sizeof(VectorBeamEntry)), 0, build_l};
+    VectorHeap expanded = {NULL, 0, 0, false};
+    int result = order && candidates && beam.entries ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+
+    for (size_t p = 0; p < n && result == EPIPHANYDB_SUCCESS; p++) {
+        uint32_t *links = vector_vamana_links(graph, (uint32_t)p);
+        size_t wanted = graph->degree < n - 1 ? graph->degree : n - 1;
+        links[0] = 0;
+        while (links[0] < wanted) {
+            uint32_t neighbor = vector_vamana_random(&rng) % (uint32_t)n;
+            bool present = neighbor == p;
+            for (uint32_t i = 1; i <= links[0] && !present; i++) {
+                present = links[i] == neighbor;
+            }
+            if (!present) {
+                links[++links[0]] = neighbor;
+            }
+        }
+        order[p] = (uint32_t)p;
+    }
+    graph->medoid = vector_vamana_medoid(graph->table);
+
+    for (int pass = 0; pass < 2 && result == EPIPHANYDB_SUCCESS; pass++) {
+        float alpha = pass == 0 ? 1.0f : VECTOR_DISKANN_ALPHA;
+        for (size_t i = n; i > 1; i--) {
+            size_t j = vector_vamana_random(&rng) % i;
+            uint32_t swap = order[i - 1];
+            order[i - 1] = order[j];
+            order[j] = swap;
+        }
+
+        for (size_t i = 0; i < n && result == EPIPHANYDB_SUCCESS; i++) {
+            uint32_t p = order[i];
+            vector_vamana_search(graph, &beam, p, &expanded);
+
+            /* Candidates: the nodes the search expanded and the current neighbors */
+            if (expanded.size + graph->degree + 1 > candidates_capacity) {
+                size_t capacity = expanded.size + graph->degree + 1;
+                VectorCandidate *grown = realloc(candidates, capacity * sizeof(VectorCandidate));
+                if (!grown) {
+                    result = EPIPHANYDB_ERROR_MEMORY;
+                    break;
+                }
+                candidates = grown;
+                candidates_capacity = capacity;
+            }
+            size_t count = expanded.size;
+            memcpy(candidates, expanded.items, count * sizeof(VectorCandidate));
+            const uint32_t *links = vector_vamana_links(graph, p);
+            for (uint32_t l = 1; l <= links[0]; l++) {
+                candidates[count].id = links[l];
+                candidates[count++].distance = vector_diskann_distance(graph->table, p, links[l]);
+            }
+            vector_vamana_prune(graph, p, candidates, count, alpha);
+
+            links = vector_vamana_links(graph, p);
+            for (uint32_t l = 1; l <= links[0] && result == EPIPHANYDB_SUCCESS; l++) {
+                result = vector_vamana_back_link(graph, links[l], p, alpha, candidates);
+            }
+        }
+    }
+
+    vector_heap_free(&expanded);
+    free(beam.entries);
+    free(candidates);
+    free(order);
+    return result;
+}
+
+/* Index files */
+
+static int vector_diskann_write(const VectorDiskANN *diskann, const VectorVamana *graph, const VectorTable *table, int fd) {
+    size_t span = diskann->nodes_per_sector ? 1 : diskann->sectors_per_node;
+    uint8_t *sector = aligned_alloc(VECTOR_DISKANN_SECTOR, span * VECTOR_DISKANN_SECTOR);
+    if (!sector) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    /* Header sector */
+    uint64_t header[8] = {
+        VECTOR_DISKANN_MAGIC, VECTOR_DISKANN_VERSION, diskann->dimension, diskann->num_nodes,
+        diskann->degree, diskann->node_size, diskann->medoid, (uint64_t)table->metric
+    };
+    memset(sector, 0, VECTOR_DISKANN_SECTOR);
+    memcpy(sector, header, sizeof(header));
+    int result = pwrite(fd, sector, VECTOR_DISKANN_SECTOR, 0) == VECTOR_DISKANN_SECTOR ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_IO;
+
+    size_t per_write = diskann->nodes_per_sector ? diskann->nodes_per_sector : 1;
+    size_t vector_bytes = diskann->dimension * sizeof(float);
+    off_t offset = VECTOR_DISKANN_SECTOR;
+    for (size_t first = 0; first < diskann->num_nodes && result == EPIPHANYDB_SUCCESS; first += per_write) {
+        memset(sector, 0, span * VECTOR_DISKANN_SECTOR);
+        for (size_t id = first; id < first + per_write && id < diskann->num_nodes; id++) {
+            uint8_t *record = sector + (id - first) * diskann->node_size;
+            const uint32_t *links = vector_vamana_links(graph, (uint32_t)id);
+            memcpy(record, vector_at(table, id), vector_bytes);
+            memcpy(record + vector_bytes, links, (1 + links[0]) * sizeof(uint32_t));
+        }
+        if (pwrite(fd, sector, span * VECTOR_DISKANN_SECTOR, offset) != (ssize_t)(span * VECTOR_DISKANN_SECTOR)) {
+            result = EPIPHANYDB_ERROR_IO;
+        }
+        offset += (off_t)(span * VECTOR_DISKANN_SECTOR);
+    }
+
+    free(sector);
+    return result;
+}
+
+/* Read descriptor of path, bypassing the page cache where the file system allows */
+static int vector_diskann_open_direct(const char *path) {
+#ifdef O_DIRECT
+    int fd = open(path, O_RDONLY | O_DIRECT);
+    if (fd >= 0) {
+        return fd;
+    }
+#endif
+    return open(path, O_RDONLY);
+}
+
+void vector_diskann_free(VectorDiskANN *diskann) {
+    if (!diskann) {
+        return;
+    }
+    if (diskann->fd >= 0) {
+        close(diskann->fd);
+    }
+    vector_ivfpq_free(diskann->pq);
+    free(diskann);
+}
+
+/*
+ * Build the graph of the vectors of table with the given degree and build
+ * list size, write it to path and keep pq_m subspace PQ codes in memory.
+ */
+int vector_diskann_build(const VectorTable *table, size_t degree, size_t build_l, size_t pq_m, const char *path, VectorDiskANN **diskann) {
+    size_t n = table->num_vectors;
+    if (n == 0 || degree == 0 || n > UINT32_MAX) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (build_l < degree) {
+        build_l = degree;
+    }
+
+    VectorDiskANN *index = calloc(1, sizeof(VectorDiskANN));
+    if (!index) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    index->fd = -1;
+    index->dimension = table->vector_dimension;
+    index->degree = degree;
+    index->num_nodes = n;
+    index->node_size = index->dimension * sizeof(float) + (1 + degree) * sizeof(uint32_t);
+    index->nodes_per_sector = VECTOR_DISKANN_SECTOR / index->node_size;
+    index->sectors_per_node = (index->node_size + VECTOR_DISKANN_SECTOR - 1) / VECTOR_DISKANN_SECTOR;
+
+    /* One list: plain PQ of the residuals to the mean, codes in node order, trained on the largest sample */
+    int result = vector_ivfpq_train(table, 1, pq_m, VECTOR_IVF_MAX_TRAIN, (uint64_t)n, &index->pq);
+    for (size_t id = 0; id < n && result == EPIPHANYDB_SUCCESS; id++) {
+        result = vector_ivfpq_add(index->pq, table, (uint32_t)id);
+    }
+
+    VectorVamana graph = {table, n, degree, NULL, NULL, 0, 0};
+    if (result == EPIPHANYDB_SUCCESS) {
+        graph.links = malloc(n * (1 + degree) * sizeof(uint32_t));
+        graph.marks = calloc(n, sizeof(uint32_t));
+        result = graph.links && graph.marks ? vector_vamana_build(&graph, build_l) : EPIPHANYDB_ERROR_MEMORY;
+    }
+    index->medoid = graph.medoid;
+
+    if (result == EPIPHANYDB_SUCCESS) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            result = EPIPHANYDB_ERROR_IO;
+        } else {
+            result = vector_diskann_write(index, &graph, table, fd);
+            if (close(fd) != 0 && result == EPIPHANYDB_SUCCESS) {
+                result = EPIPHANYDB_ERROR_IO;
+            }
+        }
+    }
+    free(graph.links);
+    free(graph.marks);
+
+    if (result == EPIPHANYDB_SUCCESS) {
+        index->fd = vector_diskann_open_direct(path);
+        if (index->fd < 0) {
+            result = EPIPHANYDB_ERROR_IO;
+        }
+    }
+    if (result != EPIPHANYDB_SUCCESS) {
+        vector_diskann_free(index);
+        return result;
+    }
+    *diskann = index;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Searching */
+
+/* Open addressing set of the node ids a search has queued */
+typedef struct VectorIdSet {
+    uint32_t *slots;                /* id + 1, 0 for empty */
+    size_t mask;
+    size_t size;
+} VectorIdSet;
+
+/* Insert id, false when present or on allocation failure (then *failed is set) */
+static bool vector_id_set_add(VectorIdSet *set, uint32_t id, bool *failed) {
+    if (2 * (set->size + 1) > set->mask + 1) {
+        size_t capacity = (set->mask + 1) * 2;
+        uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+        if (!slots) {
+            *failed = true;
+            return false;
+        }
+        for (size_t i = 0; i <= set->mask; i++) {
+            if (set->slots[i]) {
+                size_t slot = (set->slots[i] * 2654435761u) & (capacity - 1);
+                while (slots[slot]) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                slots[slot] = set->slots[i];
+            }
+        }
+        free(set->slots);
+        set->slots = slots;
+        set->mask = capacity - 1;
+    }
+
+    size_t slot = ((id + 1) * 2654435761u) & set->mask;
+    while (set->slots[slot]) {
+        if (set->slots[slot] == id + 1) {
+            return false;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+    set->slots[slot] = id + 1;
+    set->size++;
+    return true;
+}
+
+static int vector_results_append(VectorSearchResult **results, size_t *size, size_t *capacity, uint32_t id, float distance) {
+    if (*size == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 64;
+        VectorSearchResult *items = realloc(*results, grown * sizeof(VectorSearchResult));
+        if (!items) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        *results = items;
+        *capacity = grown;
+    }
+    (*results)[*size].id = id;
+    (*results)[*size].distance = distance;
+    (*size)++;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Read the records of count nodes into buffers with one batch of asynchronous reads */
+static int vector_diskann_read(const VectorDiskANN *diskann, const uint32_t *ids, size_t count, uint8_t **buffers, struct aiocb *requests) {
+    size_t span = diskann->nodes_per_sector ? 1 : diskann->sectors_per_node;
+    struct aiocb *list[VECTOR_DISKANN_MAX_BEAMWIDTH];
+
+    for (size_t i = 0; i < count; i++) {
+        size_t sector = diskann->nodes_per_sector ? ids[i] / diskann->nodes_per_sector : ids[i] * span;
+        memset(&requests[i], 0, sizeof(struct aiocb));
+        requests[i].aio_fildes = diskann->fd;
+        requests[i].aio_buf = buffers[i];
+        requests[i].aio_nbytes = span * VECTOR_DISKANN_SECTOR;
+        requests[i].aio_offset = (off_t)((1 + sector) * VECTOR_DISKANN_SECTOR);
+        requests[i].aio_lio_opcode = LIO_READ;
+        list[i] = &requests[i];
+    }
+
+    /* Requests the batch failed to complete, e.g. when the queue is full, are read in place */
+    lio_listio(LIO_WAIT, list, (int)count, NULL);
+    for (size_t i = 0; i < count; i++) {
+        const struct aiocb *suspend[1] = {&requests[i]};
+        while (aio_error(&requests[i]) == EINPROGRESS) {
+            aio_suspend(suspend, 1, NULL);
+        }
+        ssize_t bytes = aio_error(&requests[i]) == 0 ? aio_return(&requests[i]) : -1;
+        if (bytes != (ssize_t)requests[i].aio_nbytes &&
+            pread(diskann->fd, buffers[i], requests[i].aio_nbytes, requests[i].aio_offset) != (ssize_t)requests[i].aio_nbytes) {
+            return EPIPHANYDB_ERROR_IO;
+        }
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * k nearest neighbors of query: a beam search over a candidate list of
+ * search_l nodes ranked by PQ distance, expanding up to beamwidth nodes per
+ * batch of reads. Results carry exact distances from the vectors read.
+ * Vectors the table gained after the build are compared exhaustively.
+ * Nodes outside a filter bitmap are expanded but never returned.
+ */
+int vector_diskann_search(const VectorDiskANN *diskann, const VectorTable *table, const float *query, size_t k, size_t search_l, size_t beamwidth, const uint64_t *filter, VectorSearchResult *results, size_t *num_results) {
+    size_t dim = diskann->dimension;
+    size_t span = diskann->nodes_per_sector ? 1 : diskann->sectors_per_node;
+
+    *num_results = 0;
+    if (k == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (search_l < k) {
+        search_l = k;
+    }
+    if (beamwidth == 0) {
+        beamwidth = 1;
+    }
+    if (beamwidth > VECTOR_DISKANN_MAX_BEAMWIDTH) {
+        beamwidth = VECTOR_DISKANN_MAX_BEAMWIDTH;
+    }
+
+    float *table_pq = malloc(diskann->pq->code_m * VECTOR_PQ_CENTROIDS * sizeof(float));
+    VectorBeam beam = {malloc(search_l * sizeof(VectorBeamEntry)), 0, search_l};
+    VectorIdSet queued = {calloc(64, sizeof(uint32_t)), 63, 0};
+    uint8_t *buffers[VECTOR_DISKANN_MAX_BEAMWIDTH];
+    struct aiocb requests[VECTOR_DISKANN_MAX_BEAMWIDTH];
+    VectorSearchResult *found = NULL;
+    size_t num_found = 0;
+    size_t found_capacity = 0;
+    bool failed = false;
+
+    size_t num_buffers = 0;
+    while (num_buffers < beamwidth) {
+        buffers[num_buffers] = aligned_alloc(VECTOR_DISKANN_SECTOR, span * VECTOR_DISKANN_SECTOR);
+        if (!buffers[num_buffers]) {
+            break;
+        }
+        num_buffers++;
+    }
+
+    int result = table_pq && beam.entries && queued.slots && num_buffers == beamwidth ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_ivfpq_query_table(diskann->pq, 0, query, table_pq);
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        vector_id_set_add(&queued, diskann->medoid, &failed);
+        vector_beam_insert(&beam, vector_ivfpq_code_distance(diskann->pq, 0, diskann->medoid, table_pq), diskann->medoid);
+    }
+
+    float query_norm = vector_norm(query, dim);
+    while (result == EPIPHANYDB_SUCCESS) {
+        uint32_t ids[VECTOR_DISKANN_MAX_BEAMWIDTH];
+        size_t count = 0;
+        for (size_t i = 0; i < beam.size && count < beamwidth; i++) {
+            if (!beam.entries[i].expanded) {
+                beam.entries[i].expanded = true;
+                ids[count++] = beam.entries[i].id;
+            }
+        }
+        if (count == 0) {
+            break;
+        }
+
+        result = vector_diskann_read(diskann, ids, count, buffers, requests);
+        for (size_t i = 0; i < count && result == EPIPHANYDB_SUCCESS; i++) {
+            size_t position = diskann->nodes_per_sector ? ids[i] % diskann->nodes_per_sector : 0;
+            const uint8_t *record = buffers[i] + position * diskann->node_size;
+            const float *vector = (const float *)record;
+            const uint8_t *stored_links = record + dim * sizeof(float);
+            uint32_t num_links;
+
+            if (vector_filter_test(filter, ids[i])) {
+                float distance = vector_distance(table->metric, vector, vector_norm(vector, dim), query, query_norm, dim);
+                result = vector_results_append(&found, &num_found, &found_capacity, ids[i], distance);
+            }
+
+            memcpy(&num_links, stored_links, sizeof(uint32_t));
+            if (num_links > diskann->degree) {
+                num_links = (uint32_t)diskann->degree;
+            }
+            for (uint32_t l = 0; l < num_links && result == EPIPHANYDB_SUCCESS; l++) {
+                uint32_t neighbor;
+                memcpy(&neighbor, stored_links + (1 + l) * sizeof(uint32_t), sizeof(uint32_t));
+                if (neighbor >= diskann->num_nodes || !vector_id_set_add(&queued, neighbor, &failed)) {
+                    result = failed ? EPIPHANYDB_ERROR_MEMORY : EPIPHANYDB_SUCCESS;
+                    continue;
+                }
+                vector_beam_insert(&beam, vector_ivfpq_code_distance(diskann->pq, 0, neighbor, table_pq), neighbor);
+            }
+        }
+    }
+
+    /* Vectors inserted since the build */
+    for (size_t id = diskann->num_nodes; id < table->num_vectors && result == EPIPHANYDB_SUCCESS; id++) {
+        if (!vector_filter_test(filter, id)) {
+            continue;
+        }
+        float distance = vector_distance(table->metric, vector_at(table, id), table->norms[id], query, query_norm, dim);
+        result = vector_results_append(&found, &num_found, &found_capacity, (uint32_t)id, distance);
+    }
+
+    if (result == EPIPHANYDB_SUCCESS) {
+        vector_sort_results(found, num_found);
+        *num_results = num_found < k ? num_found : k;
+        memcpy(results, found, *num_results * sizeof(VectorSearchResult));
+    }
+
+    for (size_t i = 0; i < num_buffers; i++) {
+        free(buffers[i]);
+    }
+    free(found);
+    free(queued.slots);
+    free(beam.entries);
+    free(table_pq);
+    return result;
+}
+
+/* Bytes held in memory by the index: the PQ codes and codebooks */
+size_t vector_diskann_memory_usage(const VectorDiskANN *diskann) {
+    return sizeof(VectorDiskANN) + vector_ivfpq_memory_usage(diskann->pq);
+}
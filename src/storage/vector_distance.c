@@ -0,0 +1,280 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * Distance kernels. Dot product, squared L2 and L1 distance come in scalar,
+ * SSE, AVX2/FMA and AVX-512 versions; the widest one the CPU supports is
+ * picked once at startup. Wide kernels keep four independent accumulators
+ * to hide FMA latency and finish the last partial register with a masked
+ * load instead of a scalar tail loop.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define VECTOR_HAVE_X86_KERNELS 1
+#endif
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+/* Scalar kernels, also the reference the wide ones are tested against */
+
+static float vector_dot_scalar(const float *a, const float *b, size_t n) {
+    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) {
+        sum[0] += a[i] * b[i];
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+static float vector_l2_squared_scalar(const float *a, const float *b, size_t n) {
+    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        for (size_t j = 0; j < 4; j++) {
+            float diff = a[i + j] - b[i + j];
+            sum[j] += diff * diff;
+        }
+    }
+    for (; i < n; i++) {
+        float diff = a[i] - b[i];
+        sum[0] += diff * diff;
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+static float vector_l1_scalar(const float *a, const float *b, size_t n) {
+    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        for (size_t j = 0; j < 4; j++) {
+            sum[j] += fabsf(a[i + j] - b[i + j]);
+        }
+    }
+    for (; i < n; i++) {
+        sum[0] += fabsf(a[i] - b[i]);
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+#ifdef VECTOR_HAVE_X86_KERNELS
+
+/* SSE kernels: baseline on x86-64, no FMA and no masked loads */
+
+static inline float vector_hsum_sse(__m128 v) {
+    __m128 shuffled = _mm_movehl_ps(v, v);
+    __m128 sums = _mm_add_ps(v, shuffled);
+    shuffled = _mm_shuffle_ps(sums, sums, 0x55);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+
+#define VECTOR_SSE_KERNEL(NAME, TERM, SCALAR)                                                \
+    static float NAME(const float *a, const float *b, size_t n) {                            \
+        __m128 sign = _mm_set1_ps(-0.0f);                                                    \
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();                             \
+        __m128 acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();                             \
+        size_t i = 0;                                                                        \
+        (void)sign;                                                                          \
+        for (; i + 16 <= n; i += 16) {                                                       \
+            acc0 = _mm_add_ps(acc0, TERM(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));         \
+            acc1 = _mm_add_ps(acc1, TERM(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4))); \
+            acc2 = _mm_add_ps(acc2, TERM(_mm_loadu_ps(a + i + 8), _mm_loadu_ps(b + i + 8))); \
+            acc3 = _mm_add_ps(acc3, TERM(_mm_loadu_ps(a + i + 12), _mm_loadu_ps(b + i + 12))); \
+        }                                                                                    \
+        for (; i + 4 <= n; i += 4) {                                                         \
+            acc0 = _mm_add_ps(acc0, TERM(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));         \
+        }                                                                                    \
+        float sum = vector_hsum_sse(_mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3))); \
+        return sum + SCALAR(a + i, b + i, n - i);                                            \
+    }
+
+#define VECTOR_SSE_DOT(x, y) _mm_mul_ps((x), (y))
+#define VECTOR_SSE_L2(x, y) _mm_mul_ps(_mm_sub_ps((x), (y)), _mm_sub_ps((x), (y)))
+#define VECTOR_SSE_L1(x, y) _mm_andnot_ps(sign, _mm_sub_ps((x), (y)))
+
+VECTOR_SSE_KERNEL(vector_dot_sse, VECTOR_SSE_DOT, vector_dot_scalar)
+VECTOR_SSE_KERNEL(vector_l2_squared_sse, VECTOR_SSE_L2, vector_l2_squared_scalar)
+VECTOR_SSE_KERNEL(vector_l1_sse, VECTOR_SSE_L1, vector_l1_scalar)
+
+/* AVX2 kernels: FMA accumulation, the tail through _mm256_maskload_ps */
+
+static const int32_t vector_avx2_tail_masks[16] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+__attribute__((target("avx2,fma")))
+static inline float vector_hsum_avx2(__m256 v) {
+    __m128 sums = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 shuffled = _mm_movehl_ps(sums, sums);
+    sums = _mm_add_ps(sums, shuffled);
+    shuffled = _mm_shuffle_ps(sums, sums, 0x55);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+
+/* Mask of the first n < 8 lanes */
+__attribute__((target("avx2,fma")))
+static inline __m256i vector_avx2_mask(size_t n) {
+    return _mm256_loadu_si256((const __m256i *)(vector_avx2_tail_masks + 8 - n));
+}
+
+#define VECTOR_AVX2_KERNEL(NAME, STEP)                                                       \
+    __attribute__((target("avx2,fma")))                                                      \
+    static float NAME(const float *a, const float *b, size_t n) {                            \
+        __m256 sign = _mm256_set1_ps(-0.0f);                                                 \
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();                       \
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();                       \
+        size_t i = 0;                                                                        \
+        (void)sign;                                                                          \
+        for (; i + 32 <= n; i += 32) {                                                       \
+            acc0 = STEP(acc0, _mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));               \
+            acc1 = STEP(acc1, _mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));       \
+            acc2 = STEP(acc2, _mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16));     \
+            acc3 = STEP(acc3, _mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24));     \
+        }                                                                                    \
+        for (; i + 8 <= n; i += 8) {                                                         \
+            acc0 = STEP(acc0, _mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));               \
+        }                                                                                    \
+        if (i < n) {                                                                         \
+            __m256i mask = vector_avx2_mask(n - i);                                          \
+            acc1 = STEP(acc1, _mm256_maskload_ps(a + i, mask), _mm256_maskload_ps(b + i, mask)); \
+        }                                                                                    \
+        return vector_hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3))); \
+    }
+
+#define VECTOR_AVX2_DOT(acc, x, y) _mm256_fmadd_ps((x), (y), (acc))
+#define VECTOR_AVX2_L2(acc, x, y) _mm256_fmadd_ps(_mm256_sub_ps((x), (y)), _mm256_sub_ps((x), (y)), (acc))
+#define VECTOR_AVX2_L1(acc, x, y) _mm256_add_ps((acc), _mm256_andnot_ps(sign, _mm256_sub_ps((x), (y))))
+
+VECTOR_AVX2_KERNEL(vector_dot_avx2, VECTOR_AVX2_DOT)
+VECTOR_AVX2_KERNEL(vector_l2_squared_avx2, VECTOR_AVX2_L2)
+VECTOR_AVX2_KERNEL(vector_l1_avx2, VECTOR_AVX2_L1)
+
+/* AVX-512 kernels: FMA accumulation, the tail through a __mmask16 load */
+
+#define VECTOR_AVX512_KERNEL(NAME, STEP)                                                     \
+    __attribute__((target("avx512f")))                                                       \
+    static float NAME(const float *a, const float *b, size_t n) {                            \
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();                       \
+        __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();                       \
+        size_t i = 0;                                                                        \
+        for (; i + 64 <= n; i += 64) {                                                       \
+            acc0 = STEP(acc0, _mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));               \
+            acc1 = STEP(acc1, _mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));     \
+            acc2 = STEP(acc2, _mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32));     \
+            acc3 = STEP(acc3, _mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48));     \
+        }                                                                                    \
+        for (; i + 16 <= n; i += 16) {                                                       \
+            acc0 = STEP(acc0, _mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));               \
+        }                                                                                    \
+        if (i < n) {                                                                         \
+            __mmask16 mask = (__mmask16)((1U << (n - i)) - 1);                               \
+            acc1 = STEP(acc1, _mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i)); \
+        }                                                                                    \
+        return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3))); \
+    }
+
+#define VECTOR_AVX512_DOT(acc, x, y) _mm512_fmadd_ps((x), (y), (acc))
+#define VECTOR_AVX512_L2(acc, x, y) _mm512_fmadd_ps(_mm512_sub_ps((x), (y)), _mm512_sub_ps((x), (y)), (acc))
+#define VECTOR_AVX512_L1(acc, x, y) _mm512_add_ps((acc), _mm512_abs_ps(_mm512_sub_ps((x), (y))))
+
+VECTOR_AVX512_KERNEL(vector_dot_avx512, VECTOR_AVX512_DOT)
+VECTOR_AVX512_KERNEL(vector_l2_squared_avx512, VECTOR_AVX512_L2)
+VECTOR_AVX512_KERNEL(vector_l1_avx512, VECTOR_AVX512_L1)
+
+#endif /* VECTOR_HAVE_X86_KERNELS */
+
+/* Kernel dispatch */
+
+static VectorISA vector_kernel_isa = VECTOR_ISA_SCALAR;
+static VectorDistanceFn vector_dot_kernel = vector_dot_scalar;
+static VectorDistanceFn vector_l2_squared_kernel = vector_l2_squared_scalar;
+static VectorDistanceFn vector_l1_kernel = vector_l1_scalar;
+
+/* Run at load time, so the wrappers below call the kernels without any check */
+__attribute__((constructor))
+static void vector_init_kernels(void) {
+#ifdef VECTOR_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        vector_kernel_isa = VECTOR_ISA_AVX512;
+        vector_dot_kernel = vector_dot_avx512;
+        vector_l2_squared_kernel = vector_l2_squared_avx512;
+        vector_l1_kernel = vector_l1_avx512;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        vector_kernel_isa = VECTOR_ISA_AVX2;
+        vector_dot_kernel = vector_dot_avx2;
+        vector_l2_squared_kernel = vector_l2_squared_avx2;
+        vector_l1_kernel = vector_l1_avx2;
+    } else {
+        vector_kernel_isa = VECTOR_ISA_SSE;
+        vector_dot_kernel = vector_dot_sse;
+        vector_l2_squared_kernel = vector_l2_squared_sse;
+        vector_l1_kernel = vector_l1_sse;
+    }
+#endif
+}
+
+float vector_dot(const float *a, const float *b, size_t n) {
+    return vector_dot_kernel(a, b, n);
+}
+
+float vector_l2_squared(const float *a, const float *b, size_t n) {
+    return vector_l2_squared_kernel(a, b, n);
+}
+
+float vector_l1(const float *a, const float *b, size_t n) {
+    return vector_l1_kernel(a, b, n);
+}
+
+float vector_norm(const float *a, size_t n) {
+    return sqrtf(vector_dot(a, a, n));
+}
+
+VectorISA vector_isa(void) {
+    return vector_kernel_isa;
+}
+
+const char *vector_isa_name(VectorISA isa) {
+    switch (isa) {
+        case VECTOR_ISA_SSE:
+            return "sse";
+        case VECTOR_ISA_AVX2:
+            return "avx2";
+        case VECTOR_ISA_AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+    }
+}
+
+/*
+ * Distance of a to b under metric, smaller meaning closer. Cosine takes the
+ * precomputed norms of both vectors so it costs a single dot product; a
+ * zero vector is at distance 1 from everything.
+ */
+float vector_distance(VectorMetric metric, const float *a, float norm_a, const float *b, float norm_b, size_t n) {
+    switch (metric) {
+        case VECTOR_METRIC_EUCLIDEAN:
+            return sqrtf(vector_l2_squared(a, b, n));
+        case VECTOR_METRIC_MANHATTAN:
+            return vector_l1(a, b, n);
+        default:
+            if (norm_a == 0.0f || norm_b == 0.0f) {
+                return 1.0f;
+            }
+            return 1.0f - vector_dot(a, b, n) / (norm_a * norm_b);
+    }
+}
@@ -0,0 +1,182 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * Exact exhaustive search. The float arena is cut into cache-sized blocks
+ * that threads claim in id order, each keeping the k nearest vectors it
+ * has seen in a bounded max-heap whose top is the distance a vector must
+ * beat; the heaps are merged once the scan is over. Large tables are
+ * scanned by one thread per allowed CPU, giving each at least
+ * VECTOR_EXACT_THREAD_BYTES of vectors, so that the scan runs at memory
+ * bandwidth while small tables stay on the calling thread.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <pthread.h>
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+typedef struct VectorExactScan {
+    const VectorTable *table;
+    const float *query;
+    float query_norm;
+    size_t k;
+    const uint64_t *filter;         /* vectors to consider, NULL for all */
+    size_t block;                   /* vectors per claimed block */
+    size_t next;                    /* first vector not yet claimed */
+    bool stop;                      /* set when a worker fails */
+} VectorExactScan;
+
+typedef struct VectorExactWorker {
+    pthread_t thread;
+    VectorExactScan *scan;
+    VectorHeap nearest;             /* max-heap of the k nearest so far */
+    int result;
+} VectorExactWorker;
+
+static void *vector_exact_worker(void *arg) {
+    VectorExactWorker *worker = arg;
+    VectorExactScan *scan = worker->scan;
+    const VectorTable *table = scan->table;
+    size_t n = table->num_vectors;
+    VectorHeap *nearest = &worker->nearest;
+
+    worker->result = EPIPHANYDB_SUCCESS;
+    while (!__atomic_load_n(&scan->stop, __ATOMIC_RELAXED)) {
+        size_t first = __atomic_fetch_add(&scan->next, scan->block, __ATOMIC_RELAXED);
+        if (first >= n) {
+            break;
+        }
+        size_t last = first + scan->block < n ? first + scan->block : n;
+
+        for (size_t id = first; id < last && worker->result == EPIPHANYDB_SUCCESS; id++) {
+            if (scan->filter && id % 64 == 0 && scan->filter[id / 64] == 0) {
+                id += 63;
+                continue;
+            }
+            if (!vector_filter_test(scan->filter, id)) {
+                continue;
+            }
+            float distance = vector_distance(table->metric, vector_at(table, id), table->norms[id], scan->query,
+                                             scan->query_norm, table->vector_dimension);
+            if (nearest->size < scan->k) {
+                VectorCandidate candidate = {distance, (uint32_t)id};
+                worker->result = vector_heap_push(nearest, candidate);
+            } else if (distance < nearest->items[0].distance) {
+                VectorCandidate candidate = {distance, (uint32_t)id};
+                vector_heap_pop(nearest);
+                worker->result = vector_heap_push(nearest, candidate);
+            }
+        }
+        if (worker->result != EPIPHANYDB_SUCCESS) {
+            __atomic_store_n(&scan->stop, true, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+/* Closer first, then lower ids */
+static int vector_exact_compare(const void *a, const void *b) {
+    const VectorSearchResult *x = a;
+    const VectorSearchResult *y = b;
+    if (x->distance != y->distance) {
+        return x->distance < y->distance ? -1 : 1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/*
+ * The k vectors nearest to query among those in filter, NULL for all, by
+ * their float distances whatever the index or storage mode of table, read
+ * lock held. num_threads caps the scanning threads, 0 for one per allowed
+ * CPU. results receive up to k hits by increasing distance.
+ */
+int vector_exact_search(const VectorTable *table, const float *query, size_t k, const uint64_t *filter, size_t num_threads, VectorSearchResult *results, size_t *num_results) {
+    size_t n = table->num_vectors;
+    size_t vector_bytes = table->stride * sizeof(float);
+
+    *num_results = 0;
+    if (k == 0 || n == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    if (num_threads == 0) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        num_threads = sched_getaffinity(0, sizeof(allowed), &allowed) == 0 ? (size_t)CPU_COUNT(&allowed) : 1;
+    }
+    size_t fill = n * vector_bytes / VECTOR_EXACT_THREAD_BYTES;
+    if (num_threads > fill) {
+        num_threads = fill;
+    }
+    if (num_threads > VECTOR_EXACT_MAX_THREADS) {
+        num_threads = VECTOR_EXACT_MAX_THREADS;
+    }
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+
+    /* Whole cache lines of filter bits per block, so skipped words stay aligned */
+    size_t block = VECTOR_EXACT_BLOCK_BYTES / vector_bytes;
+    block = block < 64 ? 64 : block / 64 * 64;
+
+    VectorExactScan scan = {table, query, vector_norm(query, table->vector_dimension), k, filter, block, 0, false};
+    VectorExactWorker *workers = calloc(num_threads, sizeof(VectorExactWorker));
+    if (!workers) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        workers[i].scan = &scan;
+        workers[i].nearest.max_heap = true;
+    }
+
+    /* Threads that fail to start leave their share to the others */
+    size_t started = 1;
+    for (size_t i = 1; i < num_threads; i++) {
+        if (pthread_create(&workers[started].thread, NULL, vector_exact_worker, &workers[started]) == 0) {
+            started++;
+        }
+    }
+    vector_exact_worker(&workers[0]);
+
+    int result = workers[0].result;
+    size_t candidates = workers[0].nearest.size;
+    for (size_t i = 1; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = workers[i].result;
+        }
+        candidates += workers[i].nearest.size;
+    }
+
+    /* Merge the per-thread heaps, in place when they fit */
+    VectorSearchResult *merged = candidates > k ? malloc(candidates * sizeof(VectorSearchResult)) : results;
+    if (!merged) {
+        result = EPIPHANYDB_ERROR_MEMORY;
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        size_t size = 0;
+        for (size_t i = 0; i < started; i++) {
+            for (size_t j = 0; j < workers[i].nearest.size; j++) {
+                merged[size].id = workers[i].nearest.items[j].id;
+                merged[size].distance = workers[i].nearest.items[j].distance;
+                size++;
+            }
+        }
+        qsort(merged, size, sizeof(VectorSearchResult), vector_exact_compare);
+        *num_results = size < k ? size : k;
+        if (merged != results) {
+            memcpy(results, merged, *num_results * sizeof(VectorSearchResult));
+            free(merged);
+        }
+    }
+
+    for (size_t i = 0; i < num_threads; i++) {
+        vector_heap_free(&workers[i].nearest);
+    }
+    free(workers);
+    return result;
+}
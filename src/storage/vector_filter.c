@@ -0,0 +1,336 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * Metadata filters. The metadata of every vector is parsed into key and
+ * value terms, from flat JSON objects ({"tenant": "acme", "tags": ["a",
+ * "b"]}) or key=value lists (tenant=acme, lang=en), and each term keeps
+ * the ascending ids of the vectors holding it. A filter, written in the
+ * same syntax, matches the vectors holding all of its terms and evaluates
+ * to a bitmap over vector ids by intersecting their postings.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+/* Parsing */
+
+static bool vector_metadata_delimiter(char c) {
+    return isspace((unsigned char)c) || c == ',' || c == ';' || c == '&' || c == '{' || c == '}';
+}
+
+/* Quoted string or bare word at p; returns the end of the token, start and length of its text */
+static const char *vector_metadata_token(const char *p, const char **text, size_t *len) {
+    if (*p == '"' || *p == '\'') {
+        char quote = *p++;
+        *text = p;
+        while (*p && *p != quote) {
+            p += p[0] == '\\' && p[1] ? 2 : 1;
+        }
+        *len = (size_t)(p - *text);
+        return *p ? p + 1 : p;
+    }
+
+    *text = p;
+    while (*p && !vector_metadata_delimiter(*p) && !strchr("=:[]\"'", *p)) {
+        p++;
+    }
+    *len = (size_t)(p - *text);
+    return p;
+}
+
+static const char *vector_metadata_skip_space(const char *p) {
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+/*
+ * Call fn for every key and value of text. Arrays give one term per
+ * element and the keys of nested objects are taken as they are.
+ */
+int vector_metadata_parse(const char *text, VectorTermFn fn, void *context) {
+    const char *p = text;
+
+    while (*p) {
+        while (vector_metadata_delimiter(*p)) {
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+
+        const char *key;
+        size_t key_len;
+        const char *next = vector_metadata_token(p, &key, &key_len);
+        if (next == p) {
+            p++;
+            continue;
+        }
+        p = vector_metadata_skip_space(next);
+        if (*p != '=' && *p != ':') {
+            continue;
+        }
+        p = vector_metadata_skip_space(p + 1);
+        if (*p == '{') {
+            continue;
+        }
+
+        bool array = *p == '[';
+        if (array) {
+            p++;
+        }
+        do {
+            while (vector_metadata_delimiter(*p) && *p != '{' && *p != '}') {
+                p++;
+            }
+            if (array && *p == ']') {
+                p++;
+                break;
+            }
+
+            const char *value;
+            size_t value_len;
+            next = vector_metadata_token(p, &value, &value_len);
+            if (next == p) {
+                break;
+            }
+            p = next;
+            if (key_len > 0 && value_len > 0) {
+                int result = fn(context, key, key_len, value, value_len);
+                if (result != EPIPHANYDB_SUCCESS) {
+                    return result;
+                }
+            }
+        } while (array && *p);
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Inverted index */
+
+static uint64_t vector_term_hash(const char *key, size_t key_len, const char *value, size_t value_len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < key_len; i++) {
+        hash = (hash ^ (unsigned char)key[i]) * 0x100000001b3ULL;
+    }
+    hash = (hash ^ (unsigned char)VECTOR_TERM_SEPARATOR) * 0x100000001b3ULL;
+    for (size_t i = 0; i < value_len; i++) {
+        hash = (hash ^ (unsigned char)value[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static bool vector_term_equals(const char *term, const char *key, size_t key_len, const char *value, size_t value_len) {
+    return strncmp(term, key, key_len) == 0 && term[key_len] == VECTOR_TERM_SEPARATOR &&
+           strncmp(term + key_len + 1, value, value_len) == 0 && term[key_len + 1 + value_len] == '\0';
+}
+
+/* Slot of the term, or of the empty slot it would take */
+static VectorPostings *vector_metadata_slot(const VectorMetadataIndex *index, const char *key, size_t key_len, const char *value, size_t value_len) {
+    size_t mask = index->num_slots - 1;
+    size_t slot = (size_t)vector_term_hash(key, key_len, value, value_len) & mask;
+
+    while (index->slots[slot].term && !vector_term_equals(index->slots[slot].term, key, key_len, value, value_len)) {
+        slot = (slot + 1) & mask;
+    }
+    return &index->slots[slot];
+}
+
+static int vector_metadata_grow(VectorMetadataIndex *index) {
+    size_t num_slots = index->num_slots ? index->num_slots * 2 : VECTOR_METADATA_INITIAL_SLOTS;
+    VectorPostings *slots = calloc(num_slots, sizeof(VectorPostings));
+    if (!slots) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    VectorMetadataIndex grown = {slots, num_slots, index->num_terms};
+    for (size_t i = 0; i < index->num_slots; i++) {
+        VectorPostings *postings = &index->slots[i];
+        if (postings->term) {
+            const char *separator = strchr(postings->term, VECTOR_TERM_SEPARATOR);
+            *vector_metadata_slot(&grown, postings->term, (size_t)(separator - postings->term), separator + 1,
+                                  strlen(separator + 1)) = *postings;
+        }
+    }
+    free(index->slots);
+    *index = grown;
+    return EPIPHANYDB_SUCCESS;
+}
+
+typedef struct VectorTermInsert {
+    VectorMetadataIndex *index;
+    uint32_t id;
+} VectorTermInsert;
+
+static int vector_metadata_insert_term(void *context, const char *key, size_t key_len, const char *value, size_t value_len) {
+    VectorTermInsert *insert = context;
+    VectorMetadataIndex *index = insert->index;
+
+    if (2 * (index->num_terms + 1) > index->num_slots) {
+        int result = vector_metadata_grow(index);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+    }
+
+    VectorPostings *postings = vector_metadata_slot(index, key, key_len, value, value_len);
+    if (!postings->term) {
+        char *term = malloc(key_len + 1 + value_len + 1);
+        if (!term) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        memcpy(term, key, key_len);
+        term[key_len] = VECTOR_TERM_SEPARATOR;
+        memcpy(term + key_len + 1, value, value_len);
+        term[key_len + 1 + value_len] = '\0';
+        postings->term = term;
+        index->num_terms++;
+    }
+
+    /* Ids arrive in increasing order; a term repeated in one metadata is kept once */
+    if (postings->size > 0 && postings->ids[postings->size - 1] == insert->id) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (postings->size == postings->capacity) {
+        size_t capacity = postings->capacity ? postings->capacity * 2 : 4;
+        uint32_t *ids = realloc(postings->ids, capacity * sizeof(uint32_t));
+        if (!ids) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        postings->ids = ids;
+        postings->capacity = capacity;
+    }
+    postings->ids[postings->size++] = insert->id;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Index the terms of metadata under id, which must exceed every id indexed before */
+int vector_metadata_index_add(VectorMetadataIndex *index, const char *metadata, uint32_t id) {
+    VectorTermInsert insert = {index, id};
+    int result = metadata ? vector_metadata_parse(metadata, vector_metadata_insert_term, &insert) : EPIPHANYDB_SUCCESS;
+    if (result != EPIPHANYDB_SUCCESS) {
+        vector_metadata_index_remove(index, id);
+    }
+    return result;
+}
+
+/* Drop id, the last id indexed, from every term */
+void vector_metadata_index_remove(VectorMetadataIndex *index, uint32_t id) {
+    for (size_t i = 0; i < index->num_slots; i++) {
+        VectorPostings *postings = &index->slots[i];
+        if (postings->size > 0 && postings->ids[postings->size - 1] == id) {
+            postings->size--;
+        }
+    }
+}
+
+void vector_metadata_index_free(VectorMetadataIndex *index) {
+    for (size_t i = 0; i < index->num_slots; i++) {
+        free(index->slots[i].term);
+        free(index->slots[i].ids);
+    }
+    free(index->slots);
+    memset(index, 0, sizeof(VectorMetadataIndex));
+}
+
+/* Filters */
+
+typedef struct VectorTermLookup {
+    const VectorMetadataIndex *index;
+    const VectorPostings **postings;
+    size_t size;
+    size_t capacity;
+    bool missing;                   /* some term is held by no vector */
+} VectorTermLookup;
+
+static int vector_filter_lookup_term(void *context, const char *key, size_t key_len, const char *value, size_t value_len) {
+    VectorTermLookup *lookup = context;
+    const VectorPostings *postings = NULL;
+
+    if (lookup->index->num_slots > 0) {
+        postings = vector_metadata_slot(lookup->index, key, key_len, value, value_len);
+    }
+    if (!postings || !postings->term) {
+        lookup->missing = true;
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    if (lookup->size == lookup->capacity) {
+        size_t capacity = lookup->capacity ? lookup->capacity * 2 : 4;
+        const VectorPostings **grown = realloc(lookup->postings, capacity * sizeof(VectorPostings *));
+        if (!grown) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        lookup->postings = grown;
+        lookup->capacity = capacity;
+    }
+    lookup->postings[lookup->size++] = postings;
+    return EPIPHANYDB_SUCCESS;
+}
+
+static int vector_compare_postings(const void *a, const void *b) {
+    size_t x = (*(const VectorPostings *const *)a)->size;
+    size_t y = (*(const VectorPostings *const *)b)->size;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Evaluate filter against the first num_vectors vectors. bitmap receives
+ * a malloc'd array of (num_vectors + 63) / 64 words with the bits of the
+ * matching ids set, count their number. A filter without terms is invalid.
+ */
+int vector_filter_evaluate(const VectorMetadataIndex *index, const char *filter, size_t num_vectors, uint64_t **bitmap, size_t *count) {
+    VectorTermLookup lookup = {index, NULL, 0, 0, false};
+    int result = vector_metadata_parse(filter, vector_filter_lookup_term, &lookup);
+    if (result == EPIPHANYDB_SUCCESS && lookup.size == 0 && !lookup.missing) {
+        result = EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    size_t num_words = (num_vectors + 63) / 64;
+    uint64_t *bits = NULL;
+    uint64_t *scratch = NULL;
+    if (result == EPIPHANYDB_SUCCESS) {
+        bits = calloc(num_words ? num_words : 1, sizeof(uint64_t));
+        scratch = lookup.size > 1 ? malloc(num_words * sizeof(uint64_t)) : NULL;
+        if (!bits || (lookup.size > 1 && !scratch)) {
+            result = EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+
+    size_t matches = 0;
+    if (result == EPIPHANYDB_SUCCESS && !lookup.missing) {
+        /* Start from the rarest term, each further term can only clear bits */
+        qsort(lookup.postings, lookup.size, sizeof(VectorPostings *), vector_compare_postings);
+        const VectorPostings *rarest = lookup.postings[0];
+        for (size_t i = 0; i < rarest->size && rarest->ids[i] < num_vectors; i++) {
+            bits[rarest->ids[i] / 64] |= 1ULL << (rarest->ids[i] % 64);
+        }
+        for (size_t t = 1; t < lookup.size; t++) {
+            const VectorPostings *postings = lookup.postings[t];
+            memset(scratch, 0, num_words * sizeof(uint64_t));
+            for (size_t i = 0; i < postings->size && postings->ids[i] < num_vectors; i++) {
+                scratch[postings->ids[i] / 64] |= 1ULL << (postings->ids[i] % 64);
+            }
+            for (size_t w = 0; w < num_words; w++) {
+                bits[w] &= scratch[w];
+            }
+        }
+        for (size_t w = 0; w < num_words; w++) {
+            matches += (size_t)__builtin_popcountll(bits[w]);
+        }
+    }
+
+    free(scratch);
+    free(lookup.postings);
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(bits);
+        return result;
+    }
+    *bitmap = bits;
+    *count = matches;
+    return EPIPHANYDB_SUCCESS;
+}
@@ -0,0 +1,1081 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * HNSW index. Every vector is a node of a layered proximity graph: all
+ * nodes are on layer 0 and each is also drawn on the layers above with
+ * exponentially decreasing probability. Searches descend greedily from the
+ * single node of the top layer and finish with a beam search of width ef on
+ * layer 0. Inserts run the same search with ef_construction and link the
+ * node to neighbors picked by the diversity heuristic of the HNSW paper.
+ * Inserts link their node next to running searches and other inserts;
+ * bulk builds link the nodes of a table from several threads at once.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <sched.h>
+#include <pthread.h>
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+/* Candidate heaps */
+
+static bool vector_heap_above(const VectorHeap *heap, VectorCandidate a, VectorCandidate b) {
+    return heap->max_heap ? a.distance > b.distance : a.distance < b.distance;
+}
+
+int vector_heap_push(VectorHeap *heap, VectorCandidate candidate) {
+    if (heap->size == heap->capacity) {
+        size_t capacity = heap->capacity ? heap->capacity * 2 : 64;
+        VectorCandidate *items = realloc(heap->items, capacity * sizeof(VectorCandidate));
+        if (!items) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        heap->items = items;
+        heap->capacity = capacity;
+    }
+
+    size_t i = heap->size++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!vector_heap_above(heap, candidate, heap->items[parent])) {
+            break;
+        }
+        heap->items[i] = heap->items[parent];
+        i = parent;
+    }
+    heap->items[i] = candidate;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Remove and return the top candidate of a non-empty heap */
+VectorCandidate vector_heap_pop(VectorHeap *heap) {
+    VectorCandidate top = heap->items[0];
+    VectorCandidate last = heap->items[--heap->size];
+    size_t i = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= heap->size) {
+            break;
+        }
+        if (child + 1 < heap->size && vector_heap_above(heap, heap->items[child + 1], heap->items[child])) {
+            child++;
+        }
+        if (!vector_heap_above(heap, heap->items[child], last)) {
+            break;
+        }
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->size > 0) {
+        heap->items[i] = last;
+    }
+    return top;
+}
+
+void vector_heap_free(VectorHeap *heap) {
+    free(heap->items);
+    memset(heap, 0, sizeof(VectorHeap));
+}
+
+/* Visited sets */
+
+/* Visited set sized for the current nodes, starting a new epoch */
+static VectorVisited *vector_visited_acquire(VectorHNSW *hnsw) {
+    pthread_mutex_lock(&hnsw->pool_mutex);
+    VectorVisited *visited = hnsw->visited_pool;
+    if (visited) {
+        hnsw->visited_pool = visited->next;
+    }
+    pthread_mutex_unlock(&hnsw->pool_mutex);
+
+    if (!visited) {
+        visited = calloc(1, sizeof(VectorVisited));
+        if (!visited) {
+            return NULL;
+        }
+    }
+
+    if (visited->capacity < hnsw->num_nodes) {
+        size_t capacity = hnsw->capacity;
+        uint32_t *marks = realloc(visited->marks, capacity * sizeof(uint32_t));
+        if (!marks) {
+            free(visited->marks);
+            free(visited);
+            return NULL;
+        }
+        memset(marks + visited->capacity, 0, (capacity - visited->capacity) * sizeof(uint32_t));
+        visited->marks = marks;
+        visited->capacity = capacity;
+    }
+
+    /* Marks of a wrapped epoch could collide, start over from zero */
+    if (++visited->epoch == 0) {
+        memset(visited->marks, 0, visited->capacity * sizeof(uint32_t));
+        visited->epoch = 1;
+    }
+    return visited;
+}
+
+static void vector_visited_release(VectorHNSW *hnsw, VectorVisited *visited) {
+    pthread_mutex_lock(&hnsw->pool_mutex);
+    visited->next = hnsw->visited_pool;
+    hnsw->visited_pool = visited;
+    pthread_mutex_unlock(&hnsw->pool_mutex);
+}
+
+/* True when id was already visited, marking it otherwise */
+static inline bool vector_visited_test(VectorVisited *visited, uint32_t id) {
+    if (visited->marks[id] == visited->epoch) {
+        return true;
+    }
+    visited->marks[id] = visited->epoch;
+    return false;
+}
+
+/* Graph layout */
+
+/* Adjacency block of id on level: count, then the neighbor ids */
+static inline uint32_t *vector_hnsw_links(const VectorHNSW *hnsw, uint32_t id, int level) {
+    if (level == 0) {
+        return hnsw->level0 + (size_t)id * (1 + hnsw->m0);
+    }
+    return hnsw->upper[id] + (size_t)(level - 1) * (1 + hnsw->m);
+}
+
+/* Neighbor count of a block, read without its link lock */
+static inline uint32_t vector_hnsw_link_count(const uint32_t *links) {
+    return __atomic_load_n(&links[0], __ATOMIC_ACQUIRE);
+}
+
+/* Neighbor i >= 1 of a block, which a writer may be replacing but never invalidates */
+static inline uint32_t vector_hnsw_link_at(const uint32_t *links, uint32_t i) {
+    return __atomic_load_n(&links[i], __ATOMIC_RELAXED);
+}
+
+/* Replace the neighbors of a block, its link lock held: ids first, then the count */
+static void vector_hnsw_store_links(uint32_t *links, const uint32_t *ids, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        __atomic_store_n(&links[1 + i], ids[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&links[0], count, __ATOMIC_RELEASE);
+}
+
+static inline pthread_mutex_t *vector_hnsw_link_lock(const VectorHNSW *hnsw, uint32_t id) {
+    return &hnsw->link_locks[id % VECTOR_HNSW_LINK_LOCKS];
+}
+
+/* Entry point of searches and its level, false while the graph is empty */
+static inline bool vector_hnsw_entry(const VectorHNSW *hnsw, uint32_t *entry, int *level) {
+    if (__atomic_load_n(&hnsw->max_level, __ATOMIC_ACQUIRE) < 0) {
+        return false;
+    }
+    *entry = __atomic_load_n(&hnsw->entry_point, __ATOMIC_ACQUIRE);
+    *level = hnsw->levels[*entry];
+    return true;
+}
+
+/* Make id, linked up to level, the entry point; entry_mutex held */
+static void vector_hnsw_publish_entry(VectorHNSW *hnsw, uint32_t id, int level) {
+    __atomic_store_n(&hnsw->entry_point, id, __ATOMIC_RELEASE);
+    __atomic_store_n(&hnsw->max_level, level, __ATOMIC_RELEASE);
+}
+
+static int vector_hnsw_reserve(VectorHNSW *hnsw, size_t capacity) {
+    if (capacity <= hnsw->capacity) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t grown_capacity = hnsw->capacity ? hnsw->capacity : VECTOR_INITIAL_CAPACITY;
+    while (grown_capacity < capacity) {
+        grown_capacity *= 2;
+    }
+
+    uint8_t *levels = realloc(hnsw->levels, grown_capacity);
+    if (levels) {
+        hnsw->levels = levels;
+    }
+    uint32_t **upper = realloc(hnsw->upper, grown_capacity * sizeof(uint32_t *));
+    if (upper) {
+        hnsw->upper = upper;
+    }
+    uint32_t *level0 = realloc(hnsw->level0, grown_capacity * (1 + hnsw->m0) * sizeof(uint32_t));
+    if (level0) {
+        hnsw->level0 = level0;
+    }
+    if (!levels || !upper || !level0) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    hnsw->capacity = grown_capacity;
+    return EPIPHANYDB_SUCCESS;
+}
+
+VectorHNSW *vector_hnsw_create(size_t m, size_t ef_construction, uint64_t seed) {
+    if (m < 2) {
+        m = 2;
+    }
+
+    VectorHNSW *hnsw = calloc(1, sizeof(VectorHNSW));
+    if (!hnsw) {
+        return NULL;
+    }
+    hnsw->link_locks = malloc(VECTOR_HNSW_LINK_LOCKS * sizeof(pthread_mutex_t));
+    if (!hnsw->link_locks) {
+        free(hnsw);
+        return NULL;
+    }
+    hnsw->m = m;
+    hnsw->m0 = 2 * m;
+    hnsw->ef_construction = ef_construction < m ? m : ef_construction;
+    hnsw->level_mult = 1.0 / log((double)m);
+    hnsw->rng = seed ? seed : 0x9e3779b97f4a7c15ULL;
+    hnsw->max_level = -1;
+    pthread_mutex_init(&hnsw->pool_mutex, NULL);
+    pthread_mutex_init(&hnsw->entry_mutex, NULL);
+    for (size_t i = 0; i < VECTOR_HNSW_LINK_LOCKS; i++) {
+        pthread_mutex_init(&hnsw->link_locks[i], NULL);
+    }
+    return hnsw;
+}
+
+void vector_hnsw_free(VectorHNSW *hnsw) {
+    if (!hnsw) {
+        return;
+    }
+
+    for (size_t i = 0; i < hnsw->num_nodes; i++) {
+        free(hnsw->upper[i]);
+    }
+    while (hnsw->visited_pool) {
+        VectorVisited *next = hnsw->visited_pool->next;
+        free(hnsw->visited_pool->marks);
+        free(hnsw->visited_pool);
+        hnsw->visited_pool = next;
+    }
+    pthread_mutex_destroy(&hnsw->pool_mutex);
+    pthread_mutex_destroy(&hnsw->entry_mutex);
+    for (size_t i = 0; i < VECTOR_HNSW_LINK_LOCKS; i++) {
+        pthread_mutex_destroy(&hnsw->link_locks[i]);
+    }
+    free(hnsw->link_locks);
+    free(hnsw->levels);
+    free(hnsw->upper);
+    free(hnsw->level0);
+    free(hnsw);
+}
+
+/* Bytes held by the graph, visited sets excluded */
+size_t vector_hnsw_memory_usage(const VectorHNSW *hnsw) {
+    size_t bytes = sizeof(VectorHNSW) + VECTOR_HNSW_LINK_LOCKS * sizeof(pthread_mutex_t) +
+                   hnsw->capacity * (1 + sizeof(uint32_t *) + (1 + hnsw->m0) * sizeof(uint32_t));
+    for (size_t i = 0; i < hnsw->num_nodes; i++) {
+        bytes += (size_t)hnsw->levels[i] * (1 + hnsw->m) * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+/* Layer of a new node, floor(-ln(U) / ln(m)) capped at VECTOR_HNSW_MAX_LEVEL */
+static int vector_hnsw_random_level(VectorHNSW *hnsw) {
+    hnsw->rng ^= hnsw->rng << 13;
+    hnsw->rng ^= hnsw->rng >> 7;
+    hnsw->rng ^= hnsw->rng << 17;
+    double uniform = ((double)(hnsw->rng >> 11) + 0.5) / (double)(1ULL << 53);
+    int level = (int)(-log(uniform) * hnsw->level_mult);
+    return level > VECTOR_HNSW_MAX_LEVEL ? VECTOR_HNSW_MAX_LEVEL : level;
+}
+
+/* Searches */
+
+/*
+ * Query of a search: the vector, its norm and the table it is compared
+ * against, through the codes of the table when given. Nodes outside the
+ * filter bitmap are traversed but never returned.
+ */
+typedef struct VectorQuery {
+    const VectorTable *table;
+    const float *vector;
+    float norm;
+    const VectorCodes *codes;
+    const uint8_t *bits;            /* binary code of vector */
+    const uint64_t *filter;
+} VectorQuery;
+
+static inline float vector_query_distance(const VectorQuery *query, uint32_t id) {
+    const VectorTable *table = query->table;
+    if (query->codes) {
+        return vector_codes_distance(query->codes, table->metric, id, table->norms[id], query->vector, query->norm,
+                                     query->bits);
+    }
+    return vector_distance(table->metric, vector_at(table, id), table->norms[id], query->vector, query->norm,
+                           table->vector_dimension);
+}
+
+/* Move entry greedily towards query on level until no neighbor is closer */
+static VectorCandidate vector_hnsw_greedy(const VectorHNSW *hnsw, const VectorQuery *query, VectorCandidate entry, int level) {
+    bool improved = true;
+
+    while (improved) {
+        improved = false;
+        const uint32_t *links = vector_hnsw_links(hnsw, entry.id, level);
+        uint32_t count = vector_hnsw_link_count(links);
+        for (uint32_t i = 1; i <= count; i++) {
+            uint32_t neighbor = vector_hnsw_link_at(links, i);
+            float distance = vector_query_distance(query, neighbor);
+            if (distance < entry.distance) {
+                entry.distance = distance;
+                entry.id = neighbor;
+                improved = true;
+            }
+        }
+    }
+    return entry;
+}
+
+/*
+ * Beam search of width ef on level from the candidates in results, which
+ * receives the ef closest nodes found as a max-heap.
+ */
+static int vector_hnsw_search_layer(const VectorHNSW *hnsw, const VectorQuery *query, VectorVisited *visited, int level, size_t ef, VectorHeap *results) {
+    VectorHeap candidates = {NULL, 0, 0, false};
+    int status = EPIPHANYDB_SUCCESS;
+
+    for (size_t i = 0; i < results->size && status == EPIPHANYDB_SUCCESS; i++) {
+        vector_visited_test(visited, results->items[i].id);
+        status = vector_heap_push(&candidates, results->items[i]);
+    }
+    if (query->filter) {
+        results->size = 0;
+        for (size_t i = 0; i < candidates.size && status == EPIPHANYDB_SUCCESS; i++) {
+            if (vector_filter_test(query->filter, candidates.items[i].id)) {
+                status = vector_heap_push(results, candidates.items[i]);
+            }
+        }
+    }
+
+    while (candidates.size > 0 && status == EPIPHANYDB_SUCCESS) {
+        VectorCandidate current = vector_heap_pop(&candidates);
+        if (results->size >= ef && current.distance > results->items[0].distance) {
+            break;
+        }
+
+        const uint32_t *links = vector_hnsw_links(hnsw, current.id, level);
+        uint32_t count = vector_hnsw_link_count(links);
+        for (uint32_t i = 1; i <= count; i++) {
+            __builtin_prefetch(vector_at(query->table, vector_hnsw_link_at(links, i)));
+        }
+        for (uint32_t i = 1; i <= count && status == EPIPHANYDB_SUCCESS; i++) {
+            uint32_t neighbor = vector_hnsw_link_at(links, i);
+            if (vector_visited_test(visited, neighbor)) {
+                continue;
+            }
+
+            VectorCandidate candidate = {vector_query_distance(query, neighbor), neighbor};
+            if (results->size < ef || candidate.distance < results->items[0].distance) {
+                status = vector_heap_push(&candidates, candidate);
+                if (status == EPIPHANYDB_SUCCESS && vector_filter_test(query->filter, neighbor)) {
+                    status = vector_heap_push(results, candidate);
+                }
+                if (results->size > ef) {
+                    vector_heap_pop(results);
+                }
+            }
+        }
+    }
+
+    vector_heap_free(&candidates);
+    return status;
+}
+
+/*
+ * Pick at most max_links of candidates, closest first, skipping those closer
+ * to an already picked neighbor than to the base node so that links spread
+ * in different directions. Candidates are consumed.
+ */
+static size_t vector_hnsw_select(const VectorTable *table, VectorHeap *candidates, size_t max_links, uint32_t *selected) {
+    VectorCandidate *sorted = candidates->items;
+    size_t count = candidates->size;
+    size_t num_selected = 0;
+
+    /* Popping the max-heap leaves its items sorted by increasing distance */
+    while (candidates->size > 0) {
+        VectorCandidate farthest = vector_heap_pop(candidates);
+        sorted[candidates->size] = farthest;
+    }
+
+    for (size_t i = 0; i < count && num_selected < max_links; i++) {
+        VectorQuery query = {table, vector_at(table, sorted[i].id), table->norms[sorted[i].id], NULL, NULL, NULL};
+        bool diverse = true;
+        for (size_t j = 0; j < num_selected && diverse; j++) {
+            diverse = vector_query_distance(&query, selected[j]) >= sorted[i].distance;
+        }
+        if (diverse) {
+            selected[num_selected++] = sorted[i].id;
+        }
+    }
+    return num_selected;
+}
+
+/* Add a link from node to neighbor on level, pruning the neighbors of node once full */
+static int vector_hnsw_link(VectorHNSW *hnsw, const VectorTable *table, uint32_t node, uint32_t neighbor, int level) {
+    uint32_t *links = vector_hnsw_links(hnsw, node, level);
+    size_t max_links = level == 0 ? hnsw->m0 : hnsw->m;
+    pthread_mutex_t *lock = vector_hnsw_link_lock(hnsw, node);
+
+    pthread_mutex_lock(lock);
+    if (links[0] < max_links) {
+        __atomic_store_n(&links[links[0] + 1], neighbor, __ATOMIC_RELAXED);
+        __atomic_store_n(&links[0], links[0] + 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(lock);
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    VectorQuery query = {table, vector_at(table, node), table->norms[node], NULL, NULL, NULL};
+    VectorHeap candidates = {NULL, 0, 0, true};
+    VectorCandidate added = {vector_query_distance(&query, neighbor), neighbor};
+    uint32_t *selected = malloc(max_links * sizeof(uint32_t));
+    int status = selected ? vector_heap_push(&candidates, added) : EPIPHANYDB_ERROR_MEMORY;
+    for (uint32_t i = 1; i <= links[0] && status == EPIPHANYDB_SUCCESS; i++) {
+        VectorCandidate existing = {vector_query_distance(&query, links[i]), links[i]};
+        status = vector_heap_push(&candidates, existing);
+    }
+    if (status == EPIPHANYDB_SUCCESS) {
+        size_t count = vector_hnsw_select(table, &candidates, max_links, selected);
+        vector_hnsw_store_links(links, selected, (uint32_t)count);
+    }
+    pthread_mutex_unlock(lock);
+
+    free(selected);
+    vector_heap_free(&candidates);
+    return status;
+}
+
+/*
+ * Add vector id of table, which must be the next node, to the graph with
+ * no links yet, write lock held. Searches cannot reach it before
+ * vector_hnsw_connect links it.
+ */
+int vector_hnsw_add_node(VectorHNSW *hnsw, uint32_t id) {
+    if (id != hnsw->num_nodes) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int status = vector_hnsw_reserve(hnsw, (size_t)id + 1);
+    if (status != EPIPHANYDB_SUCCESS) {
+        return status;
+    }
+
+    int level = vector_hnsw_random_level(hnsw);
+    hnsw->upper[id] = NULL;
+    if (level > 0) {
+        hnsw->upper[id] = calloc((size_t)level * (1 + hnsw->m), sizeof(uint32_t));
+        if (!hnsw->upper[id]) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+    hnsw->levels[id] = (uint8_t)level;
+    vector_hnsw_links(hnsw, id, 0)[0] = 0;
+    hnsw->num_nodes++;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Link node id into the graph, read lock held. Connects of different
+ * nodes run concurrently with each other and with searches; one whose
+ * node rises above the entry point holds entry_mutex until the node is
+ * linked and published as the new entry point. Deleted vectors are
+ * crossed but never picked as neighbors.
+ */
+int vector_hnsw_connect(VectorHNSW *hnsw, const VectorTable *table, uint32_t id) {
+    int level = hnsw->levels[id];
+    uint32_t entry_id;
+    int top;
+
+    pthread_mutex_lock(&hnsw->entry_mutex);
+    if (!vector_hnsw_entry(hnsw, &entry_id, &top)) {
+        vector_hnsw_publish_entry(hnsw, id, level);
+        pthread_mutex_unlock(&hnsw->entry_mutex);
+        return EPIPHANYDB_SUCCESS;
+    }
+    bool raising = level > top;
+    if (!raising) {
+        pthread_mutex_unlock(&hnsw->entry_mutex);
+    }
+
+    VectorQuery query = {table, vector_at(table, id), table->norms[id], NULL, NULL, vector_live_filter(table)};
+    VectorCandidate entry = {vector_query_distance(&query, entry_id), entry_id};
+    for (int l = top; l > level; l--) {
+        entry = vector_hnsw_greedy(hnsw, &query, entry, l);
+    }
+
+    VectorVisited *visited = vector_visited_acquire(hnsw);
+    uint32_t *selected = malloc(hnsw->m * sizeof(uint32_t));
+    VectorHeap results = {NULL, 0, 0, true};
+    int status = visited && selected ? vector_heap_push(&results, entry) : EPIPHANYDB_ERROR_MEMORY;
+    if (visited) {
+        vector_visited_test(visited, id);
+    }
+
+    for (int l = level < top ? level : top; l >= 0 && status == EPIPHANYDB_SUCCESS; l--) {
+        status = vector_hnsw_search_layer(hnsw, &query, visited, l, hnsw->ef_construction, &results);
+        if (status != EPIPHANYDB_SUCCESS) {
+            break;
+        }
+        if (results.size == 0) {
+            /* Every node reached on this layer is deleted */
+            status = vector_heap_push(&results, entry);
+            continue;
+        }
+
+        /* The closest node found seeds the next layer down */
+        VectorCandidate closest = results.items[0];
+        for (size_t i = 1; i < results.size; i++) {
+            if (results.items[i].distance < closest.distance) {
+                closest = results.items[i];
+            }
+        }
+
+        /* Concurrent inserts may already have linked to the node, those the search missed are candidates too */
+        pthread_mutex_t *lock = vector_hnsw_link_lock(hnsw, id);
+        pthread_mutex_lock(lock);
+        uint32_t *links = vector_hnsw_links(hnsw, id, l);
+        for (uint32_t i = 1; i <= links[0] && status == EPIPHANYDB_SUCCESS; i++) {
+            if (!vector_visited_test(visited, links[i])) {
+                VectorCandidate linked = {vector_query_distance(&query, links[i]), links[i]};
+                status = vector_heap_push(&results, linked);
+            }
+        }
+        uint32_t count = 0;
+        if (status == EPIPHANYDB_SUCCESS) {
+            count = (uint32_t)vector_hnsw_select(table, &results, hnsw->m, selected);
+            vector_hnsw_store_links(links, selected, count);
+        }
+        pthread_mutex_unlock(lock);
+
+        for (uint32_t i = 0; i < count && status == EPIPHANYDB_SUCCESS; i++) {
+            status = vector_hnsw_link(hnsw, table, selected[i], id, l);
+        }
+
+        results.size = 0;
+        entry = closest;
+        if (status == EPIPHANYDB_SUCCESS) {
+            status = vector_heap_push(&results, closest);
+        }
+    }
+    vector_heap_free(&results);
+    free(selected);
+    if (visited) {
+        vector_visited_release(hnsw, visited);
+    }
+
+    if (raising) {
+        if (status == EPIPHANYDB_SUCCESS) {
+            vector_hnsw_publish_entry(hnsw, id, level);
+        }
+        pthread_mutex_unlock(&hnsw->entry_mutex);
+    }
+    return status;
+}
+
+/* Add vector id of table, which must be the next node, and link it */
+int vector_hnsw_insert(VectorHNSW *hnsw, const VectorTable *table, uint32_t id) {
+    int status = vector_hnsw_add_node(hnsw, id);
+    return status == EPIPHANYDB_SUCCESS ? vector_hnsw_connect(hnsw, table, id) : status;
+}
+
+/* Bulk builds */
+
+typedef struct VectorHNSWBuild {
+    VectorHNSW *hnsw;
+    const VectorTable *table;
+    const uint64_t *live;           /* nodes to link, NULL for all */
+    size_t next;                    /* first node not yet claimed */
+    bool stop;                      /* set when a worker fails */
+} VectorHNSWBuild;
+
+typedef struct VectorHNSWBuilder {
+    pthread_t thread;
+    VectorHNSWBuild *build;
+    int result;
+} VectorHNSWBuilder;
+
+static void *vector_hnsw_build_worker(void *arg) {
+    VectorHNSWBuilder *builder = arg;
+    VectorHNSWBuild *build = builder->build;
+    size_t num_nodes = build->hnsw->num_nodes;
+
+    builder->result = EPIPHANYDB_SUCCESS;
+    while (!__atomic_load_n(&build->stop, __ATOMIC_RELAXED)) {
+        size_t first = __atomic_fetch_add(&build->next, VECTOR_HNSW_BUILD_CHUNK, __ATOMIC_RELAXED);
+        size_t last = first + VECTOR_HNSW_BUILD_CHUNK < num_nodes ? first + VECTOR_HNSW_BUILD_CHUNK : num_nodes;
+        for (size_t id = first; id < last && builder->result == EPIPHANYDB_SUCCESS; id++) {
+            if (vector_filter_test(build->live, id)) {
+                builder->result = vector_hnsw_connect(build->hnsw, build->table, (uint32_t)id);
+            }
+        }
+        if (builder->result != EPIPHANYDB_SUCCESS) {
+            __atomic_store_n(&build->stop, true, __ATOMIC_RELAXED);
+        }
+        if (last == num_nodes) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Add the vectors of table below limit missing from the graph and link
+ * those in live, NULL for all, from num_threads threads, 0 for one per
+ * allowed CPU. Each thread claims VECTOR_HNSW_BUILD_CHUNK nodes at a time
+ * in id order. The write lock must be held unless the graph is private to
+ * the caller, which may then build it in slices under the read lock.
+ */
+int vector_hnsw_build(VectorHNSW *hnsw, const VectorTable *table, const uint64_t *live, size_t limit, size_t num_threads) {
+    size_t first = hnsw->num_nodes;
+    for (size_t id = first; id < limit; id++) {
+        int status = vector_hnsw_add_node(hnsw, (uint32_t)id);
+        if (status != EPIPHANYDB_SUCCESS) {
+            return status;
+        }
+    }
+
+    if (num_threads == 0) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        num_threads = sched_getaffinity(0, sizeof(allowed), &allowed) == 0 ? (size_t)CPU_COUNT(&allowed) : 1;
+    }
+    size_t chunks = (hnsw->num_nodes - first + VECTOR_HNSW_BUILD_CHUNK - 1) / VECTOR_HNSW_BUILD_CHUNK;
+    if (num_threads > chunks) {
+        num_threads = chunks;
+    }
+    if (num_threads > VECTOR_HNSW_MAX_BUILD_THREADS) {
+        num_threads = VECTOR_HNSW_MAX_BUILD_THREADS;
+    }
+    if (num_threads == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    VectorHNSWBuild build = {hnsw, table, live, first, false};
+    VectorHNSWBuilder builders[VECTOR_HNSW_MAX_BUILD_THREADS];
+    size_t started = 1;
+    for (size_t i = 0; i < num_threads; i++) {
+        builders[i].build = &build;
+        builders[i].result = EPIPHANYDB_SUCCESS;
+    }
+
+    /* Threads that fail to start leave their share to the others */
+    for (size_t i = 1; i < num_threads; i++) {
+        if (pthread_create(&builders[started].thread, NULL, vector_hnsw_build_worker, &builders[started]) == 0) {
+            started++;
+        }
+    }
+    vector_hnsw_build_worker(&builders[0]);
+
+    int result = builders[0].result;
+    for (size_t i = 1; i < started; i++) {
+        pthread_join(builders[i].thread, NULL);
+        if (result == EPIPHANYDB_SUCCESS) {
+            result = builders[i].result;
+        }
+    }
+    return result;
+}
+
+/* Repairs */
+
+/* Push node to candidates with its distance to query unless already visited */
+static int vector_hnsw_offer(const VectorQuery *query, VectorVisited *visited, uint32_t node, VectorHeap *candidates) {
+    if (vector_visited_test(visited, node)) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    VectorCandidate candidate = {vector_query_distance(query, node), node};
+    return vector_heap_push(candidates, candidate);
+}
+
+/*
+ * Replace the deleted neighbors of node on level: its live neighbors and
+ * the live neighbors of the deleted ones become candidates, picked again
+ * by the diversity heuristic.
+ */
+static int vector_hnsw_repair_links(VectorHNSW *hnsw, const VectorTable *table, const uint64_t *live, uint32_t node, int level, VectorHeap *candidates, uint32_t *selected) {
+    uint32_t *links = vector_hnsw_links(hnsw, node, level);
+    size_t max_links = level == 0 ? hnsw->m0 : hnsw->m;
+    pthread_mutex_t *lock = vector_hnsw_link_lock(hnsw, node);
+
+    pthread_mutex_lock(lock);
+    bool stale = false;
+    for (uint32_t i = 1; i <= links[0] && !stale; i++) {
+        stale = !vector_filter_test(live, links[i]);
+    }
+    if (!stale) {
+        pthread_mutex_unlock(lock);
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    VectorVisited *visited = vector_visited_acquire(hnsw);
+    if (!visited) {
+        pthread_mutex_unlock(lock);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    vector_visited_test(visited, node);
+
+    VectorQuery query = {table, vector_at(table, node), table->norms[node], NULL, NULL, NULL};
+    int status = EPIPHANYDB_SUCCESS;
+    candidates->size = 0;
+    for (uint32_t i = 1; i <= links[0] && status == EPIPHANYDB_SUCCESS; i++) {
+        if (vector_filter_test(live, links[i])) {
+            status = vector_hnsw_offer(&query, visited, links[i], candidates);
+            continue;
+        }
+        const uint32_t *hops = vector_hnsw_links(hnsw, links[i], level);
+        uint32_t count = vector_hnsw_link_count(hops);
+        for (uint32_t j = 1; j <= count && status == EPIPHANYDB_SUCCESS; j++) {
+            uint32_t hop = vector_hnsw_link_at(hops, j);
+            if (vector_filter_test(live, hop)) {
+                status = vector_hnsw_offer(&query, visited, hop, candidates);
+            }
+        }
+    }
+    if (status == EPIPHANYDB_SUCCESS) {
+        size_t count = vector_hnsw_select(table, candidates, max_links, selected);
+        vector_hnsw_store_links(links, selected, (uint32_t)count);
+    }
+    pthread_mutex_unlock(lock);
+
+    vector_visited_release(hnsw, visited);
+    return status;
+}
+
+/* Move a deleted entry point to the highest live node already linked, entry_mutex held */
+static void vector_hnsw_move_entry(VectorHNSW *hnsw, const uint64_t *live) {
+    uint32_t entry_id;
+    int top;
+    if (!vector_hnsw_entry(hnsw, &entry_id, &top) || vector_filter_test(live, entry_id)) {
+        return;
+    }
+
+    uint32_t best = entry_id;
+    int best_level = -1;
+    for (size_t id = 0; id < hnsw->num_nodes; id++) {
+        if (hnsw->levels[id] > best_level && vector_filter_test(live, id) &&
+            vector_hnsw_link_count(vector_hnsw_links(hnsw, (uint32_t)id, 0)) > 0) {
+            best = (uint32_t)id;
+            best_level = hnsw->levels[id];
+        }
+    }
+    if (best_level >= 0) {
+        vector_hnsw_publish_entry(hnsw, best, best_level);
+    }
+}
+
+/*
+ * Reconnect the live nodes of [first, last) that link to deleted ones,
+ * read lock held, next to searches and inserts, then move the entry point
+ * off a deleted node. Deleted nodes keep their own links, so searches
+ * already on them still find their way out.
+ */
+int vector_hnsw_repair(VectorHNSW *hnsw, const VectorTable *table, size_t first, size_t last) {
+    const uint64_t *live = vector_live_filter(table);
+    if (!live) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (last > hnsw->num_nodes) {
+        last = hnsw->num_nodes;
+    }
+
+    VectorHeap candidates = {NULL, 0, 0, true};
+    uint32_t *selected = malloc(hnsw->m0 * sizeof(uint32_t));
+    int status = selected ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    for (size_t id = first; id < last && status == EPIPHANYDB_SUCCESS; id++) {
+        if (!vector_filter_test(live, id)) {
+            continue;
+        }
+        for (int l = hnsw->levels[id]; l >= 0 && status == EPIPHANYDB_SUCCESS; l--) {
+            status = vector_hnsw_repair_links(hnsw, table, live, (uint32_t)id, l, &candidates, selected);
+        }
+    }
+    vector_heap_free(&candidates);
+    free(selected);
+
+    if (status == EPIPHANYDB_SUCCESS) {
+        pthread_mutex_lock(&hnsw->entry_mutex);
+        vector_hnsw_move_entry(hnsw, live);
+        pthread_mutex_unlock(&hnsw->entry_mutex);
+    }
+    return status;
+}
+
+/*
+ * k nearest neighbors of query found with a beam of width max(ef, k),
+ * written to results by increasing distance. The graph is built from the
+ * floats but traversed through the codes of quantized tables. With a
+ * filter the search crosses every node but returns only matching ones.
+ */
+int vector_hnsw_search(VectorHNSW *hnsw, const VectorTable *table, const float *query_vector, size_t k, size_t ef, const uint64_t *filter, VectorSearchResult *results, size_t *num_results) {
+    uint32_t entry_id;
+    int top;
+    *num_results = 0;
+    if (!vector_hnsw_entry(hnsw, &entry_id, &top) || k == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (ef < k) {
+        ef = k;
+    }
+
+    VectorQuery query = {table, query_vector, vector_norm(query_vector, table->vector_dimension), NULL, NULL, filter};
+    uint8_t *bits = NULL;
+    if (table->codes && table->codes->trained) {
+        bits = malloc(table->codes->code_size);
+        if (!bits) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        vector_codes_encode_query(table->codes, query_vector, bits);
+        query.codes = table->codes;
+        query.bits = bits;
+    }
+
+    VectorCandidate entry = {vector_query_distance(&query, entry_id), entry_id};
+    for (int l = top; l > 0; l--) {
+        entry = vector_hnsw_greedy(hnsw, &query, entry, l);
+    }
+
+    VectorVisited *visited = vector_visited_acquire(hnsw);
+    if (!visited) {
+        free(bits);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    VectorHeap nearest = {NULL, 0, 0, true};
+    int status = vector_heap_push(&nearest, entry);
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = vector_hnsw_search_layer(hnsw, &query, visited, 0, ef, &nearest);
+    }
+    vector_visited_release(hnsw, visited);
+
+    while (status == EPIPHANYDB_SUCCESS && nearest.size > k) {
+        vector_heap_pop(&nearest);
+    }
+    if (status == EPIPHANYDB_SUCCESS) {
+        size_t count = nearest.size;
+        while (nearest.size > 0) {
+            VectorCandidate farthest = vector_heap_pop(&nearest);
+            results[nearest.size].id = farthest.id;
+            results[nearest.size].distance = farthest.distance;
+        }
+        *num_results = count;
+    }
+    vector_heap_free(&nearest);
+    free(bits);
+    return status;
+}
+
+/*
+ * One search of a batch on layer 0, advanced a phase at a time: pop the
+ * next candidate and prefetch its links, read the links and prefetch the
+ * unvisited neighbors, then compare them. Stepping through the searches
+ * of a group in turn gives each prefetch the others' work to land behind.
+ */
+typedef enum VectorBatchPhase {
+    VECTOR_BATCH_POP,
+    VECTOR_BATCH_LINKS,
+    VECTOR_BATCH_DISTANCES,
+    VECTOR_BATCH_DONE
+} VectorBatchPhase;
+
+typedef struct VectorBatchSearch {
+    VectorQuery query;
+    size_t index;                   /* of the query in the batch */
+    VectorVisited *visited;
+    VectorHeap candidates;
+    VectorHeap nearest;
+    const uint32_t *links;
+    uint32_t *pending;              /* neighbors to compare, m0 slots */
+    size_t num_pending;
+    VectorBatchPhase phase;
+} VectorBatchSearch;
+
+static inline void vector_query_prefetch(const VectorQuery *query, uint32_t id) {
+    if (query->codes) {
+        __builtin_prefetch(query->codes->data + (size_t)id * query->codes->code_size);
+    } else {
+        __builtin_prefetch(vector_at(query->table, id));
+    }
+}
+
+/* Descend the upper layers for search->query and seed its layer 0 search; done at once on an empty graph */
+static int vector_batch_start(VectorHNSW *hnsw, VectorBatchSearch *search) {
+    VectorQuery *query = &search->query;
+    uint32_t entry_id;
+    int top;
+    if (!vector_hnsw_entry(hnsw, &entry_id, &top)) {
+        search->phase = VECTOR_BATCH_DONE;
+        return EPIPHANYDB_SUCCESS;
+    }
+    VectorCandidate entry = {vector_query_distance(query, entry_id), entry_id};
+    for (int l = top; l > 0; l--) {
+        entry = vector_hnsw_greedy(hnsw, query, entry, l);
+    }
+
+    search->visited = vector_visited_acquire(hnsw);
+    if (!search->visited) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    vector_visited_test(search->visited, entry.id);
+    search->candidates.size = 0;
+    search->nearest.size = 0;
+    search->phase = VECTOR_BATCH_POP;
+    int status = vector_heap_push(&search->candidates, entry);
+    if (status == EPIPHANYDB_SUCCESS && vector_filter_test(query->filter, entry.id)) {
+        status = vector_heap_push(&search->nearest, entry);
+    }
+    return status;
+}
+
+static int vector_batch_step(const VectorHNSW *hnsw, VectorBatchSearch *search, size_t ef) {
+    int status = EPIPHANYDB_SUCCESS;
+
+    switch (search->phase) {
+        case VECTOR_BATCH_POP: {
+            if (search->candidates.size == 0) {
+                search->phase = VECTOR_BATCH_DONE;
+                break;
+            }
+            VectorCandidate current = vector_heap_pop(&search->candidates);
+            if (search->nearest.size >= ef && current.distance > search->nearest.items[0].distance) {
+                search->phase = VECTOR_BATCH_DONE;
+                break;
+            }
+            search->links = vector_hnsw_links(hnsw, current.id, 0);
+            __builtin_prefetch(search->links);
+            search->phase = VECTOR_BATCH_LINKS;
+            break;
+        }
+        case VECTOR_BATCH_LINKS:
+            search->num_pending = 0;
+            for (uint32_t i = 1, count = vector_hnsw_link_count(search->links); i <= count; i++) {
+                uint32_t neighbor = vector_hnsw_link_at(search->links, i);
+                if (!vector_visited_test(search->visited, neighbor)) {
+                    search->pending[search->num_pending++] = neighbor;
+                    vector_query_prefetch(&search->query, neighbor);
+                }
+            }
+            search->phase = VECTOR_BATCH_DISTANCES;
+            break;
+        case VECTOR_BATCH_DISTANCES:
+            for (size_t i = 0; i < search->num_pending && status == EPIPHANYDB_SUCCESS; i++) {
+                VectorCandidate candidate = {vector_query_distance(&search->query, search->pending[i]), search->pending[i]};
+                if (search->nearest.size < ef || candidate.distance < search->nearest.items[0].distance) {
+                    status = vector_heap_push(&search->candidates, candidate);
+                    if (status == EPIPHANYDB_SUCCESS && vector_filter_test(search->query.filter, candidate.id)) {
+                        status = vector_heap_push(&search->nearest, candidate);
+                    }
+                    if (search->nearest.size > ef) {
+                        vector_heap_pop(&search->nearest);
+                    }
+                }
+            }
+            search->phase = VECTOR_BATCH_POP;
+            break;
+        case VECTOR_BATCH_DONE:
+            break;
+    }
+    return status;
+}
+
+/* Write the k nearest of a finished search to its row of results */
+static void vector_batch_finish(VectorHNSW *hnsw, VectorBatchSearch *search, size_t k, VectorSearchResult *results, size_t *num_results) {
+    VectorSearchResult *row = results + search->index * k;
+
+    vector_visited_release(hnsw, search->visited);
+    search->visited = NULL;
+    while (search->nearest.size > k) {
+        vector_heap_pop(&search->nearest);
+    }
+    num_results[search->index] = search->nearest.size;
+    while (search->nearest.size > 0) {
+        VectorCandidate farthest = vector_heap_pop(&search->nearest);
+        row[search->nearest.size].id = farthest.id;
+        row[search->nearest.size].distance = farthest.distance;
+    }
+}
+
+/*
+ * vector_hnsw_search for num_queries queries of dimension floats each,
+ * VECTOR_HNSW_BATCH_GROUP of them interleaved at a time. Query q writes
+ * its row results + q * k and its count to num_results[q].
+ */
+int vector_hnsw_search_batch(VectorHNSW *hnsw, const VectorTable *table, const float *queries, size_t num_queries, size_t k, size_t ef, const uint64_t *filter, VectorSearchResult *results, size_t *num_results) {
+    size_t dim = table->vector_dimension;
+    uint32_t entry_id;
+    int top;
+    memset(num_results, 0, num_queries * sizeof(size_t));
+    if (!vector_hnsw_entry(hnsw, &entry_id, &top) || k == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (ef < k) {
+        ef = k;
+    }
+
+    const VectorCodes *codes = table->codes && table->codes->trained ? table->codes : NULL;
+    size_t group = num_queries < VECTOR_HNSW_BATCH_GROUP ? num_queries : VECTOR_HNSW_BATCH_GROUP;
+    VectorBatchSearch searches[VECTOR_HNSW_BATCH_GROUP];
+    uint32_t *pending = malloc(group * hnsw->m0 * sizeof(uint32_t));
+    uint8_t *bits = codes ? malloc(group * codes->code_size) : NULL;
+    int status = pending && (!codes || bits) ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+
+    size_t next = 0;
+    size_t active = 0;
+    memset(searches, 0, sizeof(searches));
+    for (size_t s = 0; s < group; s++) {
+        searches[s].candidates.max_heap = false;
+        searches[s].nearest.max_heap = true;
+        searches[s].pending = pending ? pending + s * hnsw->m0 : NULL;
+        searches[s].phase = VECTOR_BATCH_DONE;
+    }
+
+    /* A slot whose search finishes takes the next query of the batch */
+    while (status == EPIPHANYDB_SUCCESS && (active > 0 || next < num_queries)) {
+        for (size_t s = 0; s < group && status == EPIPHANYDB_SUCCESS; s++) {
+            VectorBatchSearch *search = &searches[s];
+            if (search->phase == VECTOR_BATCH_DONE) {
+                if (search->visited) {
+                    vector_batch_finish(hnsw, search, k, results, num_results);
+                    active--;
+                }
+                if (next == num_queries) {
+                    continue;
+                }
+
+                const float *vector = queries + next * dim;
+                VectorQuery query = {table, vector, vector_norm(vector, dim), NULL, NULL, filter};
+                if (codes) {
+                    query.codes = codes;
+                    query.bits = bits + s * codes->code_size;
+                    vector_codes_encode_query(codes, vector, bits + s * codes->code_size);
+                }
+                search->query = query;
+                search->index = next++;
+                status = vector_batch_start(hnsw, search);
+                if (search->visited) {
+                    active++;
+                }
+                continue;
+            }
+            status = vector_batch_step(hnsw, search, ef);
+        }
+    }
+
+    for (size_t s = 0; s < group; s++) {
+        if (searches[s].visited) {
+            vector_visited_release(hnsw, searches[s].visited);
+        }
+        vector_heap_free(&searches[s].candidates);
+        vector_heap_free(&searches[s].nearest);
+    }
+    free(pending);
+    free(bits);
+    return status;
+}
@@ -0,0 +1,567 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * IVF-PQ index. k-means centroids trained on a sample split the vectors
+ * into inverted lists; each vector is stored as 4-bit product quantization
+ * codes of its residual to its list centroid. A query probes the lists of
+ * its nprobe nearest centroids, building for each a table of its distances
+ * to every subspace centroid, quantized to bytes so that a whole block of
+ * codes is scored with in-register shuffles (fast scan). The best
+ * candidates can be re-ranked with exact distances.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define VECTOR_HAVE_X86_KERNELS 1
+#endif
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+/* Fast-scan kernels: 16-bit sums of the table entries the codes of a block select */
+
+typedef void (*VectorPQScanFn)(const uint8_t *codes, const uint8_t *lut, size_t code_m, uint16_t *scores);
+
+static void vector_pq_scan_scalar(const uint8_t *codes, const uint8_t *lut, size_t code_m, uint16_t *scores) {
+    memset(scores, 0, VECTOR_PQ_BLOCK * sizeof(uint16_t));
+    for (size_t j = 0; j < code_m; j++) {
+        const uint8_t *block = codes + j * 16;
+        const uint8_t *table = lut + j * 16;
+        for (size_t b = 0; b < 16; b++) {
+            scores[b] += table[block[b] & 0x0f];
+            scores[b + 16] += table[block[b] >> 4];
+        }
+    }
+}
+
+#ifdef VECTOR_HAVE_X86_KERNELS
+
+__attribute__((target("ssse3")))
+static void vector_pq_scan_ssse3(const uint8_t *codes, const uint8_t *lut, size_t code_m, uint16_t *scores) {
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums[4] = {zero, zero, zero, zero};
+
+    for (size_t j = 0; j < code_m; j++) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(codes + j * 16));
+        __m128i table = _mm_loadu_si128((const __m128i *)(lut + j * 16));
+        __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(block, mask));
+        __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(block, 4), mask));
+        sums[0] = _mm_add_epi16(sums[0], _mm_unpacklo_epi8(low, zero));
+        sums[1] = _mm_add_epi16(sums[1], _mm_unpackhi_epi8(low, zero));
+        sums[2] = _mm_add_epi16(sums[2], _mm_unpacklo_epi8(high, zero));
+        sums[3] = _mm_add_epi16(sums[3], _mm_unpackhi_epi8(high, zero));
+    }
+    for (size_t i = 0; i < 4; i++) {
+        _mm_storeu_si128((__m128i *)(scores + i * 8), sums[i]);
+    }
+}
+
+/* Two subspaces per register, one per lane, folded together at the end */
+__attribute__((target("avx2")))
+static void vector_pq_scan_avx2(const uint8_t *codes, const uint8_t *lut, size_t code_m, uint16_t *scores) {
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sums[4] = {zero, zero, zero, zero};
+
+    for (size_t j = 0; j < code_m; j += 2) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(codes + j * 16));
+        __m256i table = _mm256_loadu_si256((const __m256i *)(lut + j * 16));
+        __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(block, mask));
+        __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(block, 4), mask));
+        sums[0] = _mm256_add_epi16(sums[0], _mm256_unpacklo_epi8(low, zero));
+        sums[1] = _mm256_add_epi16(sums[1], _mm256_unpackhi_epi8(low, zero));
+        sums[2] = _mm256_add_epi16(sums[2], _mm256_unpacklo_epi8(high, zero));
+        sums[3] = _mm256_add_epi16(sums[3], _mm256_unpackhi_epi8(high, zero));
+    }
+    for (size_t i = 0; i < 4; i++) {
+        __m128i folded = _mm_add_epi16(_mm256_castsi256_si128(sums[i]), _mm256_extracti128_si256(sums[i], 1));
+        _mm_storeu_si128((__m128i *)(scores + i * 8), folded);
+    }
+}
+
+#endif /* VECTOR_HAVE_X86_KERNELS */
+
+static VectorPQScanFn vector_pq_scan_kernel = vector_pq_scan_scalar;
+
+__attribute__((constructor))
+static void vector_pq_init_kernels(void) {
+#ifdef VECTOR_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        vector_pq_scan_kernel = vector_pq_scan_avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        vector_pq_scan_kernel = vector_pq_scan_ssse3;
+    }
+#endif
+}
+
+/* Training */
+
+static uint64_t vector_ivfpq_random(uint64_t *rng) {
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 7;
+    *rng ^= *rng << 17;
+    return *rng;
+}
+
+/* Distance quantization works with: L1 for manhattan tables, squared L2 otherwise */
+static inline float vector_ivfpq_distance(VectorMetric metric, const float *a, const float *b, size_t n) {
+    return metric == VECTOR_METRIC_MANHATTAN ? vector_l1(a, b, n) : vector_l2_squared(a, b, n);
+}
+
+static size_t vector_ivfpq_nearest(VectorMetric metric, const float *centroids, size_t k, const float *x, size_t n) {
+    size_t nearest = 0;
+    float nearest_distance = INFINITY;
+
+    for (size_t c = 0; c < k; c++) {
+        float distance = vector_ivfpq_distance(metric, centroids + c * n, x, n);
+        if (distance < nearest_distance) {
+            nearest_distance = distance;
+            nearest = c;
+        }
+    }
+    return nearest;
+}
+
+/*
+ * Lloyd's k-means of n points of dim floats found stride floats apart,
+ * seeded with k distinct points (repeating them when n < k).
+ */
+static int vector_kmeans(VectorMetric metric, const float *points, size_t n, size_t dim, size_t stride, size_t k, uint64_t *rng, float *centroids) {
+    size_t *order = malloc(n * sizeof(size_t));
+    size_t *counts = malloc(k * sizeof(size_t));
+    double *sums = malloc(k * dim * sizeof(double));
+    if (!order || !counts || !sums) {
+        free(order);
+        free(counts);
+        free(sums);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    for (size_t c = 0; c < k; c++) {
+        size_t i = c % n;
+        if (c < n) {
+            size_t j = i + vector_ivfpq_random(rng) % (n - i);
+            size_t swap = order[i];
+            order[i] = order[j];
+            order[j] = swap;
+        }
+        memcpy(centroids + c * dim, points + order[i] * stride, dim * sizeof(float));
+    }
+
+    for (size_t iteration = 0; iteration < VECTOR_IVF_TRAIN_ITERATIONS; iteration++) {
+        memset(counts, 0, k * sizeof(size_t));
+        memset(sums, 0, k * dim * sizeof(double));
+        for (size_t i = 0; i < n; i++) {
+            const float *point = points + i * stride;
+            size_t c = vector_ivfpq_nearest(metric, centroids, k, point, dim);
+            counts[c]++;
+            for (size_t d = 0; d < dim; d++) {
+                sums[c * dim + d] += point[d];
+            }
+        }
+
+        for (size_t c = 0; c < k; c++) {
+            float *centroid = centroids + c * dim;
+            if (counts[c] == 0) {
+                /* Restart an empty cluster on a random point */
+                const float *point = points + (vector_ivfpq_random(rng) % n) * stride;
+                memcpy(centroid, point, dim * sizeof(float));
+                continue;
+            }
+            for (size_t d = 0; d < dim; d++) {
+                centroid[d] = (float)(sums[c * dim + d] / (double)counts[c]);
+            }
+        }
+    }
+
+    free(order);
+    free(counts);
+    free(sums);
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Copy of x to quantize: normalized for cosine tables */
+static void vector_ivfpq_prepare(const VectorIVFPQ *ivfpq, const float *x, float *out) {
+    memcpy(out, x, ivfpq->dimension * sizeof(float));
+    if (ivfpq->metric == VECTOR_METRIC_COSINE) {
+        float norm = vector_norm(out, ivfpq->dimension);
+        for (size_t d = 0; d < ivfpq->dimension && norm > 0.0f; d++) {
+            out[d] /= norm;
+        }
+    }
+}
+
+void vector_ivfpq_free(VectorIVFPQ *ivfpq) {
+    if (!ivfpq) {
+        return;
+    }
+
+    for (size_t l = 0; ivfpq->lists && l < ivfpq->nlist; l++) {
+        free(ivfpq->lists[l].ids);
+        free(ivfpq->lists[l].codes);
+    }
+    free(ivfpq->lists);
+    free(ivfpq->centroids);
+    free(ivfpq->codebooks);
+    free(ivfpq);
+}
+
+/*
+ * Train an empty index on a sample of the live vectors of table: nlist
+ * coarse centroids, then 16 centroids per subspace over the residuals of
+ * the sample. The sample holds num_train vectors, 0 for
+ * VECTOR_IVF_TRAIN_PER_LIST per list, at most VECTOR_IVF_MAX_TRAIN. pq_m
+ * must divide the dimension; nlist is capped by the sample.
+ */
+int vector_ivfpq_train(const VectorTable *table, size_t nlist, size_t pq_m, size_t num_train, uint64_t seed, VectorIVFPQ **ivfpq) {
+    size_t dim = table->vector_dimension;
+    size_t live = table->num_vectors - table->num_deleted;
+    if (live == 0 || nlist == 0 || pq_m == 0 || pq_m > VECTOR_PQ_MAX_SUBSPACES || dim % pq_m != 0) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    if (num_train == 0) {
+        num_train = nlist * VECTOR_IVF_TRAIN_PER_LIST;
+    }
+    if (num_train > VECTOR_IVF_MAX_TRAIN) {
+        num_train = VECTOR_IVF_MAX_TRAIN;
+    }
+    if (num_train > live) {
+        num_train = live;
+    }
+    if (nlist > num_train) {
+        nlist = num_train;
+    }
+
+    VectorIVFPQ *index = calloc(1, sizeof(VectorIVFPQ));
+    if (!index) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    index->metric = table->metric;
+    index->dimension = dim;
+    index->nlist = nlist;
+    index->pq_m = pq_m;
+    index->code_m = (pq_m + 1) & ~(size_t)1;
+    index->sub_dimension = dim / pq_m;
+    index->centroids = malloc(nlist * dim * sizeof(float));
+    index->codebooks = malloc(pq_m * VECTOR_PQ_CENTROIDS * index->sub_dimension * sizeof(float));
+    index->lists = calloc(nlist, sizeof(VectorIVFList));
+    float *sample = calloc(num_train * dim, sizeof(float));
+    if (!index->centroids || !index->codebooks || !index->lists || !sample) {
+        free(sample);
+        vector_ivfpq_free(index);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    /* Evenly spaced live vectors, the table is in insertion order */
+    const uint64_t *filter = vector_live_filter(table);
+    for (size_t id = 0, seen = 0, i = 0; id < table->num_vectors && i < num_train; id++) {
+        if (!vector_filter_test(filter, id)) {
+            continue;
+        }
+        if (seen++ == (size_t)((double)i * live / num_train)) {
+            vector_ivfpq_prepare(index, vector_at(table, id), sample + i * dim);
+            i++;
+        }
+    }
+
+    uint64_t rng = seed ? seed : 0x9e3779b97f4a7c15ULL;
+    int result = vector_kmeans(index->metric, sample, num_train, dim, dim, nlist, &rng, index->centroids);
+
+    /* Codebooks are shared by every list and trained on residuals */
+    for (size_t i = 0; i < num_train && result == EPIPHANYDB_SUCCESS; i++) {
+        float *x = sample + i * dim;
+        const float *centroid = index->centroids + vector_ivfpq_nearest(index->metric, index->centroids, nlist, x, dim) * dim;
+        for (size_t d = 0; d < dim; d++) {
+            x[d] -= centroid[d];
+        }
+    }
+    size_t codebook_size = VECTOR_PQ_CENTROIDS * index->sub_dimension;
+    for (size_t j = 0; j < pq_m && result == EPIPHANYDB_SUCCESS; j++) {
+        result = vector_kmeans(index->metric, sample + j * index->sub_dimension, num_train, index->sub_dimension, dim,
+                               VECTOR_PQ_CENTROIDS, &rng, index->codebooks + j * codebook_size);
+    }
+    free(sample);
+
+    if (result != EPIPHANYDB_SUCCESS) {
+        vector_ivfpq_free(index);
+        return result;
+    }
+    *ivfpq = index;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Encoding */
+
+static int vector_ivf_list_reserve(const VectorIVFPQ *ivfpq, VectorIVFList *list) {
+    if (list->size < list->capacity) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t capacity = list->capacity ? list->capacity * 2 : VECTOR_PQ_BLOCK;
+    size_t block_bytes = ivfpq->code_m * 16;
+    uint32_t *ids = realloc(list->ids, capacity * sizeof(uint32_t));
+    if (ids) {
+        list->ids = ids;
+    }
+    uint8_t *codes = realloc(list->codes, capacity / VECTOR_PQ_BLOCK * block_bytes);
+    if (codes) {
+        list->codes = codes;
+    }
+    if (!ids || !codes) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    memset(codes + list->capacity / VECTOR_PQ_BLOCK * block_bytes, 0, (capacity - list->capacity) / VECTOR_PQ_BLOCK * block_bytes);
+    list->capacity = capacity;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Quantize vector id of table into the list of its nearest centroid */
+int vector_ivfpq_add(VectorIVFPQ *ivfpq, const VectorTable *table, uint32_t id) {
+    size_t dim = ivfpq->dimension;
+    float *x = malloc(dim * sizeof(float));
+    if (!x) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    vector_ivfpq_prepare(ivfpq, vector_at(table, id), x);
+    size_t l = vector_ivfpq_nearest(ivfpq->metric, ivfpq->centroids, ivfpq->nlist, x, dim);
+    VectorIVFList *list = &ivfpq->lists[l];
+    int result = vector_ivf_list_reserve(ivfpq, list);
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(x);
+        return result;
+    }
+
+    const float *centroid = ivfpq->centroids + l * dim;
+    for (size_t d = 0; d < dim; d++) {
+        x[d] -= centroid[d];
+    }
+
+    size_t slot = list->size % VECTOR_PQ_BLOCK;
+    uint8_t *block = list->codes + list->size / VECTOR_PQ_BLOCK * ivfpq->code_m * 16;
+    for (size_t j = 0; j < ivfpq->pq_m; j++) {
+        const float *codebook = ivfpq->codebooks + j * VECTOR_PQ_CENTROIDS * ivfpq->sub_dimension;
+        uint8_t code = (uint8_t)vector_ivfpq_nearest(ivfpq->metric, codebook, VECTOR_PQ_CENTROIDS,
+                                                     x + j * ivfpq->sub_dimension, ivfpq->sub_dimension);
+        block[j * 16 + slot % 16] |= slot < 16 ? code : (uint8_t)(code << 4);
+    }
+    list->ids[list->size++] = id;
+    ivfpq->num_vectors++;
+    free(x);
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Searching */
+
+/*
+ * Byte lookup table of residual r over every subspace centroid: entries are
+ * (distance - min of the subspace) * scale, rounded, with one scale for
+ * all subspaces so that sums of entries stay comparable. Returns the sum
+ * of the subspace minimums; a vector scores bias + sum of entries / scale.
+ */
+static float vector_ivfpq_lookup_table(const VectorIVFPQ *ivfpq, const float *r, float *distances, uint8_t *lut, float *scale) {
+    float bias = 0.0f;
+    float widest = 0.0f;
+
+    memset(distances, 0, ivfpq->code_m * VECTOR_PQ_CENTROIDS * sizeof(float));
+    for (size_t j = 0; j < ivfpq->pq_m; j++) {
+        const float *codebook = ivfpq->codebooks + j * VECTOR_PQ_CENTROIDS * ivfpq->sub_dimension;
+        float *row = distances + j * VECTOR_PQ_CENTROIDS;
+        float min = INFINITY;
+        float max = 0.0f;
+        for (size_t c = 0; c < VECTOR_PQ_CENTROIDS; c++) {
+            row[c] = vector_ivfpq_distance(ivfpq->metric, codebook + c * ivfpq->sub_dimension,
+                                           r + j * ivfpq->sub_dimension, ivfpq->sub_dimension);
+            min = row[c] < min ? row[c] : min;
+            max = row[c] > max ? row[c] : max;
+        }
+        for (size_t c = 0; c < VECTOR_PQ_CENTROIDS; c++) {
+            row[c] -= min;
+        }
+        bias += min;
+        widest = max - min > widest ? max - min : widest;
+    }
+
+    *scale = widest > 0.0f ? 255.0f / widest : 0.0f;
+    for (size_t i = 0; i < ivfpq->code_m * VECTOR_PQ_CENTROIDS; i++) {
+        lut[i] = (uint8_t)lrintf(distances[i] * *scale);
+    }
+    return bias;
+}
+
+/* Keep candidate among the best keep of nearest, a max-heap */
+static int vector_ivfpq_offer(VectorHeap *nearest, size_t keep, VectorCandidate candidate) {
+    if (nearest->size < keep) {
+        return vector_heap_push(nearest, candidate);
+    }
+    if (candidate.distance < nearest->items[0].distance) {
+        vector_heap_pop(nearest);
+        return vector_heap_push(nearest, candidate);
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * k approximate nearest neighbors of query from the lists of its nprobe
+ * nearest centroids, ordered by increasing distance. With rerank > 0 the
+ * rerank * k best codes are re-scored with exact distances to the stored
+ * vectors, otherwise the distances are the quantized estimates. Ids
+ * outside a filter bitmap are skipped.
+ */
+int vector_ivfpq_search(const VectorIVFPQ *ivfpq, const VectorTable *table, const float *query, size_t k, size_t nprobe, size_t rerank, const uint64_t *filter, VectorSearchResult *results, size_t *num_results) {
+    size_t dim = ivfpq->dimension;
+    size_t keep = rerank > 0 ? k * rerank : k;
+
+    *num_results = 0;
+    if (k == 0 || ivfpq->num_vectors == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (nprobe == 0) {
+        nprobe = 1;
+    }
+    if (nprobe > ivfpq->nlist) {
+        nprobe = ivfpq->nlist;
+    }
+
+    float *q = malloc(2 * dim * sizeof(float));
+    float *distances = malloc(ivfpq->code_m * VECTOR_PQ_CENTROIDS * sizeof(float));
+    uint8_t *lut = malloc(ivfpq->code_m * VECTOR_PQ_CENTROIDS);
+    VectorSearchResult *candidates = malloc(keep * sizeof(VectorSearchResult));
+    VectorHeap probes = {NULL, 0, 0, true};
+    VectorHeap nearest = {NULL, 0, 0, true};
+    int result = q && distances && lut && candidates ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+
+    if (result == EPIPHANYDB_SUCCESS) {
+        vector_ivfpq_prepare(ivfpq, query, q);
+        for (size_t l = 0; l < ivfpq->nlist && result == EPIPHANYDB_SUCCESS; l++) {
+            VectorCandidate probe = {vector_ivfpq_distance(ivfpq->metric, ivfpq->centroids + l * dim, q, dim), (uint32_t)l};
+            result = vector_ivfpq_offer(&probes, nprobe, probe);
+        }
+    }
+
+    for (size_t p = 0; p < probes.size && result == EPIPHANYDB_SUCCESS; p++) {
+        const VectorIVFList *list = &ivfpq->lists[probes.items[p].id];
+        if (list->size == 0) {
+            continue;
+        }
+
+        float *r = q + dim;
+        const float *centroid = ivfpq->centroids + probes.items[p].id * dim;
+        for (size_t d = 0; d < dim; d++) {
+            r[d] = q[d] - centroid[d];
+        }
+        float scale;
+        float bias = vector_ivfpq_lookup_table(ivfpq, r, distances, lut, &scale);
+        float inverse_scale = scale > 0.0f ? 1.0f / scale : 0.0f;
+
+        for (size_t start = 0; start < list->size && result == EPIPHANYDB_SUCCESS; start += VECTOR_PQ_BLOCK) {
+            uint16_t scores[VECTOR_PQ_BLOCK];
+            vector_pq_scan_kernel(list->codes + start / VECTOR_PQ_BLOCK * ivfpq->code_m * 16, lut, ivfpq->code_m, scores);
+
+            size_t count = list->size - start < VECTOR_PQ_BLOCK ? list->size - start : VECTOR_PQ_BLOCK;
+            for (size_t b = 0; b < count && result == EPIPHANYDB_SUCCESS; b++) {
+                VectorCandidate candidate = {bias + scores[b] * inverse_scale, list->ids[start + b]};
+                if (vector_filter_test(filter, candidate.id)) {
+                    result = vector_ivfpq_offer(&nearest, keep, candidate);
+                }
+            }
+        }
+    }
+
+    size_t count = 0;
+    if (result == EPIPHANYDB_SUCCESS) {
+        float query_norm = vector_norm(query, dim);
+        count = nearest.size;
+        for (size_t i = 0; i < count; i++) {
+            VectorCandidate candidate = nearest.items[i];
+            candidates[i].id = candidate.id;
+            if (rerank > 0) {
+                candidates[i].distance = vector_distance(table->metric, vector_at(table, candidate.id), table->norms[candidate.id],
+                                                         query, query_norm, dim);
+            } else if (ivfpq->metric == VECTOR_METRIC_EUCLIDEAN) {
+                candidates[i].distance = sqrtf(candidate.distance > 0.0f ? candidate.distance : 0.0f);
+            } else if (ivfpq->metric == VECTOR_METRIC_COSINE) {
+                candidates[i].distance = candidate.distance / 2.0f;
+            } else {
+                candidates[i].distance = candidate.distance;
+            }
+        }
+        vector_sort_results(candidates, count);
+        if (count > k) {
+            count = k;
+        }
+        memcpy(results, candidates, count * sizeof(VectorSearchResult));
+        *num_results = count;
+    }
+
+    vector_heap_free(&probes);
+    vector_heap_free(&nearest);
+    free(q);
+    free(distances);
+    free(lut);
+    free(candidates);
+    return result;
+}
+
+/*
+ * Float table of the distances from query, relative to the centroid of
+ * list, to every subspace centroid, for estimating distances to single
+ * codes rather than scanning blocks: code_m * VECTOR_PQ_CENTROIDS entries.
+ */
+int vector_ivfpq_query_table(const VectorIVFPQ *ivfpq, size_t list, const float *query, float *table) {
+    size_t dim = ivfpq->dimension;
+    float *r = malloc(dim * sizeof(float));
+    if (!r) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    vector_ivfpq_prepare(ivfpq, query, r);
+    const float *centroid = ivfpq->centroids + list * dim;
+    for (size_t d = 0; d < dim; d++) {
+        r[d] -= centroid[d];
+    }
+    for (size_t j = 0; j < ivfpq->pq_m; j++) {
+        const float *codebook = ivfpq->codebooks + j * VECTOR_PQ_CENTROIDS * ivfpq->sub_dimension;
+        for (size_t c = 0; c < VECTOR_PQ_CENTROIDS; c++) {
+            table[j * VECTOR_PQ_CENTROIDS + c] = vector_ivfpq_distance(ivfpq->metric, codebook + c * ivfpq->sub_dimension,
+                                                                       r + j * ivfpq->sub_dimension, ivfpq->sub_dimension);
+        }
+    }
+    free(r);
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Estimated distance of the code at position in list, in the units of vector_ivfpq_query_table */
+float vector_ivfpq_code_distance(const VectorIVFPQ *ivfpq, size_t list, size_t position, const float *table) {
+    const uint8_t *block = ivfpq->lists[list].codes + position / VECTOR_PQ_BLOCK * ivfpq->code_m * 16;
+    size_t slot = position % VECTOR_PQ_BLOCK;
+    float distance = 0.0f;
+
+    for (size_t j = 0; j < ivfpq->pq_m; j++) {
+        uint8_t byte = block[j * 16 + slot % 16];
+        distance += table[j * VECTOR_PQ_CENTROIDS + (slot < 16 ? byte & 0x0f : byte >> 4)];
+    }
+    return distance;
+}
+
+/* Bytes held by the index */
+size_t vector_ivfpq_memory_usage(const VectorIVFPQ *ivfpq) {
+    size_t bytes = sizeof(VectorIVFPQ) + ivfpq->nlist * (sizeof(VectorIVFList) + ivfpq->dimension * sizeof(float)) +
+                   ivfpq->pq_m * VECTOR_PQ_CENTROIDS * ivfpq->sub_dimension * sizeof(float);
+    for (size_t l = 0; l < ivfpq->nlist; l++) {
+        const VectorIVFList *list = &ivfpq->lists[l];
+        bytes += list->capacity * sizeof(uint32_t) + list->capacity / VECTOR_PQ_BLOCK * ivfpq->code_m * 16;
+    }
+    return bytes;
+}
@@ -0,0 +1,488 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * Quantized storage modes. Tables may keep float16, int8 or binary codes of
+ * their vectors next to the floats and search those instead: a 768-d vector
+ * takes 1536, 768 or 96 bytes rather than 3072. Queries stay in float32;
+ * float16 and int8 codes are decoded in registers by the distance kernels,
+ * binary codes are compared with the binarized query by Hamming distance.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define VECTOR_HAVE_X86_KERNELS 1
+#endif
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+/* Half precision conversions, rounding to nearest even */
+
+float vector_half_to_float(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        float value = ldexpf((float)mantissa, -24);
+        return sign ? -value : value;
+    }
+    if (exponent == 31) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint16_t vector_float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent == 0xff) {
+        return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+
+    int half_exponent = (int)exponent - 112;
+    if (half_exponent >= 31) {
+        return (uint16_t)(sign | 0x7c00);
+    }
+
+    uint32_t shift = 13;
+    uint32_t half = sign;
+    if (half_exponent <= 0) {
+        /* Subnormal half, the implicit bit joins the shifted mantissa */
+        if (half_exponent < -10) {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        shift = (uint32_t)(14 - half_exponent);
+    } else {
+        half |= (uint32_t)half_exponent << 10;
+    }
+
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    half += mantissa >> shift;
+    if (rest > halfway || (rest == halfway && (half & 1))) {
+        half++;
+    }
+    return (uint16_t)half;
+}
+
+/* Code distance kernels against a float query: dot product, squared L2 and L1 */
+
+typedef float (*VectorCodeFn)(const VectorCodes *codes, const uint8_t *code, const float *query, size_t start, size_t n);
+typedef uint64_t (*VectorHammingFn)(const uint64_t *a, const uint64_t *b, size_t words);
+
+static inline float vector_code_value(const VectorCodes *codes, const uint8_t *code, size_t d) {
+    if (codes->mode == VECTOR_STORAGE_FLOAT16) {
+        uint16_t half;
+        memcpy(&half, code + 2 * d, sizeof(half));
+        return vector_half_to_float(half);
+    }
+    return codes->offset[d] + codes->scale[d] * code[d];
+}
+
+/* Scalar kernels over dimensions start..n-1, also the tails of the wide ones */
+
+static float vector_code_dot_scalar(const VectorCodes *codes, const uint8_t *code, const float *query, size_t start, size_t n) {
+    float sum = 0.0f;
+    for (size_t d = start; d < n; d++) {
+        sum += vector_code_value(codes, code, d) * query[d];
+    }
+    return sum;
+}
+
+static float vector_code_l2_scalar(const VectorCodes *codes, const uint8_t *code, const float *query, size_t start, size_t n) {
+    float sum = 0.0f;
+    for (size_t d = start; d < n; d++) {
+        float diff = vector_code_value(codes, code, d) - query[d];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+static float vector_code_l1_scalar(const VectorCodes *codes, const uint8_t *code, const float *query, size_t start, size_t n) {
+    float sum = 0.0f;
+    for (size_t d = start; d < n; d++) {
+        sum += fabsf(vector_code_value(codes, code, d) - query[d]);
+    }
+    return sum;
+}
+
+static uint64_t vector_hamming_scalar(const uint64_t *a, const uint64_t *b, size_t words) {
+    uint64_t distance = 0;
+    for (size_t w = 0; w < words; w++) {
+        distance += (uint64_t)__builtin_popcountll(a[w] ^ b[w]);
+    }
+    return distance;
+}
+
+#ifdef VECTOR_HAVE_X86_KERNELS
+
+/* AVX2 kernels: eight dimensions decoded per step, F16C for halves */
+
+#define VECTOR_AVX2_CODE_KERNEL(NAME, LOAD, STEP, SCALAR)                                    \
+    __attribute__((target("avx2,fma,f16c")))                                                 \
+    static float NAME(const VectorCodes *codes, const uint8_t *code, const float *query,     \
+                      size_t start, size_t n) {                                              \
+        __m256 sign = _mm256_set1_ps(-0.0f);                                                 \
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();                       \
+        size_t i = start;                                                                    \
+        (void)sign;                                                                          \
+        for (; i + 16 <= n; i += 16) {                                                       \
+            acc0 = STEP(acc0, LOAD(i), _mm256_loadu_ps(query + i));                          \
+            acc1 = STEP(acc1, LOAD(i + 8), _mm256_loadu_ps(query + i + 8));                  \
+        }                                                                                    \
+        for (; i + 8 <= n; i += 8) {                                                         \
+            acc0 = STEP(acc0, LOAD(i), _mm256_loadu_ps(query + i));                          \
+        }                                                                                    \
+        __m256 acc = _mm256_add_ps(acc0, acc1);                                              \
+        __m128 sums = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)); \
+        sums = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));                                  \
+        sums = _mm_add_ss(sums, _mm_shuffle_ps(sums, sums, 0x55));                           \
+        return _mm_cvtss_f32(sums) + SCALAR(codes, code, query, i, n);                       \
+    }
+
+#define VECTOR_AVX2_LOAD_HALF(i) _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(code + 2 * (i))))
+#define VECTOR_AVX2_LOAD_INT8(i)                                                             \
+    _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(code + (i))))), \
+                    _mm256_loadu_ps(codes->scale + (i)), _mm256_loadu_ps(codes->offset + (i)))
+
+#define VECTOR_AVX2_CODE_DOT(acc, x, y) _mm256_fmadd_ps((x), (y), (acc))
+#define VECTOR_AVX2_CODE_L2(acc, x, y) _mm256_fmadd_ps(_mm256_sub_ps((x), (y)), _mm256_sub_ps((x), (y)), (acc))
+#define VECTOR_AVX2_CODE_L1(acc, x, y) _mm256_add_ps((acc), _mm256_andnot_ps(sign, _mm256_sub_ps((x), (y))))
+
+VECTOR_AVX2_CODE_KERNEL(vector_half_dot_avx2, VECTOR_AVX2_LOAD_HALF, VECTOR_AVX2_CODE_DOT, vector_code_dot_scalar)
+VECTOR_AVX2_CODE_KERNEL(vector_half_l2_avx2, VECTOR_AVX2_LOAD_HALF, VECTOR_AVX2_CODE_L2, vector_code_l2_scalar)
+VECTOR_AVX2_CODE_KERNEL(vector_half_l1_avx2, VECTOR_AVX2_LOAD_HALF, VECTOR_AVX2_CODE_L1, vector_code_l1_scalar)
+VECTOR_AVX2_CODE_KERNEL(vector_int8_dot_avx2, VECTOR_AVX2_LOAD_INT8, VECTOR_AVX2_CODE_DOT, vector_code_dot_scalar)
+VECTOR_AVX2_CODE_KERNEL(vector_int8_l2_avx2, VECTOR_AVX2_LOAD_INT8, VECTOR_AVX2_CODE_L2, vector_code_l2_scalar)
+VECTOR_AVX2_CODE_KERNEL(vector_int8_l1_avx2, VECTOR_AVX2_LOAD_INT8, VECTOR_AVX2_CODE_L1, vector_code_l1_scalar)
+
+/* AVX-512 kernels: sixteen dimensions decoded per step */
+
+#define VECTOR_AVX512_CODE_KERNEL(NAME, LOAD, STEP, SCALAR)                                  \
+    __attribute__((target("avx512f")))                                                       \
+    static float NAME(const VectorCodes *codes, const uint8_t *code, const float *query,     \
+                      size_t start, size_t n) {                                              \
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();                       \
+        size_t i = start;                                                                    \
+        for (; i + 32 <= n; i += 32) {                                                       \
+            acc0 = STEP(acc0, LOAD(i), _mm512_loadu_ps(query + i));                          \
+            acc1 = STEP(acc1, LOAD(i + 16), _mm512_loadu_ps(query + i + 16));                \
+        }                                                                                    \
+        for (; i + 16 <= n; i += 16) {                                                       \
+            acc0 = STEP(acc0, LOAD(i), _mm512_loadu_ps(query + i));                          \
+        }                                                                                    \
+        return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1)) + SCALAR(codes, code, query, i, n); \
+    }
+
+#define VECTOR_AVX512_LOAD_HALF(i) _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(code + 2 * (i))))
+#define VECTOR_AVX512_LOAD_INT8(i)                                                           \
+    _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(code + (i))))), \
+                    _mm512_loadu_ps(codes->scale + (i)), _mm512_loadu_ps(codes->offset + (i)))
+
+#define VECTOR_AVX512_CODE_DOT(acc, x, y) _mm512_fmadd_ps((x), (y), (acc))
+#define VECTOR_AVX512_CODE_L2(acc, x, y) _mm512_fmadd_ps(_mm512_sub_ps((x), (y)), _mm512_sub_ps((x), (y)), (acc))
+#define VECTOR_AVX512_CODE_L1(acc, x, y) _mm512_add_ps((acc), _mm512_abs_ps(_mm512_sub_ps((x), (y))))
+
+VECTOR_AVX512_CODE_KERNEL(vector_half_dot_avx512, VECTOR_AVX512_LOAD_HALF, VECTOR_AVX512_CODE_DOT, vector_code_dot_scalar)
+VECTOR_AVX512_CODE_KERNEL(vector_half_l2_avx512, VECTOR_AVX512_LOAD_HALF, VECTOR_AVX512_CODE_L2, vector_code_l2_scalar)
+VECTOR_AVX512_CODE_KERNEL(vector_half_l1_avx512, VECTOR_AVX512_LOAD_HALF, VECTOR_AVX512_CODE_L1, vector_code_l1_scalar)
+VECTOR_AVX512_CODE_KERNEL(vector_int8_dot_avx512, VECTOR_AVX512_LOAD_INT8, VECTOR_AVX512_CODE_DOT, vector_code_dot_scalar)
+VECTOR_AVX512_CODE_KERNEL(vector_int8_l2_avx512, VECTOR_AVX512_LOAD_INT8, VECTOR_AVX512_CODE_L2, vector_code_l2_scalar)
+VECTOR_AVX512_CODE_KERNEL(vector_int8_l1_avx512, VECTOR_AVX512_LOAD_INT8, VECTOR_AVX512_CODE_L1, vector_code_l1_scalar)
+
+/* Hamming kernels: the popcnt instruction, or eight words at a time with VPOPCNTDQ */
+
+__attribute__((target("popcnt")))
+static uint64_t vector_hamming_popcnt(const uint64_t *a, const uint64_t *b, size_t words) {
+    uint64_t distance = 0;
+    for (size_t w = 0; w < words; w++) {
+        distance += (uint64_t)__builtin_popcountll(a[w] ^ b[w]);
+    }
+    return distance;
+}
+
+/* words is a multiple of 8, codes being padded to VECTOR_ALIGNMENT bytes */
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint64_t vector_hamming_avx512(const uint64_t *a, const uint64_t *b, size_t words) {
+    __m512i acc = _mm512_setzero_si512();
+    for (size_t w = 0; w < words; w += 8) {
+        __m512i diff = _mm512_xor_si512(_mm512_loadu_si512(a + w), _mm512_loadu_si512(b + w));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(diff));
+    }
+    return (uint64_t)_mm512_reduce_add_epi64(acc);
+}
+
+#endif /* VECTOR_HAVE_X86_KERNELS */
+
+/* Kernel dispatch, by code type (float16, int8) then dot, L2, L1 */
+
+static VectorCodeFn vector_code_kernels[2][3] = {
+    {vector_code_dot_scalar, vector_code_l2_scalar, vector_code_l1_scalar},
+    {vector_code_dot_scalar, vector_code_l2_scalar, vector_code_l1_scalar}
+};
+static VectorHammingFn vector_hamming_kernel = vector_hamming_scalar;
+
+__attribute__((constructor))
+static void vector_init_code_kernels(void) {
+#ifdef VECTOR_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        VectorCodeFn kernels[2][3] = {
+            {vector_half_dot_avx512, vector_half_l2_avx512, vector_half_l1_avx512},
+            {vector_int8_dot_avx512, vector_int8_l2_avx512, vector_int8_l1_avx512}
+        };
+        memcpy(vector_code_kernels, kernels, sizeof(kernels));
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) {
+        VectorCodeFn kernels[2][3] = {
+            {vector_half_dot_avx2, vector_half_l2_avx2, vector_half_l1_avx2},
+            {vector_int8_dot_avx2, vector_int8_l2_avx2, vector_int8_l1_avx2}
+        };
+        memcpy(vector_code_kernels, kernels, sizeof(kernels));
+    }
+
+    if (__builtin_cpu_supports("avx512vpopcntdq")) {
+        vector_hamming_kernel = vector_hamming_avx512;
+    } else if (__builtin_cpu_supports("popcnt")) {
+        vector_hamming_kernel = vector_hamming_popcnt;
+    }
+#endif
+}
+
+/* Code arenas */
+
+const char *vector_storage_mode_name(VectorStorageMode mode) {
+    switch (mode) {
+        case VECTOR_STORAGE_FLOAT16:
+            return "float16";
+        case VECTOR_STORAGE_INT8:
+            return "int8";
+        case VECTOR_STORAGE_BINARY:
+            return "binary";
+        default:
+            return "float32";
+    }
+}
+
+VectorCodes *vector_codes_create(VectorStorageMode mode, size_t dimension) {
+    VectorCodes *codes = calloc(1, sizeof(VectorCodes));
+    if (!codes) {
+        return NULL;
+    }
+
+    size_t bytes;
+    switch (mode) {
+        case VECTOR_STORAGE_FLOAT16:
+            bytes = dimension * sizeof(uint16_t);
+            break;
+        case VECTOR_STORAGE_BINARY:
+            bytes = (dimension + 7) / 8;
+            break;
+        default:
+            bytes = dimension;
+            break;
+    }
+    codes->mode = mode;
+    codes->dimension = dimension;
+    codes->code_size = (bytes + VECTOR_ALIGNMENT - 1) / VECTOR_ALIGNMENT * VECTOR_ALIGNMENT;
+    codes->trained = mode == VECTOR_STORAGE_FLOAT16;
+    if (mode != VECTOR_STORAGE_FLOAT16) {
+        codes->offset = calloc(dimension, sizeof(float));
+        codes->scale = calloc(dimension, sizeof(float));
+        if (!codes->offset || !codes->scale) {
+            vector_codes_free(codes);
+            return NULL;
+        }
+    }
+    return codes;
+}
+
+void vector_codes_free(VectorCodes *codes) {
+    if (!codes) {
+        return;
+    }
+    free(codes->data);
+    free(codes->offset);
+    free(codes->scale);
+    free(codes);
+}
+
+static int vector_codes_reserve(VectorCodes *codes, size_t capacity) {
+    if (capacity <= codes->capacity) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t grown_capacity = codes->capacity ? codes->capacity : VECTOR_INITIAL_CAPACITY;
+    while (grown_capacity < capacity) {
+        grown_capacity *= 2;
+    }
+
+    uint8_t *data = aligned_alloc(VECTOR_ALIGNMENT, grown_capacity * codes->code_size);
+    if (!data) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    if (codes->num_vectors > 0) {
+        memcpy(data, codes->data, codes->num_vectors * codes->code_size);
+    }
+    free(codes->data);
+    codes->data = data;
+    codes->capacity = grown_capacity;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Binary code of vector, set bits for dimensions above their threshold */
+static void vector_codes_binarize(const VectorCodes *codes, const float *vector, uint8_t *bits) {
+    memset(bits, 0, codes->code_size);
+    for (size_t d = 0; d < codes->dimension; d++) {
+        bits[d / 8] |= (uint8_t)((vector[d] > codes->offset[d]) << (d % 8));
+    }
+}
+
+/* Store the code of vector as that of id, which is at most the number of codes */
+int vector_codes_encode(VectorCodes *codes, const float *vector, size_t id) {
+    if (id > codes->num_vectors || !codes->trained) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    int result = vector_codes_reserve(codes, id + 1);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    uint8_t *code = codes->data + id * codes->code_size;
+    switch (codes->mode) {
+        case VECTOR_STORAGE_FLOAT16:
+            memset(code, 0, codes->code_size);
+            for (size_t d = 0; d < codes->dimension; d++) {
+                uint16_t half = vector_float_to_half(vector[d]);
+                memcpy(code + 2 * d, &half, sizeof(half));
+            }
+            break;
+        case VECTOR_STORAGE_BINARY:
+            vector_codes_binarize(codes, vector, code);
+            break;
+        default:
+            memset(code, 0, codes->code_size);
+            for (size_t d = 0; d < codes->dimension; d++) {
+                float level = codes->scale[d] > 0.0f ? (vector[d] - codes->offset[d]) / codes->scale[d] : 0.0f;
+                code[d] = (uint8_t)(level <= 0.0f ? 0 : level >= 255.0f ? 255 : lrintf(level));
+            }
+            break;
+    }
+    if (id == codes->num_vectors) {
+        codes->num_vectors++;
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Calibrate int8 ranges or binary thresholds on the vectors of table and
+ * encode them all. Values outside the calibrated range are clamped.
+ */
+int vector_codes_train(VectorCodes *codes, const VectorTable *table) {
+    size_t dim = codes->dimension;
+
+    if (codes->mode != VECTOR_STORAGE_FLOAT16 && table->num_vectors > 0) {
+        float *max = malloc(dim * sizeof(float));
+        if (!max) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+
+        const float *first = vector_at(table, 0);
+        memcpy(codes->offset, first, dim * sizeof(float));
+        memcpy(max, first, dim * sizeof(float));
+        memset(codes->scale, 0, dim * sizeof(float));
+        for (size_t id = 0; id < table->num_vectors; id++) {
+            const float *vector = vector_at(table, id);
+            for (size_t d = 0; d < dim; d++) {
+                if (codes->mode == VECTOR_STORAGE_BINARY) {
+                    codes->scale[d] += vector[d];
+                    continue;
+                }
+                codes->offset[d] = vector[d] < codes->offset[d] ? vector[d] : codes->offset[d];
+                max[d] = vector[d] > max[d] ? vector[d] : max[d];
+            }
+        }
+
+        /* Binary thresholds are the dimension means, accumulated in scale */
+        for (size_t d = 0; d < dim; d++) {
+            if (codes->mode == VECTOR_STORAGE_BINARY) {
+                codes->offset[d] = codes->scale[d] / (float)table->num_vectors;
+                codes->scale[d] = 0.0f;
+            } else {
+                codes->scale[d] = (max[d] - codes->offset[d]) / 255.0f;
+            }
+        }
+        free(max);
+        codes->trained = true;
+    }
+    if (!codes->trained) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    codes->num_vectors = 0;
+    for (size_t id = 0; id < table->num_vectors; id++) {
+        int result = vector_codes_encode(codes, vector_at(table, id), id);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Binary code of a query, code_size bytes; unused by the other modes */
+void vector_codes_encode_query(const VectorCodes *codes, const float *query, uint8_t *bits) {
+    if (codes->mode == VECTOR_STORAGE_BINARY) {
+        vector_codes_binarize(codes, query, bits);
+    }
+}
+
+/*
+ * Distance from the code of id, whose full precision norm is norm, to
+ * query in the table metric. Binary codes give the fraction of differing
+ * bits instead, an estimate only fit for ranking and re-ranking.
+ */
+float vector_codes_distance(const VectorCodes *codes, VectorMetric metric, size_t id, float norm, const float *query, float query_norm, const uint8_t *query_bits) {
+    const uint8_t *code = codes->data + id * codes->code_size;
+    if (codes->mode == VECTOR_STORAGE_BINARY) {
+        uint64_t distance = vector_hamming_kernel((const uint64_t *)code, (const uint64_t *)query_bits, codes->code_size / 8);
+        return (float)distance / (float)codes->dimension;
+    }
+
+    VectorCodeFn *kernels = vector_code_kernels[codes->mode == VECTOR_STORAGE_INT8];
+    switch (metric) {
+        case VECTOR_METRIC_EUCLIDEAN:
+            return sqrtf(kernels[1](codes, code, query, 0, codes->dimension));
+        case VECTOR_METRIC_MANHATTAN:
+            return kernels[2](codes, code, query, 0, codes->dimension);
+        default:
+            if (norm == 0.0f || query_norm == 0.0f) {
+                return 1.0f;
+            }
+            return 1.0f - kernels[0](codes, code, query, 0, codes->dimension) / (norm * query_norm);
+    }
+}
+
+/* Bytes held by the codes and their calibration */
+size_t vector_codes_memory_usage(const VectorCodes *codes) {
+    size_t bytes = sizeof(VectorCodes) + codes->capacity * codes->code_size;
+    if (codes->offset) {
+        bytes += 2 * codes->dimension * sizeof(float);
+    }
+    return bytes;
+}
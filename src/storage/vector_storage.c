@@ -7,188 +7,1414 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
 #include <math.h>
+#include <sys/stat.h>
 #include "../../include/epiphanydb.h"
+#include "vector_storage.h"
 
-/* Vector storage specific structures */
-typedef struct VectorStorageContext {
-    char *data_directory;
-    size_t default_vector_dimension;
-    char *distance_metric;  /* euclidean, cosine, manhattan */
-    bool enable_indexing;
-} VectorStorageContext;
-
-typedef struct VectorTable {
-    char *table_name;
-    char *vector_file;
-    char *metadata_file;
-    char *index_file;
-    size_t vector_dimension;
-    size_t num_vectors;
-    char *distance_metric;
-} VectorTable;
-
-typedef struct Vector {
-    float *data;
-    size_t dimension;
-    char *metadata;  /* JSON or key-value pairs */
-} Vector;
+static VectorStorageContext *vector_ctx = NULL;
+
+/* Create path and its missing parents */
+static int vector_make_directory(const char *path) {
+    char buffer[1024];
+    size_t len = strlen(path);
+
+    if (len == 0 || len >= sizeof(buffer)) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    memcpy(buffer, path, len + 1);
+    for (char *p = buffer + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+                return EPIPHANYDB_ERROR_IO;
+            }
+            *p = '/';
+        }
+    }
+    if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+        return EPIPHANYDB_ERROR_IO;
+    }
+
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Map a metric name onto a metric, -1 when unknown */
+static int vector_parse_metric(const char *name, size_t len) {
+    static const char *names[] = {"cosine", "euclidean", "manhattan"};
+
+    for (size_t m = 0; m < sizeof(names) / sizeof(names[0]); m++) {
+        if (strlen(names[m]) == len && strncasecmp(names[m], name, len) == 0) {
+            return (int)m;
+        }
+    }
+    return -1;
+}
+
+/* Find word in schema as a whole word, case-insensitively */
+static const char *vector_find_keyword(const char *schema, const char *word) {
+    size_t len = strlen(word);
+
+    for (const char *p = schema; *p; p++) {
+        if (strncasecmp(p, word, len) == 0 && (p == schema || !isalnum((unsigned char)p[-1])) &&
+            !isalnum((unsigned char)p[len])) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Parse a parenthesized list of NAME [=] value options starting at p, such
+ * as HNSW (M 16, EF_CONSTRUCTION 200), each optional and in any order.
+ */
+static int vector_parse_options(const char *p, const char *const *names, size_t *const *options, size_t num_options) {
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p != '(') {
+        return EPIPHANYDB_SUCCESS;
+    }
+    p++;
+
+    for (;;) {
+        while (isspace((unsigned char)*p) || *p == ',') {
+            p++;
+        }
+        if (*p == ')') {
+            return EPIPHANYDB_SUCCESS;
+        }
+
+        size_t len = 0;
+        while (isalnum((unsigned char)p[len]) || p[len] == '_') {
+            len++;
+        }
+        size_t option = 0;
+        while (option < num_options && (strlen(names[option]) != len || strncasecmp(names[option], p, len) != 0)) {
+            option++;
+        }
+        if (len == 0 || option == num_options) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+
+        p += len;
+        while (isspace((unsigned char)*p) || *p == '=') {
+            p++;
+        }
+        char *end = NULL;
+        long value = strtol(p, &end, 10);
+        if (end == p || value < 0 || value > 65535) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        *options[option] = (size_t)value;
+        p = end;
+    }
+}
+
+/*
+ * Pick the dimension from the VECTOR(n) column of schema, the metric from
+ * an optional METRIC cosine|euclidean|manhattan clause, the index from
+ * an optional HNSW (M, EF_CONSTRUCTION, EF_SEARCH, BUILD_THREADS) clause, an
+ * IVFPQ (NLIST, PQ_M, NPROBE, RERANK) clause picking IVF-PQ, a
+ * DISKANN (DEGREE, BUILD_L, SEARCH_L, BEAMWIDTH, PQ_M) clause picking the
+ * disk-resident graph or a FLAT keyword, a full-text index of the metadata
+ * from an optional FULLTEXT clause, FULLTEXT (key) indexing one key only,
+ * and the storage mode from an optional STORAGE
+ * float32|float16|int8|binary (RERANK) clause.
+ */
+static int vector_parse_schema(VectorTable *table, const char *schema) {
+    const char *p = vector_find_keyword(schema, "VECTOR");
+    if (p) {
+        char *end = NULL;
+        p += strlen("VECTOR");
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p != '(') {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        long dimension = strtol(p + 1, &end, 10);
+        while (end && isspace((unsigned char)*end)) {
+            end++;
+        }
+        if (!end || *end != ')' || dimension <= 0 || dimension > VECTOR_MAX_DIMENSION) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        table->vector_dimension = (size_t)dimension;
+    }
+
+    p = vector_find_keyword(schema, "METRIC");
+    if (p) {
+        p += strlen("METRIC");
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        size_t len = 0;
+        while (isalpha((unsigned char)p[len])) {
+            len++;
+        }
+        int metric = vector_parse_metric(p, len);
+        if (metric < 0) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        table->metric = (VectorMetric)metric;
+    }
+
+    p = vector_find_keyword(schema, "HNSW");
+    if (p) {
+        static const char *const names[] = {"M", "EF_CONSTRUCTION", "EF_SEARCH", "BUILD_THREADS"};
+        size_t *const options[] = {&table->hnsw_m, &table->hnsw_ef_construction, &table->ef_search,
+                                   &table->hnsw_build_threads};
+        int result = vector_parse_options(p + strlen("HNSW"), names, options, 4);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+    }
+
+    p = vector_find_keyword(schema, "IVFPQ");
+    if (p) {
+        static const char *const names[] = {"NLIST", "PQ_M", "NPROBE", "RERANK"};
+        size_t *const options[] = {&table->ivf_nlist, &table->pq_m, &table->ivf_nprobe, &table->ivf_rerank};
+        int result = vector_parse_options(p + strlen("IVFPQ"), names, options, 4);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+        table->index_type = VECTOR_INDEX_IVFPQ;
+    }
+
+    p = vector_find_keyword(schema, "DISKANN");
+    if (p) {
+        static const char *const names[] = {"DEGREE", "BUILD_L", "SEARCH_L", "BEAMWIDTH", "PQ_M"};
+        size_t *const options[] = {&table->diskann_degree, &table->diskann_build_l, &table->diskann_search_l,
+                                   &table->diskann_beamwidth, &table->pq_m};
+        int result = vector_parse_options(p + strlen("DISKANN"), names, options, 5);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+        table->index_type = VECTOR_INDEX_DISKANN;
+    }
+    if (vector_find_keyword(schema, "FLAT")) {
+        table->index_type = VECTOR_INDEX_FLAT;
+    }
+
+    p = vector_find_keyword(schema, "FULLTEXT");
+    if (p) {
+        table->fulltext = true;
+        p += strlen("FULLTEXT");
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == '(') {
+            const char *key = ++p;
+            while (*p && *p != ')') {
+                p++;
+            }
+            size_t len = (size_t)(p - key);
+            while (len > 0 && isspace((unsigned char)key[len - 1])) {
+                len--;
+            }
+            while (len > 0 && isspace((unsigned char)*key)) {
+                key++;
+                len--;
+            }
+            if (*p != ')' || len == 0) {
+                return EPIPHANYDB_ERROR_INVALID_PARAM;
+            }
+            table->fulltext_key = strndup(key, len);
+            if (!table->fulltext_key) {
+                return EPIPHANYDB_ERROR_MEMORY;
+            }
+            table->text_index.key = table->fulltext_key;
+        }
+    }
+
+    p = vector_find_keyword(schema, "STORAGE");
+    if (p) {
+        p += strlen("STORAGE");
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        size_t len = 0;
+        while (isalnum((unsigned char)p[len])) {
+            len++;
+        }
+        VectorStorageMode mode = VECTOR_STORAGE_FLOAT32;
+        while (mode <= VECTOR_STORAGE_BINARY && (strlen(vector_storage_mode_name(mode)) != len ||
+                                                 strncasecmp(vector_storage_mode_name(mode), p, len) != 0)) {
+            mode++;
+        }
+        if (mode > VECTOR_STORAGE_BINARY) {
+            return EPIPHANYDB_ERROR_INVALID_PARAM;
+        }
+        table->storage_mode = mode;
+
+        static const char *const names[] = {"RERANK"};
+        size_t *const options[] = {&table->storage_rerank};
+        return vector_parse_options(p + len, names, options, 1);
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Subspaces of sub_dimension floats, or the closest divisor of the dimension above */
+static size_t vector_default_pq_m(size_t dimension, size_t sub_dimension) {
+    size_t pq_m = dimension / sub_dimension;
+    if (pq_m == 0) {
+        pq_m = 1;
+    }
+    while (dimension % pq_m != 0) {
+        pq_m++;
+    }
+    return pq_m;
+}
+
+/* Grow the arena of table to hold at least capacity vectors, write lock held */
+static int vector_table_reserve(VectorTable *table, size_t capacity) {
+    if (capacity <= table->capacity) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t grown_capacity = table->capacity ? table->capacity : VECTOR_INITIAL_CAPACITY;
+    while (grown_capacity < capacity) {
+        grown_capacity *= 2;
+    }
+
+    char **metadata = realloc(table->metadata, grown_capacity * sizeof(char *));
+    if (!metadata) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    table->metadata = metadata;
+    return vector_arena_grow(table, grown_capacity);
+}
+
+static void vector_table_free(VectorTable *table) {
+    if (!table) {
+        return;
+    }
+
+    pthread_rwlock_destroy(&table->lock);
+    pthread_mutex_destroy(&table->maintenance_mutex);
+    vector_hnsw_free(table->hnsw);
+    vector_ivfpq_free(table->ivfpq);
+    vector_diskann_free(table->diskann);
+    vector_codes_free(table->codes);
+    vector_metadata_index_free(&table->metadata_index);
+    vector_text_index_free(&table->text_index);
+    free(table->fulltext_key);
+    for (size_t i = 0; i < table->num_vectors; i++) {
+        free(table->metadata[i]);
+    }
+    free(table->metadata);
+    vector_arena_close(table);
+    free(table->table_name);
+    free(table->schema);
+    free(table->vector_file);
+    free(table->metadata_file);
+    free(table->index_file);
+    free(table->distance_metric);
+    free(table);
+}
+
+/* Find a table in the catalog, catalog_mutex held */
+static VectorTable *vector_lookup_table(const char *table_name) {
+    for (VectorTable *table = vector_ctx ? vector_ctx->tables : NULL; table; table = table->next) {
+        if (strcmp(table->table_name, table_name) == 0) {
+            return table;
+        }
+    }
+    return NULL;
+}
 
 /* Initialize vector storage engine */
 int vector_storage_init(EpiphanyDBContext *ctx) {
+    if (vector_ctx) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
     VectorStorageContext *vec_ctx = malloc(sizeof(VectorStorageContext));
     if (!vec_ctx) {
         return EPIPHANYDB_ERROR_MEMORY;
     }
     
     vec_ctx->data_directory = strdup("./data/vector");
-    vec_ctx->default_vector_dimension = 768;  /* Common embedding dimension */
+    vec_ctx->default_vector_dimension = VECTOR_DEFAULT_DIMENSION;  /* Common embedding dimension */
     vec_ctx->distance_metric = strdup("cosine");
     vec_ctx->enable_indexing = true;
-    
-    /* TODO: Create data directory if it doesn't exist */
-    
+    vec_ctx->tables = NULL;
+    if (!vec_ctx->data_directory || !vec_ctx->distance_metric) {
+        free(vec_ctx->data_directory);
+        free(vec_ctx->distance_metric);
+        free(vec_ctx);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    int result = vector_make_directory(vec_ctx->data_directory);
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(vec_ctx->data_directory);
+        free(vec_ctx->distance_metric);
+        free(vec_ctx);
+        return result;
+    }
+
+    pthread_mutex_init(&vec_ctx->catalog_mutex, NULL);
+    vector_ctx = vec_ctx;
     return EPIPHANYDB_SUCCESS;
 }
 
 /* Cleanup vector storage engine */
 int vector_storage_cleanup(EpiphanyDBContext *ctx) {
-    /* TODO: Cleanup vector storage resources */
+    if (!vector_ctx) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    VectorTable *table = vector_ctx->tables;
+    while (table) {
+        VectorTable *next = table->next;
+        vector_table_free(table);
+        table = next;
+    }
+    pthread_mutex_destroy(&vector_ctx->catalog_mutex);
+    free(vector_ctx->data_directory);
+    free(vector_ctx->distance_metric);
+    free(vector_ctx);
+    vector_ctx = NULL;
+
     return EPIPHANYDB_SUCCESS;
 }
 
-/* Create vector table */
-int vector_create_table(EpiphanyDBContext *ctx, const char *table_name, const char *schema) {
-    VectorTable *table = malloc(sizeof(VectorTable));
+/* Table of the given name and schema with its file paths, no arena yet */
+static int vector_table_new(const char *table_name, const char *schema, VectorTable **out) {
+    VectorTable *table = calloc(1, sizeof(VectorTable));
     if (!table) {
         return EPIPHANYDB_ERROR_MEMORY;
     }
+    pthread_rwlock_init(&table->lock, NULL);
+    pthread_mutex_init(&table->maintenance_mutex, NULL);
+    table->metadata_fd = -1;
     
     table->table_name = strdup(table_name);
-    table->vector_dimension = 768;  /* TODO: Parse from schema */
+    table->schema = strdup(schema);
+    table->vector_dimension = vector_ctx->default_vector_dimension;
     table->num_vectors = 0;
-    table->distance_metric = strdup("cosine");
+    table->distance_metric = strdup(vector_ctx->distance_metric);
+    if (!table->table_name || !table->schema || !table->distance_metric) {
+        vector_table_free(table);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    int metric = vector_parse_metric(table->distance_metric, strlen(table->distance_metric));
+    table->metric = metric < 0 ? VECTOR_METRIC_COSINE : (VectorMetric)metric;
+    table->hnsw_m = VECTOR_HNSW_DEFAULT_M;
+    table->hnsw_ef_construction = VECTOR_HNSW_DEFAULT_EF_CONSTRUCTION;
+    table->ef_search = VECTOR_HNSW_DEFAULT_EF_SEARCH;
+    table->ivf_nlist = VECTOR_IVF_DEFAULT_NLIST;
+    table->ivf_nprobe = VECTOR_IVF_DEFAULT_NPROBE;
+    table->diskann_degree = VECTOR_DISKANN_DEFAULT_DEGREE;
+    table->diskann_build_l = VECTOR_DISKANN_DEFAULT_BUILD_L;
+    table->diskann_search_l = VECTOR_DISKANN_DEFAULT_SEARCH_L;
+    table->diskann_beamwidth = VECTOR_DISKANN_DEFAULT_BEAMWIDTH;
+
+    int result = vector_parse_schema(table, schema);
+    if (result == EPIPHANYDB_SUCCESS && table->pq_m == 0) {
+        table->pq_m = vector_default_pq_m(table->vector_dimension, VECTOR_PQ_DEFAULT_SUBSPACE_DIMENSION);
+    }
+    if (result == EPIPHANYDB_SUCCESS && (table->ivf_nlist == 0 || table->pq_m > VECTOR_PQ_MAX_SUBSPACES ||
+                                         table->vector_dimension % table->pq_m != 0 || table->diskann_degree == 0 ||
+                                         table->diskann_beamwidth == 0 ||
+                                         table->diskann_beamwidth > VECTOR_DISKANN_MAX_BEAMWIDTH)) {
+        result = EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (result != EPIPHANYDB_SUCCESS) {
+        vector_table_free(table);
+        return result;
+    }
+    if (table->storage_mode != VECTOR_STORAGE_FLOAT32) {
+        table->codes = vector_codes_create(table->storage_mode, table->vector_dimension);
+        if (!table->codes) {
+            vector_table_free(table);
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+
+    /* Pad every vector to whole cache lines */
+    size_t per_line = VECTOR_ALIGNMENT / sizeof(float);
+    table->stride = (table->vector_dimension + per_line - 1) / per_line * per_line;
     
     /* Create file paths */
-    size_t base_len = strlen("./data/vector/") + strlen(table_name);
+    size_t base_len = strlen(vector_ctx->data_directory) + 1 + strlen(table_name);
     
     table->vector_file = malloc(base_len + strlen(".vectors") + 1);
-    sprintf(table->vector_file, "./data/vector/%s.vectors", table_name);
-    
     table->metadata_file = malloc(base_len + strlen(".metadata") + 1);
-    sprintf(table->metadata_file, "./data/vector/%s.metadata", table_name);
-    
     table->index_file = malloc(base_len + strlen(".index") + 1);
-    sprintf(table->index_file, "./data/vector/%s.index", table_name);
-    
-    /* TODO: Create vector files and initialize index */
-    
-    free(table->table_name);
-    free(table->vector_file);
-    free(table->metadata_file);
-    free(table->index_file);
-    free(table->distance_metric);
-    free(table);
-    
+    if (!table->vector_file || !table->metadata_file || !table->index_file) {
+        vector_table_free(table);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    sprintf(table->vector_file, "%s/%s.vectors", vector_ctx->data_directory, table_name);
+    sprintf(table->metadata_file, "%s/%s.metadata", vector_ctx->data_directory, table_name);
+    sprintf(table->index_file, "%s/%s.index", vector_ctx->data_directory, table_name);
+
+    *out = table;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Load a table missing from the catalog from its arena file and metadata
+ * log, catalog_mutex held. The metadata and text indexes are rebuilt; the
+ * vector index is not and waits for vector_build_index.
+ */
+static int vector_load_table(const char *table_name, VectorTable **out) {
+    char *path = malloc(strlen(vector_ctx->data_directory) + 1 + strlen(table_name) + strlen(".vectors") + 1);
+    if (!path) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    sprintf(path, "%s/%s.vectors", vector_ctx->data_directory, table_name);
+    char *schema = NULL;
+    int result = vector_arena_read_schema(path, &schema);
+    free(path);
+
+    VectorTable *table = NULL;
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_table_new(table_name, schema, &table);
+    }
+    free(schema);
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_arena_open(table);
+    }
+
+    /* float16 codes need no calibration and are encoded again here; int8 and binary ones wait for a build */
+    if (result == EPIPHANYDB_SUCCESS && table->codes && table->codes->trained) {
+        result = vector_codes_train(table->codes, table);
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        table->metadata = calloc(table->capacity, sizeof(char *));
+        result = table->metadata ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_arena_load_metadata(table);
+    }
+    for (size_t id = 0; id < table->num_vectors && result == EPIPHANYDB_SUCCESS; id++) {
+        result = vector_metadata_index_add(&table->metadata_index, table->metadata[id], (uint32_t)id);
+        if (result == EPIPHANYDB_SUCCESS && table->fulltext) {
+            result = vector_text_index_add(&table->text_index, table->metadata[id], (uint32_t)id);
+        }
+    }
+    if (result != EPIPHANYDB_SUCCESS) {
+        vector_table_free(table);
+        return result;
+    }
+    *out = table;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Create vector table, replacing any arena file left under its name */
+int vector_create_table(EpiphanyDBContext *ctx, const char *table_name, const char *schema) {
+    if (!table_name || !schema) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (!vector_ctx) {
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+
+    VectorTable *table = NULL;
+    int result = vector_table_new(table_name, schema, &table);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+
+    pthread_mutex_lock(&vector_ctx->catalog_mutex);
+    if (vector_lookup_table(table_name)) {
+        pthread_mutex_unlock(&vector_ctx->catalog_mutex);
+        vector_table_free(table);
+        return EPIPHANYDB_ERROR_ALREADY_EXISTS;
+    }
+    result = vector_arena_create(table, VECTOR_INITIAL_CAPACITY);
+    if (result == EPIPHANYDB_SUCCESS) {
+        table->metadata = calloc(table->capacity, sizeof(char *));
+        result = table->metadata ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    }
+    if (result != EPIPHANYDB_SUCCESS) {
+        pthread_mutex_unlock(&vector_ctx->catalog_mutex);
+        vector_table_free(table);
+        return result;
+    }
+    table->next = vector_ctx->tables;
+    vector_ctx->tables = table;
+    pthread_mutex_unlock(&vector_ctx->catalog_mutex);
+
     return EPIPHANYDB_SUCCESS;
 }
 
-/* Open vector table */
+/* Open vector table, mapping its arena file when the catalog does not hold it yet */
 int vector_open_table(EpiphanyDBContext *ctx, const char *table_name, EpiphanyDBTable **table) {
-    /* TODO: Implement vector table opening */
+    if (!ctx || !table_name || !table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (!vector_ctx) {
+        return EPIPHANYDB_ERROR_STORAGE;
+    }
+
+    pthread_mutex_lock(&vector_ctx->catalog_mutex);
+    VectorTable *vec_table = vector_lookup_table(table_name);
+    int loaded = EPIPHANYDB_SUCCESS;
+    if (!vec_table) {
+        loaded = vector_load_table(table_name, &vec_table);
+        if (loaded == EPIPHANYDB_SUCCESS) {
+            vec_table->next = vector_ctx->tables;
+            vector_ctx->tables = vec_table;
+        }
+    }
+    pthread_mutex_unlock(&vector_ctx->catalog_mutex);
+    if (loaded != EPIPHANYDB_SUCCESS) {
+        return loaded;
+    }
+
+    EpiphanyDBError result = epiphanydb_create_table(ctx, table_name, EPIPHANYDB_STORAGE_VECTOR, vec_table->schema, table);
+    if (result != EPIPHANYDB_SUCCESS) {
+        return result;
+    }
+    epiphanydb_table_set_storage_handle(*table, vec_table);
+
     return EPIPHANYDB_SUCCESS;
 }
 
 /* Close vector table */
 int vector_close_table(EpiphanyDBTable *table) {
-    /* TODO: Implement vector table closing */
+    if (!table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    /* The table itself stays registered with the engine */
+    epiphanydb_table_set_storage_handle(table, NULL);
+    epiphanydb_close_table(table);
+
     return EPIPHANYDB_SUCCESS;
 }
 
-/* Insert vector into table */
-int vector_insert_vector(EpiphanyDBTable *table, const float *vector_data, size_t dimension, const char *metadata) {
-    /* TODO: Implement vector insertion */
-    /* This should also update the vector index for efficient similarity search */
+/*
+ * Append vector_data to table as the next id, write lock held, taking
+ * over metadata. An HNSW node is only added; hnsw and generation receive
+ * the graph and index generation vector_link needs to link it.
+ */
+static int vector_append(VectorTable *table, const float *vector_data, char *metadata, size_t *id, VectorHNSW **hnsw, uint64_t *generation) {
+    *hnsw = NULL;
+    int result = vector_table_reserve(table, table->num_vectors + 1);
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(metadata);
+        return result;
+    }
+
+    size_t dimension = table->vector_dimension;
+    size_t next = table->num_vectors;
+    float *slot = table->vectors + next * table->stride;
+    memcpy(slot, vector_data, dimension * sizeof(float));
+    memset(slot + dimension, 0, (table->stride - dimension) * sizeof(float));
+    if (table->codes && table->codes->trained) {
+        result = vector_codes_encode(table->codes, slot, next);
+        if (result != EPIPHANYDB_SUCCESS) {
+            free(metadata);
+            return result;
+        }
+    }
+    table->norms[next] = vector_norm(slot, dimension);
+
+    /*
+     * Log and index the vector before publishing it, so that a failure
+     * leaves no trace a later vector taking its id would inherit.
+     * DiskANN scans vectors newer than its file instead.
+     */
+    if (metadata) {
+        result = vector_arena_append_metadata(table, next, metadata);
+        if (result != EPIPHANYDB_SUCCESS) {
+            free(metadata);
+            return result;
+        }
+    }
+    result = vector_metadata_index_add(&table->metadata_index, metadata, (uint32_t)next);
+    if (result == EPIPHANYDB_SUCCESS && table->fulltext) {
+        result = vector_text_index_add(&table->text_index, metadata, (uint32_t)next);
+        if (result != EPIPHANYDB_SUCCESS) {
+            vector_metadata_index_remove(&table->metadata_index, (uint32_t)next);
+        }
+    }
+    if (result == EPIPHANYDB_SUCCESS && (table->hnsw || table->ivfpq)) {
+        result = table->hnsw ? vector_hnsw_add_node(table->hnsw, (uint32_t)next)
+                             : vector_ivfpq_add(table->ivfpq, table, (uint32_t)next);
+        if (result != EPIPHANYDB_SUCCESS) {
+            vector_metadata_index_remove(&table->metadata_index, (uint32_t)next);
+            if (table->fulltext) {
+                vector_text_index_remove(&table->text_index, (uint32_t)next);
+            }
+        }
+    }
+    if (result != EPIPHANYDB_SUCCESS) {
+        if (metadata) {
+            vector_arena_drop_metadata(table, metadata);
+        }
+        free(metadata);
+        return result;
+    }
+
+    table->metadata[next] = metadata;
+    table->live[next / 64] |= 1ULL << (next % 64);
+    table->num_vectors++;
+    table->arena->num_vectors = table->num_vectors;
+    *id = next;
+    *hnsw = table->hnsw;
+    *generation = table->index_generation;
     return EPIPHANYDB_SUCCESS;
 }
 
-/* Update vector in table */
-int vector_update_vector(EpiphanyDBTable *table, const void *key, const float *vector_data, size_t dimension, const char *metadata) {
-    /* TODO: Implement vector update */
-    /* This requires updating both the vector data and the index */
+/*
+ * Link the HNSW node of an appended vector under the read lock, next to
+ * searches and other inserts. An index rebuilt in between already holds it.
+ */
+static int vector_link(VectorTable *table, size_t id, VectorHNSW *hnsw, uint64_t generation) {
+    int result = EPIPHANYDB_SUCCESS;
+    if (hnsw) {
+        pthread_rwlock_rdlock(&table->lock);
+        if (table->index_generation == generation) {
+            result = vector_hnsw_connect(hnsw, table, (uint32_t)id);
+        }
+        pthread_rwlock_unlock(&table->lock);
+    }
+    return result;
+}
+
+/* Tombstone vector id of table, write lock held */
+static int vector_tombstone(VectorTable *table, uint64_t id) {
+    if (id >= table->num_vectors || !vector_filter_test(table->live, id)) {
+        return EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+    table->live[id / 64] &= ~(1ULL << (id % 64));
+    table->num_deleted++;
+    free(table->metadata[id]);
+    table->metadata[id] = NULL;
     return EPIPHANYDB_SUCCESS;
 }
 
-/* Delete vector from table */
+/*
+ * Insert vector into table. Vectors are numbered from 0 in insertion
+ * order; the norm is computed once here so cosine distances need only a
+ * dot product at search time.
+ */
+int vector_insert_vector(EpiphanyDBTable *table, const float *vector_data, size_t dimension, const char *metadata) {
+    VectorTable *vec_table = vector_get_table(table);
+    if (!vec_table || !vector_data) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (dimension != vec_table->vector_dimension) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    char *metadata_copy = NULL;
+    if (metadata) {
+        metadata_copy = strdup(metadata);
+        if (!metadata_copy) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+
+    size_t id = 0;
+    VectorHNSW *hnsw = NULL;
+    uint64_t generation = 0;
+    pthread_rwlock_wrlock(&vec_table->lock);
+    int result = vector_append(vec_table, vector_data, metadata_copy, &id, &hnsw, &generation);
+    pthread_rwlock_unlock(&vec_table->lock);
+
+    return result == EPIPHANYDB_SUCCESS ? vector_link(vec_table, id, hnsw, generation) : result;
+}
+
+/*
+ * Update vector *key, a uint64_t id as searches return it. Like a delete
+ * followed by an insert, done under one lock: the new version gets the
+ * next id and the old one is tombstoned.
+ */
+int vector_update_vector(EpiphanyDBTable *table, const void *key, const float *vector_data, size_t dimension, const char *metadata) {
+    VectorTable *vec_table = vector_get_table(table);
+    if (!vec_table || !key || !vector_data) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (dimension != vec_table->vector_dimension) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    char *metadata_copy = NULL;
+    if (metadata) {
+        metadata_copy = strdup(metadata);
+        if (!metadata_copy) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+    }
+
+    uint64_t old_id = *(const uint64_t *)key;
+    size_t id = 0;
+    VectorHNSW *hnsw = NULL;
+    uint64_t generation = 0;
+    int result = EPIPHANYDB_SUCCESS;
+    pthread_rwlock_wrlock(&vec_table->lock);
+    if (old_id >= vec_table->num_vectors || !vector_filter_test(vec_table->live, old_id)) {
+        free(metadata_copy);
+        result = EPIPHANYDB_ERROR_NOT_FOUND;
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_append(vec_table, vector_data, metadata_copy, &id, &hnsw, &generation);
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_tombstone(vec_table, old_id);
+    }
+    pthread_rwlock_unlock(&vec_table->lock);
+
+    return result == EPIPHANYDB_SUCCESS ? vector_link(vec_table, id, hnsw, generation) : result;
+}
+
+/*
+ * Delete vector *key, a uint64_t id as searches return it. The vector is
+ * tombstoned: its live bit is cleared and every search skips it, while
+ * index graphs keep crossing it until vector_rebuild_index repairs them.
+ * Ids of the other vectors do not change.
+ */
 int vector_delete_vector(EpiphanyDBTable *table, const void *key) {
-    /* TODO: Implement vector deletion */
-    /* This should also remove the vector from the index */
-    return EPIPHANYDB_SUCCESS;
+    VectorTable *vec_table = vector_get_table(table);
+    if (!vec_table || !key) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    pthread_rwlock_wrlock(&vec_table->lock);
+    int result = vector_tombstone(vec_table, *(const uint64_t *)key);
+    pthread_rwlock_unlock(&vec_table->lock);
+    return result;
+}
+
+/*
+ * k nearest vectors by an exhaustive scan, of the codes when given, over
+ * the ids set in filter or all when NULL, read lock held. Float scans are
+ * exact searches, threaded on large tables.
+ */
+static int vector_flat_search(const VectorTable *table, const VectorCodes *codes, const float *query_vector, const uint64_t *filter, size_t k, VectorSearchResult *results, size_t *num_results) {
+    if (!codes) {
+        return vector_exact_search(table, query_vector, k, filter, 0, results, num_results);
+    }
+
+    VectorHeap nearest = {NULL, 0, 0, true};
+    float query_norm = vector_norm(query_vector, table->vector_dimension);
+    uint8_t *query_bits = malloc(codes->code_size);
+    int result = EPIPHANYDB_SUCCESS;
+
+    if (!query_bits) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    vector_codes_encode_query(codes, query_vector, query_bits);
+
+    for (size_t id = 0; id < table->num_vectors && result == EPIPHANYDB_SUCCESS; id++) {
+        if (filter && id % 64 == 0 && filter[id / 64] == 0) {
+            id += 63;
+            continue;
+        }
+        if (!vector_filter_test(filter, id)) {
+            continue;
+        }
+
+        VectorCandidate candidate;
+        candidate.distance = vector_codes_distance(codes, table->metric, id, table->norms[id], query_vector, query_norm,
+                                                   query_bits);
+        candidate.id = (uint32_t)id;
+        if (nearest.size < k) {
+            result = vector_heap_push(&nearest, candidate);
+        } else if (candidate.distance < nearest.items[0].distance) {
+            vector_heap_pop(&nearest);
+            result = vector_heap_push(&nearest, candidate);
+        }
+    }
+
+    *num_results = 0;
+    if (result == EPIPHANYDB_SUCCESS) {
+        *num_results = nearest.size;
+        while (nearest.size > 0) {
+            VectorCandidate farthest = vector_heap_pop(&nearest);
+            results[nearest.size].id = farthest.id;
+            results[nearest.size].distance = farthest.distance;
+        }
+    }
+    vector_heap_free(&nearest);
+    free(query_bits);
+    return result;
+}
+
+/* Re-score code hits with the floats, keeping the k nearest */
+static size_t vector_rerank(const VectorTable *table, const float *query_vector, VectorSearchResult *hits, size_t num_hits, size_t k) {
+    float query_norm = vector_norm(query_vector, table->vector_dimension);
+    for (size_t i = 0; i < num_hits; i++) {
+        hits[i].distance = vector_distance(table->metric, vector_at(table, hits[i].id), table->norms[hits[i].id], query_vector,
+                                           query_norm, table->vector_dimension);
+    }
+    vector_sort_results(hits, num_hits);
+    return num_hits < k ? num_hits : k;
 }
 
-/* Vector similarity search */
+/*
+ * Whether the matches vectors of a filter are cheaper to scan than the
+ * index search finding fetch of them would be. Graph searches compare
+ * about beam * degree nodes per result density, IVF-PQ the probed lists.
+ */
+static bool vector_filter_prefers_scan(const VectorTable *table, size_t matches, size_t fetch) {
+    double n = (double)table->num_vectors;
+    double cost;
+
+    if (table->hnsw) {
+        double ef = (double)(table->ef_search > fetch ? table->ef_search : fetch);
+        cost = ef * 2.0 * (double)table->hnsw_m * n / (double)matches;
+    } else if (table->ivfpq) {
+        cost = n * (double)table->ivf_nprobe / (double)table->ivf_nlist;
+    } else if (table->diskann) {
+        double search_l = (double)(table->diskann_search_l > fetch ? table->diskann_search_l : fetch);
+        cost = search_l * (double)table->diskann_degree * n / (double)matches;
+    } else {
+        return true;
+    }
+    return (double)matches <= cost;
+}
+
+/*
+ * Find the k vectors nearest to query_vector. results receives a malloc'd
+ * array of VectorSearchResult ordered by increasing distance. Tables with
+ * a built index are searched through it, HNSW with a beam of
+ * max(ef_search, k), IVF-PQ probing ivf_nprobe lists and DiskANN with a
+ * candidate list of diskann_search_l reading diskann_beamwidth nodes per
+ * hop; others are scanned exhaustively. Quantized tables search their
+ * codes and, with a storage RERANK factor, re-rank RERANK * k hits with
+ * the floats.
+ */
 int vector_similarity_search(EpiphanyDBTable *table, const float *query_vector, size_t dimension, size_t k, void **results, size_t *num_results) {
-    /* TODO: Implement k-nearest neighbor search */
-    /* This should use the vector index for efficient search */
+    return vector_similarity_search_filtered(table, query_vector, dimension, k, NULL, results, num_results);
+}
+
+/*
+ * vector_similarity_search restricted to the vectors whose metadata holds
+ * every key and value of filter, e.g. "tenant=acme, lang=en" or
+ * {"tenant": "acme"}; NULL matches all. The filter becomes a bitmap of ids
+ * from the metadata index, deleted vectors cleared from it, and deletes
+ * alone filter with the live bitmap. Filters matching few vectors are scanned
+ * exhaustively over the bitmap, others search the index, which skips
+ * non-matching vectors as it goes and falls back to the scan when it finds
+ * fewer than k of them.
+ */
+int vector_similarity_search_filtered(EpiphanyDBTable *table, const float *query_vector, size_t dimension, size_t k, const char *filter, void **results, size_t *num_results) {
+    VectorTable *vec_table = vector_get_table(table);
+    if (!vec_table || !query_vector || !results || !num_results) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (dimension != vec_table->vector_dimension) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
     *results = NULL;
     *num_results = 0;
+
+    pthread_rwlock_rdlock(&vec_table->lock);
+    const uint64_t *live = vector_live_filter(vec_table);
+    uint64_t *evaluated = NULL;
+    size_t matches = vec_table->num_vectors - vec_table->num_deleted;
+    if (filter) {
+        int result = vector_filter_evaluate(&vec_table->metadata_index, filter, vec_table->num_vectors, &evaluated, &matches);
+        if (result != EPIPHANYDB_SUCCESS) {
+            pthread_rwlock_unlock(&vec_table->lock);
+            return result;
+        }
+        for (size_t w = 0; live && w < (vec_table->num_vectors + 63) / 64; w++) {
+            matches -= (size_t)__builtin_popcountll(evaluated[w] & ~live[w]);
+            evaluated[w] &= live[w];
+        }
+    }
+    const uint64_t *bitmap = filter ? evaluated : live;
+    if (k > matches) {
+        k = matches;
+    }
+    if (k == 0) {
+        pthread_rwlock_unlock(&vec_table->lock);
+        free(evaluated);
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    /* Codes are searched once they cover the table, int8 and binary need calibrating first */
+    const VectorCodes *codes = vec_table->codes && vec_table->codes->trained ? vec_table->codes : NULL;
+    size_t fetch = k;
+    if (codes && vec_table->storage_rerank > 0) {
+        fetch = k * vec_table->storage_rerank < matches ? k * vec_table->storage_rerank : matches;
+    }
+
+    VectorSearchResult *hits = malloc(fetch * sizeof(VectorSearchResult));
+    if (!hits) {
+        pthread_rwlock_unlock(&vec_table->lock);
+        free(evaluated);
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    size_t num_hits = 0;
+    int result = EPIPHANYDB_SUCCESS;
+    bool scan = bitmap && vector_filter_prefers_scan(vec_table, matches, fetch);
+    if (!scan && vec_table->hnsw) {
+        result = vector_hnsw_search(vec_table->hnsw, vec_table, query_vector, fetch, vec_table->ef_search, bitmap, hits,
+                                    &num_hits);
+    } else if (!scan && vec_table->ivfpq) {
+        result = vector_ivfpq_search(vec_table->ivfpq, vec_table, query_vector, fetch, vec_table->ivf_nprobe,
+                                     vec_table->ivf_rerank, bitmap, hits, &num_hits);
+    } else if (!scan && vec_table->diskann) {
+        result = vector_diskann_search(vec_table->diskann, vec_table, query_vector, fetch, vec_table->diskann_search_l,
+                                       vec_table->diskann_beamwidth, bitmap, hits, &num_hits);
+    } else {
+        scan = true;
+    }
+    if (result == EPIPHANYDB_SUCCESS && (scan || (bitmap && num_hits < fetch))) {
+        result = vector_flat_search(vec_table, codes, query_vector, bitmap, fetch, hits, &num_hits);
+    }
+
+    if (result == EPIPHANYDB_SUCCESS && codes && vec_table->storage_rerank > 0) {
+        num_hits = vector_rerank(vec_table, query_vector, hits, num_hits, k);
+    }
+    pthread_rwlock_unlock(&vec_table->lock);
+    free(evaluated);
+
+    if (result != EPIPHANYDB_SUCCESS) {
+        free(hits);
+        return result;
+    }
+    *results = hits;
+    *num_results = num_hits;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Find the k vectors nearest to each of num_queries queries stored back to
+ * back, dimension floats each. results receives a malloc'd array of
+ * num_queries * k VectorSearchResult, the row of query q starting at
+ * q * k, ordered like vector_similarity_search; num_results, an array of
+ * num_queries counts from the caller, receives the length of each row.
+ * HNSW tables interleave the graph searches of the batch and tables scanned
+ * exhaustively compute their distances as a blocked matrix product; IVF-PQ,
+ * DiskANN and quantized scans take the queries in turn.
+ */
+int vector_similarity_search_batch(EpiphanyDBTable *table, const float *queries, size_t num_queries, size_t dimension, size_t k, void **results, size_t *num_results) {
+    VectorTable *vec_table = vector_get_table(table);
+    if (!vec_table || (!queries && num_queries > 0) || !results || (!num_results && num_queries > 0)) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (dimension != vec_table->vector_dimension) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    *results = NULL;
+    if (num_queries == 0 || k == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    memset(num_results, 0, num_queries * sizeof(size_t));
+    VectorSearchResult *rows = calloc(num_queries * k, sizeof(VectorSearchResult));
+    if (!rows) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    pthread_rwlock_rdlock(&vec_table->lock);
+    const uint64_t *live = vector_live_filter(vec_table);
+    size_t matches = vec_table->num_vectors - vec_table->num_deleted;
+    size_t wanted = k < matches ? k : matches;
+    const VectorCodes *codes = vec_table->codes && vec_table->codes->trained ? vec_table->codes : NULL;
+    size_t fetch = wanted;
+    if (codes && vec_table->storage_rerank > 0) {
+        fetch = wanted * vec_table->storage_rerank < matches ? wanted * vec_table->storage_rerank : matches;
+    }
+
+    VectorSearchResult *hits = fetch > 0 ? malloc(num_queries * fetch * sizeof(VectorSearchResult)) : NULL;
+    int result = fetch == 0 || hits ? EPIPHANYDB_SUCCESS : EPIPHANYDB_ERROR_MEMORY;
+    if (result == EPIPHANYDB_SUCCESS && fetch > 0) {
+        if (vec_table->hnsw) {
+            result = vector_hnsw_search_batch(vec_table->hnsw, vec_table, queries, num_queries, fetch, vec_table->ef_search,
+                                              live, hits, num_results);
+        } else if (!codes && !vec_table->ivfpq && !vec_table->diskann) {
+            result = vector_flat_search_batch(vec_table, queries, num_queries, fetch, live, hits, num_results);
+        }
+        for (size_t q = 0; q < num_queries && result == EPIPHANYDB_SUCCESS; q++) {
+            const float *query = queries + q * dimension;
+            VectorSearchResult *row = hits + q * fetch;
+            if (vec_table->ivfpq) {
+                result = vector_ivfpq_search(vec_table->ivfpq, vec_table, query, fetch, vec_table->ivf_nprobe,
+                                             vec_table->ivf_rerank, live, row, &num_results[q]);
+            } else if (vec_table->diskann) {
+                result = vector_diskann_search(vec_table->diskann, vec_table, query, fetch, vec_table->diskann_search_l,
+                                               vec_table->diskann_beamwidth, live, row, &num_results[q]);
+            } else if (codes && !vec_table->hnsw) {
+                result = vector_flat_search(vec_table, codes, query, live, fetch, row, &num_results[q]);
+            }
+            if (result == EPIPHANYDB_SUCCESS && codes && vec_table->storage_rerank > 0) {
+                num_results[q] = vector_rerank(vec_table, query, row, num_results[q], wanted);
+            }
+            memcpy(rows + q * k, row, num_results[q] * sizeof(VectorSearchResult));
+        }
+    }
+    pthread_rwlock_unlock(&vec_table->lock);
+    free(hits);
+
+    if (result != EPIPHANYDB_SUCCESS) {
+        memset(num_results, 0, num_queries * sizeof(size_t));
+        free(rows);
+        return result;
+    }
+    *results = rows;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * Find the k vectors nearest to query_vector exactly, by scanning every
+ * live vector with its float distance whatever the index or storage mode
+ * of the table, as ground truth for the recall of approximate searches.
+ * results receives a malloc'd array ordered like vector_similarity_search.
+ */
+int vector_similarity_search_exact(EpiphanyDBTable *table, const float *query_vector, size_t dimension, size_t k, void **results, size_t *num_results) {
+    VectorTable *vec_table = vector_get_table(table);
+    if (!vec_table || !query_vector || !results || !num_results) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (dimension != vec_table->vector_dimension) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    *results = NULL;
+    *num_results = 0;
+    if (k == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    VectorSearchResult *hits = malloc(k * sizeof(VectorSearchResult));
+    if (!hits) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+    size_t num_hits = 0;
+    pthread_rwlock_rdlock(&vec_table->lock);
+    int result = vector_exact_search(vec_table, query_vector, k, vector_live_filter(vec_table), 0, hits, &num_hits);
+    pthread_rwlock_unlock(&vec_table->lock);
+
+    if (result != EPIPHANYDB_SUCCESS || num_hits == 0) {
+        free(hits);
+        return result;
+    }
+    *results = hits;
+    *num_results = num_hits;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Text side of a hybrid search, run next to the vector search */
+typedef struct VectorTextRetrieval {
+    pthread_t thread;
+    VectorTable *table;
+    const char *query;
+    size_t k;
+    VectorHybridResult *hits;
+    size_t num_hits;
+    int result;
+} VectorTextRetrieval;
+
+static void *vector_text_retrieve(void *arg) {
+    VectorTextRetrieval *retrieval = arg;
+    VectorTable *table = retrieval->table;
+
+    pthread_rwlock_rdlock(&table->lock);
+    retrieval->result = vector_text_search(&table->text_index, retrieval->query, table->num_vectors,
+                                           vector_live_filter(table), retrieval->k, retrieval->hits, &retrieval->num_hits);
+    pthread_rwlock_unlock(&table->lock);
+    return NULL;
+}
+
+/*
+ * Rank vectors by both their similarity to query_vector and the BM25
+ * relevance of their FULLTEXT metadata to text_query, NULL for none. Each
+ * side retrieves VECTOR_HYBRID_DEPTH * k candidates, the text side on a
+ * thread of its own, and the two rankings are fused with vector_weight,
+ * between 0 and 1, going to the vector one. results receives a malloc'd
+ * array of VectorHybridResult ordered by decreasing fused score.
+ */
+int vector_similarity_search_hybrid(EpiphanyDBTable *table, const float *query_vector, size_t dimension, const char *text_query, size_t k, VectorFusion fusion, float vector_weight, void **results, size_t *num_results) {
+    VectorTable *vec_table = vector_get_table(table);
+    if (!vec_table || !query_vector || !results || !num_results) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (dimension != vec_table->vector_dimension || !(vector_weight >= 0.0f && vector_weight <= 1.0f) ||
+        (fusion != VECTOR_FUSION_RRF && fusion != VECTOR_FUSION_WEIGHTED)) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+    if (!vec_table->fulltext) {
+        return EPIPHANYDB_ERROR_INDEX;
+    }
+
+    *results = NULL;
+    *num_results = 0;
+    if (k == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    size_t fetch = k * VECTOR_HYBRID_DEPTH;
+    VectorTextRetrieval retrieval = {0};
+    retrieval.table = vec_table;
+    retrieval.query = text_query;
+    retrieval.k = fetch;
+    retrieval.result = EPIPHANYDB_SUCCESS;
+    bool started = false;
+    if (text_query) {
+        retrieval.hits = malloc(fetch * sizeof(VectorHybridResult));
+        if (!retrieval.hits) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        started = pthread_create(&retrieval.thread, NULL, vector_text_retrieve, &retrieval) == 0;
+    }
+
+    void *vector_hits = NULL;
+    size_t num_vector_hits = 0;
+    int result = vector_similarity_search(table, query_vector, dimension, fetch, &vector_hits, &num_vector_hits);
+
+    /* Without a thread the text side runs after the vector side */
+    if (started) {
+        pthread_join(retrieval.thread, NULL);
+    } else if (text_query) {
+        vector_text_retrieve(&retrieval);
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = retrieval.result;
+    }
+
+    VectorHybridResult *fused = NULL;
+    size_t num_fused = 0;
+    if (result == EPIPHANYDB_SUCCESS && num_vector_hits + retrieval.num_hits > 0) {
+        fused = malloc(k * sizeof(VectorHybridResult));
+        result = fused ? vector_hybrid_fuse(vector_hits, num_vector_hits, retrieval.hits, retrieval.num_hits, fusion,
+                                            vector_weight, k, fused, &num_fused)
+                       : EPIPHANYDB_ERROR_MEMORY;
+    }
+    free(vector_hits);
+    free(retrieval.hits);
+
+    if (result != EPIPHANYDB_SUCCESS || num_fused == 0) {
+        free(fused);
+        return result;
+    }
+    *results = fused;
+    *num_results = num_fused;
     return EPIPHANYDB_SUCCESS;
 }
 
 /* Vector-specific utility functions */
 
-/* Calculate cosine similarity */
+/*
+ * Calculate cosine similarity of two arbitrary vectors. Stored vectors
+ * carry their norms, searches use vector_distance with those instead.
+ */
 float vector_cosine_similarity(const float *vec1, const float *vec2, size_t dimension) {
-    float dot_product = 0.0f;
-    float norm1 = 0.0f;
-    float norm2 = 0.0f;
-    
-    for (size_t i = 0; i < dimension; i++) {
-        dot_product += vec1[i] * vec2[i];
-        norm1 += vec1[i] * vec1[i];
-        norm2 += vec2[i] * vec2[i];
-    }
+    float norm1 = vector_norm(vec1, dimension);
+    float norm2 = vector_norm(vec2, dimension);
     
     if (norm1 == 0.0f || norm2 == 0.0f) {
         return 0.0f;
     }
     
-    return dot_product / (sqrtf(norm1) * sqrtf(norm2));
+    return vector_dot(vec1, vec2, dimension) / (norm1 * norm2);
 }
 
 /* Calculate euclidean distance */
 float vector_euclidean_distance(const float *vec1, const float *vec2, size_t dimension) {
-    float sum = 0.0f;
-    
-    for (size_t i = 0; i < dimension; i++) {
-        float diff = vec1[i] - vec2[i];
-        sum += diff * diff;
-    }
-    
-    return sqrtf(sum);
+    return sqrtf(vector_l2_squared(vec1, vec2, dimension));
 }
 
 /* Calculate manhattan distance */
 float vector_manhattan_distance(const float *vec1, const float *vec2, size_t dimension) {
-    float sum = 0.0f;
-    
-    for (size_t i = 0; i < dimension; i++) {
-        sum += fabsf(vec1[i] - vec2[i]);
+    return vector_l1(vec1, vec2, dimension);
+}
+
+/* Internal helpers shared with the other vector sources */
+
+/* Vector table attached to an open table handle */
+VectorTable *vector_get_table(EpiphanyDBTable *table) {
+    return table ? epiphanydb_table_storage_handle(table) : NULL;
+}
+
+static int vector_compare_result(const void *a, const void *b) {
+    float x = ((const VectorSearchResult *)a)->distance;
+    float y = ((const VectorSearchResult *)b)->distance;
+    return (x > y) - (x < y);
+}
+
+/* Order results by increasing distance */
+void vector_sort_results(VectorSearchResult *results, size_t num_results) {
+    qsort(results, num_results, sizeof(VectorSearchResult), vector_compare_result);
+}
+
+/*
+ * Calibrate and encode the codes of table, then build the index its schema
+ * asks for over its vectors, write lock held.
+ */
+static int vector_index_build(VectorTable *table) {
+    if (table->codes) {
+        int result = vector_codes_train(table->codes, table);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
     }
-    
-    return sum;
+
+    table->index_built = true;
+    table->index_generation++;
+    table->deleted_at_build = table->num_deleted;
+    if (table->index_type == VECTOR_INDEX_FLAT) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (table->index_type == VECTOR_INDEX_IVFPQ) {
+        VectorIVFPQ *ivfpq = NULL;
+        int result = vector_ivfpq_train(table, table->ivf_nlist, table->pq_m, 0, (uint64_t)table->num_vectors, &ivfpq);
+        for (size_t id = 0; id < table->num_vectors && result == EPIPHANYDB_SUCCESS; id++) {
+            if (vector_filter_test(vector_live_filter(table), id)) {
+                result = vector_ivfpq_add(ivfpq, table, (uint32_t)id);
+            }
+        }
+        if (result != EPIPHANYDB_SUCCESS) {
+            vector_ivfpq_free(ivfpq);
+            return result;
+        }
+        vector_ivfpq_free(table->ivfpq);
+        table->ivfpq = ivfpq;
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (table->index_type == VECTOR_INDEX_DISKANN) {
+        VectorDiskANN *diskann = NULL;
+        int result = vector_diskann_build(table, table->diskann_degree, table->diskann_build_l, table->pq_m,
+                                          table->index_file, &diskann);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+        vector_diskann_free(table->diskann);
+        table->diskann = diskann;
+        return EPIPHANYDB_SUCCESS;
+    }
+
+    VectorHNSW *hnsw = vector_hnsw_create(table->hnsw_m, table->hnsw_ef_construction, (uint64_t)table->num_vectors);
+    if (!hnsw) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    int result = vector_hnsw_build(hnsw, table, vector_live_filter(table), table->num_vectors, table->hnsw_build_threads);
+    if (result != EPIPHANYDB_SUCCESS) {
+        vector_hnsw_free(hnsw);
+        return result;
+    }
+
+    vector_hnsw_free(table->hnsw);
+    table->hnsw = hnsw;
+    return EPIPHANYDB_SUCCESS;
 }
 
-/* Build vector index (e.g., HNSW, IVF, etc.) */
+/* Build the index of table; later inserts maintain it */
 int vector_build_index(EpiphanyDBTable *table) {
-    /* TODO: Implement vector index building */
-    /* This could use algorithms like HNSW, IVF, or LSH for approximate nearest neighbor search */
-    return EPIPHANYDB_SUCCESS;
+    VectorTable *vec_table = vector_get_table(table);
+    if (!vec_table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    pthread_rwlock_wrlock(&vec_table->lock);
+    int result = vec_table->index_built ? EPIPHANYDB_SUCCESS : vector_index_build(vec_table);
+    pthread_rwlock_unlock(&vec_table->lock);
+    return result;
 }
 
-/* Rebuild vector index */
+/*
+ * Build a new HNSW graph over the live vectors of table and swap it in
+ * without stopping searches or inserts: VECTOR_MAINTENANCE_SLICE nodes are
+ * linked per hold of the read lock, then the write lock links the vectors
+ * inserted meanwhile and replaces the graph.
+ */
+static int vector_hnsw_rebuild_online(VectorTable *table) {
+    pthread_rwlock_rdlock(&table->lock);
+    uint64_t seed = table->num_vectors;
+    pthread_rwlock_unlock(&table->lock);
+    VectorHNSW *hnsw = vector_hnsw_create(table->hnsw_m, table->hnsw_ef_construction, seed);
+    if (!hnsw) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    int result = EPIPHANYDB_SUCCESS;
+    for (bool done = false; !done && result == EPIPHANYDB_SUCCESS;) {
+        pthread_rwlock_rdlock(&table->lock);
+        size_t limit = hnsw->num_nodes + VECTOR_MAINTENANCE_SLICE;
+        done = limit >= table->num_vectors;
+        if (!done) {
+            result = vector_hnsw_build(hnsw, table, vector_live_filter(table), limit, table->hnsw_build_threads);
+        }
+        pthread_rwlock_unlock(&table->lock);
+    }
+
+    pthread_rwlock_wrlock(&table->lock);
+    if (result == EPIPHANYDB_SUCCESS) {
+        result = vector_hnsw_build(hnsw, table, vector_live_filter(table), table->num_vectors, table->hnsw_build_threads);
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        vector_hnsw_free(table->hnsw);
+        table->hnsw = hnsw;
+        table->index_generation++;
+        table->deleted_at_build = table->num_deleted;
+    }
+    pthread_rwlock_unlock(&table->lock);
+
+    if (result != EPIPHANYDB_SUCCESS) {
+        vector_hnsw_free(hnsw);
+    }
+    return result;
+}
+
+/* Reconnect the HNSW graph around deleted nodes, VECTOR_MAINTENANCE_SLICE nodes per hold of the read lock */
+static int vector_hnsw_repair_online(VectorTable *table) {
+    int result = EPIPHANYDB_SUCCESS;
+    for (size_t first = 0; result == EPIPHANYDB_SUCCESS; first += VECTOR_MAINTENANCE_SLICE) {
+        pthread_rwlock_rdlock(&table->lock);
+        bool done = first >= table->hnsw->num_nodes;
+        if (!done) {
+            result = vector_hnsw_repair(table->hnsw, table, first, first + VECTOR_MAINTENANCE_SLICE);
+        }
+        pthread_rwlock_unlock(&table->lock);
+        if (done) {
+            break;
+        }
+    }
+    return result;
+}
+
+/*
+ * Compact the index of table after deletes, online for HNSW. While fewer
+ * than VECTOR_REBUILD_DELETED_RATIO of the vectors the index holds were
+ * deleted since it was built, HNSW graphs only reconnect the neighbors of
+ * deleted nodes and the other indexes keep skipping them; past it the
+ * index is rebuilt over the live vectors, HNSW graphs next to searches and
+ * inserts, IVF-PQ and DiskANN under the write lock. Tables without a built
+ * index are built.
+ */
 int vector_rebuild_index(EpiphanyDBTable *table) {
-    /* TODO: Implement vector index rebuilding */
-    return EPIPHANYDB_SUCCESS;
-}
\ No newline at end of file
+    VectorTable *vec_table = vector_get_table(table);
+    if (!vec_table) {
+        return EPIPHANYDB_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&vec_table->maintenance_mutex);
+    pthread_rwlock_rdlock(&vec_table->lock);
+    bool built = vec_table->index_built;
+    bool graph = vec_table->hnsw != NULL;
+    size_t deleted = vec_table->num_deleted - vec_table->deleted_at_build;
+    bool rebuild = deleted > 0 && (double)deleted >= VECTOR_REBUILD_DELETED_RATIO *
+                                                      (double)(vec_table->num_vectors - vec_table->deleted_at_build);
+    pthread_rwlock_unlock(&vec_table->lock);
+
+    int result = EPIPHANYDB_SUCCESS;
+    if (built && graph) {
+        result = rebuild ? vector_hnsw_rebuild_online(vec_table) : vector_hnsw_repair_online(vec_table);
+    } else if (!built || rebuild) {
+        pthread_rwlock_wrlock(&vec_table->lock);
+        result = vector_index_build(vec_table);
+        pthread_rwlock_unlock(&vec_table->lock);
+    }
+    pthread_mutex_unlock(&vec_table->maintenance_mutex);
+    return result;
+}
@@ -0,0 +1,547 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * Internal definitions shared by the vector storage engine sources
+ */
+
+#ifndef EPIPHANYDB_VECTOR_STORAGE_H
+#define EPIPHANYDB_VECTOR_STORAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "../../include/epiphanydb.h"
+
+/* Dimension of tables whose schema declares no VECTOR(n) column */
+#define VECTOR_DEFAULT_DIMENSION 768
+
+/* Largest dimension a table may declare */
+#define VECTOR_MAX_DIMENSION 65536
+
+/* Alignment of every vector in the arena, one cache line */
+#define VECTOR_ALIGNMENT 64
+
+/* Vectors the arena of a new table has room for */
+#define VECTOR_INITIAL_CAPACITY 1024
+
+/* Vector arena files: one header page, then the vectors, norms and live bits */
+#define VECTOR_ARENA_HEADER 4096
+#define VECTOR_ARENA_MAGIC 0x41525645u        /* "EVRA" */
+#define VECTOR_ARENA_VERSION 1
+
+/* HNSW defaults: neighbors per node, build and search beam widths */
+#define VECTOR_HNSW_DEFAULT_M 16
+#define VECTOR_HNSW_DEFAULT_EF_CONSTRUCTION 200
+#define VECTOR_HNSW_DEFAULT_EF_SEARCH 64
+
+/* Highest HNSW layer a node may be drawn on */
+#define VECTOR_HNSW_MAX_LEVEL 15
+
+/* Searches of a batch interleaved to overlap their memory stalls */
+#define VECTOR_HNSW_BATCH_GROUP 8
+
+/* Locks over the HNSW neighbor lists, node id modulo this picks one */
+#define VECTOR_HNSW_LINK_LOCKS 1024
+
+/* HNSW bulk builds: most threads, and node ids a thread claims at a time */
+#define VECTOR_HNSW_MAX_BUILD_THREADS 64
+#define VECTOR_HNSW_BUILD_CHUNK 64
+
+/* Exact scans: vectors per claimed block, least vector bytes per thread, most threads */
+#define VECTOR_EXACT_BLOCK_BYTES (256 * 1024)
+#define VECTOR_EXACT_THREAD_BYTES (4 * 1024 * 1024)
+#define VECTOR_EXACT_MAX_THREADS 64
+
+/* Share of vectors deleted since the last build past which vector_rebuild_index rebuilds rather than repairs */
+#define VECTOR_REBUILD_DELETED_RATIO 0.2
+
+/* Nodes an online repair or rebuild handles per hold of the table read lock */
+#define VECTOR_MAINTENANCE_SLICE 16384
+
+/* IVF-PQ defaults: coarse lists, lists probed per query, dimensions per subspace */
+#define VECTOR_IVF_DEFAULT_NLIST 256
+#define VECTOR_IVF_DEFAULT_NPROBE 16
+#define VECTOR_PQ_DEFAULT_SUBSPACE_DIMENSION 8
+
+/* Codes are 4 bits, 16 centroids per subspace */
+#define VECTOR_PQ_CENTROIDS 16
+
+/* Vectors per fast-scan block; 8-bit table entries summed in 16 bits cap the subspaces */
+#define VECTOR_PQ_BLOCK 32
+#define VECTOR_PQ_MAX_SUBSPACES 256
+
+/* DiskANN defaults: graph degree, build and search candidate lists, sector reads per hop */
+#define VECTOR_DISKANN_DEFAULT_DEGREE 64
+#define VECTOR_DISKANN_DEFAULT_BUILD_L 100
+#define VECTOR_DISKANN_DEFAULT_SEARCH_L 100
+#define VECTOR_DISKANN_DEFAULT_BEAMWIDTH 4
+#define VECTOR_DISKANN_MAX_BEAMWIDTH 16
+
+/* Pruning slack of the second Vamana pass, keeps long edges for fewer hops */
+#define VECTOR_DISKANN_ALPHA 1.2f
+
+/* Joins the key and value of a metadata term */
+#define VECTOR_TERM_SEPARATOR '\x1f'
+
+/* Slots of a new metadata index */
+#define VECTOR_METADATA_INITIAL_SLOTS 64
+
+/* Words of a new full-text index */
+#define VECTOR_TEXT_INITIAL_SLOTS 64
+
+/* BM25 term frequency saturation and document length normalization */
+#define VECTOR_BM25_K1 1.2f
+#define VECTOR_BM25_B 0.75f
+
+/* Hybrid searches: candidates each side retrieves per result, reciprocal rank fusion constant */
+#define VECTOR_HYBRID_DEPTH 4
+#define VECTOR_RRF_K 60.0f
+
+/* Unit of DiskANN index files and their reads */
+#define VECTOR_DISKANN_SECTOR 4096
+#define VECTOR_DISKANN_MAGIC 0x4e4e4b44u      /* "DKNN" */
+#define VECTOR_DISKANN_VERSION 1
+
+/* Training sample per coarse list, total sample cap and k-means iterations */
+#define VECTOR_IVF_TRAIN_PER_LIST 64
+#define VECTOR_IVF_MAX_TRAIN 65536
+#define VECTOR_IVF_TRAIN_ITERATIONS 10
+
+/* Distance between vectors; smaller is closer for every metric */
+typedef enum VectorMetric {
+    VECTOR_METRIC_COSINE = 0,  /* 1 - cosine similarity */
+    VECTOR_METRIC_EUCLIDEAN,
+    VECTOR_METRIC_MANHATTAN
+} VectorMetric;
+
+/* Index vector_build_index builds, chosen by the schema */
+typedef enum VectorIndexType {
+    VECTOR_INDEX_HNSW = 0,
+    VECTOR_INDEX_IVFPQ,
+    VECTOR_INDEX_FLAT,              /* exhaustive scans, of the codes when quantized */
+    VECTOR_INDEX_DISKANN
+} VectorIndexType;
+
+/* Representation searches read the vectors of a table in */
+typedef enum VectorStorageMode {
+    VECTOR_STORAGE_FLOAT32 = 0,
+    VECTOR_STORAGE_FLOAT16,
+    VECTOR_STORAGE_INT8,            /* per-dimension min/max scalar quantization */
+    VECTOR_STORAGE_BINARY           /* one bit per dimension, above the dimension mean */
+} VectorStorageMode;
+
+/* Instruction set of the distance kernels picked at startup */
+typedef enum VectorISA {
+    VECTOR_ISA_SCALAR = 0,
+    VECTOR_ISA_SSE,
+    VECTOR_ISA_AVX2,
+    VECTOR_ISA_AVX512
+} VectorISA;
+
+/* Search hit, results are ordered by increasing distance */
+typedef struct VectorSearchResult {
+    uint64_t id;
+    float distance;
+} VectorSearchResult;
+
+/* How hybrid searches combine vector and text rankings */
+typedef enum VectorFusion {
+    VECTOR_FUSION_RRF = 0,          /* weighted reciprocal rank fusion */
+    VECTOR_FUSION_WEIGHTED          /* weighted sum of min-max normalized scores */
+} VectorFusion;
+
+/* Hybrid search hit, results are ordered by decreasing score */
+typedef struct VectorHybridResult {
+    uint64_t id;
+    float score;                    /* fused */
+    float distance;                 /* INFINITY when only the text matched */
+    float text_score;               /* BM25, 0 when only the vector matched */
+} VectorHybridResult;
+
+/* Candidate node of a graph search */
+typedef struct VectorCandidate {
+    float distance;
+    uint32_t id;
+} VectorCandidate;
+
+/* Binary heap of candidates, closest or farthest on top */
+typedef struct VectorHeap {
+    VectorCandidate *items;
+    size_t size;
+    size_t capacity;
+    bool max_heap;
+} VectorHeap;
+
+/*
+ * Visited set of one graph search: a node is visited when its mark equals
+ * the epoch of the search, so starting a search costs an increment rather
+ * than clearing a set.
+ */
+typedef struct VectorVisited {
+    uint32_t *marks;
+    size_t capacity;
+    uint32_t epoch;
+    struct VectorVisited *next;
+} VectorVisited;
+
+/*
+ * Hierarchical navigable small world graph over the vectors of a table.
+ * Layer 0 adjacency lives in one array of fixed-size blocks, a count
+ * followed by up to m0 neighbor ids, so a hop reads one contiguous block;
+ * the few nodes drawn on higher layers get one block of m ids per layer.
+ *
+ * Nodes are added under the table write lock and linked under its read
+ * lock, next to searches and other inserts. Writers of a neighbor list
+ * hold its link lock and publish the ids before the count; readers take
+ * no lock and may see a list mid-update, which still holds only valid
+ * ids. Searches start from the entry point alone and take its level from
+ * levels, so the two never disagree.
+ */
+typedef struct VectorHNSW {
+    size_t m;                       /* neighbors per node above layer 0 */
+    size_t m0;                      /* neighbors per node on layer 0 */
+    size_t ef_construction;
+    double level_mult;              /* 1 / ln(m) */
+    uint64_t rng;
+    uint32_t entry_point;
+    int max_level;                  /* -1 while empty */
+    size_t num_nodes;
+    size_t capacity;
+    uint8_t *levels;
+    uint32_t *level0;               /* capacity blocks of 1 + m0 words */
+    uint32_t **upper;               /* levels[i] blocks of 1 + m words, layers 1.. */
+    VectorVisited *visited_pool;
+    pthread_mutex_t pool_mutex;
+    pthread_mutex_t entry_mutex;    /* held by inserts that raise max_level */
+    pthread_mutex_t *link_locks;    /* VECTOR_HNSW_LINK_LOCKS */
+} VectorHNSW;
+
+/*
+ * Inverted list of an IVF-PQ index. Codes are kept in blocks of
+ * VECTOR_PQ_BLOCK vectors laid out for in-register table lookups: for each
+ * subspace, 16 bytes whose low nibbles are the codes of vectors 0..15 of
+ * the block and whose high nibbles are those of vectors 16..31.
+ */
+typedef struct VectorIVFList {
+    uint32_t *ids;
+    uint8_t *codes;
+    size_t size;
+    size_t capacity;                /* multiple of VECTOR_PQ_BLOCK */
+} VectorIVFList;
+
+/*
+ * Inverted file with product quantization. Each vector belongs to the list
+ * of its nearest coarse centroid and is stored as 4-bit codes of its
+ * residual to that centroid, one per subspace. Cosine tables quantize unit
+ * vectors, whose squared L2 distance is twice the cosine distance.
+ */
+typedef struct VectorIVFPQ {
+    VectorMetric metric;
+    size_t dimension;
+    size_t nlist;
+    size_t pq_m;                    /* subspaces */
+    size_t code_m;                  /* pq_m rounded up to even, padding codes are 0 */
+    size_t sub_dimension;
+    float *centroids;               /* nlist * dimension */
+    float *codebooks;               /* pq_m * VECTOR_PQ_CENTROIDS * sub_dimension */
+    VectorIVFList *lists;
+    size_t num_vectors;
+} VectorIVFPQ;
+
+/*
+ * Compressed copies of the vectors of a table, searched in place of the
+ * floats, which remain for index builds and exact re-ranking. int8 codes
+ * map [min, max] of each dimension onto 0..255 and binary codes keep one
+ * bit per dimension; both are calibrated on the vectors present when the
+ * index is built. float16 needs no calibration.
+ */
+typedef struct VectorCodes {
+    VectorStorageMode mode;
+    size_t dimension;
+    size_t code_size;               /* bytes per vector, multiple of VECTOR_ALIGNMENT */
+    uint8_t *data;                  /* capacity * code_size bytes, aligned */
+    size_t capacity;
+    size_t num_vectors;
+    bool trained;
+    float *offset;                  /* int8 minimums, binary thresholds */
+    float *scale;                   /* int8 (max - min) / 255 */
+} VectorCodes;
+
+/*
+ * SSD-resident Vamana graph. The index file starts with a header sector,
+ * followed by one record per node, the full vector then a neighbor count
+ * and degree neighbor ids, packed into VECTOR_DISKANN_SECTOR byte sectors
+ * that no record straddles unless it needs several sectors on its own.
+ * Only PQ codes of the vectors stay in memory to steer searches; the
+ * records of the nodes a search expands are read in batches.
+ */
+typedef struct VectorDiskANN {
+    int fd;
+    size_t dimension;
+    size_t degree;
+    size_t num_nodes;
+    size_t node_size;               /* bytes per record */
+    size_t nodes_per_sector;        /* 0 when a record spans sectors */
+    size_t sectors_per_node;
+    uint32_t medoid;                /* entry point, nearest the centroid */
+    VectorIVFPQ *pq;                /* single list, codes in node order */
+} VectorDiskANN;
+
+/* Ids of the vectors whose metadata holds one key and value, ascending */
+typedef struct VectorPostings {
+    char *term;                     /* key, VECTOR_TERM_SEPARATOR, value */
+    uint32_t *ids;
+    size_t size;
+    size_t capacity;
+} VectorPostings;
+
+/* Inverted index of vector metadata, an open addressing table of terms */
+typedef struct VectorMetadataIndex {
+    VectorPostings *slots;          /* term NULL for empty slots */
+    size_t num_slots;               /* power of two */
+    size_t num_terms;
+} VectorMetadataIndex;
+
+/* Vectors holding a word of the full-text index, ascending ids with the times they hold it */
+typedef struct VectorTextPosting {
+    uint32_t id;
+    uint32_t frequency;
+} VectorTextPosting;
+
+typedef struct VectorTextTerm {
+    char *word;                     /* lowercase */
+    VectorTextPosting *postings;
+    size_t size;
+    size_t capacity;
+} VectorTextTerm;
+
+/*
+ * BM25 index of the words in vector metadata values, or in the values of
+ * one key, an open addressing table of words next to the word count of
+ * every vector.
+ */
+typedef struct VectorTextIndex {
+    const char *key;                /* NULL for every value */
+    VectorTextTerm *slots;          /* word NULL for empty slots */
+    size_t num_slots;               /* power of two */
+    size_t num_terms;
+    uint32_t *lengths;              /* words per vector id */
+    size_t lengths_capacity;
+    size_t num_documents;           /* vectors with at least one word */
+    uint64_t total_length;
+} VectorTextIndex;
+
+/* Vector storage specific structures */
+typedef struct VectorStorageContext {
+    char *data_directory;
+    size_t default_vector_dimension;
+    char *distance_metric;  /* euclidean, cosine, manhattan */
+    bool enable_indexing;
+    struct VectorTable *tables;     /* catalog of created tables */
+    pthread_mutex_t catalog_mutex;
+} VectorStorageContext;
+
+/*
+ * First page of a vector arena file. The schema makes the file enough to
+ * open the table again; num_vectors is stored after every append.
+ */
+typedef struct VectorArenaHeader {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t dimension;
+    uint64_t stride;
+    uint64_t capacity;
+    uint64_t num_vectors;
+    uint64_t reserved[2];
+    char schema[VECTOR_ARENA_HEADER - 8 * sizeof(uint64_t)];
+} VectorArenaHeader;
+
+/*
+ * Vectors are numbered in insertion order and stored back to back in the
+ * arena file, each padded to a multiple of VECTOR_ALIGNMENT bytes, followed
+ * by their L2 norms computed at insert time and the live bits. The file is
+ * mapped shared, so vectors are read in place from the page cache.
+ */
+typedef struct VectorTable {
+    char *table_name;
+    char *schema;
+    char *vector_file;
+    char *metadata_file;
+    char *index_file;
+    size_t vector_dimension;
+    size_t num_vectors;
+    char *distance_metric;
+    VectorMetric metric;
+    size_t stride;                  /* floats from one vector to the next */
+    float *vectors;                 /* capacity * stride floats, aligned */
+    float *norms;
+    char **metadata;                /* NULL for vectors inserted without */
+    VectorMetadataIndex metadata_index;
+    uint64_t *live;                 /* bit per vector, cleared when it is deleted */
+    size_t num_deleted;
+    size_t deleted_at_build;        /* num_deleted when the index was last built */
+    size_t capacity;
+    VectorArenaHeader *arena;       /* mapping of vector_file, NULL until created */
+    size_t arena_size;
+    int arena_fd;
+    int metadata_fd;                /* append only log of metadata_file, -1 until opened */
+    size_t hnsw_m;                  /* HNSW parameters from the schema */
+    size_t hnsw_ef_construction;
+    size_t hnsw_build_threads;      /* 0 for one per allowed CPU */
+    size_t ef_search;               /* beam width of index searches */
+    VectorHNSW *hnsw;               /* NULL until vector_build_index */
+    VectorIndexType index_type;
+    size_t ivf_nlist;               /* IVF-PQ parameters from the schema */
+    size_t pq_m;
+    size_t ivf_nprobe;
+    size_t ivf_rerank;              /* exact re-rank of rerank * k candidates, 0 for none */
+    VectorIVFPQ *ivfpq;             /* NULL until vector_build_index */
+    size_t diskann_degree;          /* DiskANN parameters from the schema */
+    size_t diskann_build_l;
+    size_t diskann_search_l;
+    size_t diskann_beamwidth;
+    VectorDiskANN *diskann;         /* NULL until vector_build_index */
+    bool index_built;
+    uint64_t index_generation;      /* counts index builds */
+    VectorStorageMode storage_mode;
+    size_t storage_rerank;          /* exact re-rank of rerank * k code hits, 0 for none */
+    VectorCodes *codes;             /* NULL for float32 tables */
+    bool fulltext;                  /* FULLTEXT clause in the schema */
+    char *fulltext_key;             /* metadata key it indexes, NULL for all */
+    VectorTextIndex text_index;
+    pthread_rwlock_t lock;          /* searches read, inserts write then link HNSW nodes reading */
+    pthread_mutex_t maintenance_mutex;  /* held by vector_rebuild_index */
+    struct VectorTable *next;
+} VectorTable;
+
+typedef struct Vector {
+    float *data;
+    size_t dimension;
+    char *metadata;  /* JSON or key-value pairs */
+} Vector;
+
+/* Distance kernels over n floats, picked once for the running CPU */
+typedef float (*VectorDistanceFn)(const float *a, const float *b, size_t n);
+
+/* Storage engine entry points (vector_storage.c) */
+int vector_storage_init(EpiphanyDBContext *ctx);
+int vector_storage_cleanup(EpiphanyDBContext *ctx);
+int vector_create_table(EpiphanyDBContext *ctx, const char *table_name, const char *schema);
+int vector_open_table(EpiphanyDBContext *ctx, const char *table_name, EpiphanyDBTable **table);
+int vector_close_table(EpiphanyDBTable *table);
+int vector_insert_vector(EpiphanyDBTable *table, const float *vector_data, size_t dimension, const char *metadata);
+int vector_update_vector(EpiphanyDBTable *table, const void *key, const float *vector_data, size_t dimension, const char *metadata);
+int vector_delete_vector(EpiphanyDBTable *table, const void *key);
+int vector_similarity_search(EpiphanyDBTable *table, const float *query_vector, size_t dimension, size_t k, void **results, size_t *num_results);
+int vector_similarity_search_filtered(EpiphanyDBTable *table, const float *query_vector, size_t dimension, size_t k, const char *filter, void **results, size_t *num_results);
+int vector_similarity_search_batch(EpiphanyDBTable *table, const float *queries, size_t num_queries, size_t dimension, size_t k, void **results, size_t *num_results);
+int vector_similarity_search_exact(EpiphanyDBTable *table, const float *query_vector, size_t dimension, size_t k, void **results, size_t *num_results);
+int vector_similarity_search_hybrid(EpiphanyDBTable *table, const float *query_vector, size_t dimension, const char *text_query, size_t k, VectorFusion fusion, float vector_weight, void **results, size_t *num_results);
+float vector_cosine_similarity(const float *vec1, const float *vec2, size_t dimension);
+float vector_euclidean_distance(const float *vec1, const float *vec2, size_t dimension);
+float vector_manhattan_distance(const float *vec1, const float *vec2, size_t dimension);
+int vector_build_index(EpiphanyDBTable *table);
+int vector_rebuild_index(EpiphanyDBTable *table);
+
+/* Table access (vector_storage.c) */
+VectorTable *vector_get_table(EpiphanyDBTable *table);
+void vector_sort_results(VectorSearchResult *results, size_t num_results);
+
+static inline const float *vector_at(const VectorTable *table, size_t id) {
+    return table->vectors + id * table->stride;
+}
+
+/* Whether id passes filter, a bitmap from vector_filter_evaluate or NULL for none */
+static inline bool vector_filter_test(const uint64_t *filter, size_t id) {
+    return !filter || (filter[id / 64] >> (id % 64)) & 1;
+}
+
+/* Filter of the vectors not deleted, NULL while none are */
+static inline const uint64_t *vector_live_filter(const VectorTable *table) {
+    return table->num_deleted > 0 ? table->live : NULL;
+}
+
+/* HNSW index (vector_hnsw.c) */
+int vector_heap_push(VectorHeap *heap, VectorCandidate candidate);
+VectorCandidate vector_heap_pop(VectorHeap *heap);
+void vector_heap_free(VectorHeap *heap);
+VectorHNSW *vector_hnsw_create(size_t m, size_t ef_construction, uint64_t seed);
+void vector_hnsw_free(VectorHNSW *hnsw);
+int vector_hnsw_add_node(VectorHNSW *hnsw, uint32_t id);
+int vector_hnsw_connect(VectorHNSW *hnsw, const VectorTable *table, uint32_t id);
+int vector_hnsw_insert(VectorHNSW *hnsw, const VectorTable *table, uint32_t id);
+int vector_hnsw_build(VectorHNSW *hnsw, const VectorTable *table, const uint64_t *live, size_t limit, size_t num_threads);
+int vector_hnsw_repair(VectorHNSW *hnsw, const VectorTable *table, size_t first, size_t last);
+int vector_hnsw_search(VectorHNSW *hnsw, const VectorTable *table, const float *query, size_t k, size_t ef, const uint64_t *filter, VectorSearchResult *results, size_t *num_results);
+int vector_hnsw_search_batch(VectorHNSW *hnsw, const VectorTable *table, const float *queries, size_t num_queries, size_t k, size_t ef, const uint64_t *filter, VectorSearchResult *results, size_t *num_results);
+size_t vector_hnsw_memory_usage(const VectorHNSW *hnsw);
+
+/* IVF-PQ index (vector_ivfpq.c) */
+int vector_ivfpq_train(const VectorTable *table, size_t nlist, size_t pq_m, size_t num_train, uint64_t seed, VectorIVFPQ **ivfpq);
+void vector_ivfpq_free(VectorIVFPQ *ivfpq);
+int vector_ivfpq_add(VectorIVFPQ *ivfpq, const VectorTable *table, uint32_t id);
+int vector_ivfpq_search(const VectorIVFPQ *ivfpq, const VectorTable *table, const float *query, size_t k, size_t nprobe, size_t rerank, const uint64_t *filter, VectorSearchResult *results, size_t *num_results);
+size_t vector_ivfpq_memory_usage(const VectorIVFPQ *ivfpq);
+int vector_ivfpq_query_table(const VectorIVFPQ *ivfpq, size_t list, const float *query, float *table);
+float vector_ivfpq_code_distance(const VectorIVFPQ *ivfpq, size_t list, size_t position, const float *table);
+
+/* DiskANN index (vector_diskann.c) */
+int vector_diskann_build(const VectorTable *table, size_t degree, size_t build_l, size_t pq_m, const char *path, VectorDiskANN **diskann);
+void vector_diskann_free(VectorDiskANN *diskann);
+int vector_diskann_search(const VectorDiskANN *diskann, const VectorTable *table, const float *query, size_t k, size_t search_l, size_t beamwidth, const uint64_t *filter, VectorSearchResult *results, size_t *num_results);
+size_t vector_diskann_memory_usage(const VectorDiskANN *diskann);
+
+/* Batched exhaustive search (vector_batch.c) */
+int vector_flat_search_batch(const VectorTable *table, const float *queries, size_t num_queries, size_t k, const uint64_t *filter, VectorSearchResult *results, size_t *num_results);
+
+/* Exact search (vector_exact.c) */
+int vector_exact_search(const VectorTable *table, const float *query, size_t k, const uint64_t *filter, size_t num_threads, VectorSearchResult *results, size_t *num_results);
+
+/* Metadata filters (vector_filter.c) */
+typedef int (*VectorTermFn)(void *context, const char *key, size_t key_len, const char *value, size_t value_len);
+int vector_metadata_parse(const char *text, VectorTermFn fn, void *context);
+int vector_metadata_index_add(VectorMetadataIndex *index, const char *metadata, uint32_t id);
+void vector_metadata_index_remove(VectorMetadataIndex *index, uint32_t id);
+void vector_metadata_index_free(VectorMetadataIndex *index);
+int vector_filter_evaluate(const VectorMetadataIndex *index, const char *filter, size_t num_vectors, uint64_t **bitmap, size_t *count);
+
+/* Full-text index and hybrid fusion (vector_text.c) */
+int vector_text_index_add(VectorTextIndex *index, const char *metadata, uint32_t id);
+void vector_text_index_remove(VectorTextIndex *index, uint32_t id);
+void vector_text_index_free(VectorTextIndex *index);
+int vector_text_search(const VectorTextIndex *index, const char *query, size_t num_vectors, const uint64_t *filter, size_t k, VectorHybridResult *results, size_t *num_results);
+int vector_hybrid_fuse(const VectorSearchResult *vector_hits, size_t num_vector_hits, const VectorHybridResult *text_hits, size_t num_text_hits, VectorFusion fusion, float vector_weight, size_t k, VectorHybridResult *results, size_t *num_results);
+
+/* Quantized storage (vector_quantize.c) */
+VectorCodes *vector_codes_create(VectorStorageMode mode, size_t dimension);
+void vector_codes_free(VectorCodes *codes);
+int vector_codes_train(VectorCodes *codes, const VectorTable *table);
+int vector_codes_encode(VectorCodes *codes, const float *vector, size_t id);
+void vector_codes_encode_query(const VectorCodes *codes, const float *query, uint8_t *bits);
+float vector_codes_distance(const VectorCodes *codes, VectorMetric metric, size_t id, float norm, const float *query, float query_norm, const uint8_t *query_bits);
+size_t vector_codes_memory_usage(const VectorCodes *codes);
+const char *vector_storage_mode_name(VectorStorageMode mode);
+float vector_half_to_float(uint16_t half);
+uint16_t vector_float_to_half(float value);
+
+/* Arena files (vector_arena.c) */
+int vector_arena_create(VectorTable *table, size_t capacity);
+int vector_arena_open(VectorTable *table);
+int vector_arena_read_schema(const char *path, char **schema);
+int vector_arena_grow(VectorTable *table, size_t capacity);
+int vector_arena_append_metadata(VectorTable *table, size_t id, const char *metadata);
+void vector_arena_drop_metadata(VectorTable *table, const char *metadata);
+int vector_arena_load_metadata(VectorTable *table);
+void vector_arena_close(VectorTable *table);
+
+/* Distance kernels (vector_distance.c) */
+float vector_dot(const float *a, const float *b, size_t n);
+float vector_l2_squared(const float *a, const float *b, size_t n);
+float vector_l1(const float *a, const float *b, size_t n);
+float vector_norm(const float *a, size_t n);
+VectorISA vector_isa(void);
+const char *vector_isa_name(VectorISA isa);
+float vector_distance(VectorMetric metric, const float *a, float norm_a, const float *b, float norm_b, size_t n);
+
+#endif /* EPIPHANYDB_VECTOR_STORAGE_H */
@@ -0,0 +1,409 @@
+/*
+ * EpiphanyDB Vector Storage Engine
+ *
+ * Full-text index and hybrid fusion. The metadata values of every vector,
+ * or those of the key the FULLTEXT clause names, are split into lowercase
+ * words, each word keeping the ascending ids of the vectors holding it
+ * with their counts. Text queries score the vectors holding their words
+ * with BM25. Hybrid searches fuse such a ranking with a vector ranking,
+ * by reciprocal rank or by a weighted sum of min-max normalized scores.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "../../include/epiphanydb.h"
+#include "vector_storage.h"
+
+/* Words */
+
+/* ASCII letters and digits, and every byte of multibyte UTF-8 sequences */
+static bool vector_word_char(char c) {
+    return isalnum((unsigned char)c) || (unsigned char)c >= 0x80;
+}
+
+typedef int (*VectorWordFn)(void *context, const char *word, size_t len);
+
+/* Call fn for every word of text, lowercased into buffer, which holds len bytes */
+static int vector_text_words(const char *text, size_t len, char *buffer, VectorWordFn fn, void *context) {
+    size_t i = 0;
+    while (i < len) {
+        while (i < len && !vector_word_char(text[i])) {
+            i++;
+        }
+        size_t word_len = 0;
+        while (i < len && vector_word_char(text[i])) {
+            buffer[word_len++] = (char)tolower((unsigned char)text[i++]);
+        }
+        if (word_len > 0) {
+            int result = fn(context, buffer, word_len);
+            if (result != EPIPHANYDB_SUCCESS) {
+                return result;
+            }
+        }
+    }
+    return EPIPHANYDB_SUCCESS;
+}
+
+static uint64_t vector_word_hash(const char *word, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)word[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* Slot of the word, or of the empty slot it would take */
+static VectorTextTerm *vector_text_slot(const VectorTextIndex *index, const char *word, size_t len) {
+    size_t mask = index->num_slots - 1;
+    size_t slot = (size_t)vector_word_hash(word, len) & mask;
+
+    while (index->slots[slot].word &&
+           (strncmp(index->slots[slot].word, word, len) != 0 || index->slots[slot].word[len] != '\0')) {
+        slot = (slot + 1) & mask;
+    }
+    return &index->slots[slot];
+}
+
+static int vector_text_grow(VectorTextIndex *index) {
+    size_t num_slots = index->num_slots ? index->num_slots * 2 : VECTOR_TEXT_INITIAL_SLOTS;
+    VectorTextTerm *slots = calloc(num_slots, sizeof(VectorTextTerm));
+    if (!slots) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    VectorTextIndex grown = *index;
+    grown.slots = slots;
+    grown.num_slots = num_slots;
+    for (size_t i = 0; i < index->num_slots; i++) {
+        VectorTextTerm *term = &index->slots[i];
+        if (term->word) {
+            *vector_text_slot(&grown, term->word, strlen(term->word)) = *term;
+        }
+    }
+    free(index->slots);
+    *index = grown;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/* Indexing */
+
+typedef struct VectorTextInsert {
+    VectorTextIndex *index;
+    uint32_t id;
+    uint32_t length;                /* words of the vector so far */
+    char *buffer;
+    size_t buffer_size;
+} VectorTextInsert;
+
+static int vector_text_insert_word(void *context, const char *word, size_t len) {
+    VectorTextInsert *insert = context;
+    VectorTextIndex *index = insert->index;
+
+    if (2 * (index->num_terms + 1) > index->num_slots) {
+        int result = vector_text_grow(index);
+        if (result != EPIPHANYDB_SUCCESS) {
+            return result;
+        }
+    }
+
+    VectorTextTerm *term = vector_text_slot(index, word, len);
+    if (!term->word) {
+        term->word = strndup(word, len);
+        if (!term->word) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        index->num_terms++;
+    }
+    insert->length++;
+
+    /* Ids arrive in increasing order, a repeated word counts in the last posting */
+    if (term->size > 0 && term->postings[term->size - 1].id == insert->id) {
+        term->postings[term->size - 1].frequency++;
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (term->size == term->capacity) {
+        size_t capacity = term->capacity ? term->capacity * 2 : 4;
+        VectorTextPosting *postings = realloc(term->postings, capacity * sizeof(VectorTextPosting));
+        if (!postings) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        term->postings = postings;
+        term->capacity = capacity;
+    }
+    term->postings[term->size].id = insert->id;
+    term->postings[term->size].frequency = 1;
+    term->size++;
+    return EPIPHANYDB_SUCCESS;
+}
+
+static int vector_text_insert_value(void *context, const char *key, size_t key_len, const char *value, size_t value_len) {
+    VectorTextInsert *insert = context;
+    const char *wanted = insert->index->key;
+
+    if (wanted && (strlen(wanted) != key_len || strncmp(wanted, key, key_len) != 0)) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (value_len > insert->buffer_size) {
+        char *buffer = realloc(insert->buffer, value_len);
+        if (!buffer) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        insert->buffer = buffer;
+        insert->buffer_size = value_len;
+    }
+    return vector_text_words(value, value_len, insert->buffer, vector_text_insert_word, insert);
+}
+
+/* Index the words of metadata under id, which must exceed every id indexed before */
+int vector_text_index_add(VectorTextIndex *index, const char *metadata, uint32_t id) {
+    if (!metadata) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    if (id >= index->lengths_capacity) {
+        size_t capacity = index->lengths_capacity ? index->lengths_capacity : VECTOR_INITIAL_CAPACITY;
+        while (capacity <= id) {
+            capacity *= 2;
+        }
+        uint32_t *lengths = realloc(index->lengths, capacity * sizeof(uint32_t));
+        if (!lengths) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        memset(lengths + index->lengths_capacity, 0, (capacity - index->lengths_capacity) * sizeof(uint32_t));
+        index->lengths = lengths;
+        index->lengths_capacity = capacity;
+    }
+
+    VectorTextInsert insert = {index, id, 0, NULL, 0};
+    int result = vector_metadata_parse(metadata, vector_text_insert_value, &insert);
+    free(insert.buffer);
+
+    index->lengths[id] = insert.length;
+    index->total_length += insert.length;
+    if (insert.length > 0) {
+        index->num_documents++;
+    }
+    if (result != EPIPHANYDB_SUCCESS) {
+        vector_text_index_remove(index, id);
+    }
+    return result;
+}
+
+/* Drop id, the last id indexed, from every word and from the statistics */
+void vector_text_index_remove(VectorTextIndex *index, uint32_t id) {
+    for (size_t i = 0; i < index->num_slots; i++) {
+        VectorTextTerm *term = &index->slots[i];
+        if (term->size > 0 && term->postings[term->size - 1].id == id) {
+            term->size--;
+        }
+    }
+    if (id < index->lengths_capacity) {
+        index->total_length -= index->lengths[id];
+        if (index->lengths[id] > 0) {
+            index->num_documents--;
+        }
+        index->lengths[id] = 0;
+    }
+}
+
+void vector_text_index_free(VectorTextIndex *index) {
+    for (size_t i = 0; i < index->num_slots; i++) {
+        free(index->slots[i].word);
+        free(index->slots[i].postings);
+    }
+    free(index->slots);
+    free(index->lengths);
+    memset(index, 0, sizeof(VectorTextIndex));
+}
+
+/* Searches */
+
+/* Higher scores first, then lower ids */
+static int vector_hybrid_compare_score(const void *a, const void *b) {
+    const VectorHybridResult *x = a;
+    const VectorHybridResult *y = b;
+    if (x->score != y->score) {
+        return x->score > y->score ? -1 : 1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+typedef struct VectorTextQuery {
+    const VectorTextIndex *index;
+    const VectorTextTerm **terms;   /* distinct words of the query held by some vector */
+    size_t size;
+    size_t capacity;
+} VectorTextQuery;
+
+static int vector_text_lookup_word(void *context, const char *word, size_t len) {
+    VectorTextQuery *query = context;
+    if (query->index->num_slots == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    const VectorTextTerm *term = vector_text_slot(query->index, word, len);
+    if (!term->word) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    for (size_t i = 0; i < query->size; i++) {
+        if (query->terms[i] == term) {
+            return EPIPHANYDB_SUCCESS;
+        }
+    }
+
+    if (query->size == query->capacity) {
+        size_t capacity = query->capacity ? query->capacity * 2 : 4;
+        const VectorTextTerm **terms = realloc(query->terms, capacity * sizeof(VectorTextTerm *));
+        if (!terms) {
+            return EPIPHANYDB_ERROR_MEMORY;
+        }
+        query->terms = terms;
+        query->capacity = capacity;
+    }
+    query->terms[query->size++] = term;
+    return EPIPHANYDB_SUCCESS;
+}
+
+/*
+ * The k vectors below num_vectors and in filter, NULL for all, that best
+ * match the words of query by BM25, read lock held. results receive up to
+ * k hits by decreasing text_score, then increasing id, with score equal to it.
+ */
+int vector_text_search(const VectorTextIndex *index, const char *query, size_t num_vectors, const uint64_t *filter, size_t k, VectorHybridResult *results, size_t *num_results) {
+    *num_results = 0;
+    size_t len = strlen(query);
+    VectorTextQuery lookup = {index, NULL, 0, 0};
+    char *buffer = malloc(len + 1);
+    int result = buffer ? vector_text_words(query, len, buffer, vector_text_lookup_word, &lookup) : EPIPHANYDB_ERROR_MEMORY;
+    free(buffer);
+    if (result != EPIPHANYDB_SUCCESS || lookup.size == 0 || k == 0 || num_vectors == 0) {
+        free(lookup.terms);
+        return result;
+    }
+
+    /* Scores accumulate per vector, touched lists the vectors scored */
+    float *scores = calloc(num_vectors, sizeof(float));
+    uint32_t *touched = malloc(num_vectors * sizeof(uint32_t));
+    size_t num_touched = 0;
+    if (!scores || !touched) {
+        result = EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    double documents = (double)index->num_documents;
+    double average_length = index->num_documents ? (double)index->total_length / documents : 1.0;
+    for (size_t t = 0; t < lookup.size && result == EPIPHANYDB_SUCCESS; t++) {
+        const VectorTextTerm *term = lookup.terms[t];
+        double holders = (double)term->size;
+        float idf = (float)log(1.0 + (documents - holders + 0.5) / (holders + 0.5));
+        for (size_t i = 0; i < term->size && term->postings[i].id < num_vectors; i++) {
+            uint32_t id = term->postings[i].id;
+            if (!vector_filter_test(filter, id)) {
+                continue;
+            }
+            float frequency = (float)term->postings[i].frequency;
+            float norm = VECTOR_BM25_K1 * (1.0f - VECTOR_BM25_B + VECTOR_BM25_B * (float)(index->lengths[id] / average_length));
+            if (scores[id] == 0.0f) {
+                touched[num_touched++] = id;
+            }
+            scores[id] += idf * frequency * (VECTOR_BM25_K1 + 1.0f) / (frequency + norm);
+        }
+    }
+
+    /* Highest scores kept in a max-heap of negated scores */
+    VectorHeap best = {NULL, 0, 0, true};
+    for (size_t i = 0; i < num_touched && result == EPIPHANYDB_SUCCESS; i++) {
+        VectorCandidate candidate = {-scores[touched[i]], touched[i]};
+        if (best.size < k) {
+            result = vector_heap_push(&best, candidate);
+        } else if (candidate.distance < best.items[0].distance) {
+            vector_heap_pop(&best);
+            result = vector_heap_push(&best, candidate);
+        }
+    }
+    if (result == EPIPHANYDB_SUCCESS) {
+        *num_results = best.size;
+        while (best.size > 0) {
+            VectorCandidate worst = vector_heap_pop(&best);
+            VectorHybridResult *hit = &results[best.size];
+            hit->id = worst.id;
+            hit->score = -worst.distance;
+            hit->distance = INFINITY;
+            hit->text_score = -worst.distance;
+        }
+        qsort(results, *num_results, sizeof(VectorHybridResult), vector_hybrid_compare_score);
+    }
+
+    vector_heap_free(&best);
+    free(touched);
+    free(scores);
+    free(lookup.terms);
+    return result;
+}
+
+/* Fusion */
+
+static int vector_hybrid_compare_id(const void *a, const void *b) {
+    uint64_t x = ((const VectorHybridResult *)a)->id;
+    uint64_t y = ((const VectorHybridResult *)b)->id;
+    return (x > y) - (x < y);
+}
+
+/* Weight of the hit at rank, from 0, of a ranking whose values span [first, last] */
+static float vector_hybrid_contribution(VectorFusion fusion, size_t rank, float value, float first, float last) {
+    if (fusion == VECTOR_FUSION_RRF) {
+        return 1.0f / (VECTOR_RRF_K + (float)(rank + 1));
+    }
+    return first == last ? 1.0f : (value - last) / (first - last);
+}
+
+/*
+ * Fuse vector hits, by increasing distance, with text hits, by decreasing
+ * text_score, giving the vector ranking vector_weight and the text ranking
+ * the rest. A hit missing from one ranking gets nothing from it. results
+ * receive the k best by decreasing score.
+ */
+int vector_hybrid_fuse(const VectorSearchResult *vector_hits, size_t num_vector_hits, const VectorHybridResult *text_hits, size_t num_text_hits, VectorFusion fusion, float vector_weight, size_t k, VectorHybridResult *results, size_t *num_results) {
+    *num_results = 0;
+    size_t total = num_vector_hits + num_text_hits;
+    if (total == 0 || k == 0) {
+        return EPIPHANYDB_SUCCESS;
+    }
+    VectorHybridResult *fused = malloc(total * sizeof(VectorHybridResult));
+    if (!fused) {
+        return EPIPHANYDB_ERROR_MEMORY;
+    }
+
+    /* Negated distances make both rankings descending */
+    for (size_t i = 0; i < num_vector_hits; i++) {
+        fused[i].id = vector_hits[i].id;
+        fused[i].distance = vector_hits[i].distance;
+        fused[i].text_score = 0.0f;
+        fused[i].score = vector_weight * vector_hybrid_contribution(fusion, i, -vector_hits[i].distance,
+                                                                    -vector_hits[0].distance,
+                                                                    -vector_hits[num_vector_hits - 1].distance);
+    }
+    qsort(fused, num_vector_hits, sizeof(VectorHybridResult), vector_hybrid_compare_id);
+
+    size_t size = num_vector_hits;
+    for (size_t i = 0; i < num_text_hits; i++) {
+        float contribution = (1.0f - vector_weight) * vector_hybrid_contribution(fusion, i, text_hits[i].text_score,
+                                                                                 text_hits[0].text_score,
+                                                                                 text_hits[num_text_hits - 1].text_score);
+        VectorHybridResult *hit = bsearch(&text_hits[i], fused, num_vector_hits, sizeof(VectorHybridResult),
+                                          vector_hybrid_compare_id);
+        if (!hit) {
+            hit = &fused[size++];
+            hit->id = text_hits[i].id;
+            hit->distance = INFINITY;
+            hit->score = 0.0f;
+        }
+        hit->text_score = text_hits[i].text_score;
+        hit->score += contribution;
+    }
+
+    qsort(fused, size, sizeof(VectorHybridResult), vector_hybrid_compare_score);
+    *num_results = size < k ? size : k;
+    memcpy(results, fused, *num_results * sizeof(VectorHybridResult));
+    free(fused);
+    return EPIPHANYDB_SUCCESS;
+}
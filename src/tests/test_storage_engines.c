@@ -9,7 +9,11 @@
 #include <string.h>
 #include <assert.h>
 #include <time.h>
+#include <math.h>
+#include <pthread.h>
 #include "../../include/epiphanydb.h"
+#include "../storage/columnar_storage.h"
+#include "../storage/vector_storage.h"
 
 /* Test result structure */
 typedef struct TestResult {
@@ -181,6 +185,958 @@ void test_columnar_table_creation(void) {
                    execution_time);
 }
 
+void test_columnar_vectorized_aggregation(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    columnar_create_table(ctx, "test_columnar_agg", "id INTEGER, sales DOUBLE, region TEXT");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_agg", &table);
+    
+    /* Insert 10000 rows spread over two regions */
+    const char *regions[] = {"east", "west"};
+    for (int i = 0; i < 10000; i++) {
+        ColumnarDatum values[3];
+        bool nulls[3] = {false, false, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = i;
+        values[1].f64 = 1.5;
+        values[2].text = regions[i % 2];
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+    }
+    
+    ColumnarAggSpec aggregates[] = {
+        {COLUMNAR_AGG_COUNT_STAR, NULL},
+        {COLUMNAR_AGG_SUM, "sales"},
+        {COLUMNAR_AGG_MAX, "id"}
+    };
+    ColumnarAggSpec metadata_aggregates[] = {
+        {COLUMNAR_AGG_COUNT_STAR, NULL},
+        {COLUMNAR_AGG_MAX, "id"}
+    };
+    ColumnarAggResult *result = NULL;
+    
+    /* Ungrouped COUNT/MAX come straight from zone maps once merged */
+    columnar_flush_delta(table);
+    int status = columnar_aggregate(table, NULL, metadata_aggregates, 2, NULL, &result);
+    bool passed = (status == EPIPHANYDB_SUCCESS && result->from_metadata &&
+                   result->values[0].value.i64 == 10000 && result->values[1].value.i64 == 9999);
+    columnar_free_agg_result(result);
+    
+    /* Grouped aggregation through the hash table, integer bounds spelled any way strtod reads */
+    static const char *const conditions[] = {"id < 1000", "id < 1E3", "id < 0x3e8", "id < 999.5 AND id > -inf"};
+    for (int c = 0; c < 4 && passed; c++) {
+        status = columnar_aggregate(table, "region", aggregates, 3, conditions[c], &result);
+        passed = status == EPIPHANYDB_SUCCESS && result->num_groups == 2;
+        for (size_t g = 0; passed && g < result->num_groups; g++) {
+            passed = result->values[g * 3].value.i64 == 500 && result->values[g * 3 + 1].value.f64 == 750.0;
+        }
+        columnar_free_agg_result(result);
+    }
+    
+    /* Integer sums wrap around alike in the kernels and row by row, a NULL row forcing the latter */
+    columnar_create_table(ctx, "test_columnar_agg_wrap", "id INTEGER, region TEXT");
+    EpiphanyDBTable *wrap_table = NULL;
+    columnar_open_table(ctx, "test_columnar_agg_wrap", &wrap_table);
+    for (int i = 0; i < 20; i++) {
+        ColumnarDatum values[2];
+        bool nulls[2] = {i == 10, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = i == 0 ? INT64_MAX : 1;
+        values[1].text = regions[0];
+        columnar_encode_row(wrap_table, values, nulls, &row, &row_size);
+        columnar_insert_row(wrap_table, row, row_size);
+        free(row);
+    }
+    ColumnarAggSpec sum_aggregate = {COLUMNAR_AGG_SUM, "id"};
+    for (int merged = 0; merged < 2 && passed; merged++) {
+        if (merged) {
+            columnar_flush_delta(wrap_table);
+        }
+        for (int grouped = 0; grouped < 2 && passed; grouped++) {
+            status = columnar_aggregate(wrap_table, grouped ? "region" : NULL, &sum_aggregate, 1, NULL, &result);
+            passed = status == EPIPHANYDB_SUCCESS && result->values[0].value.i64 == INT64_MIN + 17;
+            columnar_free_agg_result(result);
+        }
+    }
+    columnar_close_table(wrap_table);
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Vectorized Aggregation", passed, 
+                   passed ? NULL : "Aggregation returned wrong results", 
+                   execution_time);
+}
+
+void test_columnar_delta_store(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    columnar_create_table(ctx, "test_columnar_delta", "id INTEGER, sales DOUBLE, region TEXT");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_delta", &table);
+    
+    /* Enough rows to freeze a segment and wake the merger */
+    for (int i = 0; i < COLUMNAR_DELTA_MERGE_THRESHOLD + 1000; i++) {
+        ColumnarDatum values[3];
+        bool nulls[3] = {false, false, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = i;
+        values[1].f64 = 1.0;
+        values[2].text = "east";
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+    }
+    
+    ColumnarAggSpec count_star[] = {{COLUMNAR_AGG_COUNT_STAR, NULL}};
+    ColumnarAggResult *result = NULL;
+    
+    /* Delete one merged row and one still in the delta store */
+    ColumnarDatum key;
+    key.i64 = 10;
+    bool passed = columnar_delete_row(table, &key) == EPIPHANYDB_SUCCESS;
+    passed = passed && columnar_delete_row(table, &key) == EPIPHANYDB_ERROR_NOT_FOUND;
+    key.i64 = COLUMNAR_DELTA_MERGE_THRESHOLD + 10;
+    passed = passed && columnar_delete_row(table, &key) == EPIPHANYDB_SUCCESS;
+    
+    int status = columnar_aggregate(table, NULL, count_star, 1, NULL, &result);
+    passed = passed && status == EPIPHANYDB_SUCCESS &&
+             result->values[0].value.i64 == COLUMNAR_DELTA_MERGE_THRESHOLD + 998;
+    columnar_free_agg_result(result);
+    
+    /* Counts survive folding the delta into row groups */
+    columnar_flush_delta(table);
+    status = columnar_aggregate(table, NULL, count_star, 1, "id >= 0", &result);
+    passed = passed && status == EPIPHANYDB_SUCCESS &&
+             result->values[0].value.i64 == COLUMNAR_DELTA_MERGE_THRESHOLD + 998;
+    columnar_free_agg_result(result);
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Delta Store", passed, 
+                   passed ? NULL : "Delta store lost or resurrected rows", 
+                   execution_time);
+}
+
+void test_columnar_delete_bitmaps(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    columnar_create_table(ctx, "test_columnar_deletes", "id INTEGER, sales DOUBLE, region TEXT");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_deletes", &table);
+    
+    for (int i = 0; i < 10000; i++) {
+        ColumnarDatum values[3];
+        bool nulls[3] = {false, false, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = i;
+        values[1].f64 = 1.0;
+        values[2].text = "east";
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+    }
+    columnar_flush_delta(table);
+    
+    /* Scattered deletes only set bits in the row group bitmap */
+    ColumnarDatum key;
+    bool passed = true;
+    for (int i = 0; i < 10000; i += 3) {
+        key.i64 = i;
+        passed = passed && columnar_delete_row(table, &key) == EPIPHANYDB_SUCCESS;
+    }
+    
+    ColumnarAggSpec count_star[] = {{COLUMNAR_AGG_COUNT_STAR, NULL}};
+    ColumnarAggResult *result = NULL;
+    int status = columnar_aggregate(table, NULL, count_star, 1, "id < 3000", &result);
+    passed = passed && status == EPIPHANYDB_SUCCESS && result->values[0].value.i64 == 2000;
+    columnar_free_agg_result(result);
+    
+    /* A third of the rows is gone, so the row group has been rewritten */
+    columnar_compact_table(table);
+    ColumnarTable *col_table = columnar_get_table(table);
+    passed = passed && col_table->num_row_groups == 1 &&
+             col_table->row_groups[0]->num_rows < 10000 &&
+             col_table->row_groups[0]->num_rows - col_table->row_groups[0]->num_deleted == 6666;
+    
+    status = columnar_aggregate(table, NULL, count_star, 1, "id < 3000", &result);
+    passed = passed && status == EPIPHANYDB_SUCCESS && result->values[0].value.i64 == 2000;
+    columnar_free_agg_result(result);
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Delete Bitmaps", passed, 
+                   passed ? NULL : "Deleted rows visible or compaction incomplete", 
+                   execution_time);
+}
+
+void test_columnar_compression(void) {
+    clock_t start = clock();
+    
+    /* Block round trip */
+    size_t num_values = 65536;
+    int64_t *values = malloc(num_values * sizeof(int64_t));
+    for (size_t i = 0; i < num_values; i++) {
+        values[i] = (int64_t)(i % 100);
+    }
+    void *block = NULL;
+    size_t block_size = 0;
+    void *data = NULL;
+    size_t data_size = 0;
+    bool passed = columnar_compress_column(values, num_values * sizeof(int64_t), &block, &block_size) == EPIPHANYDB_SUCCESS &&
+                  columnar_decompress_column(block, block_size, &data, &data_size) == EPIPHANYDB_SUCCESS &&
+                  data_size == num_values * sizeof(int64_t) && memcmp(data, values, data_size) == 0;
+    free(block);
+    free(data);
+    free(values);
+    
+    /* Sealed row groups are read back from the column files */
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    columnar_create_table(ctx, "test_columnar_compression", "id INTEGER, sales DOUBLE, region TEXT");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_compression", &table);
+    
+    const char *regions[] = {"east", "west", "north"};
+    for (int i = 0; i < 5000; i++) {
+        ColumnarDatum row_values[3];
+        bool nulls[3] = {false, i % 10 == 0, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        row_values[0].i64 = i;
+        row_values[1].f64 = 2.0;
+        row_values[2].text = regions[i % 3];
+        columnar_encode_row(table, row_values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+    }
+    columnar_flush_delta(table);
+    
+    ColumnarTable *col_table = columnar_get_table(table);
+    passed = passed && col_table->num_row_groups == 1 && col_table->row_groups[0]->chunks[2].block_size > 0;
+    
+    void *results = NULL;
+    size_t num_results = 0;
+    int status = columnar_vectorized_scan(table, "region", "id >= 4995", &results, &num_results);
+    passed = passed && status == EPIPHANYDB_SUCCESS && num_results == 5 &&
+             strcmp(((ColumnarDatum *)results)[0].text, "east") == 0;
+    free(results);
+    
+    ColumnarAggSpec sum_sales[] = {{COLUMNAR_AGG_SUM, "sales"}};
+    ColumnarAggResult *result = NULL;
+    status = columnar_aggregate(table, NULL, sum_sales, 1, NULL, &result);
+    passed = passed && status == EPIPHANYDB_SUCCESS && result->values[0].value.f64 == 9000.0;
+    columnar_free_agg_result(result);
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Compression", passed, 
+                   passed ? NULL : "Compressed chunks did not round trip", 
+                   execution_time);
+}
+
+void test_columnar_parallel_scan(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    columnar_create_table(ctx, "test_columnar_parallel", "id INTEGER, sales DOUBLE, region TEXT");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_parallel", &table);
+    
+    /* Five row groups of 4000 rows plus 100 unmerged delta rows */
+    const char *regions[] = {"east", "west", "north", "south"};
+    for (int i = 0; i < 20100; i++) {
+        ColumnarDatum values[3];
+        bool nulls[3] = {false, false, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = i;
+        values[1].f64 = 1.0;
+        values[2].text = regions[i % 4];
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+        if (i < 20000 && (i + 1) % 4000 == 0) {
+            columnar_flush_delta(table);
+        }
+    }
+    
+    ColumnarTable *col_table = columnar_get_table(table);
+    col_table->scan_workers = 4;
+    bool passed = col_table->num_row_groups == 5;
+    
+    /* Values come back in row group order whatever worker scanned them */
+    void *results = NULL;
+    size_t num_results = 0;
+    int status = columnar_vectorized_scan(table, "id", "id >= 100", &results, &num_results);
+    passed = passed && status == EPIPHANYDB_SUCCESS && num_results == 20000;
+    for (size_t i = 0; passed && i < num_results; i++) {
+        passed = ((ColumnarDatum *)results)[i].i64 == (int64_t)(i + 100);
+    }
+    free(results);
+    
+    /* Per-worker partial aggregates merge into one row per group */
+    ColumnarAggSpec aggregates[] = {
+        {COLUMNAR_AGG_COUNT_STAR, NULL},
+        {COLUMNAR_AGG_SUM, "sales"},
+        {COLUMNAR_AGG_MIN, "id"}
+    };
+    ColumnarAggResult *result = NULL;
+    status = columnar_aggregate(table, "region", aggregates, 3, NULL, &result);
+    passed = passed && status == EPIPHANYDB_SUCCESS && result->num_groups == 4;
+    for (size_t g = 0; passed && g < result->num_groups; g++) {
+        passed = result->values[g * 3].value.i64 == 5025 && result->values[g * 3 + 1].value.f64 == 5025.0 &&
+                 result->values[g * 3 + 2].value.i64 < 4;
+    }
+    columnar_free_agg_result(result);
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Parallel Scan", passed, 
+                   passed ? NULL : "Parallel scan results differ from a serial scan", 
+                   execution_time);
+}
+
+void test_columnar_bloom_filters(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    columnar_create_table(ctx, "test_columnar_bloom", "id INTEGER, sales DOUBLE, region TEXT");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_bloom", &table);
+    
+    /* Scattered ids, so every row group spans nearly the whole id range */
+    for (int i = 0; i < 20000; i++) {
+        ColumnarDatum values[3];
+        bool nulls[3] = {false, false, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = (int64_t)i * 7919 % 20011;
+        values[1].f64 = (double)i;
+        values[2].text = "east";
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+        if ((i + 1) % 5000 == 0) {
+            columnar_flush_delta(table);
+        }
+    }
+    
+    ColumnarTable *col_table = columnar_get_table(table);
+    bool passed = col_table->num_row_groups == 4 && col_table->row_groups[0]->chunks[0].bloom.num_blocks > 0 &&
+                  col_table->row_groups[0]->chunks[2].bloom.num_blocks == 0;
+    
+    /* Zone maps cannot prune the point lookup, bloom filters can */
+    const char *columns[] = {"id"};
+    ColumnarScan *scan = NULL;
+    ColumnarBatch *batch = NULL;
+    size_t matches = 0;
+    int status = columnar_scan_begin(col_table, columns, 1, "id = 15838", &scan);
+    while (status == EPIPHANYDB_SUCCESS && columnar_scan_next(scan, &batch)) {
+        matches += batch->num_selected;
+    }
+    passed = passed && status == EPIPHANYDB_SUCCESS && matches == 1 && scan->row_groups_skipped >= 2;
+    columnar_scan_end(scan);
+    
+    /* Row 2 carries id 15838 */
+    void *results = NULL;
+    size_t num_results = 0;
+    status = columnar_query_rows(table, "id = 15838", &results, &num_results);
+    passed = passed && status == EPIPHANYDB_SUCCESS && num_results == 1;
+    if (passed) {
+        ColumnarRowData *rows = results;
+        ColumnarDatum values[3];
+        bool nulls[3];
+        char *text = NULL;
+        status = columnar_decode_row(col_table, rows[0].data, rows[0].size, values, nulls, &text);
+        passed = status == EPIPHANYDB_SUCCESS && values[0].i64 == 15838 && values[1].f64 == 2.0 &&
+                 strcmp(values[2].text, "east") == 0;
+        free(text);
+    }
+    free(results);
+    
+    status = columnar_query_rows(table, "id = 20011", &results, &num_results);
+    passed = passed && status == EPIPHANYDB_SUCCESS && num_results == 0;
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Bloom Filters", passed, 
+                   passed ? NULL : "Point lookup was not pruned by bloom filters", 
+                   execution_time);
+}
+
+void test_columnar_clustering(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    bool passed = columnar_create_table(ctx, "test_columnar_zorder", "x INTEGER, y DOUBLE, ZORDER KEY (x, y)") == EPIPHANYDB_SUCCESS &&
+                  columnar_create_table(ctx, "test_columnar_bad_key", "x INTEGER, SORT KEY (z)") == EPIPHANYDB_ERROR_INVALID_PARAM;
+    
+    columnar_create_table(ctx, "test_columnar_sorted", "id INTEGER, sales DOUBLE, SORT KEY (id)");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_sorted", &table);
+    
+    /* Every merged row group spans nearly the whole id range */
+    size_t expected = 0;
+    for (int i = 0; i < 80000; i++) {
+        ColumnarDatum values[2];
+        bool nulls[2] = {false, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = (int64_t)i * 7919 % 80021;
+        values[1].f64 = (double)i;
+        expected += values[0].i64 >= 70000;
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+        if ((i + 1) % 20000 == 0) {
+            columnar_flush_delta(table);
+        }
+    }
+    
+    /* Clustering leaves row groups covering disjoint id ranges */
+    ColumnarTable *col_table = columnar_get_table(table);
+    passed = passed && columnar_compact_table(table) == EPIPHANYDB_SUCCESS && col_table->num_row_groups == 2;
+    if (passed) {
+        const ColumnarZoneMap *first = &col_table->row_groups[0]->chunks[0].zone_map;
+        const ColumnarZoneMap *second = &col_table->row_groups[1]->chunks[0].zone_map;
+        passed = col_table->row_groups[0]->clustered && (first->max.i64 < second->min.i64 || second->max.i64 < first->min.i64);
+    }
+    
+    const char *columns[] = {"id"};
+    ColumnarScan *scan = NULL;
+    ColumnarBatch *batch = NULL;
+    size_t matches = 0;
+    int status = columnar_scan_begin(col_table, columns, 1, "id >= 70000", &scan);
+    while (status == EPIPHANYDB_SUCCESS && columnar_scan_next(scan, &batch)) {
+        matches += batch->num_selected;
+    }
+    passed = passed && status == EPIPHANYDB_SUCCESS && matches == expected && scan->row_groups_skipped == 1;
+    columnar_scan_end(scan);
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Clustering", passed, 
+                   passed ? NULL : "Row groups were not clustered on the sort key", 
+                   execution_time);
+}
+
+void test_columnar_compiled_conditions(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    columnar_create_table(ctx, "test_columnar_conditions", "id INTEGER, sales DOUBLE, region TEXT");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_conditions", &table);
+    
+    const char *regions[] = {"east", "west", "north", "south"};
+    for (int i = 0; i < 10000; i++) {
+        ColumnarDatum values[3];
+        bool nulls[3] = {false, i % 10 == 0, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = i;
+        values[1].f64 = (double)(i % 100);
+        values[2].text = regions[i % 4];
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+    }
+    columnar_flush_delta(table);
+    
+    /* The second scan of the same text reuses the compiled condition */
+    ColumnarTable *col_table = columnar_get_table(table);
+    const char *condition = "id >= 2000 AND sales < 50.5 AND region = 'west'";
+    const char *columns[] = {"id"};
+    ColumnarCondition *compiled[2] = {NULL, NULL};
+    size_t matches[2] = {0, 0};
+    bool passed = true;
+    for (int run = 0; run < 2; run++) {
+        ColumnarScan *scan = NULL;
+        ColumnarBatch *batch = NULL;
+        int status = columnar_scan_begin(col_table, columns, 1, condition, &scan);
+        passed = passed && status == EPIPHANYDB_SUCCESS;
+        while (status == EPIPHANYDB_SUCCESS && columnar_scan_next(scan, &batch)) {
+            matches[run] += batch->num_selected;
+        }
+        compiled[run] = scan ? scan->condition : NULL;
+        columnar_scan_end(scan);
+    }
+    /* Odd ids never have NULL sales; i % 4 == 1 leaves 13 sales values of 1, 5, ..., 49 per 100 ids */
+    passed = passed && compiled[0] && compiled[0] == compiled[1] && col_table->num_conditions == 1 &&
+             matches[0] == 80 * 13 && matches[1] == matches[0];
+    
+    /* Least recently used conditions are evicted */
+    for (int i = 0; i < COLUMNAR_CONDITION_CACHE_SIZE + 1; i++) {
+        char text[32];
+        ColumnarScan *scan = NULL;
+        snprintf(text, sizeof(text), "id = %d", i);
+        if (columnar_scan_begin(col_table, columns, 1, text, &scan) == EPIPHANYDB_SUCCESS) {
+            columnar_scan_end(scan);
+        }
+    }
+    passed = passed && col_table->num_conditions == COLUMNAR_CONDITION_CACHE_SIZE &&
+             strcmp(col_table->conditions[0]->text, "id = 64") == 0;
+    
+    /* Column names longer than conditions can hold are rejected, not cut down to another column */
+    char long_name[128];
+    char schema[300];
+    char long_condition[160];
+    memset(long_name, 'c', 127);
+    long_name[127] = '\0';
+    snprintf(schema, sizeof(schema), "%s INTEGER, %sd INTEGER", long_name, long_name);
+    snprintf(long_condition, sizeof(long_condition), "%sd = 1", long_name);
+    columnar_create_table(ctx, "test_columnar_long_names", schema);
+    EpiphanyDBTable *long_table = NULL;
+    columnar_open_table(ctx, "test_columnar_long_names", &long_table);
+    ColumnarTable *long_col_table = columnar_get_table(long_table);
+    const char *long_columns[] = {long_name};
+    ColumnarScan *long_scan = NULL;
+    passed = passed && long_col_table &&
+             columnar_scan_begin(long_col_table, long_columns, 1, long_condition, &long_scan) == EPIPHANYDB_ERROR_INVALID_PARAM;
+    long_condition[127] = ' ';
+    passed = passed && columnar_scan_begin(long_col_table, long_columns, 1, long_condition, &long_scan) == EPIPHANYDB_SUCCESS;
+    columnar_scan_end(long_scan);
+    columnar_close_table(long_table);
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Compiled Conditions", passed, 
+                   passed ? NULL : "Compiled conditions were not cached or filtered incorrectly", 
+                   execution_time);
+}
+
+void test_columnar_statistics(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    columnar_create_table(ctx, "test_columnar_stats", "id INTEGER, sales DOUBLE, region TEXT");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_stats", &table);
+    
+    /* Four row groups and 1000 unmerged delta rows */
+    const char *regions[] = {"east", "west", "north", "south"};
+    for (int i = 0; i < 21000; i++) {
+        ColumnarDatum values[3];
+        bool nulls[3] = {false, i % 10 == 0, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = i;
+        values[1].f64 = (double)(i % 100);
+        values[2].text = regions[i % 4];
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+        if ((i + 1) % 5000 == 0 && i < 20000) {
+            columnar_flush_delta(table);
+        }
+    }
+    
+    uint64_t num_rows = 0;
+    uint64_t table_size = 0;
+    bool passed = epiphanydb_get_table_stats(table, &num_rows, &table_size) == EPIPHANYDB_SUCCESS &&
+                  num_rows == 21000 && table_size > 0;
+    
+    ColumnarTable *col_table = columnar_get_table(table);
+    passed = passed && epiphanydb_analyze_table(table) == EPIPHANYDB_SUCCESS && col_table->stats;
+    if (passed) {
+        const ColumnarColumnStats *id = &col_table->stats[0];
+        const ColumnarColumnStats *sales = &col_table->stats[1];
+        const ColumnarColumnStats *region = &col_table->stats[2];
+        passed = id->min.i64 == 0 && id->max.i64 == 20999 && id->ndv > 19000 && id->ndv < 23000 &&
+                 sales->null_count == 2100 && sales->ndv > 85 && sales->ndv < 95 &&
+                 region->ndv > 3.5 && region->ndv < 4.5 && strcmp(region->min.text, "east") == 0 &&
+                 id->num_bounds == COLUMNAR_HISTOGRAM_BUCKETS + 1;
+    }
+    
+    /* Estimates follow the data rather than fixed guesses */
+    ColumnarPredicate *predicates = NULL;
+    size_t num_predicates = 0;
+    if (passed && columnar_parse_condition(col_table, "id < 5250 AND region = 'west' AND sales >= 50", &predicates, &num_predicates) == EPIPHANYDB_SUCCESS) {
+        double range = columnar_estimate_selectivity(col_table, &predicates[0]);
+        double equal = columnar_estimate_selectivity(col_table, &predicates[1]);
+        double above = columnar_estimate_selectivity(col_table, &predicates[2]);
+        passed = range > 0.22 && range < 0.28 && equal > 0.22 && equal < 0.28 && above > 0.4 && above < 0.5;
+        columnar_free_predicates(col_table, predicates, num_predicates);
+    } else {
+        passed = false;
+    }
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Statistics", passed, 
+                   passed ? NULL : "Table statistics or selectivity estimates were inaccurate", 
+                   execution_time);
+}
+
+void test_columnar_projection(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    /* 40 columns c0 ... c39 */
+    char schema[1024] = "";
+    for (int c = 0; c < 40; c++) {
+        char column[32];
+        snprintf(column, sizeof(column), "%sc%d INTEGER", c > 0 ? ", " : "", c);
+        strcat(schema, column);
+    }
+    columnar_create_table(ctx, "test_columnar_wide", schema);
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_wide", &table);
+    
+    for (int i = 0; i < 9000; i++) {
+        ColumnarDatum values[40];
+        bool nulls[40];
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        for (int c = 0; c < 40; c++) {
+            values[c].i64 = (int64_t)i * 40 + c;
+            nulls[c] = false;
+        }
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+        if ((i + 1) % 3000 == 0) {
+            columnar_flush_delta(table);
+        }
+    }
+    
+    /* Projected columns come back, the others are NULL */
+    const char *columns[] = {"c3", "c7"};
+    void *results = NULL;
+    size_t num_results = 0;
+    ColumnarTable *col_table = columnar_get_table(table);
+    int status = columnar_query_columns(table, columns, 2, "c0 >= 200000", &results, &num_results);
+    bool passed = status == EPIPHANYDB_SUCCESS && num_results == 4000;
+    if (passed) {
+        ColumnarRowData *rows = results;
+        ColumnarDatum values[40];
+        bool nulls[40];
+        char *text = NULL;
+        status = columnar_decode_row(col_table, rows[0].data, rows[0].size, values, nulls, &text);
+        passed = status == EPIPHANYDB_SUCCESS && !nulls[3] && values[3].i64 == 5000 * 40 + 3 &&
+                 !nulls[7] && values[7].i64 == 5000 * 40 + 7 && nulls[0] && nulls[39];
+        free(text);
+    }
+    free(results);
+    
+    /* One read covers the chunks of all three row groups; unprojected columns are never read */
+    const char *scan_columns[] = {"c3"};
+    ColumnarScan *scan = NULL;
+    ColumnarBatch *batch = NULL;
+    size_t matches = 0;
+    status = columnar_scan_begin(col_table, scan_columns, 1, NULL, &scan);
+    while (status == EPIPHANYDB_SUCCESS && columnar_scan_next(scan, &batch)) {
+        matches += batch->num_selected;
+    }
+    passed = passed && status == EPIPHANYDB_SUCCESS && matches == 9000;
+    if (scan && col_table->column_fds) {
+        const ColumnarChunk *last = &col_table->row_groups[2]->chunks[3];
+        passed = passed && columnar_chunk_buffered(&scan->buffers[3], last) &&
+                 scan->buffers[3].window_offset == col_table->row_groups[0]->chunks[3].file_offset &&
+                 !scan->buffers[4].window && !scan->buffers[4].block;
+    }
+    columnar_scan_end(scan);
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Projection", passed, 
+                   passed ? NULL : "Projected reads returned or read the wrong columns", 
+                   execution_time);
+}
+
+void test_columnar_join_filters(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    /* Fact row group g holds scattered customer ids g * 10000 ... g * 10000 + 5002 */
+    columnar_create_table(ctx, "test_columnar_fact", "customer_id INTEGER, amount DOUBLE");
+    EpiphanyDBTable *fact = NULL;
+    columnar_open_table(ctx, "test_columnar_fact", &fact);
+    for (int i = 0; i < 20000; i++) {
+        ColumnarDatum values[2];
+        bool nulls[2] = {false, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = (int64_t)(i / 5000) * 10000 + (int64_t)(i % 5000) * 7919 % 5003;
+        values[1].f64 = (double)i;
+        columnar_encode_row(fact, values, nulls, &row, &row_size);
+        columnar_insert_row(fact, row, row_size);
+        free(row);
+        if ((i + 1) % 5000 == 0) {
+            columnar_flush_delta(fact);
+        }
+    }
+    
+    /* Dimension ids 0, 500, ... 19500; the north ones are multiples of 2000 */
+    columnar_create_table(ctx, "test_columnar_dim", "id INTEGER, region TEXT");
+    EpiphanyDBTable *dim = NULL;
+    columnar_open_table(ctx, "test_columnar_dim", &dim);
+    for (int k = 0; k < 40; k++) {
+        ColumnarDatum values[2];
+        bool nulls[2] = {false, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = (int64_t)k * 500;
+        values[1].text = k % 4 == 0 ? "north" : "south";
+        columnar_encode_row(dim, values, nulls, &row, &row_size);
+        columnar_insert_row(dim, row, row_size);
+        free(row);
+    }
+    
+    /* The key range rules out the last two row groups, the key bloom filter most other rows */
+    ColumnarJoinFilter filter;
+    int status = columnar_join_filter_from_table(dim, "id", "region = 'north'", &filter);
+    bool passed = status == EPIPHANYDB_SUCCESS && filter.has_keys && filter.min.i64 == 0 &&
+                  filter.max.i64 == 18000 && filter.num_hashes == 10;
+    
+    ColumnarTable *col_table = columnar_get_table(fact);
+    const char *columns[] = {"customer_id"};
+    const ColumnarJoinFilter *filters[] = {&filter};
+    ColumnarScan *scan = NULL;
+    ColumnarBatch *batch = NULL;
+    size_t matches = 0;
+    size_t joined = 0;
+    status = columnar_scan_begin(col_table, columns, 1, NULL, &scan);
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = columnar_scan_add_join_filter(scan, "customer_id", &filter);
+    }
+    while (status == EPIPHANYDB_SUCCESS && columnar_scan_next(scan, &batch)) {
+        const int64_t *ids = batch->values[0];
+        for (size_t i = 0; i < batch->num_selected; i++) {
+            int64_t id = ids[batch->selection ? batch->selection[i] : i];
+            joined += id % 2000 == 0 && id <= 18000;
+        }
+        matches += batch->num_selected;
+    }
+    passed = passed && status == EPIPHANYDB_SUCCESS && joined == 6 && matches < 500 &&
+             scan->row_groups_skipped == 2;
+    columnar_scan_end(scan);
+    
+    /* The vectorized scan keeps every fact row with a join partner */
+    void *results = NULL;
+    size_t num_results = 0;
+    status = columnar_vectorized_join_scan(fact, "customer_id", "amount < 7500", columns, filters, 1, &results, &num_results);
+    passed = passed && status == EPIPHANYDB_SUCCESS && num_results >= 3 && num_results < 300;
+    free(results);
+    columnar_join_filter_free(&filter);
+    
+    /* Few keys spanning the whole range are probed against chunk bloom filters */
+    ColumnarDatum keys[2];
+    keys[0].i64 = 3;
+    keys[1].i64 = 30003;
+    status = columnar_join_filter_build(COLUMNAR_TYPE_INT64, keys, NULL, 2, &filter);
+    scan = NULL;
+    matches = 0;
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = columnar_scan_begin(col_table, columns, 1, NULL, &scan);
+    }
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = columnar_scan_add_join_filter(scan, "customer_id", &filter);
+    }
+    while (status == EPIPHANYDB_SUCCESS && columnar_scan_next(scan, &batch)) {
+        matches += batch->num_selected;
+    }
+    passed = passed && status == EPIPHANYDB_SUCCESS && matches >= 2 && scan->row_groups_skipped == 2;
+    columnar_scan_end(scan);
+    columnar_join_filter_free(&filter);
+    
+    columnar_close_table(dim);
+    columnar_close_table(fact);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Join Filters", passed, 
+                   passed ? NULL : "Join filters did not prune the fact table scan", 
+                   execution_time);
+}
+
+void test_columnar_scan_cache(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    columnar_storage_init(ctx);
+    
+    columnar_create_table(ctx, "test_columnar_cache", "id INTEGER, sales DOUBLE, region TEXT");
+    EpiphanyDBTable *table = NULL;
+    columnar_open_table(ctx, "test_columnar_cache", &table);
+    
+    const char *regions[] = {"east", "west", "north", "south"};
+    for (int i = 0; i < 20000; i++) {
+        ColumnarDatum values[3];
+        bool nulls[3] = {false, false, false};
+        void *row = NULL;
+        size_t row_size = 0;
+        
+        values[0].i64 = i;
+        values[1].f64 = (double)i;
+        values[2].text = regions[i % 4];
+        columnar_encode_row(table, values, nulls, &row, &row_size);
+        columnar_insert_row(table, row, row_size);
+        free(row);
+        if ((i + 1) % 5000 == 0) {
+            columnar_flush_delta(table);
+        }
+    }
+    
+    ColumnarTable *col_table = columnar_get_table(table);
+    ColumnarCache *cache = columnar_cache_create(16 << 20);
+    ColumnarCache *small_cache = columnar_cache_create(64 << 10);
+    col_table->cache = cache;
+    
+    /* The first run decodes three chunks of each of the two row groups left by the zone maps */
+    const char *columns[] = {"sales"};
+    const char *condition = "id >= 12000 AND region = 'west'";
+    void *results = NULL;
+    size_t num_results = 0;
+    int status = columnar_query_columns(table, columns, 1, condition, &results, &num_results);
+    free(results);
+    bool passed = cache && small_cache && status == EPIPHANYDB_SUCCESS && num_results == 2000 &&
+                  cache->hits == 0 && cache->misses == 8;
+    
+    /* The rerun takes the condition results and the sales chunks from the cache */
+    status = columnar_query_columns(table, columns, 1, condition, &results, &num_results);
+    free(results);
+    passed = passed && status == EPIPHANYDB_SUCCESS && num_results == 2000 && cache->hits == 4 && cache->misses == 8;
+    
+    /* Deletes are masked on top of cached condition results */
+    ColumnarDatum key;
+    key.i64 = 12001;
+    columnar_delete_row(table, &key);
+    status = columnar_query_columns(table, columns, 1, condition, &results, &num_results);
+    free(results);
+    passed = passed && status == EPIPHANYDB_SUCCESS && num_results == 1999;
+    
+    /* A cache smaller than the scanned chunks evicts and stays within budget */
+    if (small_cache) {
+        col_table->cache = small_cache;
+        status = columnar_vectorized_scan(table, "sales", NULL, &results, &num_results);
+        free(results);
+        passed = passed && status == EPIPHANYDB_SUCCESS && num_results == 19999 &&
+                 small_cache->evictions > 0 && small_cache->used <= small_cache->budget;
+    }
+    
+    columnar_close_table(table);
+    columnar_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    columnar_cache_destroy(cache);
+    columnar_cache_destroy(small_cache);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Columnar Scan Cache", passed, 
+                   passed ? NULL : "Repeated scans did not reuse cached chunks and filters", 
+                   execution_time);
+}
+
 /* Vector storage tests */
 void test_vector_table_creation(void) {
     clock_t start = clock();
@@ -188,18 +1144,1140 @@ void test_vector_table_creation(void) {
     EpiphanyDBContext *ctx = NULL;
     epiphanydb_init_context(&ctx);
     
-    int result = epiphanydb_create_table(ctx, "test_vector_table", EPIPHANYDB_STORAGE_VECTOR, 
-                                        "id INTEGER, embedding VECTOR(768), metadata TEXT");
+    int result = epiphanydb_create_table(ctx, "test_vector_table", EPIPHANYDB_STORAGE_VECTOR, 
+                                        "id INTEGER, embedding VECTOR(768), metadata TEXT");
+    
+    bool passed = (result == EPIPHANYDB_SUCCESS);
+    
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Table Creation", passed, 
+                   passed ? NULL : "Failed to create vector table", 
+                   execution_time);
+}
+
+void test_vector_distance_kernels(void) {
+    clock_t start = clock();
+    
+    /* Dispatched kernels agree with a double precision reference around every remainder */
+    static const size_t dimensions[] = {1, 3, 7, 8, 15, 16, 17, 31, 33, 63, 64, 65, 100, 768};
+    float a[768];
+    float b[768];
+    bool passed = true;
+    unsigned int seed = 42;
+    for (size_t d = 0; d < sizeof(dimensions) / sizeof(dimensions[0]); d++) {
+        size_t n = dimensions[d];
+        double dot = 0.0, l2 = 0.0, l1 = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            seed = seed * 1103515245 + 12345;
+            a[i] = (float)((seed >> 8) % 2001) / 1000.0f - 1.0f;
+            seed = seed * 1103515245 + 12345;
+            b[i] = (float)((seed >> 8) % 2001) / 1000.0f - 1.0f;
+            dot += (double)a[i] * b[i];
+            l2 += ((double)a[i] - b[i]) * ((double)a[i] - b[i]);
+            l1 += a[i] > b[i] ? (double)a[i] - b[i] : (double)b[i] - a[i];
+        }
+        double errors[3] = {vector_dot(a, b, n) - dot, vector_l2_squared(a, b, n) - l2, vector_l1(a, b, n) - l1};
+        for (size_t e = 0; e < 3; e++) {
+            passed = passed && errors[e] < 1e-3 * (double)n && errors[e] > -1e-3 * (double)n;
+        }
+    }
+    
+    /* Stored vectors are padded to cache lines and carry their norms */
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_kernels", "id INTEGER, embedding VECTOR(37), metadata TEXT");
+    EpiphanyDBTable *table = NULL;
+    int status = vector_open_table(ctx, "test_vector_kernels", &table);
+    for (int v = 0; v < 10 && status == EPIPHANYDB_SUCCESS; v++) {
+        for (size_t i = 0; i < 37; i++) {
+            a[i] = (float)((v + 1) * (int)(i % 5) - 3);
+        }
+        status = vector_insert_vector(table, a, 37, NULL);
+    }
+    VectorTable *vec_table = vector_get_table(table);
+    passed = passed && status == EPIPHANYDB_SUCCESS && vec_table && vec_table->num_vectors == 10 &&
+             vec_table->stride == 48 && (uintptr_t)vec_table->vectors % VECTOR_ALIGNMENT == 0;
+    if (passed) {
+        const float *first = vector_at(vec_table, 0);
+        const float *last = vector_at(vec_table, 9);
+        float similarity = vector_cosine_similarity(first, last, 37);
+        float distance = vector_distance(VECTOR_METRIC_COSINE, first, vec_table->norms[0], last, vec_table->norms[9], 37);
+        float norm = vector_norm(last, 37);
+        passed = vec_table->norms[9] == norm && distance - (1.0f - similarity) < 1e-5f &&
+                 distance - (1.0f - similarity) > -1e-5f && last[37] == 0.0f && last[47] == 0.0f;
+    }
+    passed = passed && vector_insert_vector(table, a, 36, NULL) == EPIPHANYDB_ERROR_INVALID_PARAM;
+    
+    vector_close_table(table);
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Distance Kernels", passed, 
+                   passed ? NULL : "Distance kernels disagree with the scalar reference", 
+                   execution_time);
+}
+
+void test_vector_hnsw_index(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_hnsw", "id INTEGER, embedding VECTOR(32) METRIC euclidean HNSW (M 12, EF_CONSTRUCTION = 100, EF_SEARCH 48)");
+    EpiphanyDBTable *table = NULL;
+    int status = vector_open_table(ctx, "test_vector_hnsw", &table);
+    
+    /* Half the vectors are indexed by the build, the rest by inserts afterwards */
+    static float data[2000][32];
+    unsigned int seed = 7;
+    for (int v = 0; v < 2000 && status == EPIPHANYDB_SUCCESS; v++) {
+        for (int i = 0; i < 32; i++) {
+            seed = seed * 1103515245 + 12345;
+            data[v][i] = (float)((seed >> 8) % 10001) / 10000.0f;
+        }
+        status = vector_insert_vector(table, data[v], 32, NULL);
+        if (v == 999 && status == EPIPHANYDB_SUCCESS) {
+            status = vector_build_index(table);
+        }
+    }
+    VectorTable *vec_table = vector_get_table(table);
+    bool passed = status == EPIPHANYDB_SUCCESS && vec_table && vec_table->hnsw && vec_table->hnsw->num_nodes == 2000 &&
+                  vec_table->hnsw->m == 12 && vec_table->ef_search == 48;
+    
+    /* Recall@10 against exact neighbors */
+    size_t found = 0;
+    for (int q = 0; q < 50 && passed; q++) {
+        float query[32];
+        for (int i = 0; i < 32; i++) {
+            seed = seed * 1103515245 + 12345;
+            query[i] = (float)((seed >> 8) % 10001) / 10000.0f;
+        }
+        
+        float exact[10];
+        for (int j = 0; j < 10; j++) {
+            exact[j] = 1e30f;
+        }
+        for (int v = 0; v < 2000; v++) {
+            float distance = vector_euclidean_distance(data[v], query, 32);
+            for (int j = 0; j < 10; j++) {
+                if (distance < exact[j]) {
+                    float displaced = exact[j];
+                    exact[j] = distance;
+                    distance = displaced;
+                }
+            }
+        }
+        
+        void *results = NULL;
+        size_t num_results = 0;
+        status = vector_similarity_search(table, query, 32, 10, &results, &num_results);
+        VectorSearchResult *hits = results;
+        passed = status == EPIPHANYDB_SUCCESS && num_results == 10;
+        for (size_t j = 0; j < num_results && passed; j++) {
+            passed = hits[j].id < 2000 && (j == 0 || hits[j].distance >= hits[j - 1].distance);
+            found += hits[j].distance <= exact[9] * 1.0001f;
+        }
+        free(results);
+    }
+    passed = passed && found >= 450;
+    
+    vector_close_table(table);
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector HNSW Index", passed, 
+                   passed ? NULL : "HNSW search recall below 0.9", 
+                   execution_time);
+}
+
+void test_vector_ivfpq_index(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_ivfpq", "id INTEGER, embedding VECTOR(32) METRIC euclidean IVFPQ (NLIST 16, PQ_M 16, NPROBE 4, RERANK 8)");
+    EpiphanyDBTable *table = NULL;
+    int status = vector_open_table(ctx, "test_vector_ivfpq", &table);
+    
+    /* Vectors gather around 16 centers; half are encoded by the build, half on insert */
+    static float centers[16][32];
+    static float data[2000][32];
+    unsigned int seed = 11;
+    for (int c = 0; c < 16; c++) {
+        for (int i = 0; i < 32; i++) {
+            seed = seed * 1103515245 + 12345;
+            centers[c][i] = (float)((seed >> 8) % 10001) / 10000.0f;
+        }
+    }
+    for (int v = 0; v < 2000 && status == EPIPHANYDB_SUCCESS; v++) {
+        for (int i = 0; i < 32; i++) {
+            seed = seed * 1103515245 + 12345;
+            data[v][i] = centers[v % 16][i] + (float)((seed >> 8) % 2001) / 10000.0f - 0.1f;
+        }
+        status = vector_insert_vector(table, data[v], 32, NULL);
+        if (v == 999 && status == EPIPHANYDB_SUCCESS) {
+            status = vector_build_index(table);
+        }
+    }
+    VectorTable *vec_table = vector_get_table(table);
+    bool passed = status == EPIPHANYDB_SUCCESS && vec_table && !vec_table->hnsw && vec_table->ivfpq &&
+                  vec_table->ivfpq->num_vectors == 2000 && vec_table->ivfpq->code_m == 16;
+    
+    /* Codes take 8 bytes a vector against 128 for the floats */
+    passed = passed && vector_ivfpq_memory_usage(vec_table->ivfpq) < 2000 * 32 * sizeof(float) / 4;
+    
+    /* Recall@10 against exact neighbors, with and without the exact re-rank */
+    size_t found[2] = {0, 0};
+    for (int q = 0; q < 40 && passed; q++) {
+        float query[32];
+        for (int i = 0; i < 32; i++) {
+            seed = seed * 1103515245 + 12345;
+            query[i] = centers[q % 16][i] + (float)((seed >> 8) % 2001) / 10000.0f - 0.1f;
+        }
+        
+        float exact[10];
+        for (int j = 0; j < 10; j++) {
+            exact[j] = 1e30f;
+        }
+        for (int v = 0; v < 2000; v++) {
+            float distance = vector_euclidean_distance(data[v], query, 32);
+            for (int j = 0; j < 10; j++) {
+                if (distance < exact[j]) {
+                    float displaced = exact[j];
+                    exact[j] = distance;
+                    distance = displaced;
+                }
+            }
+        }
+        
+        for (int pass = 0; pass < 2 && passed; pass++) {
+            vec_table->ivf_rerank = pass == 0 ? 8 : 0;
+            void *results = NULL;
+            size_t num_results = 0;
+            status = vector_similarity_search(table, query, 32, 10, &results, &num_results);
+            VectorSearchResult *hits = results;
+            passed = status == EPIPHANYDB_SUCCESS && num_results == 10;
+            for (size_t j = 0; j < num_results && passed; j++) {
+                passed = hits[j].id < 2000 && (j == 0 || hits[j].distance >= hits[j - 1].distance);
+                float distance = vector_euclidean_distance(data[hits[j].id], query, 32);
+                found[pass] += distance <= exact[9] * 1.0001f;
+            }
+            free(results);
+        }
+    }
+    passed = passed && found[0] >= 360 && found[1] >= 230;
+    
+    vector_close_table(table);
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector IVF-PQ Index", passed, 
+                   passed ? NULL : "IVF-PQ search recall too low", 
+                   execution_time);
+}
+
+void test_vector_quantized_storage(void) {
+    clock_t start = clock();
+    
+    /* Half conversions round to nearest even, subnormals included */
+    bool passed = vector_float_to_half(1.0f) == 0x3c00 && vector_half_to_float(0x3c00) == 1.0f &&
+                  vector_float_to_half(-2.5f) == 0xc100 && vector_float_to_half(65520.0f) == 0x7c00 &&
+                  vector_half_to_float(0x0001) == 5.9604645e-8f && vector_float_to_half(8.9406967e-8f) == 0x0002;
+    float roundtrip = vector_half_to_float(vector_float_to_half(0.1f));
+    passed = passed && roundtrip > 0.0999f && roundtrip < 0.1001f;
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    
+    /* Each mode scans its codes, then re-ranks some multiple of k hits with the floats */
+    static const char *const modes[] = {"float16", "int8", "binary"};
+    static const int reranks[] = {2, 2, 10};
+    static const size_t code_sizes[] = {256, 128, 64};
+    static const size_t min_found[] = {290, 280, 180};
+    static float data[1000][100];
+    unsigned int seed = 5;
+    for (int v = 0; v < 1000; v++) {
+        for (int i = 0; i < 100; i++) {
+            seed = seed * 1103515245 + 12345;
+            data[v][i] = (float)((seed >> 8) % 10001) / 10000.0f - (v % 2 ? 0.3f : 0.7f) * (i % 3);
+        }
+    }
+    for (size_t m = 0; m < 3 && passed; m++) {
+        char name[64];
+        char schema[128];
+        snprintf(name, sizeof(name), "test_vector_storage_%s", modes[m]);
+        snprintf(schema, sizeof(schema), "id INTEGER, embedding VECTOR(100) FLAT STORAGE %s (RERANK %d)", modes[m], reranks[m]);
+        vector_create_table(ctx, name, schema);
+        EpiphanyDBTable *table = NULL;
+        int status = vector_open_table(ctx, name, &table);
+        for (int v = 0; v < 1000 && status == EPIPHANYDB_SUCCESS; v++) {
+            status = vector_insert_vector(table, data[v], 100, NULL);
+            if (v == 499 && status == EPIPHANYDB_SUCCESS) {
+                status = vector_build_index(table);
+            }
+        }
+        VectorTable *vec_table = vector_get_table(table);
+        passed = status == EPIPHANYDB_SUCCESS && vec_table && vec_table->codes && !vec_table->hnsw &&
+                 vec_table->codes->trained && vec_table->codes->num_vectors == 1000 &&
+                 vec_table->codes->code_size == code_sizes[m];
+        
+        size_t found = 0;
+        for (int q = 0; q < 30 && passed; q++) {
+            float query[100];
+            for (int i = 0; i < 100; i++) {
+                seed = seed * 1103515245 + 12345;
+                query[i] = (float)((seed >> 8) % 10001) / 10000.0f - (q % 2 ? 0.3f : 0.7f) * (i % 3);
+            }
+            
+            float exact[10];
+            for (int j = 0; j < 10; j++) {
+                exact[j] = 1e30f;
+            }
+            for (int v = 0; v < 1000; v++) {
+                float distance = 1.0f - vector_cosine_similarity(data[v], query, 100);
+                for (int j = 0; j < 10; j++) {
+                    if (distance < exact[j]) {
+                        float displaced = exact[j];
+                        exact[j] = distance;
+                        distance = displaced;
+                    }
+                }
+            }
+            
+            void *results = NULL;
+            size_t num_results = 0;
+            status = vector_similarity_search(table, query, 100, 10, &results, &num_results);
+            VectorSearchResult *hits = results;
+            passed = status == EPIPHANYDB_SUCCESS && num_results == 10;
+            for (size_t j = 0; j < num_results && passed; j++) {
+                passed = hits[j].id < 1000 && (j == 0 || hits[j].distance >= hits[j - 1].distance);
+                found += hits[j].distance <= exact[9] + 1e-6f;
+            }
+            free(results);
+        }
+        passed = passed && found >= min_found[m];
+        vector_close_table(table);
+    }
+    
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Quantized Storage", passed, 
+                   passed ? NULL : "Quantized storage modes lose too much recall", 
+                   execution_time);
+}
+
+void test_vector_diskann_index(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_diskann", "id INTEGER, embedding VECTOR(48) METRIC euclidean DISKANN (DEGREE 24, BUILD_L 48, SEARCH_L 48, BEAMWIDTH 4, PQ_M 12)");
+    EpiphanyDBTable *table = NULL;
+    int status = vector_open_table(ctx, "test_vector_diskann", &table);
+    
+    /*
+     * Vectors mix 8 random directions, like embeddings of low intrinsic
+     * dimension. 2000 go to the index file and 20 more are inserted after
+     * the build; 30 queries are fresh mixes, 10 look up those insertions.
+     */
+    static float basis[8][48];
+    static float data[2070][48];
+    unsigned int seed = 17;
+    for (int b = 0; b < 8; b++) {
+        for (int i = 0; i < 48; i++) {
+            seed = seed * 1103515245 + 12345;
+            basis[b][i] = (float)((seed >> 8) % 2001) / 1000.0f - 1.0f;
+        }
+    }
+    for (int v = 0; v < 2070; v++) {
+        memset(data[v], 0, sizeof(data[v]));
+        for (int b = 0; b < 8; b++) {
+            seed = seed * 1103515245 + 12345;
+            float weight = (float)((seed >> 8) % 10001) / 10000.0f;
+            for (int i = 0; i < 48; i++) {
+                data[v][i] += weight * basis[b][i];
+            }
+        }
+    }
+    for (int v = 0; v < 2020 && status == EPIPHANYDB_SUCCESS; v++) {
+        status = vector_insert_vector(table, data[v], 48, NULL);
+        if (v == 1999 && status == EPIPHANYDB_SUCCESS) {
+            status = vector_build_index(table);
+        }
+    }
+    VectorTable *vec_table = vector_get_table(table);
+    bool passed = status == EPIPHANYDB_SUCCESS && vec_table && vec_table->diskann && !vec_table->hnsw &&
+                  vec_table->diskann->num_nodes == 2000;
     
-    bool passed = (result == EPIPHANYDB_SUCCESS);
+    /* Records of 48 floats and 25 ids fit 14 to a sector behind the header sector */
+    if (passed) {
+        FILE *file = fopen(vec_table->index_file, "rb");
+        passed = file && fseek(file, 0, SEEK_END) == 0 && ftell(file) == 4096L * (1 + (2000 + 13) / 14);
+        if (file) {
+            fclose(file);
+        }
+    }
+    
+    /* Only the PQ codes stay in memory, 6 bytes a vector against 192 for the floats */
+    passed = passed && vector_diskann_memory_usage(vec_table->diskann) < 2000 * 48 * sizeof(float) / 8;
+    
+    /* Recall@10 against exact neighbors; the vectors inserted last find themselves */
+    size_t found = 0;
+    for (int q = 0; q < 40 && passed; q++) {
+        const float *query = q < 30 ? data[2040 + q] : data[1980 + q];
+        
+        float exact[10];
+        for (int j = 0; j < 10; j++) {
+            exact[j] = 1e30f;
+        }
+        for (int v = 0; v < 2020; v++) {
+            float distance = vector_euclidean_distance(data[v], query, 48);
+            for (int j = 0; j < 10; j++) {
+                if (distance < exact[j]) {
+                    float displaced = exact[j];
+                    exact[j] = distance;
+                    distance = displaced;
+                }
+            }
+        }
+        
+        void *results = NULL;
+        size_t num_results = 0;
+        status = vector_similarity_search(table, query, 48, 10, &results, &num_results);
+        VectorSearchResult *hits = results;
+        passed = status == EPIPHANYDB_SUCCESS && num_results == 10 && (q < 30 || (hits[0].id == (uint64_t)(1980 + q) && hits[0].distance == 0.0f));
+        for (size_t j = 0; j < num_results && passed; j++) {
+            passed = hits[j].id < 2020 && (j == 0 || hits[j].distance >= hits[j - 1].distance);
+            found += q < 30 && vector_euclidean_distance(data[hits[j].id], query, 48) <= exact[9] * 1.0001f;
+        }
+        free(results);
+    }
+    passed = passed && found >= 270;
+    vector_close_table(table);
+    
+    /* Builds after deletes train and enter the graph on live vectors only */
+    vector_create_table(ctx, "test_vector_diskann_deleted", "id INTEGER, embedding VECTOR(48) METRIC euclidean DISKANN (DEGREE 24, PQ_M 12)");
+    status = passed ? vector_open_table(ctx, "test_vector_diskann_deleted", &table) : EPIPHANYDB_ERROR_UNKNOWN;
+    for (int v = 0; v < 1000 && status == EPIPHANYDB_SUCCESS; v++) {
+        status = vector_insert_vector(table, data[v], 48, NULL);
+    }
+    for (uint64_t id = 0; id < 900 && status == EPIPHANYDB_SUCCESS; id++) {
+        status = vector_delete_vector(table, &id);
+    }
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = vector_build_index(table);
+    }
+    vec_table = status == EPIPHANYDB_SUCCESS ? vector_get_table(table) : NULL;
+    passed = passed && vec_table && vec_table->diskann->medoid >= 900;
+    if (status == EPIPHANYDB_SUCCESS) {
+        void *results = NULL;
+        size_t num_results = 0;
+        status = vector_similarity_search(table, data[950], 48, 1, &results, &num_results);
+        passed = passed && status == EPIPHANYDB_SUCCESS && num_results == 1 && ((VectorSearchResult *)results)[0].id == 950;
+        free(results);
+        vector_close_table(table);
+    }
     
+    vector_storage_cleanup(ctx);
     epiphanydb_cleanup_context(ctx);
     
     clock_t end = clock();
     double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
     
-    test_add_result("Vector Table Creation", passed, 
-                   passed ? NULL : "Failed to create vector table", 
+    test_add_result("Vector DiskANN Index", passed, 
+                   passed ? NULL : "DiskANN search recall too low", 
+                   execution_time);
+}
+
+void test_vector_filtered_search(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_filtered", "id INTEGER, embedding VECTOR(16) METRIC euclidean HNSW (M 8, EF_SEARCH 40)");
+    EpiphanyDBTable *table = NULL;
+    int status = vector_open_table(ctx, "test_vector_filtered", &table);
+    
+    /* Ten tenants, two languages, every third vector tagged "b" */
+    static float data[3000][16];
+    unsigned int seed = 23;
+    for (int v = 0; v < 3000 && status == EPIPHANYDB_SUCCESS; v++) {
+        for (int i = 0; i < 16; i++) {
+            seed = seed * 1103515245 + 12345;
+            data[v][i] = (float)((seed >> 8) % 10001) / 10000.0f;
+        }
+        char metadata[96];
+        snprintf(metadata, sizeof(metadata), "{\"tenant\": \"t%d\", \"lang\": \"%s\", \"tags\": [\"a\"%s]}",
+                 v % 10, v % 2 ? "fr" : "en", v % 3 ? "" : ", \"b\"");
+        status = vector_insert_vector(table, data[v], 16, metadata);
+        if (v == 1499 && status == EPIPHANYDB_SUCCESS) {
+            status = vector_build_index(table);
+        }
+    }
+    bool passed = status == EPIPHANYDB_SUCCESS;
+    
+    /*
+     * A language matches half the table and goes through the graph, a
+     * tenant and language a tenth and is scanned; both must find the exact
+     * filtered neighbors, written as JSON or as key=value pairs.
+     */
+    static const char *const filters[] = {"lang=en", "{\"tenant\": \"t3\", \"lang\": \"fr\"}", "tags: b, lang = en"};
+    size_t found[3] = {0, 0, 0};
+    for (int q = 0; q < 60 && passed; q++) {
+        int f = q % 3;
+        float query[16];
+        for (int i = 0; i < 16; i++) {
+            seed = seed * 1103515245 + 12345;
+            query[i] = (float)((seed >> 8) % 10001) / 10000.0f;
+        }
+        
+        float exact[10];
+        for (int j = 0; j < 10; j++) {
+            exact[j] = 1e30f;
+        }
+        for (int v = 0; v < 3000; v++) {
+            bool match = f == 0 ? v % 2 == 0 : f == 1 ? v % 10 == 3 : v % 6 == 0;
+            float distance = match ? vector_euclidean_distance(data[v], query, 16) : 1e30f;
+            for (int j = 0; j < 10; j++) {
+                if (distance < exact[j]) {
+                    float displaced = exact[j];
+                    exact[j] = distance;
+                    distance = displaced;
+                }
+            }
+        }
+        
+        void *results = NULL;
+        size_t num_results = 0;
+        status = vector_similarity_search_filtered(table, query, 16, 10, filters[f], &results, &num_results);
+        VectorSearchResult *hits = results;
+        passed = status == EPIPHANYDB_SUCCESS && num_results == 10;
+        for (size_t j = 0; j < num_results && passed; j++) {
+            uint64_t id = hits[j].id;
+            passed = f == 0 ? id % 2 == 0 : f == 1 ? id % 10 == 3 : id % 6 == 0;
+            found[f] += hits[j].distance <= exact[9] * 1.0001f;
+        }
+        free(results);
+    }
+    passed = passed && found[0] >= 190 && found[1] == 200 && found[2] == 200;
+    
+    /* Terms no vector holds match nothing, filters without terms are rejected */
+    void *results = NULL;
+    size_t num_results = 1;
+    float query[16] = {0};
+    passed = passed && vector_similarity_search_filtered(table, query, 16, 10, "lang=de", &results, &num_results) == EPIPHANYDB_SUCCESS &&
+             num_results == 0 && results == NULL;
+    passed = passed && vector_similarity_search_filtered(table, query, 16, 10, " , ", &results, &num_results) == EPIPHANYDB_ERROR_INVALID_PARAM;
+    
+    vector_close_table(table);
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Filtered Search", passed, 
+                   passed ? NULL : "Filtered search returned wrong or missing vectors", 
+                   execution_time);
+}
+
+void test_vector_batch_search(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    
+    /* A batch must return what the queries return one at a time, exhaustively or through the graph */
+    static const char *const schemas[] = {"id INTEGER, embedding VECTOR(40) METRIC euclidean FLAT",
+                                          "id INTEGER, embedding VECTOR(40) METRIC cosine FLAT",
+                                          "id INTEGER, embedding VECTOR(40) METRIC cosine HNSW (M 8, EF_SEARCH 32)"};
+    static float data[1500][40];
+    static float queries[37][40];
+    unsigned int seed = 29;
+    for (int v = 0; v < 1500; v++) {
+        for (int i = 0; i < 40; i++) {
+            seed = seed * 1103515245 + 12345;
+            data[v][i] = (float)((seed >> 8) % 10001) / 10000.0f - 0.5f;
+        }
+    }
+    for (int q = 0; q < 37; q++) {
+        memcpy(queries[q], data[q * 40], sizeof(queries[q]));
+        queries[q][q % 40] += 0.25f;
+    }
+    
+    bool passed = true;
+    for (int t = 0; t < 3 && passed; t++) {
+        char name[64];
+        snprintf(name, sizeof(name), "test_vector_batch_%d", t);
+        vector_create_table(ctx, name, schemas[t]);
+        EpiphanyDBTable *table = NULL;
+        int status = vector_open_table(ctx, name, &table);
+        for (int v = 0; v < 1500 && status == EPIPHANYDB_SUCCESS; v++) {
+            status = vector_insert_vector(table, data[v], 40, NULL);
+        }
+        if (status == EPIPHANYDB_SUCCESS) {
+            status = vector_build_index(table);
+        }
+        
+        void *batch = NULL;
+        size_t counts[37];
+        status = status == EPIPHANYDB_SUCCESS ? vector_similarity_search_batch(table, &queries[0][0], 37, 40, 12, &batch, counts) : status;
+        passed = status == EPIPHANYDB_SUCCESS && batch != NULL;
+        for (int q = 0; q < 37 && passed; q++) {
+            void *results = NULL;
+            size_t num_results = 0;
+            status = vector_similarity_search(table, queries[q], 40, 12, &results, &num_results);
+            VectorSearchResult *single = results;
+            VectorSearchResult *row = (VectorSearchResult *)batch + q * 12;
+            passed = status == EPIPHANYDB_SUCCESS && counts[q] == 12 && num_results == 12 && row[0].id == (uint64_t)(q * 40);
+            for (size_t j = 0; j < num_results && passed; j++) {
+                passed = row[j].id == single[j].id && row[j].distance - single[j].distance < 1e-5f && single[j].distance - row[j].distance < 1e-5f;
+            }
+            free(results);
+        }
+        free(batch);
+        vector_close_table(table);
+    }
+    
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Batch Search", passed, 
+                   passed ? NULL : "Batched search differs from single queries", 
+                   execution_time);
+}
+
+/* Writer and reader threads of test_vector_concurrent_inserts */
+typedef struct ConcurrentVectorWorker {
+    EpiphanyDBTable *table;
+    const float (*data)[24];
+    int first;
+    int count;
+    int status;
+    bool ordered;
+} ConcurrentVectorWorker;
+
+static void *concurrent_vector_writer(void *arg) {
+    ConcurrentVectorWorker *worker = arg;
+    for (int v = worker->first; v < worker->first + worker->count && worker->status == EPIPHANYDB_SUCCESS; v++) {
+        worker->status = vector_insert_vector(worker->table, worker->data[v], 24, NULL);
+    }
+    return NULL;
+}
+
+static void *concurrent_vector_reader(void *arg) {
+    ConcurrentVectorWorker *worker = arg;
+    for (int q = 0; q < worker->count && worker->status == EPIPHANYDB_SUCCESS; q++) {
+        void *results = NULL;
+        size_t num_results = 0;
+        worker->status = vector_similarity_search(worker->table, worker->data[worker->first + q * 7 % 2000], 24, 10,
+                                                  &results, &num_results);
+        VectorSearchResult *hits = results;
+        for (size_t j = 1; j < num_results; j++) {
+            worker->ordered = worker->ordered && hits[j].distance >= hits[j - 1].distance;
+        }
+        free(results);
+    }
+    return NULL;
+}
+
+void test_vector_concurrent_inserts(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_concurrent", "id INTEGER, embedding VECTOR(24) METRIC euclidean HNSW (M 8, EF_CONSTRUCTION 64, EF_SEARCH 48, BUILD_THREADS 4)");
+    EpiphanyDBTable *table = NULL;
+    int status = vector_open_table(ctx, "test_vector_concurrent", &table);
+    
+    /* Half the vectors go through a four-thread build, four writers insert the rest while two readers search */
+    static float data[4000][24];
+    unsigned int seed = 31;
+    for (int v = 0; v < 4000; v++) {
+        for (int i = 0; i < 24; i++) {
+            seed = seed * 1103515245 + 12345;
+            data[v][i] = (float)((seed >> 8) % 10001) / 10000.0f;
+        }
+    }
+    for (int v = 0; v < 2000 && status == EPIPHANYDB_SUCCESS; v++) {
+        status = vector_insert_vector(table, data[v], 24, NULL);
+    }
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = vector_build_index(table);
+    }
+    
+    ConcurrentVectorWorker workers[6];
+    pthread_t threads[6];
+    int started = 0;
+    for (int w = 0; w < 6 && status == EPIPHANYDB_SUCCESS; w++) {
+        bool writer = w < 4;
+        ConcurrentVectorWorker worker = {table, (const float (*)[24])data, writer ? 2000 + w * 500 : 0, writer ? 500 : 300,
+                                         EPIPHANYDB_SUCCESS, true};
+        workers[w] = worker;
+        if (pthread_create(&threads[w], NULL, writer ? concurrent_vector_writer : concurrent_vector_reader, &workers[w]) != 0) {
+            status = EPIPHANYDB_ERROR_STORAGE;
+            break;
+        }
+        started++;
+    }
+    for (int w = 0; w < started; w++) {
+        pthread_join(threads[w], NULL);
+        if (status == EPIPHANYDB_SUCCESS) {
+            status = workers[w].status;
+        }
+    }
+    VectorTable *vec_table = vector_get_table(table);
+    bool passed = status == EPIPHANYDB_SUCCESS && workers[4].ordered && workers[5].ordered && vec_table &&
+                  vec_table->num_vectors == 4000 && vec_table->hnsw && vec_table->hnsw->num_nodes == 4000;
+    
+    /* Every concurrently inserted vector must be reachable through the graph */
+    size_t found = 0;
+    for (int v = 2000; v < 4000 && passed; v += 5) {
+        void *results = NULL;
+        size_t num_results = 0;
+        status = vector_similarity_search(table, data[v], 24, 1, &results, &num_results);
+        VectorSearchResult *hits = results;
+        passed = status == EPIPHANYDB_SUCCESS && num_results == 1;
+        found += passed && hits[0].distance < 1e-4f;
+        free(results);
+    }
+    passed = passed && found >= 392;
+    
+    vector_close_table(table);
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Concurrent Inserts", passed, 
+                   passed ? NULL : "Concurrently inserted vectors missing from the HNSW graph", 
+                   execution_time);
+}
+
+void test_vector_deletes(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_deletes", "id INTEGER, embedding VECTOR(16) METRIC euclidean HNSW (M 8, EF_CONSTRUCTION 64, EF_SEARCH 64)");
+    EpiphanyDBTable *table = NULL;
+    int status = vector_open_table(ctx, "test_vector_deletes", &table);
+    
+    static float data[3000][16];
+    unsigned int seed = 37;
+    for (int v = 0; v < 3000 && status == EPIPHANYDB_SUCCESS; v++) {
+        for (int i = 0; i < 16; i++) {
+            seed = seed * 1103515245 + 12345;
+            data[v][i] = (float)((seed >> 8) % 10001) / 10000.0f;
+        }
+        status = vector_insert_vector(table, data[v], 16, NULL);
+    }
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = vector_build_index(table);
+    }
+    VectorTable *vec_table = vector_get_table(table);
+    
+    /* A tenth of the vectors is deleted, vector 1 moves to a new place and a new id */
+    for (uint64_t id = 0; id < 3000 && status == EPIPHANYDB_SUCCESS; id += 10) {
+        status = vector_delete_vector(table, &id);
+    }
+    uint64_t missing = 3000;
+    uint64_t deleted = 20;
+    uint64_t moved = 1;
+    float replacement[16] = {2.0f, 2.0f, 2.0f, 2.0f};
+    bool passed = status == EPIPHANYDB_SUCCESS && vector_delete_vector(table, &deleted) == EPIPHANYDB_ERROR_NOT_FOUND &&
+                  vector_delete_vector(table, &missing) == EPIPHANYDB_ERROR_NOT_FOUND &&
+                  vector_update_vector(table, &moved, replacement, 16, NULL) == EPIPHANYDB_SUCCESS &&
+                  vec_table->num_vectors == 3001 && vec_table->num_deleted == 301;
+    
+    /* Searches skip tombstones before and after the repair, which leaves live nodes no deleted neighbor */
+    uint64_t generation = vec_table->index_generation;
+    for (int round = 0; round < 2 && passed; round++) {
+        if (round == 1) {
+            passed = vector_rebuild_index(table) == EPIPHANYDB_SUCCESS && vec_table->index_generation == generation;
+            for (size_t id = 0; id < vec_table->hnsw->num_nodes && passed; id++) {
+                const uint32_t *links = vec_table->hnsw->level0 + id * (1 + vec_table->hnsw->m0);
+                for (uint32_t i = 1; i <= links[0] && vector_filter_test(vec_table->live, id); i++) {
+                    passed = passed && vector_filter_test(vec_table->live, links[i]);
+                }
+            }
+        }
+        size_t found = 0;
+        for (int v = 0; v < 3000 && passed; v += 7) {
+            void *results = NULL;
+            size_t num_results = 0;
+            status = vector_similarity_search(table, data[v], 16, 5, &results, &num_results);
+            VectorSearchResult *hits = results;
+            passed = status == EPIPHANYDB_SUCCESS && num_results == 5;
+            for (size_t j = 0; j < num_results && passed; j++) {
+                passed = hits[j].id % 10 != 0 && hits[j].id != 1;
+            }
+            found += passed && v % 10 != 0 && v != 1 && hits[0].id == (uint64_t)v;
+            free(results);
+        }
+        passed = passed && found >= 360;
+        
+        void *results = NULL;
+        size_t num_results = 0;
+        status = vector_similarity_search(table, replacement, 16, 1, &results, &num_results);
+        passed = passed && status == EPIPHANYDB_SUCCESS && num_results == 1 && ((VectorSearchResult *)results)[0].id == 3000;
+        free(results);
+    }
+    
+    /* Past a fifth of deleted vectors the graph is rebuilt over the live ones */
+    for (uint64_t id = 5; id < 3000 && passed; id += 10) {
+        passed = vector_delete_vector(table, &id) == EPIPHANYDB_SUCCESS;
+    }
+    passed = passed && vector_rebuild_index(table) == EPIPHANYDB_SUCCESS && vec_table->index_generation == generation + 1;
+    
+    void *batch = NULL;
+    size_t counts[2];
+    float queries[2][16];
+    memcpy(queries[0], data[10], sizeof(queries[0]));
+    memcpy(queries[1], data[12], sizeof(queries[1]));
+    status = vector_similarity_search_batch(table, &queries[0][0], 2, 16, 10, &batch, counts);
+    passed = passed && status == EPIPHANYDB_SUCCESS && counts[0] == 10 && counts[1] == 10 &&
+             ((VectorSearchResult *)batch)[10].id == 12;
+    for (size_t j = 0; j < 20 && passed; j++) {
+        passed = ((VectorSearchResult *)batch)[j].id % 5 != 0;
+    }
+    free(batch);
+    
+    /* Only deletes since that build count towards the next one */
+    for (uint64_t id = 2; id < 600 && passed; id += 10) {
+        passed = vector_delete_vector(table, &id) == EPIPHANYDB_SUCCESS;
+    }
+    passed = passed && vector_rebuild_index(table) == EPIPHANYDB_SUCCESS && vec_table->index_generation == generation + 1;
+    
+    vector_close_table(table);
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Deletes", passed, 
+                   passed ? NULL : "Deleted vectors returned or graph not repaired", 
+                   execution_time);
+}
+
+void test_vector_arena_file(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_arena", "id INTEGER, embedding VECTOR(20) METRIC euclidean FULLTEXT (body)");
+    EpiphanyDBTable *table = NULL;
+    int status = vector_open_table(ctx, "test_vector_arena", &table);
+    
+    /* Past the initial capacity, so the file grows twice; every seventh vector has metadata */
+    static float data[3000][20];
+    unsigned int seed = 41;
+    for (int v = 0; v < 3000 && status == EPIPHANYDB_SUCCESS; v++) {
+        for (int i = 0; i < 20; i++) {
+            seed = seed * 1103515245 + 12345;
+            data[v][i] = (float)((seed >> 8) % 10001) / 10000.0f;
+        }
+        char metadata[64];
+        snprintf(metadata, sizeof(metadata), "{\"group\": \"seven\", \"body\": \"word%d\"}", v);
+        status = vector_insert_vector(table, data[v], 20, v % 7 == 0 ? metadata : NULL);
+    }
+    for (uint64_t id = 3; id < 3000 && status == EPIPHANYDB_SUCCESS; id += 100) {
+        status = vector_delete_vector(table, &id);
+    }
+    
+    /* An insert whose metadata cannot be logged leaves no vector behind */
+    VectorTable *vec_table = vector_get_table(table);
+    int metadata_fd = vec_table->metadata_fd;
+    vec_table->metadata_fd = -1;
+    bool rejected = vector_insert_vector(table, data[0], 20, "{\"group\": \"lost\"}") == EPIPHANYDB_ERROR_IO;
+    vec_table->metadata_fd = metadata_fd;
+    bool passed = status == EPIPHANYDB_SUCCESS && rejected && vec_table->arena != NULL && vec_table->num_vectors == 3000 &&
+                  !vector_filter_test(vec_table->live, 3000);
+    for (size_t id = 0; id < 3000 && passed; id++) {
+        passed = ((uintptr_t)vector_at(vec_table, id)) % VECTOR_ALIGNMENT == 0;
+    }
+    float norm = passed ? vec_table->norms[2999] : 0.0f;
+    vector_close_table(table);
+    vector_storage_cleanup(ctx);
+    
+    /* A fresh engine maps the file: same vectors, norms and deletes, and inserts go on */
+    vector_storage_init(ctx);
+    status = vector_open_table(ctx, "test_vector_arena", &table);
+    vec_table = status == EPIPHANYDB_SUCCESS ? vector_get_table(table) : NULL;
+    passed = passed && vec_table && vec_table->num_vectors == 3000 && vec_table->num_deleted == 30 &&
+             vec_table->norms[2999] == norm;
+    for (size_t id = 0; id < 3000 && passed; id++) {
+        passed = memcmp(vector_at(vec_table, id), data[id], sizeof(data[id])) == 0 &&
+                 vector_filter_test(vec_table->live, id) == (id % 100 != 3);
+    }
+    for (int v = 3; v < 3000 && passed; v += 50) {
+        void *results = NULL;
+        size_t num_results = 0;
+        status = vector_similarity_search(table, data[v], 20, 1, &results, &num_results);
+        uint64_t hit = status == EPIPHANYDB_SUCCESS && num_results == 1 ? ((VectorSearchResult *)results)[0].id : UINT64_MAX;
+        passed = hit != UINT64_MAX && (v % 100 == 3 ? hit != (uint64_t)v : hit == (uint64_t)v);
+        free(results);
+    }
+    
+    /* Metadata comes back from its log, filter and text indexes included, without the deleted vectors */
+    void *results = NULL;
+    size_t num_results = 0;
+    size_t sevens = 0;
+    for (int v = 0; v < 3000; v += 7) {
+        sevens += v % 100 != 3;
+    }
+    passed = passed && vec_table->metadata[14] && strcmp(vec_table->metadata[14], "{\"group\": \"seven\", \"body\": \"word14\"}") == 0 &&
+             vec_table->metadata[203] == NULL &&
+             vector_similarity_search_filtered(table, data[0], 20, 3000, "group=seven", &results, &num_results) == EPIPHANYDB_SUCCESS &&
+             num_results == sevens && ((VectorSearchResult *)results)[0].id == 0;
+    free(results);
+    results = NULL;
+    passed = passed && vector_similarity_search_hybrid(table, data[0], 20, "word14", 1, VECTOR_FUSION_RRF, 0.0f, &results, &num_results) == EPIPHANYDB_SUCCESS &&
+             num_results == 1 && ((VectorHybridResult *)results)[0].id == 14;
+    free(results);
+    for (int v = 0; v < 2000 && passed; v++) {
+        passed = vector_insert_vector(table, data[v], 20, NULL) == EPIPHANYDB_SUCCESS;
+    }
+    passed = passed && vec_table->num_vectors == 5000 && vec_table->capacity >= 5000 &&
+             memcmp(vector_at(vec_table, 4999), data[1999], sizeof(data[1999])) == 0 &&
+             vector_filter_test(vec_table->live, 4999) && !vector_filter_test(vec_table->live, 103) &&
+             vec_table->metadata[3000] == NULL;
+    
+    vector_close_table(table);
+    vector_storage_cleanup(ctx);
+    
+    /* Quantized tables reopen with float16 codes encoded again and int8 ones rebuilt */
+    static const char *const modes[] = {"float16", "int8"};
+    for (int m = 0; m < 2 && passed; m++) {
+        char name[64];
+        char schema[128];
+        snprintf(name, sizeof(name), "test_vector_arena_%s", modes[m]);
+        snprintf(schema, sizeof(schema), "id INTEGER, embedding VECTOR(20) METRIC euclidean FLAT STORAGE %s", modes[m]);
+        vector_storage_init(ctx);
+        vector_create_table(ctx, name, schema);
+        table = NULL;
+        status = vector_open_table(ctx, name, &table);
+        for (int v = 0; v < 100 && status == EPIPHANYDB_SUCCESS; v++) {
+            status = vector_insert_vector(table, data[v], 20, NULL);
+        }
+        if (status == EPIPHANYDB_SUCCESS) {
+            status = vector_build_index(table);
+        }
+        vector_close_table(table);
+        vector_storage_cleanup(ctx);
+        
+        vector_storage_init(ctx);
+        table = NULL;
+        if (status == EPIPHANYDB_SUCCESS) {
+            status = vector_open_table(ctx, name, &table);
+        }
+        for (int v = 100; v < 200 && status == EPIPHANYDB_SUCCESS; v++) {
+            status = vector_insert_vector(table, data[v], 20, NULL);
+        }
+        if (status == EPIPHANYDB_SUCCESS && m == 1) {
+            status = vector_build_index(table);
+        }
+        vec_table = status == EPIPHANYDB_SUCCESS ? vector_get_table(table) : NULL;
+        passed = vec_table && vec_table->codes->trained && vec_table->codes->num_vectors == 200;
+        for (int v = 0; v < 200 && passed; v += 7) {
+            void *results = NULL;
+            size_t num_results = 0;
+            status = vector_similarity_search(table, data[v], 20, 1, &results, &num_results);
+            passed = status == EPIPHANYDB_SUCCESS && num_results == 1 && ((VectorSearchResult *)results)[0].id == (uint64_t)v;
+            free(results);
+        }
+        vector_close_table(table);
+        vector_storage_cleanup(ctx);
+    }
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Arena File", passed, 
+                   passed ? NULL : "Vectors not restored from the arena file", 
+                   execution_time);
+}
+
+void test_vector_exact_search(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_exact", "id INTEGER, embedding VECTOR(64) METRIC euclidean");
+    EpiphanyDBTable *table = NULL;
+    int status = vector_open_table(ctx, "test_vector_exact", &table);
+    
+    /* 10 MB of vectors, enough for two scanning threads; small integer coordinates tie often */
+    float vector[64];
+    unsigned int seed = 43;
+    for (int v = 0; v < 40000 && status == EPIPHANYDB_SUCCESS; v++) {
+        for (int i = 0; i < 64; i++) {
+            seed = seed * 1103515245 + 12345;
+            vector[i] = (float)(seed >> 29);
+        }
+        status = vector_insert_vector(table, vector, 64, NULL);
+    }
+    for (uint64_t id = 0; id < 40000 && status == EPIPHANYDB_SUCCESS; id += 7) {
+        status = vector_delete_vector(table, &id);
+    }
+    VectorTable *vec_table = vector_get_table(table);
+    bool passed = status == EPIPHANYDB_SUCCESS;
+    
+    /* Threaded scans merge to the distances of a single scan; tied ids may differ */
+    for (int q = 0; q < 10 && passed; q++) {
+        VectorSearchResult single[50], threaded[50];
+        size_t num_single = 0, num_threaded = 0;
+        void *results = NULL;
+        size_t num_results = 0;
+        memcpy(vector, vector_at(vec_table, (size_t)q * 3003 + 1), sizeof(vector));
+        passed = vector_exact_search(vec_table, vector, 50, vec_table->live, 1, single, &num_single) == EPIPHANYDB_SUCCESS &&
+                 vector_exact_search(vec_table, vector, 50, vec_table->live, 4, threaded, &num_threaded) == EPIPHANYDB_SUCCESS &&
+                 vector_similarity_search_exact(table, vector, 64, 50, &results, &num_results) == EPIPHANYDB_SUCCESS &&
+                 num_single == 50 && num_threaded == 50 && num_results == 50 && single[0].id == (uint64_t)q * 3003 + 1 &&
+                 single[0].distance == 0.0f;
+        for (size_t i = 0; i < 50 && passed; i++) {
+            passed = single[i].distance == threaded[i].distance &&
+                     single[i].distance == ((VectorSearchResult *)results)[i].distance && single[i].id % 7 != 0 &&
+                     threaded[i].id % 7 != 0 && (i == 0 || single[i - 1].distance <= single[i].distance);
+        }
+        free(results);
+    }
+    
+    vector_close_table(table);
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Exact Search", passed, 
+                   passed ? NULL : "Threaded exact search differs from a single scan", 
+                   execution_time);
+}
+
+void test_vector_hybrid_search(void) {
+    clock_t start = clock();
+    
+    EpiphanyDBContext *ctx = NULL;
+    epiphanydb_init_context(&ctx);
+    vector_storage_init(ctx);
+    vector_create_table(ctx, "test_vector_hybrid", "id INTEGER, embedding VECTOR(8) METRIC euclidean FULLTEXT (body)");
+    vector_create_table(ctx, "test_vector_hybrid_plain", "id INTEGER, embedding VECTOR(8) METRIC euclidean");
+    EpiphanyDBTable *table = NULL;
+    EpiphanyDBTable *plain = NULL;
+    int status = vector_open_table(ctx, "test_vector_hybrid", &table);
+    if (status == EPIPHANYDB_SUCCESS) {
+        status = vector_open_table(ctx, "test_vector_hybrid_plain", &plain);
+    }
+    
+    /* Vector i lies at distance |i - q| from vector q; 12, 150 and 151 are the rare ones, 190 the zebra */
+    for (int v = 0; v < 200 && status == EPIPHANYDB_SUCCESS; v++) {
+        float vector[8] = {(float)v};
+        char metadata[96];
+        const char *words = v == 12 || v == 150 || v == 151 ? "rare" : "common";
+        if (v == 190) {
+            snprintf(metadata, sizeof(metadata), "{\"body\": \"Zebra zebra ZEBRA\", \"tenant\": \"acme\"}");
+        } else if (v == 191) {
+            snprintf(metadata, sizeof(metadata), "{\"body\": \"zebra doc%d common\", \"tenant\": \"acme\"}", v);
+        } else {
+            snprintf(metadata, sizeof(metadata), "{\"body\": \"doc%d %s\", \"tenant\": \"acme\"}", v, words);
+        }
+        status = vector_insert_vector(table, vector, 8, metadata);
+    }
+    
+    float query[8] = {10.0f};
+    bool passed = status == EPIPHANYDB_SUCCESS;
+    
+    /* 12 is both near and rare, so both fusions put it ahead of the nearest and the rarest */
+    for (int fusion = VECTOR_FUSION_RRF; fusion <= VECTOR_FUSION_WEIGHTED && passed; fusion++) {
+        void *results = NULL;
+        size_t num_results = 0;
+        status = vector_similarity_search_hybrid(table, query, 8, "rare", 5, (VectorFusion)fusion, 0.5f, &results, &num_results);
+        VectorHybridResult *hits = results;
+        bool near = false, rare = false;
+        for (size_t i = 0; status == EPIPHANYDB_SUCCESS && i < num_results; i++) {
+            near = near || (hits[i].id == 10 && hits[i].distance == 0.0f);
+            rare = rare || (hits[i].id == 150 && hits[i].distance == INFINITY && hits[i].text_score > 0.0f);
+        }
+        passed = status == EPIPHANYDB_SUCCESS && num_results == 5 && hits[0].id == 12 && hits[0].text_score > 0.0f &&
+                 hits[0].distance == 2.0f && near && rare;
+        free(results);
+    }
+    
+    /* All weight on the vectors follows the vector ranking */
+    void *results = NULL;
+    void *expected = NULL;
+    size_t num_results = 0, num_expected = 0;
+    passed = passed && vector_similarity_search_hybrid(table, query, 8, "rare", 5, VECTOR_FUSION_RRF, 1.0f, &results, &num_results) == EPIPHANYDB_SUCCESS &&
+             vector_similarity_search(table, query, 8, 5, &expected, &num_expected) == EPIPHANYDB_SUCCESS &&
+             num_results == 5 && num_expected == 5;
+    for (size_t i = 0; i < 5 && passed; i++) {
+        passed = ((VectorHybridResult *)results)[i].id == ((VectorSearchResult *)expected)[i].id;
+    }
+    free(results);
+    free(expected);
+    
+    /* All weight on the text: BM25 counts repeats case-insensitively, other keys are not indexed */
+    results = NULL;
+    passed = passed && vector_similarity_search_hybrid(table, query, 8, "ZEBRA", 3, VECTOR_FUSION_RRF, 0.0f, &results, &num_results) == EPIPHANYDB_SUCCESS &&
+             num_results == 3 && ((VectorHybridResult *)results)[0].id == 190 && ((VectorHybridResult *)results)[1].id == 191 &&
+             ((VectorHybridResult *)results)[0].text_score > ((VectorHybridResult *)results)[1].text_score;
+    free(results);
+    uint64_t deleted = 151;
+    results = NULL;
+    passed = passed && vector_delete_vector(table, &deleted) == EPIPHANYDB_SUCCESS &&
+             vector_similarity_search_hybrid(table, query, 8, "rare acme", 3, VECTOR_FUSION_RRF, 0.0f, &results, &num_results) == EPIPHANYDB_SUCCESS &&
+             num_results == 3 && ((VectorHybridResult *)results)[0].id == 12 && ((VectorHybridResult *)results)[1].id == 150 &&
+             ((VectorHybridResult *)results)[2].text_score == 0.0f;
+    free(results);
+    
+    /* Tables without FULLTEXT have no text side */
+    results = NULL;
+    passed = passed && vector_similarity_search_hybrid(plain, query, 8, "rare", 5, VECTOR_FUSION_RRF, 0.5f, &results, &num_results) == EPIPHANYDB_ERROR_INDEX;
+    
+    vector_close_table(table);
+    vector_close_table(plain);
+    vector_storage_cleanup(ctx);
+    epiphanydb_cleanup_context(ctx);
+    
+    clock_t end = clock();
+    double execution_time = ((double)(end - start)) / CLOCKS_PER_SEC * 1000.0;
+    
+    test_add_result("Vector Hybrid Search", passed, 
+                   passed ? NULL : "Hybrid ranking does not fuse vector and text results", 
                    execution_time);
 }
 
@@ -297,7 +2375,31 @@ int main(void) {
     /* Run storage engine specific tests */
     test_heap_table_creation();
     test_columnar_table_creation();
+    test_columnar_vectorized_aggregation();
+    test_columnar_delta_store();
+    test_columnar_delete_bitmaps();
+    test_columnar_compression();
+    test_columnar_parallel_scan();
+    test_columnar_bloom_filters();
+    test_columnar_clustering();
+    test_columnar_compiled_conditions();
+    test_columnar_statistics();
+    test_columnar_projection();
+    test_columnar_join_filters();
+    test_columnar_scan_cache();
     test_vector_table_creation();
+    test_vector_distance_kernels();
+    test_vector_hnsw_index();
+    test_vector_ivfpq_index();
+    test_vector_quantized_storage();
+    test_vector_diskann_index();
+    test_vector_filtered_search();
+    test_vector_batch_search();
+    test_vector_concurrent_inserts();
+    test_vector_deletes();
+    test_vector_arena_file();
+    test_vector_exact_search();
+    test_vector_hybrid_search();
     test_timeseries_table_creation();
     test_graph_table_creation();
     